@@ -101,13 +101,31 @@ svn_delta__delta_from_editor(const svn_delta_editor_t **deditor,
                              struct svn_delta__extra_baton *exb,
                              apr_pool_t *pool);
 
-/** Read the txdelta window header from @a stream and return the total
-    length of the unparsed window data in @a *window_len. */
+/** Read the txdelta window header of svndiff version @a svndiff_version
+    from @a stream and return the total length of the unparsed window data
+    in @a *window_len. */
 svn_error_t *
 svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
+                                 int svndiff_version,
                                  apr_pool_t *pool);
 
+/** Return the size of the largest delta window that svndiff version
+ * @a svndiff_version can carry. */
+apr_size_t
+svn_txdelta__max_window_size(int svndiff_version);
+
+/** Like svn_txdelta_target_push() but produce delta windows covering up
+ * to @a window_size bytes of target and source data each.  The windows
+ * must only be encoded in svndiff versions whose
+ * svn_txdelta__max_window_size() is at least @a window_size. */
+svn_stream_t *
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         apr_size_t window_size,
+                         apr_pool_t *pool);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
@@ -353,6 +353,44 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                       apr_array_header_t *entries,
                       apr_pool_t *scratch_pool);
 
+/* Re-encode the delta representations in all packed shards of FS using
+ * COMPRESSION, given in the syntax of the "compression" option in
+ * fsfs.conf.  The deltas themselves and their bases remain unchanged and
+ * only representations that actually get smaller will be replaced.
+ * Each pack file is replaced atomically under the pack lock.
+ *
+ * Before and after processing a shard, call NOTIFY_FUNC with NOTIFY_BATON
+ * unless it is NULL.  If not NULL, call CANCEL_FUNC with CANCEL_BATON
+ * from time to time.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * Note that data cached for the rewritten shards becomes stale, i.e. FS
+ * and any other instance of the same repository using the same cache
+ * must not be used after this call.
+ */
+svn_error_t *
+svn_fs_fs__recompress(svn_fs_t *fs,
+                      const char *compression,
+                      svn_fs_pack_notify_t notify_func,
+                      void *notify_baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool);
+
+/* Move all locks of FS from the per-path digest files into a single
+ * lock database, which allows listing the locks of a sub-tree by a single
+ * range scan.  Expired locks will be dropped.  This is a no-op if FS
+ * already uses a lock database.  The migration runs under the write lock
+ * and is only available for FSFS format 9 repositories.
+ *
+ * If not NULL, call CANCEL_FUNC with CANCEL_BATON from time to time.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__migrate_locks(svn_fs_t *fs,
+                         svn_cancel_func_t cancel_func,
+                         void *cancel_baton,
+                         apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -85,6 +85,33 @@ svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
 
+/** Create @a to_path as a hard link to the existing file @a from_path.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_link(const char *from_path,
+                  const char *to_path,
+                  apr_pool_t *scratch_pool);
+
+/** Try to replace the contents of @a dst_file with a copy-on-write clone
+ * ("reflink") of @a src_file, so that both share their data blocks on disk
+ * until either one is modified.  Set @a *cloned to TRUE on success.
+ *
+ * If the platform or the file system can't do this, e.g. because the
+ * files live on different file systems, set @a *cloned to FALSE and leave
+ * @a dst_file unchanged; the caller should then copy the data itself.
+ *
+ * @a dst_file must be open for writing.  Use @a scratch_pool for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_io__file_clone(svn_boolean_t *cloned,
+                   apr_file_t *dst_file,
+                   apr_file_t *src_file,
+                   apr_pool_t *scratch_pool);
+
+
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
  */
@@ -287,6 +287,81 @@ svn_rangelist__merge_many(svn_rangelist_t *merged_rangelist,
                           apr_pool_t *result_pool,
                           apr_pool_t *scratch_pool);
 
+/* A rangelist stored as parallel arrays rather than as an array of
+   pointers to individually allocated svn_merge_range_t.  Range I covers
+   the revisions START[I]+1 through END[I] and is inheritable iff
+   INHERITABLE[I] is TRUE.
+
+   Ranges are always forward, sorted and non-overlapping, i.e. the
+   compact rangelist corresponds to a canonical svn_rangelist_t (see
+   svn_rangelist__is_canonical).  All set operations below run in a
+   single linear pass over their inputs. */
+typedef struct svn_rangelist__compact_t
+{
+  /* Number of ranges. */
+  int nelts;
+
+  /* Number of ranges the arrays below have room for. */
+  int nalloc;
+
+  svn_revnum_t *start;
+  svn_revnum_t *end;
+  svn_boolean_t *inheritable;
+
+  /* The arrays get (re-)allocated in this pool. */
+  apr_pool_t *pool;
+} svn_rangelist__compact_t;
+
+/* Return a new, empty compact rangelist with room for NALLOC ranges,
+   allocated in RESULT_POOL. */
+svn_rangelist__compact_t *
+svn_rangelist__compact_create(int nalloc,
+                              apr_pool_t *result_pool);
+
+/* Set *COMPACT to a compact copy of RANGELIST, allocated in RESULT_POOL.
+   If RANGELIST is not canonical, canonicalize a copy of it first; return
+   SVN_ERR_MERGEINFO_PARSE_ERROR if that fails.  Use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_rangelist__compact_from_rangelist(svn_rangelist__compact_t **compact,
+                                      const svn_rangelist_t *rangelist,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool);
+
+/* Return COMPACT as a canonical svn_rangelist_t, allocated in RESULT_POOL.
+   All svn_merge_range_t elements share a single allocation. */
+svn_rangelist_t *
+svn_rangelist__compact_to_rangelist(const svn_rangelist__compact_t *compact,
+                                    apr_pool_t *result_pool);
+
+/* Set *OUTPUT to the union of RANGELIST1 and RANGELIST2, allocated in
+   RESULT_POOL.  As with svn_rangelist_merge2(), a revision is inheritable
+   in *OUTPUT if it is inheritable in either input, and adjacent ranges
+   are combined only if their inheritability is the same. */
+void
+svn_rangelist__compact_merge(svn_rangelist__compact_t **output,
+                             const svn_rangelist__compact_t *rangelist1,
+                             const svn_rangelist__compact_t *rangelist2,
+                             apr_pool_t *result_pool);
+
+/* Set *OUTPUT to the intersection of RANGELIST1 and RANGELIST2, allocated
+   in RESULT_POOL.  This is the equivalent of svn_rangelist_intersect()
+   with CONSIDER_INHERITANCE set to FALSE. */
+void
+svn_rangelist__compact_intersect(svn_rangelist__compact_t **output,
+                                 const svn_rangelist__compact_t *rangelist1,
+                                 const svn_rangelist__compact_t *rangelist2,
+                                 apr_pool_t *result_pool);
+
+/* Set *OUTPUT to WHITEBOARD without the revisions in ERASER, allocated in
+   RESULT_POOL.  This is the equivalent of svn_rangelist_remove() with
+   CONSIDER_INHERITANCE set to FALSE. */
+void
+svn_rangelist__compact_remove(svn_rangelist__compact_t **output,
+                              const svn_rangelist__compact_t *eraser,
+                              const svn_rangelist__compact_t *whiteboard,
+                              apr_pool_t *result_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
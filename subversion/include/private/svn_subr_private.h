@@ -591,6 +591,18 @@ svn__decompress_lz4(const void *data, apr_size_t len,
                     svn_stringbuf_t *out,
                     apr_size_t limit);
 
+/* Like svn_stream_compressed(), but use LZ4 compression: return a stream
+ * that compresses all data written to it and writes the result to STREAM,
+ * and that decompresses the data read from STREAM.
+ *
+ * The data is split into blocks of 64 kB.  Each of them is stored as its
+ * size followed by the output of svn__compress_lz4(), so large texts can
+ * be processed in constant memory.  Allocate the stream in POOL.
+ */
+svn_stream_t *
+svn__stream_compressed_lz4(svn_stream_t *stream,
+                           apr_pool_t *pool);
+
 /** @} */
 
 /**
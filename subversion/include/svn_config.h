@@ -171,6 +171,12 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_SQLITE_EXCLUSIVE_CLIENTS  "exclusive-locking-clients"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SQLITE_BUSY_TIMEOUT       "busy-timeout"
+/** @since New in 1.11. */
+#define SVN_CONFIG_OPTION_INSTALL_THREADS           "install-threads"
+/** @since New in 1.11. */
+#define SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE     "shared-pristine-store"
+/** @since New in 1.11. */
+#define SVN_CONFIG_OPTION_COMPRESS_PRISTINES        "compress-pristines"
 /** @} */
 
 /** @name Repository conf directory configuration files strings
@@ -142,6 +142,25 @@ extern "C" {
  * @since New in 1.7.  */
 #define SVN_DAV_REV_ROOT_STUB_HEADER "SVN-Rev-Root-Stub"
 
+/** This header provides an opaque URI that the client can append the
+ * hex SHA-1 checksum of a file text to, in order to construct a URI
+ * that identifies just that text.  GET requests for such URIs must
+ * carry the @c SVN_DAV_CONTENT_LOCATOR_HEADER.  Responses are marked
+ * as publicly cacheable forever, so that caching proxies can serve
+ * identical texts from any path and revision from a single cache
+ * entry.  Only sent if the server has been configured to support
+ * these URIs.  (HTTP protocol v2 only)
+ * @since New in 1.11.  */
+#define SVN_DAV_SHA1_STUB_HEADER "SVN-Sha1-Stub"
+
+/** This header tells the server where to find the file text requested
+ * through a URI built from @c SVN_DAV_SHA1_STUB_HEADER.  Its value is
+ * of the form REVISION/PATH, like the part of a revision root URI
+ * following the @c SVN_DAV_REV_ROOT_STUB_HEADER stub, with PATH being
+ * URI-encoded.  It is deliberately not part of the cache key.
+ * @since New in 1.11.  */
+#define SVN_DAV_CONTENT_LOCATOR_HEADER "X-SVN-Content-Locator"
+
 /** This header provides an opaque URI which represents a Subversion
  * transaction (revision-in-progress) object.  It is suitable for use
  * in fetching and modifying transaction properties as part of a
@@ -413,6 +432,15 @@ extern "C" {
 #define SVN_DAV_NS_DAV_SVN_SVNDIFF2\
             SVN_DAV_PROP_NS_DAV "svn/svndiff2"
 
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to handle
+ * svndiff3 format encoding.
+ *
+ * @since New in 1.11.
+ */
+#define SVN_DAV_NS_DAV_SVN_SVNDIFF3\
+            SVN_DAV_PROP_NS_DAV "svn/svndiff3"
+
 /** Presence of this in a DAV header in an OPTIONS response indicates
  * that the transmitter (in this case, the server) sends the result
  * checksum in the response to a successful PUT request.
@@ -521,8 +521,10 @@ svn_txdelta_apply(svn_stream_t *source,
  * compression level from 0 (no compression) and 9 (maximum compression).
  *
  * @since New in 1.7.  Since 1.10, @a svndiff_version can be 2 for the
- * svndiff2 format.  @a compression_level is currently ignored if
- * @a svndiff_version is set to 2.
+ * svndiff2 format.  Since 1.11, it can be 3 for the svndiff3 format,
+ * which uses LZ4 like svndiff2, a more compact instruction encoding and
+ * may carry delta windows of up to 1 MB.  @a compression_level is
+ * currently ignored if @a svndiff_version is set to 2 or 3.
  */
 void
 svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
@@ -250,7 +250,10 @@ typedef enum svn_repos_notify_action_t
   svn_repos_notify_pack_noop,
 
   /** The revision properties got set. @since New in 1.10. */
-  svn_repos_notify_load_revprop_set
+  svn_repos_notify_load_revprop_set,
+
+  /** A revision has been added to the log index. @since New in 1.11. */
+  svn_repos_notify_log_index_rev_end
 } svn_repos_notify_action_t;
 
 /** The type of warning occurring.
@@ -317,8 +320,9 @@ typedef struct svn_repos_notify_t
   /** Action that describes what happened in the repository. */
   svn_repos_notify_action_t action;
 
-  /** For #svn_repos_notify_dump_rev_end and #svn_repos_notify_verify_rev_end,
-   * the revision which just completed.
+  /** For #svn_repos_notify_dump_rev_end, #svn_repos_notify_verify_rev_end
+   * and #svn_repos_notify_log_index_rev_end, the revision which just
+   * completed.
    * For #svn_fs_upgrade_format_bumped, the new format version. */
   svn_revnum_t revision;
 
@@ -2192,6 +2196,74 @@ svn_repos_get_logs5(svn_repos_t *repos,
                     void *revision_receiver_baton,
                     apr_pool_t *scratch_pool);
 
+/**
+ * Create the optional log index of @a repos if it does not exist yet and
+ * bring it up to date with the youngest revision in the repository.
+ *
+ * The log index maps paths to the revisions in which they, or any node
+ * below them, have been changed.  svn_repos_get_logs5() uses it to find
+ * the revisions that touch the requested paths without walking node
+ * history one step at a time.  It also stores the mergeinfo changes of
+ * every revision in pre-parsed form, so that svn_repos_get_logs5() with
+ * @c include_merged_revisions does not need to re-read and re-parse
+ * svn:mergeinfo properties.  Once created, the index is updated
+ * incrementally by svn_repos_fs_commit_txn().  Revisions committed by
+ * other means will be picked up by the next call to this function or
+ * the next commit through svn_repos_fs_commit_txn().
+ *
+ * If @a notify_func is not @c NULL, then call it with @a notify_baton and
+ * a notification of type #svn_repos_notify_log_index_rev_end for every
+ * revision that has been added to the index.
+ *
+ * If @a cancel_func is not @c NULL, call it with @a cancel_baton at regular
+ * intervals.  Revisions indexed before cancellation will remain in the
+ * index.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_repos_log_index_build(svn_repos_t *repos,
+                          svn_repos_notify_func_t notify_func,
+                          void *notify_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool);
+
+/**
+ * Verify that the log index of @a repos matches the changed paths and
+ * mergeinfo changes recorded in the filesystem for all revisions from
+ * @a start_rev to @a end_rev inclusive.  If @a start_rev is
+ * #SVN_INVALID_REVNUM, it defaults to r0.  If @a end_rev is
+ * #SVN_INVALID_REVNUM, it defaults to the youngest indexed revision.
+ *
+ * Return #SVN_ERR_REPOS_DISABLED_FEATURE if @a repos has no log index
+ * and #SVN_ERR_REPOS_BAD_ARGS if @a end_rev has not been indexed yet or
+ * if @a start_rev is greater than @a end_rev.
+ * Return #SVN_ERR_FS_CORRUPT upon the first mismatch found.
+ *
+ * If @a notify_func is not @c NULL, then call it with @a notify_baton and
+ * a notification of type #svn_repos_notify_verify_rev_end for every
+ * revision that has been verified.
+ *
+ * If @a cancel_func is not @c NULL, call it with @a cancel_baton at regular
+ * intervals.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_repos_log_index_verify(svn_repos_t *repos,
+                           svn_revnum_t start_rev,
+                           svn_revnum_t end_rev,
+                           svn_repos_notify_func_t notify_func,
+                           void *notify_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool);
+
 /**
  * Similar to svn_repos_get_logs5 but using a #svn_log_entry_receiver_t
  * @a receiver to receive revision properties and changed paths through a
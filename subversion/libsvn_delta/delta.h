@@ -44,6 +44,11 @@ extern "C" {
 
 #define SVN_DELTA_WINDOW_SIZE 102400
 
+/* The maximum size of one svndiff3 window.  Deltas with windows larger
+   than SVN_DELTA_WINDOW_SIZE must not be encoded in older formats. */
+
+#define SVN_DELTA_LARGE_WINDOW_SIZE (1024 * 1024)
+
 
 /* Context/baton for building an operation sequence. */
 
@@ -39,13 +39,16 @@
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
 static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 2)
+  if (version == 3)
+    return SVNDIFF_V3;
+  else if (version == 2)
     return SVNDIFF_V2;
   else if (version == 1)
     return SVNDIFF_V1;
@@ -70,9 +73,36 @@ struct encoder_baton {
 /* This is at least as big as the largest size for a single instruction. */
 #define MAX_INSTRUCTION_LEN (2*SVN__MAX_ENCODED_UINT_LEN+1)
 /* This is at least as big as the largest possible instructions
-   section: in theory, the instructions could be SVN_DELTA_WINDOW_SIZE
-   1-byte copy-from-source instructions (though this is very unlikely). */
-#define MAX_INSTRUCTION_SECTION_LEN (SVN_DELTA_WINDOW_SIZE*MAX_INSTRUCTION_LEN)
+   section for windows of up to WINDOW_SIZE bytes: in theory, the
+   instructions could be WINDOW_SIZE 1-byte copy-from-source instructions
+   (though this is very unlikely). */
+#define MAX_INSTRUCTION_SECTION_LEN(window_size) \
+  ((window_size) * MAX_INSTRUCTION_LEN)
+
+apr_size_t
+svn_txdelta__max_window_size(int svndiff_version)
+{
+  return svndiff_version >= 3 ? SVN_DELTA_LARGE_WINDOW_SIZE
+                              : SVN_DELTA_WINDOW_SIZE;
+}
+
+/* In svndiff3, the offsets of source copy instructions are stored
+   relative to the end of the previous source copy within the same window,
+   and those of target copy instructions as the distance back from the
+   current target position.  Deltas mostly copy consecutive source ranges
+   and repeat recent target data, so this keeps most offsets to a single
+   byte even with 1 MB windows. */
+
+/* Return the svndiff3 representation of source copy offset OFFSET if the
+   previous source copy ended at SOURCE_POS: the distance between them,
+   with the sign in the lowest bit. */
+static apr_uint64_t
+encode_source_offset(apr_size_t offset, apr_size_t source_pos)
+{
+  return offset >= source_pos
+       ? (apr_uint64_t)(offset - source_pos) << 1
+       : ((apr_uint64_t)(source_pos - offset) << 1) - 1;
+}
 
 
 /* Append an encoded integer to a string.  */
@@ -169,6 +199,7 @@ encode_window(svn_stringbuf_t **instructions_p,
   const svn_string_t *newdata;
   unsigned char ibuf[MAX_INSTRUCTION_LEN], *ip;
   const svn_txdelta_op_t *op;
+  apr_size_t source_pos = 0, target_pos = 0;
 
   /* create the necessary data buffers */
   instructions = svn_stringbuf_create_empty(pool);
@@ -189,8 +220,22 @@ encode_window(svn_stringbuf_t **instructions_p,
         *ip++ |= (unsigned char)op->length;
       else
         ip = svn__encode_uint(ip + 1, op->length);
-      if (op->action_code != svn_txdelta_new)
-        ip = svn__encode_uint(ip, op->offset);
+      if (version < 3)
+        {
+          if (op->action_code != svn_txdelta_new)
+            ip = svn__encode_uint(ip, op->offset);
+        }
+      else if (op->action_code == svn_txdelta_source)
+        {
+          ip = svn__encode_uint(ip, encode_source_offset(op->offset,
+                                                         source_pos));
+          source_pos = op->offset + op->length;
+        }
+      else if (op->action_code == svn_txdelta_target)
+        {
+          ip = svn__encode_uint(ip, target_pos - op->offset - 1);
+        }
+      target_pos += op->length;
       svn_stringbuf_appendbytes(instructions, (const char *)ibuf, ip - ibuf);
     }
 
@@ -198,7 +243,7 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (version == 2)
+  if (version >= 2)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -217,7 +262,7 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, instructions->len);
 
   /* Encode the data. */
-  if (version == 2)
+  if (version >= 2)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -424,11 +469,36 @@ decode_size(apr_size_t *val,
   return result;
 }
 
+/* Where we are within the instructions of a window.  Only needed to
+   resolve the relative offsets of svndiff3 instructions. */
+typedef struct instruction_state_t
+{
+  /* TRUE if offsets are relative. */
+  svn_boolean_t relative;
+
+  /* End of the last source copy and current position in the target view. */
+  apr_size_t source_pos;
+  apr_size_t target_pos;
+} instruction_state_t;
+
+/* Initialize *STATE for the first instruction of a svndiff VERSION
+   window. */
+static void
+init_instruction_state(instruction_state_t *state,
+                       unsigned int version)
+{
+  state->relative = version >= 3;
+  state->source_pos = 0;
+  state->target_pos = 0;
+}
+
 /* Decode an instruction into OP, returning a pointer to the text
-   after the instruction.  Note that if the action code is
+   after the instruction.  STATE tracks the position within the window
+   and will be updated.  Note that if the action code is
    svn_txdelta_new, the offset field of *OP will not be set.  */
 static const unsigned char *
 decode_instruction(svn_txdelta_op_t *op,
+                   instruction_state_t *state,
                    const unsigned char *p,
                    const unsigned char *end)
 {
@@ -465,28 +535,67 @@ decode_instruction(svn_txdelta_op_t *op,
         return NULL;
     }
 
+  /* Turn relative offsets into absolute ones. */
+  if (state->relative)
+    {
+      if (action == svn_txdelta_source)
+        {
+          apr_size_t distance = (op->offset >> 1) + (op->offset & 1);
+
+          if (op->offset & 1)
+            {
+              if (distance > state->source_pos)
+                return NULL;
+              op->offset = state->source_pos - distance;
+            }
+          else
+            {
+              if (distance > APR_SIZE_MAX - state->source_pos)
+                return NULL;
+              op->offset = state->source_pos + distance;
+            }
+
+          if (op->length > APR_SIZE_MAX - op->offset)
+            return NULL;
+          state->source_pos = op->offset + op->length;
+        }
+      else if (action == svn_txdelta_target)
+        {
+          if (op->offset >= state->target_pos)
+            return NULL;
+          op->offset = state->target_pos - op->offset - 1;
+        }
+
+      if (op->length > APR_SIZE_MAX - state->target_pos)
+        return NULL;
+      state->target_pos += op->length;
+    }
+
   return p;
 }
 
 /* Count the instructions in the range [P..END-1] and make sure they
-   are valid for the given window lengths.  Return an error if the
-   instructions are invalid; otherwise set *NINST to the number of
-   instructions.  */
+   are valid for the given window lengths and svndiff VERSION.  Return an
+   error if the instructions are invalid; otherwise set *NINST to the
+   number of instructions.  */
 static svn_error_t *
 count_and_verify_instructions(int *ninst,
                               const unsigned char *p,
                               const unsigned char *end,
                               apr_size_t sview_len,
                               apr_size_t tview_len,
-                              apr_size_t new_len)
+                              apr_size_t new_len,
+                              unsigned int version)
 {
   int n = 0;
   svn_txdelta_op_t op;
+  instruction_state_t state;
   apr_size_t tpos = 0, npos = 0;
 
+  init_instruction_state(&state, version);
   while (p < end)
     {
-      p = decode_instruction(&op, p, end);
+      p = decode_instruction(&op, &state, p, end);
 
       /* Detect any malformed operations from the instruction stream. */
       if (p == NULL)
@@ -558,6 +667,8 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
   apr_size_t npos;
   svn_txdelta_op_t *ops, *op;
   svn_string_t *new_data;
+  instruction_state_t state;
+  apr_size_t max_window_size = svn_txdelta__max_window_size(version);
 
   window->sview_offset = sview_offset;
   window->sview_len = sview_len;
@@ -565,15 +676,15 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 2)
+  if (version >= 2)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
-      SVN_ERR(svn__decompress_lz4(insend, newlen, ndout,
-                                  SVN_DELTA_WINDOW_SIZE));
+      SVN_ERR(svn__decompress_lz4(insend, newlen, ndout, max_window_size));
       SVN_ERR(svn__decompress_lz4(data, insend - data, instout,
-                                  MAX_INSTRUCTION_SECTION_LEN));
+                                  MAX_INSTRUCTION_SECTION_LEN(
+                                    max_window_size)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -586,10 +697,10 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
-      SVN_ERR(svn__decompress_zlib(insend, newlen, ndout,
-                                   SVN_DELTA_WINDOW_SIZE));
+      SVN_ERR(svn__decompress_zlib(insend, newlen, ndout, max_window_size));
       SVN_ERR(svn__decompress_zlib(data, insend - data, instout,
-                                   MAX_INSTRUCTION_SECTION_LEN));
+                                   MAX_INSTRUCTION_SECTION_LEN(
+                                     max_window_size)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -606,15 +717,17 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   /* Count the instructions and make sure they are all valid.  */
   SVN_ERR(count_and_verify_instructions(&ninst, data, insend,
-                                        sview_len, tview_len, newlen));
+                                        sview_len, tview_len, newlen,
+                                        version));
 
   /* Allocate a buffer for the instructions and decode them. */
   ops = apr_palloc(pool, ninst * sizeof(*ops));
   npos = 0;
   window->src_ops = 0;
+  init_instruction_state(&state, version);
   for (op = ops; op < ops + ninst; op++)
     {
-      data = decode_instruction(op, data, insend);
+      data = decode_instruction(op, &state, data, insend);
       if (op->action_code == svn_txdelta_source)
         ++window->src_ops;
       else if (op->action_code == svn_txdelta_new)
@@ -653,6 +766,8 @@ write_handler(void *baton,
         db->version = 1;
       else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
         db->version = 2;
+      else if (memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -688,6 +803,8 @@ write_handler(void *baton,
         {
           svn_filesize_t sview_offset;
           apr_size_t sview_len, tview_len, inslen, newlen;
+          apr_size_t max_window_size
+            = svn_txdelta__max_window_size(db->version);
           const unsigned char *hdr_start = p;
 
           p = decode_file_offset(&sview_offset, p, end);
@@ -710,11 +827,11 @@ write_handler(void *baton,
           if (p == NULL)
               break;
 
-          if (tview_len > SVN_DELTA_WINDOW_SIZE ||
-              sview_len > SVN_DELTA_WINDOW_SIZE ||
+          if (tview_len > max_window_size ||
+              sview_len > max_window_size ||
               /* for svndiff1, newlen includes the original length */
-              newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-              inslen > MAX_INSTRUCTION_SECTION_LEN)
+              newlen > max_window_size + SVN__MAX_ENCODED_UINT_LEN ||
+              inslen > MAX_INSTRUCTION_SECTION_LEN(max_window_size))
             return svn_error_create(
                      SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                      _("Svndiff contains a too-large window"));
@@ -894,12 +1011,13 @@ read_one_size(apr_size_t *size,
   return SVN_NO_ERROR;
 }
 
-/* Read a window header from STREAM and check it for integer overflow. */
+/* Read a window header from STREAM and check it for integer overflow
+   and for views larger than MAX_WINDOW_SIZE. */
 static svn_error_t *
 read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
                    apr_size_t *sview_len, apr_size_t *tview_len,
                    apr_size_t *inslen, apr_size_t *newlen,
-                   apr_size_t *header_len)
+                   apr_size_t *header_len, apr_size_t max_window_size)
 {
   unsigned char c;
 
@@ -921,11 +1039,11 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   SVN_ERR(read_one_size(inslen, header_len, stream));
   SVN_ERR(read_one_size(newlen, header_len, stream));
 
-  if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
-      *sview_len > SVN_DELTA_WINDOW_SIZE ||
+  if (*tview_len > max_window_size ||
+      *sview_len > max_window_size ||
       /* for svndiff1, newlen includes the original length */
-      *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-      *inslen > MAX_INSTRUCTION_SECTION_LEN)
+      *newlen > max_window_size + SVN__MAX_ENCODED_UINT_LEN ||
+      *inslen > MAX_INSTRUCTION_SECTION_LEN(max_window_size))
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                             _("Svndiff contains a too-large window"));
 
@@ -950,7 +1068,8 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
   unsigned char *buf;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svn_txdelta__max_window_size(svndiff_version)));
   len = inslen + newlen;
   buf = apr_palloc(pool, len);
   SVN_ERR(svn_stream_read_full(stream, (char*)buf, &len));
@@ -974,7 +1093,8 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
   apr_off_t offset;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svn_txdelta__max_window_size(svndiff_version)));
 
   offset = inslen + newlen;
   return svn_io_file_seek(file, APR_CUR, &offset, pool);
@@ -983,13 +1103,15 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
 svn_error_t *
 svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
+                                 int svndiff_version,
                                  apr_pool_t *pool)
 {
   svn_filesize_t sview_offset;
   apr_size_t sview_len, tview_len, inslen, newlen, header_len;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svn_txdelta__max_window_size(svndiff_version)));
 
   *window_len = inslen + newlen + header_len;
   return SVN_NO_ERROR;
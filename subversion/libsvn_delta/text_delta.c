@@ -34,6 +34,7 @@
 #include "svn_checksum.h"
 
 #include "delta.h"
+#include "private/svn_delta_private.h"
 
 
 /* Text delta stream descriptor. */
@@ -76,6 +77,7 @@ struct tpush_baton {
 
   /* Private data */
   char *buf;
+  apr_size_t window_size;
   svn_filesize_t source_offset;
   apr_size_t source_len;
   svn_boolean_t source_done;
@@ -520,14 +522,14 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
       /* Make sure we're all full up on source data, if possible. */
       if (tb->source_len == 0 && !tb->source_done)
         {
-          tb->source_len = SVN_DELTA_WINDOW_SIZE;
+          tb->source_len = tb->window_size;
           SVN_ERR(svn_stream_read_full(tb->source, tb->buf, &tb->source_len));
-          if (tb->source_len < SVN_DELTA_WINDOW_SIZE)
+          if (tb->source_len < tb->window_size)
             tb->source_done = TRUE;
         }
 
-      /* Copy in the target data, up to SVN_DELTA_WINDOW_SIZE. */
-      chunk_len = SVN_DELTA_WINDOW_SIZE - tb->target_len;
+      /* Copy in the target data, up to the window size. */
+      chunk_len = tb->window_size - tb->target_len;
       if (chunk_len > data_len)
         chunk_len = data_len;
       memcpy(tb->buf + tb->source_len + tb->target_len, data, chunk_len);
@@ -536,7 +538,7 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
       tb->target_len += chunk_len;
 
       /* If we're full of target data, compute and fire off a window. */
-      if (tb->target_len == SVN_DELTA_WINDOW_SIZE)
+      if (tb->target_len == tb->window_size)
         {
           window = compute_window(tb->buf, tb->source_len, tb->target_len,
                                   tb->source_offset, pool);
@@ -575,9 +577,11 @@ tpush_close_handler(void *baton)
 
 
 svn_stream_t *
-svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
-                        void *handler_baton, svn_stream_t *source,
-                        apr_pool_t *pool)
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         apr_size_t window_size,
+                         apr_pool_t *pool)
 {
   struct tpush_baton *tb;
   svn_stream_t *stream;
@@ -588,7 +592,8 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
   tb->wh = handler;
   tb->whb = handler_baton;
   tb->pool = pool;
-  tb->buf = apr_palloc(pool, 2 * SVN_DELTA_WINDOW_SIZE);
+  tb->buf = apr_palloc(pool, 2 * window_size);
+  tb->window_size = window_size;
   tb->source_offset = 0;
   tb->source_len = 0;
   tb->source_done = FALSE;
@@ -601,6 +606,15 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
   return stream;
 }
 
+svn_stream_t *
+svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
+                        void *handler_baton, svn_stream_t *source,
+                        apr_pool_t *pool)
+{
+  return svn_txdelta__target_push(handler, handler_baton, source,
+                                  SVN_DELTA_WINDOW_SIZE, pool);
+}
+
 
 
 /* Functions for applying deltas.  */
@@ -61,7 +61,40 @@ block_read(void **result,
 #define SVN_FS_FS__LOG_ACCESS
  */
 
-/* When SVN_FS_FS__LOG_ACCESS has been defined, write a line to console
+/* If FS has been configured to record an access trace, append a line
+ * for REVISION, ITEM_INDEX to it.  Accesses to transaction data will be
+ * ignored.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+record_access(svn_fs_t *fs,
+              svn_revnum_t revision,
+              apr_uint64_t item_index,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *line;
+
+  if (!ffd->record_access_trace || !SVN_IS_VALID_REVNUM(revision))
+    return SVN_NO_ERROR;
+
+  /* Unbuffered appends keep the lines of concurrent processes intact. */
+  if (!ffd->access_trace_file)
+    SVN_ERR(svn_io_file_open(&ffd->access_trace_file,
+                             ffd->record_access_trace,
+                             APR_WRITE | APR_CREATE | APR_APPEND,
+                             APR_OS_DEFAULT, fs->pool));
+
+  line = apr_psprintf(scratch_pool, "%ld %" APR_UINT64_T_FMT "\n",
+                      revision, item_index);
+  return svn_error_trace(svn_io_file_write_full(ffd->access_trace_file,
+                                                line, strlen(line), NULL,
+                                                scratch_pool));
+}
+
+/* Record the access to REVISION, ITEM_INDEX in FS's access trace, if
+ * enabled.
+ *
+ * When SVN_FS_FS__LOG_ACCESS has been defined, also write a line to console
  * showing where REVISION, ITEM_INDEX is located in FS and use ITEM to
  * show details on it's contents if not NULL.  To support format 6 and
  * earlier repos, ITEM_TYPE (SVN_FS_FS__ITEM_TYPE_*) must match ITEM.
@@ -133,6 +166,10 @@ dbg_log_access(svn_fs_t *fs,
         description = "  PLAIN";
       else if (header->type == svn_fs_fs__rep_self_delta)
         description = "  DELTA";
+      else if (header->type == svn_fs_fs__rep_external)
+        description = "  EXTERNAL";
+      else if (header->type == svn_fs_fs__rep_chunked)
+        description = "  CHUNKED";
       else
         description = apr_psprintf(scratch_pool,
                                    "  DELTA against %ld/%" APR_UINT64_T_FMT,
@@ -190,6 +227,8 @@ dbg_log_access(svn_fs_t *fs,
 
 #endif
 
+  SVN_ERR(record_access(fs, revision, item_index, scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -714,6 +753,31 @@ typedef struct shared_file_t
      remains open / valid beyond the respective local context that required
      the file to be opened eventually. */
   apr_pool_t *pool;
+
+  /* If not NULL, FILE is not a rev / pack file but the out-of-line
+     fulltext with this SHA1 digest.  REVISION is invalid in that case. */
+  const unsigned char *large_sha1;
+
+  /* If LARGE_SHA1 is not NULL, the transaction containing that file or
+     unused if it has already been committed. */
+  svn_fs_fs__id_part_t large_txn_id;
+
+  /* If set, LARGE_SHA1 names the chunk list of a CHUNKED fulltext and
+     FILE will not be used. */
+  svn_boolean_t chunked;
+
+  /* For chunked fulltexts, the svn_fs_fs__chunk_t array read from the
+     chunk list.  NULL while that has not been read, yet. */
+  apr_array_header_t *chunks;
+
+  /* For chunked fulltexts, the chunk at index CHUNK_IDX in CHUNKS starts
+     at offset CHUNK_START within the fulltext.  CHUNK_DATA holds its
+     contents, allocated in CHUNK_POOL, or is NULL if they have not been
+     read, yet. */
+  int chunk_idx;
+  apr_off_t chunk_start;
+  svn_stringbuf_t *chunk_data;
+  apr_pool_t *chunk_pool;
 } shared_file_t;
 
 /* Represents where in the current svndiff data block each
@@ -744,8 +808,19 @@ typedef struct rep_state_t
   int ver;          /* If a delta, what svndiff version?
                        -1 for unknown delta version. */
   int chunk_index;  /* number of the window to read */
+                    /* see rep_generation(), 0 for txns */
+  apr_uint64_t generation;
 } rep_state_t;
 
+/* Return the generation of FILE to use in the cache keys of the rep
+ * headers and windows read from it.  Only pack files get recompressed,
+ * and packing copies reps verbatim.  Hence, this is 0 for rev files. */
+static apr_uint64_t
+rep_generation(svn_fs_fs__revision_file_t *file)
+{
+  return file->is_packed ? file->generation : 0;
+}
+
 /* Simple wrapper around svn_io_file_get_offset to simplify callers. */
 static svn_error_t *
 get_file_offset(apr_off_t *offset,
@@ -771,11 +846,51 @@ rs_aligned_seek(rep_state_t *rs,
                                                   pool));
 }
 
-/* Open FILE->FILE and FILE->STREAM if they haven't been opened, yet. */
+/* Read the chunk list of the CHUNKED fulltext described by FILE. */
+static svn_error_t *
+read_chunk_list(shared_file_t *file)
+{
+  svn_stream_t *stream;
+  const char *path = svn_fs_fs__id_txn_used(&file->large_txn_id)
+                   ? svn_fs_fs__path_txn_chunk_list(file->fs,
+                                                    &file->large_txn_id,
+                                                    file->large_sha1,
+                                                    file->pool)
+                   : svn_fs_fs__path_chunk_list(file->fs, file->large_sha1,
+                                                file->pool);
+
+  SVN_ERR(svn_stream_open_readonly(&stream, path, file->pool, file->pool));
+  SVN_ERR(svn_fs_fs__read_chunk_list(&file->chunks, stream, file->pool,
+                                     file->pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  file->chunk_idx = 0;
+  file->chunk_start = 0;
+  file->chunk_data = NULL;
+  file->chunk_pool = svn_pool_create(file->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open FILE->FILE and FILE->STREAM if they haven't been opened, yet.
+   For chunked fulltexts, read the chunk list instead. */
 static svn_error_t*
 auto_open_shared_file(shared_file_t *file)
 {
-  if (file->rfile == NULL)
+  if (file->chunked)
+    {
+      if (file->chunks == NULL)
+        SVN_ERR(read_chunk_list(file));
+    }
+  else if (file->rfile == NULL && file->large_sha1)
+    SVN_ERR(svn_fs_fs__open_large_file(&file->rfile, file->fs,
+                                       svn_fs_fs__id_txn_used(
+                                                        &file->large_txn_id)
+                                         ? &file->large_txn_id
+                                         : NULL,
+                                       file->large_sha1, file->pool,
+                                       file->pool));
+  else if (file->rfile == NULL)
     SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&file->rfile, file->fs,
                                              file->revision, file->pool,
                                              file->pool));
@@ -784,12 +899,22 @@ auto_open_shared_file(shared_file_t *file)
 }
 
 /* Set RS->START to the begin of the representation raw in RS->FILE->FILE,
-   if that hasn't been done yet.  Use POOL for temporary allocations. */
+   if that hasn't been done yet.  Return SVN_ERR_FS_REP_CHANGED if that
+   file has been replaced since RS has been initialized from cached data.
+   Use POOL for temporary allocations. */
 static svn_error_t*
 auto_set_start_offset(rep_state_t *rs, apr_pool_t *pool)
 {
   if (rs->start == -1)
     {
+      /* Opening the file has updated the pack generation known to FS.
+       * So, a retry will not run into this again. */
+      if (   rs->generation
+          && rs->generation != rep_generation(rs->sfile->rfile))
+        return svn_error_createf(SVN_ERR_FS_REP_CHANGED, NULL,
+                                 _("Pack file containing revision %ld "
+                                   "has been replaced"), rs->revision);
+
       SVN_ERR(svn_fs_fs__item_offset(&rs->start, rs->sfile->fs,
                                      rs->sfile->rfile, rs->revision, NULL,
                                      rs->item_index, pool));
@@ -826,6 +951,37 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Make RS, which has just read the EXTERNAL or CHUNKED rep header RH in
+ * FS, read the fulltext like a plain rep from the file or chunks described
+ * by RH instead.  TXN_ID is the transaction containing the rep or unused
+ * if it has been committed.  That file will only be opened when needed
+ * and its contents be kept out of the window caches.  Allocate the file
+ * info in RESULT_POOL.
+ */
+static void
+redirect_to_large_file(rep_state_t *rs,
+                       svn_fs_t *fs,
+                       svn_fs_fs__rep_header_t *rh,
+                       const svn_fs_fs__id_part_t *txn_id,
+                       apr_pool_t *result_pool)
+{
+  shared_file_t *file = apr_pcalloc(result_pool, sizeof(*file));
+  file->revision = SVN_INVALID_REVNUM;
+  file->pool = result_pool;
+  file->fs = fs;
+  file->large_sha1 = rh->sha1_digest;
+  file->large_txn_id = *txn_id;
+  file->chunked = rh->type == svn_fs_fs__rep_chunked;
+
+  rs->sfile = file;
+  rs->start = 0;
+  rs->current = 0;
+  rs->size = rh->expanded_size;
+  rs->raw_window_cache = NULL;
+  rs->window_cache = NULL;
+  rs->combined_cache = NULL;
+}
+
 /* See create_rep_state, which wraps this and adds another error. */
 static svn_error_t *
 create_rep_state_body(rep_state_t **rep_state,
@@ -858,9 +1014,7 @@ create_rep_state_body(rep_state_t **rep_state,
       && (   ((*shared_file)->revision / ffd->max_files_per_dir)
           == (rep->revision / ffd->max_files_per_dir));
 
-  pair_cache_key_t key;
-  key.revision = rep->revision;
-  key.second = rep->item_index;
+  rep_header_cache_key_t key = { 0 };
 
   /* continue constructing RS and RA */
   rs->size = rep->size;
@@ -889,11 +1043,6 @@ create_rep_state_body(rep_state_t **rep_state,
                      ? ffd->combined_window_cache
                      : NULL;
 
-  /* cache lookup, i.e. skip reading the rep header if possible */
-  if (ffd->rep_header_cache && !svn_fs_fs__id_txn_used(&rep->txn_id))
-    SVN_ERR(svn_cache__get((void **) &rh, &is_cached,
-                           ffd->rep_header_cache, &key, result_pool));
-
   /* initialize the (shared) FILE member in RS */
   if (reuse_shared_file)
     {
@@ -912,19 +1061,41 @@ create_rep_state_body(rep_state_t **rep_state,
         *shared_file = file;
     }
 
+  /* The cached headers and windows of packed reps are only valid for the
+   * pack file they were read from.  Open it only if we don't know its
+   * generation, yet. */
+  if (   !svn_fs_fs__id_txn_used(&rep->txn_id)
+      && svn_fs_fs__is_packed_rev(fs, rep->revision))
+    {
+      rs->generation = rs->sfile->rfile
+                     ? rep_generation(rs->sfile->rfile)
+                     : svn_fs_fs__pack_generation(fs, rep->revision);
+      if (rs->generation == 0)
+        {
+          SVN_ERR(auto_open_shared_file(rs->sfile));
+          rs->generation = rep_generation(rs->sfile->rfile);
+        }
+    }
+
+  /* cache lookup, i.e. skip reading the rep header if possible */
+  key.revision = rep->revision;
+  key.item_index = rep->item_index;
+  key.generation = rs->generation;
+  if (ffd->rep_header_cache && !svn_fs_fs__id_txn_used(&rep->txn_id))
+    SVN_ERR(svn_cache__get((void **) &rh, &is_cached,
+                           ffd->rep_header_cache, &key, result_pool));
+
   /* read rep header, if necessary */
   if (!is_cached)
     {
       /* ensure file is open and navigate to the start of rep header */
-      if (reuse_shared_file)
+      if (rs->sfile->rfile)
         {
           apr_off_t offset;
 
-          /* ... we can re-use the same, already open file object.
+          /* ... we can use the already open file object.
            * This implies that we don't read from a txn.
            */
-          rs->sfile = *shared_file;
-          SVN_ERR(auto_open_shared_file(rs->sfile));
           SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rs->sfile->rfile,
                                          rep->revision, NULL, rep->item_index,
                                          scratch_pool));
@@ -943,6 +1114,10 @@ create_rep_state_body(rep_state_t **rep_state,
                                          result_pool, scratch_pool));
       SVN_ERR(get_file_offset(&rs->start, rs, result_pool));
 
+      /* The file may have been replaced since we learned its generation. */
+      rs->generation = rep_generation(rs->sfile->rfile);
+      key.generation = rs->generation;
+
       /* populate the cache if appropriate */
       if (! svn_fs_fs__id_txn_used(&rep->txn_id))
         {
@@ -961,6 +1136,8 @@ create_rep_state_body(rep_state_t **rep_state,
                          SVN_FS_FS__ITEM_TYPE_ANY_REP, scratch_pool));
 
   rs->header_size = rh->header_size;
+  if (rh->size)
+    rs->size = rh->size;
   *rep_state = rs;
   *rep_header = rh;
 
@@ -968,6 +1145,13 @@ create_rep_state_body(rep_state_t **rep_state,
     /* This is a plaintext, so just return the current rep_state. */
     return SVN_NO_ERROR;
 
+  if (   rh->type == svn_fs_fs__rep_external
+      || rh->type == svn_fs_fs__rep_chunked)
+    {
+      redirect_to_large_file(rs, fs, rh, &rep->txn_id, result_pool);
+      return SVN_NO_ERROR;
+    }
+
   /* skip "SVNx" diff marker */
   rs->current = 4;
 
@@ -1165,6 +1349,23 @@ svn_fs_fs__rep_chain_length(int *chain_length,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__rep_is_external(svn_boolean_t *is_external,
+                           representation_t *rep,
+                           svn_fs_t *fs,
+                           apr_pool_t *scratch_pool)
+{
+  rep_state_t *rep_state;
+  svn_fs_fs__rep_header_t *header;
+
+  SVN_ERR(create_rep_state_body(&rep_state, &header, NULL, rep, fs,
+                                scratch_pool, scratch_pool));
+  *is_external = (   header->type == svn_fs_fs__rep_external
+                  || header->type == svn_fs_fs__rep_chunked);
+
+  return SVN_NO_ERROR;
+}
+
 struct rep_read_baton
 {
   /* The FS from which we're reading. */
@@ -1238,6 +1439,7 @@ get_window_key(window_cache_key_t *key, rep_state_t *rs)
   key->revision = (apr_uint32_t)rs->revision;
   key->item_index = rs->item_index;
   key->chunk_index = rs->chunk_index;
+  key->generation = rs->generation;
 
   return key;
 }
@@ -1477,7 +1679,9 @@ build_rep_list(apr_array_header_t **list,
           break;
         }
 
-      if (rep_header->type == svn_fs_fs__rep_plain)
+      if (   rep_header->type == svn_fs_fs__rep_plain
+          || rep_header->type == svn_fs_fs__rep_external
+          || rep_header->type == svn_fs_fs__rep_chunked)
         {
           /* This is a plaintext, so just return the current rep_state. */
           *src_state = rs;
@@ -1633,6 +1837,72 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   return SVN_NO_ERROR;
 }
 
+/* Read SIZE bytes from the chunked fulltext RS and return it in *NWIN.
+ * Allocate the result in RESULT_POOL. */
+static svn_error_t *
+read_chunked_window(svn_stringbuf_t **nwin, rep_state_t *rs,
+                    apr_size_t size, apr_pool_t *result_pool)
+{
+  shared_file_t *file = rs->sfile;
+
+  *nwin = svn_stringbuf_create_ensure(size, result_pool);
+  while ((*nwin)->len < size)
+    {
+      const svn_fs_fs__chunk_t *chunk;
+      apr_size_t offset, count;
+
+      /* Windows are read in order but may be skipped.  Go back to the
+       * first chunk only if the caller went backwards. */
+      if (rs->current < file->chunk_start)
+        {
+          file->chunk_idx = 0;
+          file->chunk_start = 0;
+          file->chunk_data = NULL;
+        }
+
+      /* Find the chunk containing the current position. */
+      while (TRUE)
+        {
+          if (file->chunk_idx >= file->chunks->nelts)
+            return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                    _("Chunk list too short for "
+                                      "representation"));
+
+          chunk = &APR_ARRAY_IDX(file->chunks, file->chunk_idx,
+                                 svn_fs_fs__chunk_t);
+          if (rs->current < file->chunk_start + (apr_off_t)chunk->size)
+            break;
+
+          file->chunk_start += chunk->size;
+          file->chunk_idx++;
+          file->chunk_data = NULL;
+        }
+
+      /* Chunks are small, so simply read them as a whole. */
+      if (file->chunk_data == NULL)
+        {
+          svn_pool_clear(file->chunk_pool);
+          SVN_ERR(svn_stringbuf_from_file2(&file->chunk_data,
+                                           svn_fs_fs__path_chunk(
+                                             file->fs, chunk->sha1_digest,
+                                             file->chunk_pool),
+                                           file->chunk_pool));
+          if (file->chunk_data->len != chunk->size)
+            return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                    _("Fulltext chunk has unexpected "
+                                      "size"));
+        }
+
+      offset = (apr_size_t)(rs->current - file->chunk_start);
+      count = MIN(size - (*nwin)->len, chunk->size - offset);
+      svn_stringbuf_appendbytes(*nwin, file->chunk_data->data + offset,
+                                count);
+      rs->current += (apr_off_t)count;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Read SIZE bytes from the representation RS and return it in *NWIN. */
 static svn_error_t *
 read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
@@ -1644,6 +1914,10 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
   /* RS->FILE may be shared between RS instances -> make sure we point
    * to the right data. */
   SVN_ERR(auto_open_shared_file(rs->sfile));
+  if (rs->sfile->chunked)
+    return svn_error_trace(read_chunked_window(nwin, rs, size,
+                                               result_pool));
+
   SVN_ERR(auto_set_start_offset(rs, scratch_pool));
 
   offset = rs->start + rs->current;
@@ -1777,10 +2051,14 @@ get_combined_window(svn_stringbuf_t **result,
 
 /* Returns whether or not the expanded fulltext of the file is cachable
  * based on its size SIZE.  The decision depends on the cache used by FFD.
+ * Fulltexts large enough to be stored out-of-line are never cached.
  */
 static svn_boolean_t
 fulltext_size_is_cachable(fs_fs_data_t *ffd, svn_filesize_t size)
 {
+  if (ffd->large_file_threshold && size >= ffd->large_file_threshold)
+    return FALSE;
+
   return (size < APR_SIZE_MAX)
       && svn_cache__is_cachable(ffd->fulltext_cache, (apr_size_t)size);
 }
@@ -2279,6 +2557,8 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
                                      pool, pool));
   SVN_ERR(get_file_offset(&rs->start, rs, pool));
   rs->header_size = rh->header_size;
+  if (rh->size)
+    rs->size = rh->size;
 
   /* Log the access. */
   SVN_ERR(dbg_log_access(fs, SVN_INVALID_REVNUM, 0, rh,
@@ -2290,6 +2570,13 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
       rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
       rb->src_state = rs;
     }
+  else if (   rh->type == svn_fs_fs__rep_external
+           || rh->type == svn_fs_fs__rep_chunked)
+    {
+      redirect_to_large_file(rs, fs, rh, &rep->txn_id, pool);
+      rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
+      rb->src_state = rs;
+    }
   else if (rh->type == svn_fs_fs__rep_self_delta)
     {
       rb->rs_list = apr_array_make(pool, 1, sizeof(rep_state_t *));
@@ -2433,6 +2720,33 @@ delta_read_md5_digest(void *baton)
   return drb->md5_digest;
 }
 
+/* Set *USABLE to TRUE if the delta windows of the on-disk representation
+ * REP_STATE can be passed on to arbitrary consumers, i.e. if they don't
+ * exceed the standard window size.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+storaged_delta_is_usable(svn_boolean_t *usable,
+                         rep_state_t *rep_state,
+                         apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = rep_state->sfile->fs->fsap_data;
+
+  /* Only svndiff3 deltas may have large windows. */
+  if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    {
+      *usable = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(auto_open_shared_file(rep_state->sfile));
+  SVN_ERR(auto_set_start_offset(rep_state, scratch_pool));
+  SVN_ERR(auto_read_diff_version(rep_state, scratch_pool));
+  *usable = svn_txdelta__max_window_size(rep_state->ver)
+         <= SVN_DELTA_WINDOW_SIZE;
+
+  return SVN_NO_ERROR;
+}
+
 /* Return a txdelta stream for on-disk representation REP_STATE
  * of TARGET.  Allocate the result in POOL.
  */
@@ -2460,6 +2774,7 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
   svn_stream_t *source_stream, *target_stream;
   rep_state_t *rep_state;
   svn_fs_fs__rep_header_t *rep_header;
+  svn_boolean_t usable;
   fs_fs_data_t *ffd = fs->fsap_data;
 
   /* Try a shortcut: if the target is stored as a delta against the source,
@@ -2480,8 +2795,13 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
               && rep_header->base_revision == source->data_rep->revision
               && rep_header->base_item_index == source->data_rep->item_index)
             {
-              *stream_p = get_storaged_delta_stream(rep_state, target, pool);
-              return SVN_NO_ERROR;
+              SVN_ERR(storaged_delta_is_usable(&usable, rep_state, pool));
+              if (usable)
+                {
+                  *stream_p = get_storaged_delta_stream(rep_state, target,
+                                                        pool);
+                  return SVN_NO_ERROR;
+                }
             }
         }
       else if (!source)
@@ -2491,8 +2811,13 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
              format. */
           if (rep_header->type == svn_fs_fs__rep_self_delta)
             {
-              *stream_p = get_storaged_delta_stream(rep_state, target, pool);
-              return SVN_NO_ERROR;
+              SVN_ERR(storaged_delta_is_usable(&usable, rep_state, pool));
+              if (usable)
+                {
+                  *stream_p = get_storaged_delta_stream(rep_state, target,
+                                                        pool);
+                  return SVN_NO_ERROR;
+                }
             }
         }
 
@@ -2773,6 +3098,89 @@ get_dir_contents(svn_fs_fs__dir_data_t *dir,
 }
 
 
+/* With log addressing, look up the offsets of all node revisions in
+ * ENTRIES that live in the same rev / pack file as the directory NODEREV
+ * in a single batch.  This reads each affected l2p index page only once
+ * and leaves them in the page cache so that the individual lookups when
+ * the caller walks the directory become cache hits.  Entries whose node
+ * revisions are cached already don't need their offsets, and we don't
+ * open the rev / pack file unless at least two others are left.
+ *
+ * This is merely an optimization, so errors will be ignored.
+ */
+static void
+prefetch_entry_offsets(svn_fs_t *fs,
+                       node_revision_t *noderev,
+                       apr_array_header_t *entries,
+                       apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__revision_file_t *rev_file;
+  apr_array_header_t *items;
+  apr_off_t *offsets;
+  svn_revnum_t start_rev;
+  svn_error_t *err;
+  int i;
+
+  if (   !svn_fs_fs__use_log_addressing(fs)
+      || !noderev->data_rep
+      || svn_fs_fs__id_txn_used(&noderev->data_rep->txn_id)
+      || entries->nelts < 2)
+    return;
+
+  start_rev = svn_fs_fs__packed_base_rev(fs, noderev->data_rep->revision);
+  items = apr_array_make(scratch_pool, entries->nelts,
+                         sizeof(svn_fs_fs__id_part_t));
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_fs_dirent_t *dirent = APR_ARRAY_IDX(entries, i, svn_fs_dirent_t *);
+      const svn_fs_fs__id_part_t *rev_item
+        = svn_fs_fs__id_rev_item(dirent->id);
+
+      if (   !SVN_IS_VALID_REVNUM(rev_item->revision)
+          || svn_fs_fs__packed_base_rev(fs, rev_item->revision) != start_rev)
+        continue;
+
+      if (ffd->node_revision_cache)
+        {
+          pair_cache_key_t key = { 0 };
+          svn_boolean_t is_cached;
+
+          key.revision = rev_item->revision;
+          key.second = rev_item->number;
+          err = svn_cache__has_key(&is_cached, ffd->node_revision_cache,
+                                   &key, scratch_pool);
+          if (err)
+            {
+              svn_error_clear(err);
+              return;
+            }
+
+          if (is_cached)
+            continue;
+        }
+
+      APR_ARRAY_PUSH(items, svn_fs_fs__id_part_t) = *rev_item;
+    }
+
+  if (items->nelts < 2)
+    return;
+
+  offsets = apr_palloc(scratch_pool, items->nelts * sizeof(*offsets));
+  err = svn_fs_fs__open_pack_or_rev_file(&rev_file, fs,
+                                         noderev->data_rep->revision,
+                                         scratch_pool, scratch_pool);
+  if (!err)
+    {
+      err = svn_fs_fs__item_offsets(offsets, fs, rev_file, items,
+                                    scratch_pool);
+      err = svn_error_compose_create(err,
+                                     svn_fs_fs__close_revision_file(rev_file));
+    }
+
+  svn_error_clear(err);
+}
+
 /* Return the cache object in FS responsible to storing the directory the
  * NODEREV plus the corresponding *KEY.  If no cache exists, return NULL.
  * PAIR_KEY must point to some key struct, which does not need to be
@@ -2853,6 +3261,9 @@ svn_fs_fs__rep_contents_dir(apr_array_header_t **entries_p,
   SVN_ERR(get_dir_contents(dir, fs, noderev, result_pool, scratch_pool));
   *entries_p = dir->entries;
 
+  /* Callers will typically access many of the entries next. */
+  prefetch_entry_offsets(fs, noderev, dir->entries, scratch_pool);
+
   /* Update the cache, if we are to use one.
    *
    * Don't even attempt to serialize very large directories; it would cause
@@ -3208,6 +3619,7 @@ init_rep_state(rep_state_t *rs,
   rs->size = entry->size - rep_header->header_size - 7;
   rs->ver = 1;
   rs->chunk_index = 0;
+  rs->generation = rep_generation(file);
   rs->raw_window_cache = ffd->raw_window_cache;
   rs->window_cache = ffd->txdelta_window_cache;
   rs->combined_cache = ffd->combined_window_cache;
@@ -3308,7 +3720,7 @@ cache_windows(svn_fs_t *fs,
           SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
           SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
                                                    rs->sfile->rfile->stream,
-                                                   iterpool));
+                                                   rs->ver, iterpool));
 
           /* Read the raw window. */
           buf = apr_palloc(iterpool, window_len + 1);
@@ -3362,6 +3774,12 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
   apr_off_t offset;
   window_cache_key_t key = { 0 };
 
+  /* There are no windows in the rev / pack file for EXTERNAL and CHUNKED
+     reps. */
+  if (   rep_header->type == svn_fs_fs__rep_external
+      || rep_header->type == svn_fs_fs__rep_chunked)
+    return SVN_NO_ERROR;
+
   if (   (rep_header->type != svn_fs_fs__rep_plain
           && (!ffd->txdelta_window_cache || !ffd->raw_window_cache))
       || (rep_header->type == svn_fs_fs__rep_plain
@@ -3378,6 +3796,7 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
     {
       svn_stringbuf_t *plaintext;
       svn_boolean_t is_cached;
+      const char *mapped;
 
       /* already in cache? */
       SVN_ERR(svn_cache__has_key(&is_cached, rs.combined_cache,
@@ -3386,22 +3805,35 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
       if (is_cached)
         return SVN_NO_ERROR;
 
-      /* for larger reps, the header may have crossed a block boundary.
-       * make sure we still read blocks properly aligned, i.e. don't use
-       * plain seek here. */
-      SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
+      mapped = svn_fs_fs__mapped_data(rev_file, offset, (apr_size_t)rs.size);
+      if (mapped)
+        {
+          plaintext = svn_stringbuf_ncreate(mapped, (apr_size_t)rs.size,
+                                            result_pool);
+        }
+      else
+        {
+          /* for larger reps, the header may have crossed a block boundary.
+           * make sure we still read blocks properly aligned, i.e. don't use
+           * plain seek here. */
+          SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset,
+                               scratch_pool));
 
-      plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
-                                     rs.size, &plaintext->len, NULL,
-                                     result_pool));
-      plaintext->data[plaintext->len] = 0;
+          plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
+          SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
+                                         rs.size, &plaintext->len, NULL,
+                                         result_pool));
+          plaintext->data[plaintext->len] = 0;
+        }
       rs.current += rs.size;
 
       SVN_ERR(set_cached_combined_window(plaintext, &rs, scratch_pool));
     }
   else
     {
+      /* The window size limits depend on the actual svndiff version. */
+      rs.ver = -1;
+      SVN_ERR(auto_read_diff_version(&rs, scratch_pool));
       SVN_ERR(cache_windows(fs, &rs, max_offset, scratch_pool));
     }
 
@@ -3417,7 +3849,7 @@ static svn_error_t *
 read_rep_header(svn_fs_fs__rep_header_t **rep_header,
                 svn_fs_t *fs,
                 svn_stream_t *stream,
-                pair_cache_key_t *key,
+                rep_header_cache_key_t *key,
                 apr_pool_t *result_pool,
                 apr_pool_t *scratch_pool)
 {
@@ -3456,11 +3888,12 @@ block_read_contents(svn_fs_t *fs,
                     apr_off_t max_offset,
                     apr_pool_t *scratch_pool)
 {
-  pair_cache_key_t header_key = { 0 };
+  rep_header_cache_key_t header_key = { 0 };
   svn_fs_fs__rep_header_t *rep_header;
 
   header_key.revision = (apr_int32_t)entry->item.revision;
-  header_key.second = entry->item.number;
+  header_key.item_index = entry->item.number;
+  header_key.generation = rep_generation(rev_file);
 
   SVN_ERR(read_rep_header(&rep_header, fs, rev_file->stream, &header_key,
                           scratch_pool, scratch_pool));
@@ -3484,17 +3917,33 @@ read_item(svn_stream_t **stream,
   apr_uint32_t digest;
   svn_checksum_t *expected, *actual;
   apr_uint32_t plain_digest;
+  const char *mapped = svn_fs_fs__mapped_data(rev_file, entry->offset,
+                                              (apr_size_t)entry->size);
 
-  /* Read item into string buffer. */
-  svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
-  text->len = entry->size;
-  text->data[text->len] = 0;
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
-                                 NULL, NULL, pool));
-
-  /* Return (construct, calculate) stream and checksum. */
-  *stream = svn_stream_from_stringbuf(text, pool);
-  digest = svn__fnv1a_32x4(text->data, text->len);
+  if (mapped)
+    {
+      /* Parse the item right from the mapped file.  The mapping will stay
+       * valid for as long as REV_FILE remains open. */
+      svn_string_t *text = apr_palloc(pool, sizeof(*text));
+      text->data = mapped;
+      text->len = (apr_size_t)entry->size;
+
+      *stream = svn_stream_from_string(text, pool);
+      digest = svn__fnv1a_32x4(text->data, text->len);
+    }
+  else
+    {
+      /* Read item into string buffer. */
+      svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
+      text->len = entry->size;
+      text->data[text->len] = 0;
+      SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
+                                     NULL, NULL, pool));
+
+      /* Return (construct, calculate) stream and checksum. */
+      *stream = svn_stream_from_stringbuf(text, pool);
+      digest = svn__fnv1a_32x4(text->data, text->len);
+    }
 
   /* Checksums will match most of the time. */
   if (entry->fnv1_checksum == digest)
@@ -81,6 +81,14 @@ svn_fs_fs__rep_chain_length(int *chain_length,
                             svn_fs_t *fs,
                             apr_pool_t *scratch_pool);
 
+/* Set *IS_EXTERNAL to TRUE if the fulltext of REP in FS has been stored
+   outside the rev / pack file.  Do any allocations in SCRATCH_POOL. */
+svn_error_t *
+svn_fs_fs__rep_is_external(svn_boolean_t *is_external,
+                           representation_t *rep,
+                           svn_fs_t *fs,
+                           apr_pool_t *scratch_pool);
+
 /* Set *CONTENTS_P to be a readable svn_stream_t that receives the text
    representation REP as seen in filesystem FS.  If CACHE_FULLTEXT is
    not set, bypass fulltext cache lookup for this rep and don't put the
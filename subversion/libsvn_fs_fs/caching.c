@@ -492,7 +492,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        1, 200, /* ~40 bytes / entry; 200 entries total */
                        svn_fs_fs__serialize_rep_header,
                        svn_fs_fs__deserialize_rep_header,
-                       sizeof(pair_cache_key_t),
+                       sizeof(rep_header_cache_key_t),
                        apr_pstrcat(pool, prefix, "REPHEADER", SVN_VA_NULL),
                        SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
                        has_namespace,
@@ -123,6 +123,15 @@ fs_serialized_init(svn_fs_t *fs, apr_pool_t *common_pool, apr_pool_t *pool)
          transaction list and free transaction pointer. */
       SVN_ERR(svn_mutex__init(&ffsd->txn_list_lock, TRUE, common_pool));
 
+      /* Group commits queue transactions from any thread. */
+      SVN_ERR(svn_mutex__init(&ffsd->commit_queue_lock, TRUE, common_pool));
+#if APR_HAS_THREADS
+      status = apr_thread_cond_create(&ffsd->commit_queue_cond, common_pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create condition variable"));
+#endif
+
       key = apr_pstrdup(common_pool, key);
       status = apr_pool_userdata_set(ffsd, key, NULL, common_pool);
       if (status)
@@ -26,6 +26,7 @@
 #include <apr_pools.h>
 #include <apr_hash.h>
 #include <apr_network_io.h>
+#include <apr_thread_cond.h>
 #include <apr_md5.h>
 #include <apr_sha1.h>
 
@@ -64,6 +65,9 @@ extern "C" {
 #define PATH_TXN_CURRENT      "txn-current"      /* File with next txn key */
 #define PATH_TXN_CURRENT_LOCK "txn-current-lock" /* Lock for txn-current */
 #define PATH_LOCKS_DIR        "locks"            /* Directory of locks */
+#define PATH_LOCKS_DB         "locks.db"         /* Optional lock database */
+#define PATH_LARGE_DIR        "large"            /* Out-of-line fulltexts */
+#define PATH_CHUNKS_DIR       "chunks"           /* Shared fulltext chunks */
 #define PATH_MIN_UNPACKED_REV "min-unpacked-rev" /* Oldest revision which
                                                     has not been packed. */
 #define PATH_REVPROP_GENERATION "revprop-generation"
@@ -89,6 +93,9 @@ extern "C" {
 #define PATH_EXT_PROPS     ".props"        /* Extension for node props */
 #define PATH_EXT_REV       ".rev"          /* Extension of protorev file */
 #define PATH_EXT_REV_LOCK  ".rev-lock"     /* Extension of protorev lock file */
+#define PATH_EXT_LARGE     ".large"        /* Extension of out-of-line
+                                              fulltext files */
+#define PATH_EXT_CHUNKS    ".chunks"       /* Extension of chunk lists */
 #define PATH_TXN_ITEM_INDEX "itemidx"      /* File containing the current item
                                               index number */
 #define PATH_INDEX          "index"        /* name of index files w/o ext */
@@ -107,6 +114,9 @@ extern "C" {
 #define CONFIG_OPTION_ENABLE_PROPS_DELTIFICATION "enable-props-deltification"
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
+#define CONFIG_OPTION_DELTA_BASE_CANDIDATES      "delta-base-candidates"
+#define CONFIG_OPTION_LARGE_FILE_THRESHOLD       "large-file-threshold"
+#define CONFIG_OPTION_LARGE_FILE_CHUNKING        "large-file-chunking"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
@@ -115,10 +125,16 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_MMAP_FILES         "mmap-files"
+#define CONFIG_OPTION_GROUP_COMMIT       "group-commit"
+#define CONFIG_SECTION_PACKING           "packing"
+#define CONFIG_OPTION_ACCESS_TRACE       "access-trace"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
+#define CONFIG_OPTION_RECORD_ACCESS_TRACE "record-access-trace"
 #define CONFIG_OPTION_COMPRESSION        "compression"
+#define CONFIG_OPTION_LARGE_DELTA_WINDOWS "large-delta-windows"
 
 /* The format number of this filesystem.
    This is independent of the repository format number, and
@@ -127,7 +143,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -200,6 +216,21 @@ extern "C" {
     database. */
 #define SVN_FS_FS__MIN_REP_CACHE_SCHEMA_V2_FORMAT 8
 
+/* The minimum format number that supports file representations stored
+   outside the rev files ("EXTERNAL" rep headers, see structure). */
+#define SVN_FS_FS__MIN_LARGE_FILE_FORMAT 9
+
+/* The minimum format number that supports svndiff version 3. */
+#define SVN_FS_FS__MIN_SVNDIFF3_FORMAT 9
+
+/* The minimum format number that supports recompressed DELTA reps, i.e.
+   "SIZE" in rep headers (see structure). */
+#define SVN_FS_FS__MIN_RECOMPRESSED_REP_FORMAT 9
+
+/* The minimum format number that may keep its locks in a lock database
+   ("locks.db", see structure).  Older releases would ignore those locks. */
+#define SVN_FS_FS__MIN_LOCK_DB_FORMAT 9
+
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
    locks, so we don't have to add our own mutex for just in-process
@@ -239,6 +270,9 @@ typedef struct fs_fs_shared_txn_data_t
   apr_pool_t *pool;
 } fs_fs_shared_txn_data_t;
 
+/* A transaction waiting for a group commit.  See transaction.c. */
+typedef struct fs_fs_queued_commit_t fs_fs_queued_commit_t;
+
 /* Private FSFS-specific data shared between all svn_fs_t objects that
    relate to a particular filesystem, as identified by filesystem UUID.
    Objects of this type are allocated in the common pool. */
@@ -258,7 +292,8 @@ typedef struct fs_fs_shared_data_t
      declaration here.  Any subset may be acquired and held at any given
      time but their relative acquisition order must not change.
 
-     (lock 'txn-current' before 'pack' before 'write' before 'txn-list') */
+     (lock 'txn-current' before 'pack' before 'write' before 'txn-list'
+      or 'commit-queue') */
 
   /* A lock for intra-process synchronization when accessing the TXNS list. */
   svn_mutex__t *txn_list_lock;
@@ -275,6 +310,25 @@ typedef struct fs_fs_shared_data_t
      txn-current file. */
   svn_mutex__t *txn_current_lock;
 
+  /* Transactions waiting for the next group commit, oldest first, and the
+     last entry of that list.  NULL if there are none.  All access to these
+     is synchronised under COMMIT_QUEUE_LOCK. */
+  fs_fs_queued_commit_t *commit_queue;
+  fs_fs_queued_commit_t *commit_queue_last;
+
+  /* A lock for intra-process synchronization when accessing the
+     COMMIT_QUEUE and GROUP_COMMITTING. */
+  svn_mutex__t *commit_queue_lock;
+
+  /* Set while a thread runs a group commit for all queued transactions.
+     Synchronised under COMMIT_QUEUE_LOCK. */
+  svn_boolean_t group_committing;
+
+#if APR_HAS_THREADS
+  /* Signalled under COMMIT_QUEUE_LOCK when a group commit has finished. */
+  apr_thread_cond_t *commit_queue_cond;
+#endif
+
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
@@ -309,8 +363,28 @@ typedef struct window_cache_key_t
 
   /* Item index of the representation */
   apr_uint64_t item_index;
+
+  /* Generation of the rev / pack file containing the representation,
+     see svn_fs_fs__revision_file_t. */
+  apr_uint64_t generation;
 } window_cache_key_t;
 
+/* Key type that identifies a representation header.
+
+   Note: Cache keys should require no padding. */
+typedef struct rep_header_cache_key_t
+{
+  /* The object's revision.  Use the 64 data type to prevent padding. */
+  apr_int64_t revision;
+
+  /* Item index of the representation */
+  apr_uint64_t item_index;
+
+  /* Generation of the rev / pack file containing the representation,
+     see svn_fs_fs__revision_file_t. */
+  apr_uint64_t generation;
+} rep_header_cache_key_t;
+
 typedef enum compression_type_t
 {
   compression_type_none,
@@ -347,6 +421,15 @@ typedef struct fs_fs_data_t
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
 
+  /* Memory mappings of recently used rev / pack files.  NULL if mapping
+   * files has not been enabled or is not supported on this platform. */
+  svn_fs_fs__file_mappings_t *file_mappings;
+
+  /* Generations of the pack files as they have last been opened through
+   * this FS, indexed by shard.  0 for shards not opened, yet.  NULL until
+   * the first pack file gets opened.  See svn_fs_fs__pack_generation. */
+  apr_array_header_t *pack_generations;
+
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
@@ -417,7 +500,7 @@ typedef struct fs_fs_data_t
   svn_cache__t *changes_cache;
 
   /* Cache for svn_fs_fs__rep_header_t objects; the key is a
-     (revision, item index) pair */
+     rep_header_cache_key_t */
   svn_cache__t *rep_header_cache;
 
   /* Cache for svn_mergeinfo_t objects; the key is a combination of
@@ -465,6 +548,10 @@ typedef struct fs_fs_data_t
   /* Thread-safe boolean */
   svn_atomic_t rep_cache_db_opened;
 
+  /* The sqlite database holding the locks, if the repository uses one
+     instead of the digest files.  NULL until it has been found. */
+  svn_sqlite__db_t *lock_db;
+
   /* The oldest revision not in a pack file.  It also applies to revprops
    * if revprop packing has been enabled by the FSFS format version. */
   svn_revnum_t min_unpacked_rev;
@@ -493,18 +580,49 @@ typedef struct fs_fs_data_t
    * deltification history after which skip deltas will be used. */
   apr_int64_t max_linear_deltification;
 
+  /* Maximum number of delta base candidates to compare when writing file
+   * contents.  0 uses the plain skip-delta base. */
+  apr_int64_t delta_base_candidates;
+
+  /* File representations of at least this many bytes will be stored
+   * outside the rev files.  0 disables out-of-line storage. */
+  apr_int64_t large_file_threshold;
+
+  /* Whether to split out-of-line fulltexts into content-defined chunks
+   * that are shared between all representations. */
+  svn_boolean_t large_file_chunking;
+
   /* Compression type to use with txdelta storage format in new revs. */
   compression_type_t delta_compression_type;
 
   /* Compression level (currently, only used with compression_type_zlib). */
   int delta_compression_level;
 
+  /* Write svndiff3 deltas with large windows (requires LZ4 compression). */
+  svn_boolean_t large_delta_windows;
+
+  /* Let concurrent commits within this process share their flushes to
+     disk and their update of the 'current' file. */
+  svn_boolean_t group_commit;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
   /* Verify each new revision before commit. */
   svn_boolean_t verify_before_commit;
 
+  /* Access trace file to order the items in new pack files by.
+     NULL if pack files shall use the default ordering only. */
+  const char *pack_access_trace;
+
+  /* Append the item of every data read to this access trace file.
+     NULL if no trace shall be recorded. */
+  const char *record_access_trace;
+
+  /* The opened RECORD_ACCESS_TRACE file, allocated in the FS pool.
+     NULL until the first access gets recorded. */
+  apr_file_t *access_trace_file;
+
   /* Per-instance filesystem ID, which provides an additional level of
      uniqueness for filesystems that share the same UUID, but should
      still be distinguishable (e.g. backups produced by svn_fs_hotcopy()
@@ -72,6 +72,12 @@
    Values < 1 disable deltification. */
 #define SVN_FS_FS_MAX_DELTIFICATION_WALK 1023
 
+/* File representations of at least this many kBytes will be stored
+   outside the rev files by default.  Below that size, the benefits of
+   not copying the data around during commit and of keeping it out of
+   the caches are small compared to the extra file per representation. */
+#define SVN_FS_FS_LARGE_FILE_THRESHOLD 0x4000
+
 /* Notes:
 
 To avoid opening and closing the rev-files all the time, it would
@@ -683,10 +689,10 @@ verify_block_size(apr_int64_t block_size,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *
-parse_compression_option(compression_type_t *compression_type_p,
-                         int *compression_level_p,
-                         const char *value)
+svn_error_t *
+svn_fs_fs__parse_compression_option(compression_type_t *compression_type_p,
+                                    int *compression_level_p,
+                                    const char *value)
 {
   compression_type_t type;
   int level;
@@ -747,6 +753,7 @@ read_config(fs_fs_data_t *ffd,
             apr_pool_t *scratch_pool)
 {
   svn_config_t *config;
+  apr_int64_t mmap_files;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -779,6 +786,10 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_DELTIFICATION,
                                    CONFIG_OPTION_MAX_LINEAR_DELTIFICATION,
                                    SVN_FS_FS_MAX_LINEAR_DELTIFICATION));
+      SVN_ERR(svn_config_get_int64(config, &ffd->delta_base_candidates,
+                                   CONFIG_SECTION_DELTIFICATION,
+                                   CONFIG_OPTION_DELTA_BASE_CANDIDATES,
+                                   0));
     }
   else
     {
@@ -786,6 +797,26 @@ read_config(fs_fs_data_t *ffd,
       ffd->deltify_properties = FALSE;
       ffd->max_deltification_walk = SVN_FS_FS_MAX_DELTIFICATION_WALK;
       ffd->max_linear_deltification = SVN_FS_FS_MAX_LINEAR_DELTIFICATION;
+      ffd->delta_base_candidates = 0;
+    }
+
+  /* Initialize out-of-line storage settings in ffd. */
+  if (ffd->format >= SVN_FS_FS__MIN_LARGE_FILE_FORMAT)
+    {
+      SVN_ERR(svn_config_get_int64(config, &ffd->large_file_threshold,
+                                   CONFIG_SECTION_DELTIFICATION,
+                                   CONFIG_OPTION_LARGE_FILE_THRESHOLD,
+                                   SVN_FS_FS_LARGE_FILE_THRESHOLD));
+      ffd->large_file_threshold = MAX(ffd->large_file_threshold, 0) * 0x400;
+      SVN_ERR(svn_config_get_bool(config, &ffd->large_file_chunking,
+                                  CONFIG_SECTION_DELTIFICATION,
+                                  CONFIG_OPTION_LARGE_FILE_CHUNKING,
+                                  FALSE));
+    }
+  else
+    {
+      ffd->large_file_threshold = 0;
+      ffd->large_file_chunking = FALSE;
     }
 
   /* Initialize revprop packing settings in ffd. */
@@ -848,6 +879,35 @@ read_config(fs_fs_data_t *ffd,
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
     }
 
+  /* The mappings are shared by all rev files opened through this FS. */
+  SVN_ERR(svn_config_get_int64(config, &mmap_files,
+                               CONFIG_SECTION_IO,
+                               CONFIG_OPTION_MMAP_FILES,
+                               0));
+#if APR_HAS_MMAP
+  ffd->file_mappings
+    = mmap_files > 0
+    ? svn_fs_fs__file_mappings_create((int)MIN(mmap_files, 0x10000),
+                                      result_pool)
+    : NULL;
+#else
+  ffd->file_mappings = NULL;
+#endif
+
+  /* Group commits assume that 'current' contains nothing but the
+     revision number. */
+  if (ffd->format >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT)
+    {
+      SVN_ERR(svn_config_get_bool(config, &ffd->group_commit,
+                                  CONFIG_SECTION_IO,
+                                  CONFIG_OPTION_GROUP_COMMIT,
+                                  FALSE));
+    }
+  else
+    {
+      ffd->group_commit = FALSE;
+    }
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
@@ -880,9 +940,10 @@ read_config(fs_fs_data_t *ffd,
         }
       else if (compression_val)
         {
-          SVN_ERR(parse_compression_option(&ffd->delta_compression_type,
-                                           &ffd->delta_compression_level,
-                                           compression_val));
+          SVN_ERR(svn_fs_fs__parse_compression_option(
+                                        &ffd->delta_compression_type,
+                                        &ffd->delta_compression_level,
+                                        compression_val));
           if (ffd->delta_compression_type == compression_type_lz4 &&
               ffd->format < SVN_FS_FS__MIN_SVNDIFF2_FORMAT)
             {
@@ -925,6 +986,20 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
     }
 
+  /* svndiff3 always uses LZ4, so large windows depend on that. */
+  if (   ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT
+      && ffd->delta_compression_type == compression_type_lz4)
+    {
+      SVN_ERR(svn_config_get_bool(config, &ffd->large_delta_windows,
+                                  CONFIG_SECTION_DELTIFICATION,
+                                  CONFIG_OPTION_LARGE_DELTA_WINDOWS,
+                                  FALSE));
+    }
+  else
+    {
+      ffd->large_delta_windows = FALSE;
+    }
+
 #ifdef SVN_DEBUG
   SVN_ERR(svn_config_get_bool(config, &ffd->verify_before_commit,
                               CONFIG_SECTION_DEBUG,
@@ -937,6 +1012,36 @@ read_config(fs_fs_data_t *ffd,
                               FALSE));
 #endif
 
+  /* Access traces only make sense where pack files get their items
+     reordered, i.e. with logical addressing. */
+  if (ffd->format >= SVN_FS_FS__MIN_LOG_ADDRESSING_FORMAT)
+    {
+      const char *trace_path;
+
+      svn_config_get(config, &trace_path, CONFIG_SECTION_PACKING,
+                     CONFIG_OPTION_ACCESS_TRACE, NULL);
+      ffd->pack_access_trace
+        = trace_path && *trace_path
+        ? svn_dirent_join(fs_path, svn_dirent_internal_style(trace_path,
+                                                             scratch_pool),
+                          result_pool)
+        : NULL;
+
+      svn_config_get(config, &trace_path, CONFIG_SECTION_DEBUG,
+                     CONFIG_OPTION_RECORD_ACCESS_TRACE, NULL);
+      ffd->record_access_trace
+        = trace_path && *trace_path
+        ? svn_dirent_join(fs_path, svn_dirent_internal_style(trace_path,
+                                                             scratch_pool),
+                          result_pool)
+        : NULL;
+    }
+  else
+    {
+      ffd->pack_access_trace = NULL;
+      ffd->record_access_trace = NULL;
+    }
+
   /* memcached configuration */
   SVN_ERR(svn_cache__make_memcache_from_config(&ffd->memcache, config,
                                                result_pool, scratch_pool));
@@ -1055,6 +1160,46 @@ write_config(svn_fs_t *fs,
 "### For 1.8, the default value is 16; earlier versions use 1."              NL
 "# " CONFIG_OPTION_MAX_LINEAR_DELTIFICATION " = 16"                          NL
 "###"                                                                        NL
+"### By default, file contents get deltified against the base picked by"     NL
+"### the scheme above, i.e. against some earlier version of the same node."  NL
+"### Setting this to a positive number N makes the server compare up to N"   NL
+"### candidate bases instead:  the default base, the previous version of"    NL
+"### the node (which is the copy source for copied nodes) and, for files"    NL
+"### without history, recently committed contents of similar size found in"  NL
+"### the rep-cache.  The server estimates the delta size against each"       NL
+"### candidate from the first 64 kBytes of the new contents and uses the"    NL
+"### best one.  This helps with files that have been added instead of"       NL
+"### copied, e.g. by merges between unrelated branches or by imports."       NL
+"### Every candidate adds some CPU and I/O overhead to the commit."          NL
+"### The default value is 0, i.e. only the default base is used."            NL
+"# " CONFIG_OPTION_DELTA_BASE_CANDIDATES " = 0"                              NL
+"###"                                                                        NL
+"### File contents of at least this many kBytes will not be stored in the"   NL
+"### revision files but in separate files, one per distinct content, in"     NL
+"### the '" PATH_LARGE_DIR "' folder.  Such contents are stored as a whole,"  NL
+"### i.e. they are neither deltified nor compressed and never serve as"      NL
+"### delta base.  Reading them requires no reconstruction and bypasses"      NL
+"### the caches, so very large files don't push other data out of the"       NL
+"### caches.  The size is compared to the content's deltified size, i.e."    NL
+"### files that deltify well against their previous version will still"      NL
+"### be stored in the revision files.  A value of 0 disables this feature."  NL
+"### Out-of-line storage is supported, starting from format 9 repositories," NL
+"### available in Subversion 1.11 and higher."                               NL
+"### The default value is 16384 (16 MB)."                                    NL
+"# " CONFIG_OPTION_LARGE_FILE_THRESHOLD " = 16384"                           NL
+"###"                                                                        NL
+"### If enabled, such out-of-line contents are split into chunks at"         NL
+"### content-defined boundaries and each distinct chunk is stored only"      NL
+"### once in the '" PATH_CHUNKS_DIR "' folder.  Versions of a large file"  NL
+"### that only differ in a few places then share most of their chunks,"      NL
+"### which saves disk space.  Commits don't get cheaper, though: they"       NL
+"### still write the contents as a delta first and read that back to"        NL
+"### split it into chunks.  Reading chunked contents requires one file"      NL
+"### access per chunk.  Chunking is supported, starting from format 9"       NL
+"### repositories, available in Subversion 1.11 and higher."                 NL
+"### The default value is false."                                            NL
+"# " CONFIG_OPTION_LARGE_FILE_CHUNKING " = false"                            NL
+"###"                                                                        NL
 "### After deltification, we compress the data to minimize on-disk size."    NL
 "### This setting controls the compression algorithm, which will be used in" NL
 "### future revisions.  It can be used to either disable compression or to"  NL
@@ -1073,6 +1218,16 @@ write_config(svn_fs_t *fs,
 "### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5'."         NL
 "# " CONFIG_OPTION_COMPRESSION " = lz4"                                      NL
 "###"                                                                        NL
+"### With lz4 compression, deltas may span up to 1 MB of the file per delta" NL
+"### window instead of the default 100 kB.  This finds more matches within"  NL
+"### large files whose contents move around, at the expense of more memory"  NL
+"### during commits.  Such deltas cannot be passed on to clients as they"    NL
+"### are but must be recomputed, so this makes checkouts and updates more"   NL
+"### expensive for the server.  Large delta windows are supported, starting" NL
+"### from format 9 repositories, available in Subversion 1.11 and higher."   NL
+"### The default value is false."                                            NL
+"# " CONFIG_OPTION_LARGE_DELTA_WINDOWS " = false"                            NL
+"###"                                                                        NL
 "### DEPRECATED: The new '" CONFIG_OPTION_COMPRESSION "' option deprecates previously used" NL
 "### '" CONFIG_OPTION_COMPRESSION_LEVEL "' option, which was used to configure zlib compression." NL
 "### For compatibility with previous versions of Subversion, this option can"NL
@@ -1147,6 +1302,44 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### Rev and pack files may be mapped into memory instead of being read"     NL
+"### through file buffers.  Index lookups and reading small items then"      NL
+"### become simple memory accesses and repeated reads of the same data"      NL
+"### don't require any system calls.  This option sets the maximum number"   NL
+"### of files kept mapped per open repository (least recently used files"    NL
+"### get unmapped first).  On 32 bit systems, large pack files may quickly"  NL
+"### exhaust the address space, so keep this low there.  Files being"        NL
+"### truncated or replaced while mapped (e.g. by 'svnadmin load-index')"     NL
+"### are detected when they get opened next time."                           NL
+"### mmap-files is 0 (disabled) by default."                                 NL
+"# " CONFIG_OPTION_MMAP_FILES " = 0"                                         NL
+"###"                                                                        NL
+"### Every commit flushes its revision data and the 'current' file to disk"  NL
+"### before it completes, so the commit rate is limited by the latency of"   NL
+"### those flushes.  With group commits enabled, the transactions that"      NL
+"### other threads of the same process want to commit while the repository"  NL
+"### is locked get committed back-to-back as consecutive revisions.  They"   NL
+"### share a single round of flushes and become visible together.  This"     NL
+"### speeds up servers with many concurrent committers, e.g. a threaded"     NL
+"### Apache MPM, on storage with slow flushes.  Group commits require"       NL
+"### format 3 repositories or later and Subversion 1.11 or higher."          NL
+"### group-commit is false by default."                                      NL
+"# " CONFIG_OPTION_GROUP_COMMIT " = false"                                   NL
+""                                                                           NL
+"[" CONFIG_SECTION_PACKING "]"                                               NL
+"### 'svnadmin pack' places the items of a shard in an order that keeps"     NL
+"### the data typically needed for a checkout of HEAD close together."       NL
+"### If the actual read pattern of the repository is known, it can be used"  NL
+"### instead:  All items read in the given access trace will be put at the"  NL
+"### front of their pack file, in the order they were first read, so data"   NL
+"### that is read together shares the same blocks.  All other items follow" NL
+"### in the default order.  Use '" CONFIG_OPTION_RECORD_ACCESS_TRACE "' in the"          NL
+"### [" CONFIG_SECTION_DEBUG "] section to record such a trace.  Relative paths are"     NL
+"### relative to the db directory.  Access traces require format 7"          NL
+"### repositories or later and Subversion 1.11 or higher."                   NL
+"### The default is to use no trace."                                        NL
+"# " CONFIG_OPTION_ACCESS_TRACE " = access-trace"                            NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1154,6 +1347,14 @@ write_config(svn_fs_t *fs,
 "### the commit. The default is false in release-mode builds, and true"      NL
 "### in debug-mode builds."                                                  NL
 "# " CONFIG_OPTION_VERIFY_BEFORE_COMMIT " = false"                           NL
+"###"                                                                        NL
+"### Append one line '<revision> <item index>' for every item read from a"   NL
+"### revision or pack file to the given file.  This records the read"        NL
+"### pattern of a real-world workload for use with the [" CONFIG_SECTION_PACKING "]" NL
+"### " CONFIG_OPTION_ACCESS_TRACE " option.  Tracing slows down all read access."         NL
+"### Relative paths are relative to the db directory.  The default is to"   NL
+"### record no trace."                                                       NL
+"# " CONFIG_OPTION_RECORD_ACCESS_TRACE " = access-trace"                     NL
 ;
 #undef NL
   return svn_io_file_create(svn_dirent_join(fs->path, PATH_CONFIG, pool),
@@ -1951,6 +2152,9 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 9: format = 7;
                   break;
 
+          case 10: format = 8;
+                   break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -2322,8 +2526,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 11;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
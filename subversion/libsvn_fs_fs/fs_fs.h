@@ -30,6 +30,14 @@
 svn_error_t *
 svn_fs_fs__read_format_file(svn_fs_t *fs, apr_pool_t *scratch_pool);
 
+/* Parse VALUE, given in the syntax of the 'compression' option in
+ * fsfs.conf, i.e. "none", "lz4", "zlib" or "zlib-1" ... "zlib-9", and
+ * return the result in *COMPRESSION_TYPE_P and *COMPRESSION_LEVEL_P. */
+svn_error_t *
+svn_fs_fs__parse_compression_option(compression_type_t *compression_type_p,
+                                    int *compression_level_p,
+                                    const char *value);
+
 /* Open the fsfs filesystem pointed to by PATH and associate it with
    filesystem object FS.  Use POOL for temporary allocations.
 
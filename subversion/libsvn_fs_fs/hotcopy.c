@@ -918,6 +918,29 @@ hotcopy_body(void *baton, apr_pool_t *pool)
   SVN_ERR(svn_io_make_dir_recursively(dst_revs_dir, pool));
   SVN_ERR(svn_io_make_dir_recursively(dst_revprops_dir, pool));
 
+  /* Copy the out-of-line fulltexts before any revision referring to them
+   * becomes visible in the destination.  They are never modified, so
+   * files that already exist in the destination will be skipped.
+   * Chunk lists refer to chunks, so copy those first. */
+  if (src_ffd->format >= SVN_FS_FS__MIN_LARGE_FILE_FORMAT)
+    {
+      src_subdir = svn_dirent_join(src_fs->path, PATH_CHUNKS_DIR, pool);
+      SVN_ERR(svn_io_check_path(src_subdir, &kind, pool));
+      if (kind == svn_node_dir)
+        SVN_ERR(hotcopy_io_copy_dir_recursively(NULL, src_subdir,
+                                                dst_fs->path, PATH_CHUNKS_DIR,
+                                                TRUE, cancel_func,
+                                                cancel_baton, pool));
+
+      src_subdir = svn_dirent_join(src_fs->path, PATH_LARGE_DIR, pool);
+      SVN_ERR(svn_io_check_path(src_subdir, &kind, pool));
+      if (kind == svn_node_dir)
+        SVN_ERR(hotcopy_io_copy_dir_recursively(NULL, src_subdir,
+                                                dst_fs->path, PATH_LARGE_DIR,
+                                                TRUE, cancel_func,
+                                                cancel_baton, pool));
+    }
+
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
@@ -959,6 +982,18 @@ hotcopy_body(void *baton, apr_pool_t *pool)
                                         PATH_LOCKS_DIR, TRUE,
                                         cancel_func, cancel_baton, pool));
 
+  /* Same for the lock database, which replaces the locks tree once it
+   * has been migrated. */
+  dst_subdir = svn_dirent_join(dst_fs->path, PATH_LOCKS_DB, pool);
+  SVN_ERR(svn_io_remove_file2(dst_subdir, TRUE, pool));
+  src_subdir = svn_dirent_join(src_fs->path, PATH_LOCKS_DB, pool);
+  SVN_ERR(svn_io_check_path(src_subdir, &kind, pool));
+  if (kind == svn_node_file)
+    {
+      SVN_ERR(svn_sqlite__hotcopy(src_subdir, dst_subdir, pool));
+      SVN_ERR(svn_io_set_file_read_write(dst_subdir, FALSE, pool));
+    }
+
   /* Now copy the node-origins cache tree. */
   src_subdir = svn_dirent_join(src_fs->path, PATH_NODE_ORIGINS_DIR, pool);
   SVN_ERR(svn_io_check_path(src_subdir, &kind, pool));
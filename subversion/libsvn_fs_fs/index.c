@@ -28,6 +28,7 @@
 
 #include "svn_private_config.h"
 
+#include "private/svn_eol_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_temp_serializer.h"
@@ -211,6 +212,11 @@ struct svn_fs_fs__packed_number_stream_t
   /* read the file in chunks of this size */
   apr_size_t block_size;
 
+  /* If not NULL, the stream data (starting at STREAM_START) mapped into
+   * memory.  We will then decode directly from it instead of reading
+   * FILE. */
+  const unsigned char *mapped_data;
+
   /* pool to be used for file ops etc. */
   apr_pool_t *pool;
 
@@ -250,43 +256,58 @@ SVN__PREVENT_INLINE
 static svn_error_t *
 packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 {
-  unsigned char buffer[MAX_NUMBER_PREFETCH];
+  unsigned char local_buffer[MAX_NUMBER_PREFETCH];
+  const unsigned char *buffer = local_buffer;
   apr_size_t bytes_read = 0;
   apr_size_t i;
   value_position_pair_t *target;
   apr_off_t block_start = 0;
   apr_off_t block_left = 0;
-  apr_status_t err;
+  apr_status_t err = APR_SUCCESS;
 
   /* all buffered data will have been read starting here */
   stream->start_offset = stream->next_offset;
 
-  /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH blocks,
-   * i.e. the last number has been incomplete (and not buffered in stream)
-   * and need to be re-read.  Therefore, always correct the file pointer.
-   */
-  SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
-                                   &block_start, stream->next_offset,
-                                   stream->pool));
+  if (stream->mapped_data)
+    {
+      /* No I/O and no need to respect block boundaries.  Simply decode
+       * the next numbers right from the mapped file data. */
+      buffer = stream->mapped_data
+             + (stream->next_offset - stream->stream_start);
+      if (stream->next_offset < stream->stream_end)
+        bytes_read = (apr_size_t)MIN(MAX_NUMBER_PREFETCH,
+                                     stream->stream_end - stream->next_offset);
+    }
+  else
+    {
+      /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH
+       * blocks, i.e. the last number has been incomplete (and not buffered
+       * in stream) and need to be re-read.  Therefore, always correct the
+       * file pointer.
+       */
+      SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
+                                       &block_start, stream->next_offset,
+                                       stream->pool));
 
-  /* prefetch at least one number but, if feasible, don't cross block
-   * boundaries.  This shall prevent jumping back and forth between two
-   * blocks because the extra data was not actually request _now_.
-   */
-  bytes_read = sizeof(buffer);
-  block_left = stream->block_size - (stream->next_offset - block_start);
-  if (block_left >= 10 && block_left < bytes_read)
-    bytes_read = (apr_size_t)block_left;
-
-  /* Don't read beyond the end of the file section that belongs to this
-   * index / stream. */
-  bytes_read = (apr_size_t)MIN(bytes_read,
-                               stream->stream_end - stream->next_offset);
-
-  err = apr_file_read(stream->file, buffer, &bytes_read);
-  if (err && !APR_STATUS_IS_EOF(err))
-    return stream_error_create(stream, err,
-      _("Can't read index file '%s' at offset 0x%s"));
+      /* prefetch at least one number but, if feasible, don't cross block
+       * boundaries.  This shall prevent jumping back and forth between two
+       * blocks because the extra data was not actually request _now_.
+       */
+      bytes_read = sizeof(local_buffer);
+      block_left = stream->block_size - (stream->next_offset - block_start);
+      if (block_left >= 10 && block_left < bytes_read)
+        bytes_read = (apr_size_t)block_left;
+
+      /* Don't read beyond the end of the file section that belongs to this
+       * index / stream. */
+      bytes_read = (apr_size_t)MIN(bytes_read,
+                                   stream->stream_end - stream->next_offset);
+
+      err = apr_file_read(stream->file, local_buffer, &bytes_read);
+      if (err && !APR_STATUS_IS_EOF(err))
+        return stream_error_create(stream, err,
+          _("Can't read index file '%s' at offset 0x%s"));
+    }
 
   /* if the last number is incomplete, trim it from the buffer */
   while (bytes_read > 0 && buffer[bytes_read-1] >= 0x80)
@@ -302,6 +323,26 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
   target = stream->buffer;
   for (i = 0; i < bytes_read;)
     {
+#if SVN_UNALIGNED_ACCESS_IS_OK
+      /* Check a whole machine word for continuation bits at once.  If
+       * there are none, it contains only small numbers that we expand
+       * without further checks. */
+      if (   bytes_read - i >= sizeof(apr_uintptr_t)
+          && (*(const apr_uintptr_t *)(buffer + i) & SVN__BIT_7_SET) == 0)
+        {
+          apr_size_t k;
+          for (k = 0; k < sizeof(apr_uintptr_t); ++k)
+            {
+              target->value = buffer[i];
+              ++i;
+              target->total_len = i;
+              ++target;
+            }
+
+          continue;
+        }
+#endif
+
       if (buffer[i] < 0x80)
         {
           /* numbers < 128 are relatively frequent and particularly easy
@@ -344,13 +385,14 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 }
 
 /* Create and open a packed number stream reading from offsets START to
- * END in FILE and return it in *STREAM.  Access the file in chunks of
- * BLOCK_SIZE bytes.  Expect the stream to be prefixed by STREAM_PREFIX.
- * Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ * END in REV_FILE and return it in *STREAM.  Access the file in chunks of
+ * BLOCK_SIZE bytes, unless it has been mapped into memory.  Expect the
+ * stream to be prefixed by STREAM_PREFIX.  Allocate *STREAM in RESULT_POOL
+ * and use SCRATCH_POOL for temporaries.
  */
 static svn_error_t *
 packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
-                   apr_file_t *file,
+                   svn_fs_fs__revision_file_t *rev_file,
                    apr_off_t start,
                    apr_off_t end,
                    const char *stream_prefix,
@@ -361,16 +403,28 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
   char buffer[STREAM_PREFIX_LEN + 1] = { 0 };
   apr_size_t len = strlen(stream_prefix);
   svn_fs_fs__packed_number_stream_t *result;
+  const char *mapped = NULL;
 
   /* If this is violated, we forgot to adjust STREAM_PREFIX_LEN after
    * changing the index header prefixes. */
   SVN_ERR_ASSERT(len < sizeof(buffer));
 
   /* Read the header prefix and compare it with the expected prefix */
-  SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
-                                   scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
-                                 scratch_pool));
+  if (start <= end)
+    mapped = svn_fs_fs__mapped_data(rev_file, start,
+                                    (apr_size_t)(end - start));
+  if (mapped && len <= end - start)
+    {
+      memcpy(buffer, mapped, len);
+    }
+  else
+    {
+      mapped = NULL;
+      SVN_ERR(svn_io_file_aligned_seek(rev_file->file, block_size, NULL,
+                                       start, scratch_pool));
+      SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, len, NULL, NULL,
+                                     scratch_pool));
+    }
 
   if (strncmp(buffer, stream_prefix, len))
     return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
@@ -382,7 +436,7 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
   result = apr_palloc(result_pool, sizeof(*result));
 
   result->pool = result_pool;
-  result->file = file;
+  result->file = rev_file->file;
   result->stream_start = start + len;
   result->stream_end = end;
 
@@ -391,6 +445,9 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
   result->start_offset = result->stream_start;
   result->next_offset = result->stream_start;
   result->block_size = block_size;
+  result->mapped_data = mapped
+                      ? (const unsigned char *)mapped + len
+                      : NULL;
 
   *stream = result;
 
@@ -464,6 +521,43 @@ packed_stream_offset(svn_fs_fs__packed_number_stream_t *stream)
   return file_offset - stream->stream_start;
 }
 
+/* Return in *DATA the SIZE raw, i.e. still encoded, bytes found at packed
+ * stream offset OFFSET in STREAM.  Point into the mapped file if that is
+ * available and read the bytes into a buffer allocated in RESULT_POOL
+ * otherwise.  The state of STREAM does not change.
+ */
+static svn_error_t *
+packed_stream_raw_data(const unsigned char **data,
+                       svn_fs_fs__packed_number_stream_t *stream,
+                       apr_off_t offset,
+                       apr_size_t size,
+                       apr_pool_t *result_pool)
+{
+  apr_off_t file_offset = offset + stream->stream_start;
+  unsigned char *buffer;
+
+  if (   offset < 0
+      || file_offset > stream->stream_end
+      || size > stream->stream_end - file_offset)
+    return stream_error_create(stream, SVN_ERR_FS_INDEX_CORRUPTION,
+      _("Index file %s section at offset 0x%s exceeds the index"));
+
+  if (stream->mapped_data)
+    {
+      *data = stream->mapped_data + offset;
+      return SVN_NO_ERROR;
+    }
+
+  buffer = apr_palloc(result_pool, size);
+  SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size, NULL,
+                                   file_offset, result_pool));
+  SVN_ERR(svn_io_file_read_full2(stream->file, buffer, size, NULL, NULL,
+                                 result_pool));
+  *data = buffer;
+
+  return SVN_NO_ERROR;
+}
+
 /* Encode VALUE as 7/8b into P and return the number of bytes written.
  * This will be used when _writing_ packed data.  packed_stream_* is for
  * read operations only.
@@ -512,6 +606,116 @@ decode_int(apr_uint64_t value)
   return (apr_int64_t)(value % 2 ? -1 - value / 2 : value / 2);
 }
 
+/* Decode the 7b/8b encoded unsigned integer starting at P into *VALUE
+ * without reading beyond END.  Return a pointer to the first byte behind
+ * the number or NULL if the number was incomplete or too large.
+ */
+static const unsigned char *
+decode_uint_checked(apr_uint64_t *value,
+                    const unsigned char *p,
+                    const unsigned char *end)
+{
+  apr_uint64_t result = 0;
+  int shift = 0;
+
+  while (p < end && *p >= 0x80)
+    {
+      if (shift > 8 * (int)sizeof(result) - 7)
+        return NULL;
+
+      result |= (apr_uint64_t)(*p & 0x7f) << shift;
+      shift += 7;
+      ++p;
+    }
+
+  if (p == end)
+    return NULL;
+
+  *value = result | ((apr_uint64_t)*p << shift);
+  return p + 1;
+}
+
+/* Decode the COUNT entries of an L2P page from the SIZE bytes of raw
+ * index data at DATA and write the absolute item offsets to OFFSETS.
+ * The data must contain exactly COUNT numbers.
+ *
+ * L2P pages are long runs of small deltas, most of which fit into one to
+ * three bytes.  Decode those a machine word or a number at a time without
+ * any per-byte bounds check and fall back to the generic decoder only near
+ * the end of the data and for larger numbers.
+ */
+static svn_error_t *
+decode_l2p_page(apr_uint64_t *offsets,
+                apr_uint32_t count,
+                const unsigned char *data,
+                apr_size_t size)
+{
+  const unsigned char *p = data;
+  const unsigned char *end = data + size;
+  apr_uint64_t last_value = 0;
+  apr_uint32_t i;
+
+  for (i = 0; i < count; ++i)
+    {
+      apr_uint64_t value;
+
+#if SVN_UNALIGNED_ACCESS_IS_OK
+      /* Runs of small deltas: expand a whole machine word at once. */
+      if (   count - i >= sizeof(apr_uintptr_t)
+          && (apr_size_t)(end - p) >= sizeof(apr_uintptr_t)
+          && (*(const apr_uintptr_t *)p & SVN__BIT_7_SET) == 0)
+        {
+          apr_size_t k;
+          for (k = 0; k < sizeof(apr_uintptr_t); ++k)
+            {
+              last_value += decode_int(p[k]);
+              offsets[i + k] = last_value - 1;
+            }
+
+          p += sizeof(apr_uintptr_t);
+          i += sizeof(apr_uintptr_t) - 1;
+          continue;
+        }
+#endif
+
+      if (end - p >= 3 && p[0] < 0x80)
+        {
+          value = p[0];
+          p += 1;
+        }
+      else if (end - p >= 3 && p[1] < 0x80)
+        {
+          value = (apr_uint64_t)(p[0] & 0x7f)
+                | ((apr_uint64_t)p[1] << 7);
+          p += 2;
+        }
+      else if (end - p >= 3 && p[2] < 0x80)
+        {
+          value = (apr_uint64_t)(p[0] & 0x7f)
+                | ((apr_uint64_t)(p[1] & 0x7f) << 7)
+                | ((apr_uint64_t)p[2] << 14);
+          p += 3;
+        }
+      else
+        {
+          p = decode_uint_checked(&value, p, end);
+          if (p == NULL)
+            return svn_error_create(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                                    _("Corrupt L2P index page"));
+        }
+
+      last_value += decode_int(value);
+      offsets[i] = last_value - 1;
+    }
+
+  /* All page data must have been consumed. */
+  if (p != end)
+    return svn_error_create(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                _("L2P actual page size does not match page table value."));
+
+  return SVN_NO_ERROR;
+}
+
 /* Write VALUE to the PROTO_INDEX file, using SCRATCH_POOL for temporary
  * allocations.
  *
@@ -946,7 +1150,7 @@ auto_open_l2p_index(svn_fs_fs__revision_file_t *rev_file,
 
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->l2p_stream,
-                                 rev_file->file,
+                                 rev_file,
                                  rev_file->l2p_offset,
                                  rev_file->p2l_offset,
                                  L2P_STREAM_PREFIX,
@@ -958,6 +1162,19 @@ auto_open_l2p_index(svn_fs_fs__revision_file_t *rev_file,
   return SVN_NO_ERROR;
 }
 
+/* Set *KEY to the cache key of the index headers in REV_FILE.  The index
+ * changes whenever the file gets replaced, so the key includes the file's
+ * generation next to the packed flag.
+ */
+static void
+header_cache_key(pair_cache_key_t *key,
+                 svn_fs_fs__revision_file_t *rev_file)
+{
+  key->revision = rev_file->start_revision;
+  key->second = (apr_int64_t)(  (rev_file->generation << 1)
+                              | (rev_file->is_packed ? 1 : 0));
+}
+
 /* Read the header data structure of the log-to-phys index for REVISION
  * in FS and return it in *HEADER, allocated in RESULT_POOL.  Use REV_FILE
  * to access on-disk data.  Use SCRATCH_POOL for temporary allocations.
@@ -980,8 +1197,7 @@ get_l2p_header_body(l2p_header_t **header,
   svn_revnum_t next_rev;
 
   pair_cache_key_t key;
-  key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  header_cache_key(&key, rev_file);
 
   SVN_ERR(auto_open_l2p_index(rev_file, fs, revision));
   packed_stream_seek(rev_file->l2p_stream, 0);
@@ -1212,8 +1428,7 @@ get_l2p_page_info(l2p_page_info_baton_t *baton,
 
   /* try to find the info in the cache */
   pair_cache_key_t key;
-  key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  header_cache_key(&key, rev_file);
   SVN_ERR(svn_cache__get_partial((void**)&dummy, &is_cached,
                                  ffd->l2p_header_cache, &key,
                                  l2p_page_info_access_func, baton,
@@ -1302,8 +1517,7 @@ get_l2p_page_table(apr_array_header_t *pages,
   l2p_page_table_baton_t baton;
 
   pair_cache_key_t key;
-  key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  header_cache_key(&key, rev_file);
 
   apr_array_clear(pages);
   baton.revision = revision;
@@ -1329,34 +1543,23 @@ get_l2p_page(l2p_page_t **page,
              l2p_page_table_entry_t *table_entry,
              apr_pool_t *result_pool)
 {
-  apr_uint32_t i;
   l2p_page_t *result = apr_pcalloc(result_pool, sizeof(*result));
-  apr_uint64_t last_value = 0;
+  const unsigned char *data;
 
-  /* open index file and select page */
+  /* open index file and fetch the whole page in one go */
   SVN_ERR(auto_open_l2p_index(rev_file, fs, start_revision));
-  packed_stream_seek(rev_file->l2p_stream, table_entry->offset);
+  SVN_ERR(packed_stream_raw_data(&data, rev_file->l2p_stream,
+                                 (apr_off_t)table_entry->offset,
+                                 table_entry->size, result_pool));
 
   /* initialize the page content */
   result->entry_count = table_entry->entry_count;
   result->offsets = apr_pcalloc(result_pool, result->entry_count
                                            * sizeof(*result->offsets));
 
-  /* read all page entries (offsets in rev file and container sub-items) */
-  for (i = 0; i < result->entry_count; ++i)
-    {
-      apr_uint64_t value = 0;
-      SVN_ERR(packed_stream_get(&value, rev_file->l2p_stream));
-      last_value += decode_int(value);
-      result->offsets[i] = last_value - 1;
-    }
-
-  /* After reading all page entries, the read cursor must have moved by
-   * TABLE_ENTRY->SIZE bytes. */
-  if (   packed_stream_offset(rev_file->l2p_stream)
-      != table_entry->offset + table_entry->size)
-    return svn_error_create(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
-                _("L2P actual page size does not match page table value."));
+  /* decode all page entries (offsets in rev file and container sub-items) */
+  SVN_ERR(decode_l2p_page(result->offsets, result->entry_count, data,
+                          table_entry->size));
 
   *page = result;
 
@@ -1416,6 +1619,7 @@ prefetch_l2p_pages(svn_boolean_t *end,
   assert(revision <= APR_UINT32_MAX);
   key.revision = (apr_uint32_t)revision;
   key.is_packed = rev_file->is_packed;
+  key.generation = rev_file->generation;
 
   for (i = 0; i < pages->nelts && !*end; ++i)
     {
@@ -1555,6 +1759,7 @@ l2p_index_lookup(apr_off_t *offset,
   assert(revision <= APR_UINT32_MAX);
   key.revision = (apr_uint32_t)revision;
   key.is_packed = svn_fs_fs__is_packed_rev(fs, revision);
+  key.generation = rev_file->generation;
   key.page = info_baton.page_no;
 
   SVN_ERR(svn_cache__get_partial(&dummy, &is_cached,
@@ -1692,8 +1897,7 @@ get_l2p_header(l2p_header_t **header,
 
   /* first, try cache lookop */
   pair_cache_key_t key;
-  key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  header_cache_key(&key, rev_file);
   SVN_ERR(svn_cache__get((void**)header, &is_cached, ffd->l2p_header_cache,
                          &key, result_pool));
   if (is_cached)
@@ -1767,6 +1971,159 @@ svn_fs_fs__l2p_get_max_ids(apr_array_header_t **max_ids,
   return SVN_NO_ERROR;
 }
 
+/* One request in a batched L2P index lookup.
+ */
+typedef struct l2p_batch_entry_t
+{
+  /* location of the L2P page that contains the item */
+  l2p_page_table_entry_t entry;
+
+  /* the item to look up */
+  svn_revnum_t revision;
+  apr_uint64_t item_index;
+
+  /* page number within the pages for REVISION and offset within it */
+  apr_uint32_t page_no;
+  apr_uint32_t page_offset;
+
+  /* position of this request in the caller's array */
+  int index;
+} l2p_batch_entry_t;
+
+/* qsort()-compatible comparison function ordering l2p_batch_entry_t
+ * by their page's position in the index file.
+ */
+static int
+compare_l2p_batch_entries(const void *lhs,
+                          const void *rhs)
+{
+  const l2p_batch_entry_t *lhs_entry = lhs;
+  const l2p_batch_entry_t *rhs_entry = rhs;
+
+  if (lhs_entry->entry.offset != rhs_entry->entry.offset)
+    return lhs_entry->entry.offset < rhs_entry->entry.offset ? -1 : 1;
+
+  return lhs_entry->index - rhs_entry->index;
+}
+
+/* Using the log-to-phys indexes in FS, find the absolute offsets in the
+ * rev file for all svn_fs_fs__id_part_t in ITEMS and return them in the
+ * respective elements of OFFSETS.  All items must be covered by the
+ * index in REV_FILE.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+l2p_index_batch_lookup(apr_off_t *offsets,
+                       svn_fs_t *fs,
+                       svn_fs_fs__revision_file_t *rev_file,
+                       const apr_array_header_t *items,
+                       apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  l2p_header_t *header;
+  l2p_batch_entry_t *batch;
+  apr_pool_t *iterpool;
+  svn_fs_fs__page_cache_key_t key = { 0 };
+  int i, first, last;
+
+  /* Map all items to their L2P pages using a single copy of the header. */
+  SVN_ERR(get_l2p_header(&header, rev_file, fs,
+                         APR_ARRAY_IDX(items, 0, svn_fs_fs__id_part_t).revision,
+                         scratch_pool, scratch_pool));
+
+  batch = apr_palloc(scratch_pool, items->nelts * sizeof(*batch));
+  for (i = 0; i < items->nelts; ++i)
+    {
+      const svn_fs_fs__id_part_t *item
+        = &APR_ARRAY_IDX(items, i, svn_fs_fs__id_part_t);
+      l2p_page_info_baton_t info_baton;
+
+      info_baton.revision = item->revision;
+      info_baton.item_index = item->number;
+      SVN_ERR(l2p_page_info_copy(&info_baton, header, header->page_table,
+                                 header->page_table_index, scratch_pool));
+
+      batch[i].entry = info_baton.entry;
+      batch[i].revision = item->revision;
+      batch[i].item_index = item->number;
+      batch[i].page_no = info_baton.page_no;
+      batch[i].page_offset = info_baton.page_offset;
+      batch[i].index = i;
+    }
+
+  /* Process the pages in file order and each one only once. */
+  qsort(batch, items->nelts, sizeof(*batch), compare_l2p_batch_entries);
+
+  iterpool = svn_pool_create(scratch_pool);
+  key.is_packed = rev_file->is_packed;
+  key.generation = rev_file->generation;
+  for (first = 0; first < items->nelts; first = last)
+    {
+      l2p_page_t *page = NULL;
+      svn_boolean_t is_cached = FALSE;
+
+      svn_pool_clear(iterpool);
+
+      last = first + 1;
+      while (   last < items->nelts
+             && batch[last].entry.offset == batch[first].entry.offset)
+        ++last;
+
+      assert(batch[first].revision <= APR_UINT32_MAX);
+      key.revision = (apr_uint32_t)batch[first].revision;
+      key.page = batch[first].page_no;
+
+      if (last - first == 1)
+        {
+          /* Single item -> don't copy the whole page out of the cache. */
+          l2p_entry_baton_t page_baton;
+          void *dummy = NULL;
+
+          page_baton.revision = batch[first].revision;
+          page_baton.item_index = batch[first].item_index;
+          page_baton.page_offset = batch[first].page_offset;
+          SVN_ERR(svn_cache__get_partial(&dummy, &is_cached,
+                                         ffd->l2p_page_cache, &key,
+                                         l2p_entry_access_func, &page_baton,
+                                         iterpool));
+          if (is_cached)
+            {
+              offsets[batch[first].index] = page_baton.offset;
+              continue;
+            }
+        }
+      else
+        {
+          SVN_ERR(svn_cache__get((void **)&page, &is_cached,
+                                 ffd->l2p_page_cache, &key, iterpool));
+        }
+
+      if (!is_cached)
+        {
+          SVN_ERR(get_l2p_page(&page, rev_file, fs, header->first_revision,
+                               &batch[first].entry, iterpool));
+          SVN_ERR(svn_cache__set(ffd->l2p_page_cache, &key, page,
+                                 iterpool));
+        }
+
+      for (i = first; i < last; ++i)
+        {
+          l2p_entry_baton_t page_baton;
+
+          page_baton.revision = batch[i].revision;
+          page_baton.item_index = batch[i].item_index;
+          page_baton.page_offset = batch[i].page_offset;
+          SVN_ERR(l2p_page_get_entry(&page_baton, page, page->offsets,
+                                     iterpool));
+
+          offsets[batch[i].index] = page_baton.offset;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__item_offset(apr_off_t *absolute_position,
                        svn_fs_t *fs,
@@ -1816,6 +2173,36 @@ svn_fs_fs__item_offset(apr_off_t *absolute_position,
   return svn_error_trace(err);
 }
 
+svn_error_t *
+svn_fs_fs__item_offsets(apr_off_t *absolute_positions,
+                        svn_fs_t *fs,
+                        svn_fs_fs__revision_file_t *rev_file,
+                        const apr_array_header_t *items,
+                        apr_pool_t *scratch_pool)
+{
+  int i;
+
+  if (items->nelts == 0)
+    return SVN_NO_ERROR;
+
+  if (svn_fs_fs__use_log_addressing(fs))
+    return svn_error_trace(l2p_index_batch_lookup(absolute_positions, fs,
+                                                  rev_file, items,
+                                                  scratch_pool));
+
+  /* Physical addressing requires no index lookup. */
+  for (i = 0; i < items->nelts; ++i)
+    {
+      const svn_fs_fs__id_part_t *item
+        = &APR_ARRAY_IDX(items, i, svn_fs_fs__id_part_t);
+      SVN_ERR(svn_fs_fs__item_offset(&absolute_positions[i], fs, rev_file,
+                                     item->revision, NULL, item->number,
+                                     scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /*
  * phys-to-log index
  */
@@ -2138,7 +2525,7 @@ auto_open_p2l_index(svn_fs_fs__revision_file_t *rev_file,
 
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->p2l_stream,
-                                 rev_file->file,
+                                 rev_file,
                                  rev_file->p2l_offset,
                                  rev_file->footer_offset,
                                  P2L_STREAM_PREFIX,
@@ -2172,8 +2559,7 @@ get_p2l_header(p2l_header_t **header,
 
   /* look for the header data in our cache */
   pair_cache_key_t key;
-  key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  header_cache_key(&key, rev_file);
 
   SVN_ERR(svn_cache__get((void**)header, &is_cached, ffd->p2l_header_cache,
                          &key, result_pool));
@@ -2347,8 +2733,7 @@ get_p2l_page_info(p2l_page_info_baton_t *baton,
 
   /* look for the header data in our cache */
   pair_cache_key_t key;
-  key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  header_cache_key(&key, rev_file);
 
   SVN_ERR(svn_cache__get_partial(&dummy, &is_cached, ffd->p2l_header_cache,
                                  &key, p2l_page_info_func, baton,
@@ -2556,6 +2941,7 @@ prefetch_p2l_page(svn_boolean_t *end,
   assert(baton->first_revision <= APR_UINT32_MAX);
   key.revision = (apr_uint32_t)baton->first_revision;
   key.is_packed = svn_fs_fs__is_packed_rev(fs, baton->first_revision);
+  key.generation = rev_file->generation;
   key.page = baton->page_no;
   SVN_ERR(svn_cache__has_key(&already_cached, ffd->p2l_page_cache,
                              &key, scratch_pool));
@@ -2627,6 +3013,7 @@ get_p2l_keys(p2l_page_info_baton_t *page_info_p,
       assert(page_info.first_revision <= APR_UINT32_MAX);
       key.revision = (apr_uint32_t)page_info.first_revision;
       key.is_packed = rev_file->is_packed;
+      key.generation = rev_file->generation;
       key.page = page_info.page_no;
 
       *key_p = key;
@@ -3059,8 +3446,7 @@ p2l_get_max_offset(apr_off_t *offset,
 
   /* look for the header data in our cache */
   pair_cache_key_t key;
-  key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  header_cache_key(&key, rev_file);
 
   SVN_ERR(svn_cache__get_partial((void **)&offset_p, &is_cached,
                                  ffd->p2l_header_cache, &key,
@@ -200,6 +200,23 @@ svn_fs_fs__item_offset(apr_off_t *absolute_position,
                        apr_uint64_t item_index,
                        apr_pool_t *scratch_pool);
 
+/* Batch version of svn_fs_fs__item_offset for committed revisions.  For
+ * each svn_fs_fs__id_part_t element of ITEMS, return its position in the
+ * rev or pack file in the respective element of ABSOLUTE_POSITIONS, which
+ * must provide room for ITEMS->NELTS values.
+ *
+ * All ITEMS must be within the rev or pack file given by REV_FILE.  Each
+ * L2P index page will be read at most once and in file order.  This is
+ * much more efficient than individual lookups if many items are needed.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__item_offsets(apr_off_t *absolute_positions,
+                        svn_fs_t *fs,
+                        svn_fs_fs__revision_file_t *rev_file,
+                        const apr_array_header_t *items,
+                        apr_pool_t *scratch_pool);
+
 /* Use the log-to-phys indexes in FS to determine the maximum item indexes
  * assigned to revision START_REV to START_REV + COUNT - 1.  That is a
  * close upper limit to the actual number of items in the respective revs.
@@ -277,6 +294,9 @@ typedef struct svn_fs_fs__page_cache_key_t
    * in p2l: page number with the rev / pack file
    */
   apr_uint64_t page;
+
+  /* generation of the rev / pack file containing the index */
+  apr_uint64_t generation;
 } svn_fs_fs__page_cache_key_t;
 
 /*
@@ -20,6 +20,7 @@
  * ====================================================================
  */
 
+#include "svn_dirent_uri.h"
 #include "svn_pools.h"
 
 #include "private/svn_fs_fs_private.h"
@@ -29,6 +30,8 @@
 #include "util.h"
 #include "transaction.h"
 
+#include "../libsvn_fs/fs-loader.h"
+
 /* From the ENTRIES array of svn_fs_fs__p2l_entry_t*, sorted by offset,
  * return the first offset behind the last item. */
 static apr_off_t
@@ -99,6 +102,7 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                       apr_array_header_t *entries,
                       apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   apr_pool_t *subpool = svn_pool_create(scratch_pool);
 
   /* Check the FS format number. */
@@ -117,24 +121,27 @@ svn_fs_fs__load_index(svn_fs_t *fs,
       svn_fs_fs__revision_file_t *rev_file;
       svn_error_t *err;
       apr_off_t max_covered = get_max_covered(entries);
+      apr_off_t data_end;
+      apr_off_t offset;
+      const char *path;
+      const char *new_path;
+      apr_file_t *new_file;
 
       /* Ensure that the index data is complete. */
       SVN_ERR(check_all_covered(entries, scratch_pool));
 
-      /* Open rev / pack file & trim indexes + footer off it. */
-      SVN_ERR(svn_fs_fs__open_pack_or_rev_file_writable(&rev_file, fs,
-                                                        revision, subpool,
-                                                        subpool));
+      /* Open rev / pack file and find the end of its contents. */
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, revision,
+                                               subpool, subpool));
 
-      /* Remove the existing index info. */
+      /* Ignore the existing index info. */
       err = svn_fs_fs__auto_read_footer(rev_file);
       if (err)
         {
           /* Even the index footer cannot be read, even less be trusted.
            * Take the range of valid data from the new index data. */
           svn_error_clear(err);
-          SVN_ERR(svn_io_file_trunc(rev_file->file, max_covered,
-                                    subpool));
+          data_end = max_covered;
         }
       else
         {
@@ -149,8 +156,7 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                        apr_psprintf(scratch_pool, "%" APR_UINT64_T_HEX_FMT,
                                     (apr_uint64_t) rev_file->l2p_offset));
 
-          SVN_ERR(svn_io_file_trunc(rev_file->file, rev_file->l2p_offset,
-                                    subpool));
+          data_end = rev_file->l2p_offset;
         }
 
       /* Create proto index files for the new index data
@@ -162,10 +168,36 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                                                     entries, subpool,
                                                     subpool));
 
+      /* Never truncate the rev / pack file in place: other processes may
+       * have it mapped into memory and would crash accessing pages beyond
+       * the new EOF.  Write the new file next to it and replace the old
+       * one instead, which leaves existing mappings intact. */
+      path = svn_fs_fs__path_rev_absolute(fs, revision, subpool);
+      SVN_ERR(svn_io_open_unique_file3(&new_file, &new_path,
+                                       svn_dirent_dirname(path, subpool),
+                                       svn_io_file_del_on_pool_cleanup,
+                                       subpool, subpool));
+
+      offset = 0;
+      SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, subpool));
+      SVN_ERR(svn_stream_copy3(svn_stream_from_aprfile2(rev_file->file,
+                                                        TRUE, subpool),
+                               svn_stream_from_aprfile2(new_file, TRUE,
+                                                        subpool),
+                               NULL, NULL, subpool));
+      SVN_ERR(svn_io_file_trunc(new_file, data_end, subpool));
+
       /* Combine rev data with new index data. */
-      SVN_ERR(svn_fs_fs__add_index_data(fs, rev_file->file, l2p_proto_index,
+      SVN_ERR(svn_fs_fs__add_index_data(fs, new_file, l2p_proto_index,
                                         p2l_proto_index,
                                         rev_file->start_revision, subpool));
+      SVN_ERR(svn_io_file_close(new_file, subpool));
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+      SVN_ERR(svn_fs_fs__move_into_place(new_path, path, path,
+                                         ffd->flush_to_disk, subpool));
+      SVN_ERR(svn_io_set_file_read_only(path, FALSE, subpool));
+      svn_fs_fs__forget_pack_generation(fs, revision);
     }
 
   svn_pool_destroy(subpool);
@@ -0,0 +1,68 @@
+/* lock-db.sql -- schema of the optional FSFS lock database
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+/* One row per lock.  PATH is the canonical FS path of the locked file.
+   Because the rows are ordered by PATH, all locks below some directory
+   D form a single key range starting at 'D/' and ending before 'D0',
+   '0' being the character that follows '/'.  EXPIRATION_DATE is NULL
+   for locks that never expire.  Dates are given in microseconds since
+   the epoch, i.e. as apr_time_t. */
+CREATE TABLE locks (
+  path TEXT NOT NULL PRIMARY KEY,
+  token TEXT NOT NULL,
+  owner TEXT NOT NULL,
+  comment TEXT,
+  is_dav_comment INTEGER NOT NULL,
+  creation_date INTEGER NOT NULL,
+  expiration_date INTEGER
+  ) WITHOUT ROWID;
+
+PRAGMA USER_VERSION = 1;
+
+-- STMT_PRAGMA_SYNCHRONOUS
+/* The lock database is the only copy of the locks, so don't use the
+   svn_sqlite__open default of OFF here.  Lock changes are rare. */
+PRAGMA synchronous = FULL;
+
+-- STMT_GET_LOCK
+SELECT path, token, owner, comment, is_dav_comment, creation_date,
+       expiration_date
+FROM locks
+WHERE path = ?1
+
+-- STMT_GET_LOCKS_IN_RANGE
+SELECT path, token, owner, comment, is_dav_comment, creation_date,
+       expiration_date
+FROM locks
+WHERE path >= ?1 AND path < ?2
+ORDER BY path
+
+-- STMT_SET_LOCK
+INSERT OR REPLACE INTO locks (path, token, owner, comment, is_dav_comment,
+                              creation_date, expiration_date)
+VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7)
+
+-- STMT_DELETE_LOCK
+DELETE FROM locks
+WHERE path = ?1
@@ -39,11 +39,17 @@
 #include "util.h"
 #include "../libsvn_fs/fs-loader.h"
 
+#include "private/svn_fs_fs_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
+#include "private/svn_sqlite.h"
 #include "svn_private_config.h"
 
+#include "lock-db.h"
+
+LOCK_DB_SQL_DECLARE_STATEMENTS(statements);
+
 /* Names of hash keys used to store a lock for writing to disk. */
 #define PATH_KEY "path"
 #define TOKEN_KEY "token"
@@ -58,6 +64,9 @@
    calculate a subdirectory in which to drop that file. */
 #define DIGEST_SUBDIR_LEN 3
 
+/* Schema version of the lock database. */
+#define LOCK_DB_SCHEMA_FORMAT 1
+
 
 
 /*** Generic helper functions. ***/
@@ -110,6 +119,13 @@ hash_fetch(apr_hash_t *hash,
 }
 
 
+/* Check if LOCK has been already expired. */
+static svn_boolean_t lock_expired(const svn_lock_t *lock)
+{
+  return lock->expiration_date && (apr_time_now() > lock->expiration_date);
+}
+
+
 /* SVN_ERR_FS_CORRUPT: the lockfile for PATH in FS is corrupt.  */
 static svn_error_t *
 err_corrupt_lockfile(const char *fs_path, const char *path)
@@ -332,6 +348,220 @@ read_digest_file(apr_hash_t **children_p,
 
 
 
+/*** Lock database handling functions. ***/
+
+/* Open the lock database at DB_PATH in *SDB using MODE.  If MODE is
+   svn_sqlite__mode_rwcreate, create the database and its schema if they
+   don't exist yet and give it the permissions of the 'current' file in
+   the filesystem at FS_PATH.  The database will be closed when
+   RESULT_POOL gets cleaned up.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+open_lock_db(svn_sqlite__db_t **sdb,
+             const char *fs_path,
+             const char *db_path,
+             svn_sqlite__mode_t mode,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  int version;
+
+#ifndef WIN32
+  if (mode == svn_sqlite__mode_rwcreate)
+    {
+      /* Extend the permissions that apply to the repository as a whole
+         to the new database instead of simply defaulting to umask. */
+      svn_error_t *err = svn_io_file_create_empty(db_path, scratch_pool);
+
+      if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+        return svn_error_trace(err);
+      else if (err)
+        svn_error_clear(err);
+      else
+        SVN_ERR(svn_io_copy_perms(svn_dirent_join(fs_path, PATH_CURRENT,
+                                                  scratch_pool),
+                                  db_path, scratch_pool));
+    }
+#endif
+
+  SVN_ERR(svn_sqlite__open(sdb, db_path, mode, statements, 0, NULL, 0,
+                           result_pool, scratch_pool));
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(*sdb,
+                                                    STMT_PRAGMA_SYNCHRONOUS),
+                        *sdb);
+
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, *sdb,
+                                                        scratch_pool),
+                        *sdb);
+  if (version <= 0 && mode == svn_sqlite__mode_rwcreate)
+    SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(*sdb,
+                                                      STMT_CREATE_SCHEMA),
+                          *sdb);
+  else if (version != LOCK_DB_SCHEMA_FORMAT)
+    return svn_error_createf(SVN_ERR_SQLITE_UNSUPPORTED_SCHEMA,
+                             svn_sqlite__close(*sdb),
+                             _("Lock database '%s' has unsupported schema "
+                               "version %d"),
+                             svn_dirent_local_style(db_path, scratch_pool),
+                             version);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *SDB to the lock database of FS or to NULL, if FS still keeps its
+   locks in digest files.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_lock_db(svn_sqlite__db_t **sdb,
+            svn_fs_t *fs,
+            apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* Repositories never go back from the database to digest files.
+     So, once we found the database, we can keep using it. */
+  if (!ffd->lock_db)
+    {
+      const char *db_path = svn_dirent_join(fs->path, PATH_LOCKS_DB,
+                                            scratch_pool);
+      svn_node_kind_t kind;
+
+      SVN_ERR(svn_io_check_path(db_path, &kind, scratch_pool));
+      if (kind == svn_node_file)
+        SVN_ERR(open_lock_db(&ffd->lock_db, fs->path, db_path,
+                             svn_sqlite__mode_readwrite, fs->pool,
+                             scratch_pool));
+    }
+
+  *sdb = ffd->lock_db;
+  return SVN_NO_ERROR;
+}
+
+/* Set *LOCK_P to the lock in the current row of STMT.  Allocate it in
+   RESULT_POOL. */
+static void
+read_lock_row(svn_lock_t **lock_p,
+              svn_sqlite__stmt_t *stmt,
+              apr_pool_t *result_pool)
+{
+  svn_lock_t *lock = svn_lock_create(result_pool);
+
+  lock->path = svn_sqlite__column_text(stmt, 0, result_pool);
+  lock->token = svn_sqlite__column_text(stmt, 1, result_pool);
+  lock->owner = svn_sqlite__column_text(stmt, 2, result_pool);
+  lock->comment = svn_sqlite__column_text(stmt, 3, result_pool);
+  lock->is_dav_comment = svn_sqlite__column_boolean(stmt, 4);
+  lock->creation_date = svn_sqlite__column_int64(stmt, 5);
+  lock->expiration_date = svn_sqlite__column_int64(stmt, 6);
+
+  *lock_p = lock;
+}
+
+/* Set *LOCK_P to the lock for PATH in the lock database SDB or to NULL,
+   if there is none.  Use POOL for allocations. */
+static svn_error_t *
+db_get_lock(svn_lock_t **lock_p,
+            svn_sqlite__db_t *sdb,
+            const char *path,
+            apr_pool_t *pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_LOCK));
+  SVN_ERR(svn_sqlite__bindf(stmt, "s", path));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  *lock_p = NULL;
+  if (have_row)
+    read_lock_row(lock_p, stmt, pool);
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Add LOCK to the lock database SDB, replacing any previous lock on the
+   same path.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+db_set_lock(svn_sqlite__db_t *sdb,
+            const svn_lock_t *lock,
+            apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SET_LOCK));
+  SVN_ERR(svn_sqlite__bindf(stmt, "ssssdL", lock->path, lock->token,
+                            lock->owner, lock->comment,
+                            lock->is_dav_comment ? 1 : 0,
+                            (apr_int64_t)lock->creation_date));
+  if (lock->expiration_date)
+    SVN_ERR(svn_sqlite__bind_int64(stmt, 7, lock->expiration_date));
+
+  return svn_error_trace(svn_sqlite__insert(NULL, stmt));
+}
+
+/* Remove the lock on PATH from the lock database SDB, if there is one. */
+static svn_error_t *
+db_delete_lock(svn_sqlite__db_t *sdb,
+               const char *path)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_DELETE_LOCK));
+  SVN_ERR(svn_sqlite__bindf(stmt, "s", path));
+
+  return svn_error_trace(svn_sqlite__update(NULL, stmt));
+}
+
+/* Call FUNC with BATON for every lock in the lock database SDB whose
+   path is in the range [LOWER, UPPER).  Expired locks are not reported
+   but added to EXPIRED.  Allocate the latter in the pool of EXPIRED and
+   use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+db_read_locks(svn_sqlite__db_t *sdb,
+              const char *lower,
+              const char *upper,
+              svn_fs_get_locks_callback_t func,
+              void *baton,
+              apr_array_header_t *expired,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_error_t *err;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_LOCKS_IN_RANGE));
+  SVN_ERR(svn_sqlite__bindf(stmt, "ss", lower, upper));
+
+  iterpool = svn_pool_create(scratch_pool);
+  err = svn_sqlite__step(&have_row, stmt);
+  while (!err && have_row)
+    {
+      svn_lock_t *lock;
+
+      svn_pool_clear(iterpool);
+      read_lock_row(&lock, stmt, iterpool);
+
+      if (lock_expired(lock))
+        {
+          APR_ARRAY_PUSH(expired, svn_lock_t *)
+            = svn_lock_dup(lock, expired->pool);
+        }
+      else
+        {
+          err = func(baton, lock, iterpool);
+        }
+
+      if (!err)
+        err = svn_sqlite__step(&have_row, stmt);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_error_compose_create(err,
+                                                  svn_sqlite__reset(stmt)));
+}
+
+
 /*** Lock helper functions (path here are still FS paths, not on-disk
      schema-supporting paths) ***/
 
@@ -451,12 +681,6 @@ unlock_single(svn_fs_t *fs,
               svn_lock_t *lock,
               apr_pool_t *pool);
 
-/* Check if LOCK has been already expired. */
-static svn_boolean_t lock_expired(const svn_lock_t *lock)
-{
-  return lock->expiration_date && (apr_time_now() > lock->expiration_date);
-}
-
 /* Set *LOCK_P to the lock for PATH in FS.  HAVE_WRITE_LOCK should be
    TRUE if the caller (or one of its callers) has taken out the
    repository-wide write lock, FALSE otherwise.  If MUST_EXIST is
@@ -472,15 +696,24 @@ get_lock(svn_lock_t **lock_p,
          apr_pool_t *pool)
 {
   svn_lock_t *lock = NULL;
-  const char *digest_path;
-  svn_node_kind_t kind;
-
-  SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
-  SVN_ERR(svn_io_check_path(digest_path, &kind, pool));
+  svn_sqlite__db_t *sdb;
 
   *lock_p = NULL;
-  if (kind != svn_node_none)
-    SVN_ERR(read_digest_file(NULL, &lock, fs->path, digest_path, pool));
+  SVN_ERR(get_lock_db(&sdb, fs, pool));
+  if (sdb)
+    {
+      SVN_ERR(db_get_lock(&lock, sdb, path, pool));
+    }
+  else
+    {
+      const char *digest_path;
+      svn_node_kind_t kind;
+
+      SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
+      SVN_ERR(svn_io_check_path(digest_path, &kind, pool));
+      if (kind != svn_node_none)
+        SVN_ERR(read_digest_file(NULL, &lock, fs->path, digest_path, pool));
+    }
 
   if (! lock)
     return must_exist ? SVN_FS__ERR_NO_SUCH_LOCK(fs, path) : SVN_NO_ERROR;
@@ -534,16 +767,17 @@ get_lock_helper(svn_fs_t *fs,
 
 
 /* A function that calls GET_LOCKS_FUNC/GET_LOCKS_BATON for
-   all locks in and under PATH in FS.
+   all locks in and under the path whose digest file is DIGEST_PATH
+   in FS.
    HAVE_WRITE_LOCK should be true if the caller (directly or indirectly)
    has the FS write lock. */
 static svn_error_t *
-walk_locks(svn_fs_t *fs,
-           const char *digest_path,
-           svn_fs_get_locks_callback_t get_locks_func,
-           void *get_locks_baton,
-           svn_boolean_t have_write_lock,
-           apr_pool_t *pool)
+walk_digest_locks(svn_fs_t *fs,
+                  const char *digest_path,
+                  svn_fs_get_locks_callback_t get_locks_func,
+                  void *get_locks_baton,
+                  svn_boolean_t have_write_lock,
+                  apr_pool_t *pool)
 {
   apr_hash_index_t *hi;
   apr_hash_t *children;
@@ -594,6 +828,79 @@ walk_locks(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Like walk_digest_locks() but for the lock database SDB. */
+static svn_error_t *
+walk_db_locks(svn_fs_t *fs,
+              svn_sqlite__db_t *sdb,
+              const char *path,
+              svn_fs_get_locks_callback_t get_locks_func,
+              void *get_locks_baton,
+              svn_boolean_t have_write_lock,
+              apr_pool_t *pool)
+{
+  apr_array_header_t *expired = apr_array_make(pool, 0,
+                                               sizeof(svn_lock_t *));
+  svn_lock_t *lock;
+  const char *prefix;
+  char *upper;
+  int i;
+
+  /* First, send up any lock on PATH itself. */
+  SVN_ERR(db_get_lock(&lock, sdb, path, pool));
+  if (lock && lock_expired(lock))
+    APR_ARRAY_PUSH(expired, svn_lock_t *) = lock;
+  else if (lock)
+    SVN_ERR(get_locks_func(get_locks_baton, lock, pool));
+
+  /* Everything below PATH is a single key range in the database:
+     from PREFIX up to but excluding PREFIX with its last character,
+     i.e. the '/', incremented. */
+  prefix = svn_fspath__is_root(path, strlen(path))
+         ? path
+         : apr_pstrcat(pool, path, "/", SVN_VA_NULL);
+  upper = apr_pstrdup(pool, prefix);
+  upper[strlen(upper) - 1]++;
+
+  SVN_ERR(db_read_locks(sdb, prefix, upper, get_locks_func, get_locks_baton,
+                        expired, pool));
+
+  /* Only remove expired locks if we have the write lock.
+     Read operations shouldn't change the filesystem. */
+  if (have_write_lock)
+    for (i = 0; i < expired->nelts; ++i)
+      SVN_ERR(unlock_single(fs, APR_ARRAY_IDX(expired, i, svn_lock_t *),
+                            pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* A function that calls GET_LOCKS_FUNC/GET_LOCKS_BATON for
+   all locks in and under PATH in FS.
+   HAVE_WRITE_LOCK should be true if the caller (directly or indirectly)
+   has the FS write lock. */
+static svn_error_t *
+walk_locks(svn_fs_t *fs,
+           const char *path,
+           svn_fs_get_locks_callback_t get_locks_func,
+           void *get_locks_baton,
+           svn_boolean_t have_write_lock,
+           apr_pool_t *pool)
+{
+  svn_sqlite__db_t *sdb;
+  const char *digest_path;
+
+  SVN_ERR(get_lock_db(&sdb, fs, pool));
+  if (sdb)
+    return svn_error_trace(walk_db_locks(fs, sdb, path, get_locks_func,
+                                         get_locks_baton, have_write_lock,
+                                         pool));
+
+  SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
+  return svn_error_trace(walk_digest_locks(fs, digest_path, get_locks_func,
+                                           get_locks_baton, have_write_lock,
+                                           pool));
+}
+
 
 /* Utility function:  verify that a lock can be used.  Interesting
    errors returned from this function:
@@ -652,9 +959,7 @@ svn_fs_fs__allow_locked_operation(const char *path,
   if (recurse)
     {
       /* Discover all locks at or below the path. */
-      const char *digest_path;
-      SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
-      SVN_ERR(walk_locks(fs, digest_path, get_locks_callback,
+      SVN_ERR(walk_locks(fs, path, get_locks_callback,
                          fs, have_write_lock, pool));
     }
   else
@@ -823,6 +1128,59 @@ struct lock_info_t {
   svn_error_t *fs_err;
 };
 
+/* Create the locks for all LB->INFOS that don't have an error yet and
+   write them to SDB or, if that is NULL, to the digest files of LB->FS.
+   Use PERMS_REFERENCE for the permissions of any digest files.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_locks(struct lock_baton *lb,
+            svn_sqlite__db_t *sdb,
+            const char *perms_reference,
+            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < lb->infos->nelts; ++i)
+    {
+      struct lock_info_t *info = &APR_ARRAY_IDX(lb->infos, i,
+                                                struct lock_info_t);
+      svn_sort__item_t *item = &APR_ARRAY_IDX(lb->targets, i, svn_sort__item_t);
+      svn_fs_lock_target_t *target = item->value;
+
+      svn_pool_clear(iterpool);
+
+      if (! info->fs_err)
+        {
+          info->lock = svn_lock_create(lb->result_pool);
+          if (target->token)
+            info->lock->token = apr_pstrdup(lb->result_pool, target->token);
+          else
+            SVN_ERR(svn_fs_fs__generate_lock_token(&(info->lock->token), lb->fs,
+                                                   lb->result_pool));
+
+          /* The INFO->PATH is already allocated in LB->RESULT_POOL as a result
+             of svn_fspath__canonicalize() (see svn_fs_fs__lock()). */
+          info->lock->path = info->path;
+          info->lock->owner = apr_pstrdup(lb->result_pool,
+                                          lb->fs->access_ctx->username);
+          info->lock->comment = apr_pstrdup(lb->result_pool, lb->comment);
+          info->lock->is_dav_comment = lb->is_dav_comment;
+          info->lock->creation_date = apr_time_now();
+          info->lock->expiration_date = lb->expiration_date;
+
+          if (sdb)
+            info->fs_err = db_set_lock(sdb, info->lock, iterpool);
+          else
+            info->fs_err = set_lock(lb->fs->path, info->lock,
+                                    perms_reference, iterpool);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 /* The body of svn_fs_fs__lock(), which see.
 
    BATON is a 'struct lock_baton *' holding the effective arguments.
@@ -841,6 +1199,7 @@ lock_body(void *baton, apr_pool_t *pool)
   svn_fs_root_t *root;
   svn_revnum_t youngest;
   const char *rev_0_path;
+  svn_sqlite__db_t *sdb;
   int i;
   apr_hash_t *index_updates = apr_hash_make(pool);
   apr_hash_index_t *hi;
@@ -852,6 +1211,7 @@ lock_body(void *baton, apr_pool_t *pool)
      library dependencies, which are not portable. */
   SVN_ERR(lb->fs->vtable->youngest_rev(&youngest, lb->fs, pool));
   SVN_ERR(lb->fs->vtable->revision_root(&root, lb->fs, youngest, pool));
+  SVN_ERR(get_lock_db(&sdb, lb->fs, pool));
 
   for (i = 0; i < lb->targets->nelts; ++i)
     {
@@ -869,8 +1229,8 @@ lock_body(void *baton, apr_pool_t *pool)
                          youngest, iterpool));
 
       /* If no error occurred while pre-checking, schedule the index updates for
-         this path. */
-      if (!info.fs_err)
+         this path.  The lock database does not need them. */
+      if (!info.fs_err && !sdb)
         schedule_index_update(index_updates, info.path, iterpool);
 
       APR_ARRAY_PUSH(lb->infos, struct lock_info_t) = info;
@@ -897,38 +1257,11 @@ lock_body(void *baton, apr_pool_t *pool)
                             iterpool));
     }
 
-  for (i = 0; i < lb->infos->nelts; ++i)
-    {
-      struct lock_info_t *info = &APR_ARRAY_IDX(lb->infos, i,
-                                                struct lock_info_t);
-      svn_sort__item_t *item = &APR_ARRAY_IDX(lb->targets, i, svn_sort__item_t);
-      svn_fs_lock_target_t *target = item->value;
-
-      svn_pool_clear(iterpool);
-
-      if (! info->fs_err)
-        {
-          info->lock = svn_lock_create(lb->result_pool);
-          if (target->token)
-            info->lock->token = apr_pstrdup(lb->result_pool, target->token);
-          else
-            SVN_ERR(svn_fs_fs__generate_lock_token(&(info->lock->token), lb->fs,
-                                                   lb->result_pool));
-
-          /* The INFO->PATH is already allocated in LB->RESULT_POOL as a result
-             of svn_fspath__canonicalize() (see svn_fs_fs__lock()). */
-          info->lock->path = info->path;
-          info->lock->owner = apr_pstrdup(lb->result_pool,
-                                          lb->fs->access_ctx->username);
-          info->lock->comment = apr_pstrdup(lb->result_pool, lb->comment);
-          info->lock->is_dav_comment = lb->is_dav_comment;
-          info->lock->creation_date = apr_time_now();
-          info->lock->expiration_date = lb->expiration_date;
-
-          info->fs_err = set_lock(lb->fs->path, info->lock, rev_0_path,
-                                  iterpool);
-        }
-    }
+  /* Write all new locks to the database within a single transaction. */
+  if (sdb)
+    SVN_SQLITE__WITH_TXN(write_locks(lb, sdb, rev_0_path, iterpool), sdb);
+  else
+    SVN_ERR(write_locks(lb, NULL, rev_0_path, iterpool));
 
   svn_pool_destroy(iterpool);
   return SVN_NO_ERROR;
@@ -975,6 +1308,39 @@ struct unlock_info_t {
   svn_boolean_t done;
 };
 
+/* Delete the locks for all UB->INFOS that don't have an error from SDB
+   or, if that is NULL, from the digest files of UB->FS.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+delete_locks(struct unlock_baton *ub,
+             svn_sqlite__db_t *sdb,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < ub->infos->nelts; ++i)
+    {
+      struct unlock_info_t *info = &APR_ARRAY_IDX(ub->infos, i,
+                                                  struct unlock_info_t);
+
+      svn_pool_clear(iterpool);
+
+      if (! info->fs_err)
+        {
+          if (sdb)
+            SVN_ERR(db_delete_lock(sdb, info->path));
+          else
+            SVN_ERR(delete_lock(ub->fs->path, info->path, iterpool));
+
+          info->done = TRUE;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 /* The body of svn_fs_fs__unlock(), which see.
 
    BATON is a 'struct unlock_baton *' holding the effective arguments.
@@ -993,6 +1359,7 @@ unlock_body(void *baton, apr_pool_t *pool)
   svn_fs_root_t *root;
   svn_revnum_t youngest;
   const char *rev_0_path;
+  svn_sqlite__db_t *sdb;
   int i;
   apr_hash_t *indices_updates = apr_hash_make(pool);
   apr_hash_index_t *hi;
@@ -1000,6 +1367,7 @@ unlock_body(void *baton, apr_pool_t *pool)
 
   SVN_ERR(ub->fs->vtable->youngest_rev(&youngest, ub->fs, pool));
   SVN_ERR(ub->fs->vtable->revision_root(&root, ub->fs, youngest, pool));
+  SVN_ERR(get_lock_db(&sdb, ub->fs, pool));
 
   for (i = 0; i < ub->targets->nelts; ++i)
     {
@@ -1019,8 +1387,8 @@ unlock_body(void *baton, apr_pool_t *pool)
                              iterpool));
 
       /* If no error occurred while pre-checking, schedule the index updates for
-         this path. */
-      if (!info.fs_err)
+         this path.  The lock database does not need them. */
+      if (!info.fs_err && !sdb)
         schedule_index_update(indices_updates, info.path, iterpool);
 
       APR_ARRAY_PUSH(ub->infos, struct unlock_info_t) = info;
@@ -1031,19 +1399,10 @@ unlock_body(void *baton, apr_pool_t *pool)
   /* Unlike the lock_body(), we need to delete locks *before* we start to
      update indices. */
 
-  for (i = 0; i < ub->infos->nelts; ++i)
-    {
-      struct unlock_info_t *info = &APR_ARRAY_IDX(ub->infos, i,
-                                                  struct unlock_info_t);
-
-      svn_pool_clear(iterpool);
-
-      if (! info->fs_err)
-        {
-          SVN_ERR(delete_lock(ub->fs->path, info->path, iterpool));
-          info->done = TRUE;
-        }
-    }
+  if (sdb)
+    SVN_SQLITE__WITH_TXN(delete_locks(ub, sdb, iterpool), sdb);
+  else
+    SVN_ERR(delete_locks(ub, NULL, iterpool));
 
   for (hi = apr_hash_first(pool, indices_updates); hi; hi = apr_hash_next(hi))
     {
@@ -1348,7 +1707,6 @@ svn_fs_fs__get_locks(svn_fs_t *fs,
                      void *get_locks_baton,
                      apr_pool_t *pool)
 {
-  const char *digest_path;
   get_locks_filter_baton_t glfb;
 
   SVN_ERR(svn_fs__check_fs(fs, TRUE));
@@ -1359,9 +1717,95 @@ svn_fs_fs__get_locks(svn_fs_t *fs,
   glfb.get_locks_func = get_locks_func;
   glfb.get_locks_baton = get_locks_baton;
 
-  /* Get the top digest path in our tree of interest, and then walk it. */
-  SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
-  SVN_ERR(walk_locks(fs, digest_path, get_locks_filter_func, &glfb,
+  /* Walk the tree of interest. */
+  SVN_ERR(walk_locks(fs, path, get_locks_filter_func, &glfb,
                      FALSE, pool));
   return SVN_NO_ERROR;
 }
+
+
+/* Baton for migrate_locks_body(). */
+typedef struct migrate_locks_baton_t
+{
+  svn_fs_t *fs;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} migrate_locks_baton_t;
+
+/* Implements svn_fs_get_locks_callback_t, adding LOCK to the lock
+   database BATON. */
+static svn_error_t *
+migrate_lock(void *baton,
+             svn_lock_t *lock,
+             apr_pool_t *pool)
+{
+  return svn_error_trace(db_set_lock(baton, lock, pool));
+}
+
+/* The body of svn_fs_fs__migrate_locks(), which see.
+
+   BATON is a 'migrate_locks_baton_t *' holding the effective arguments.
+
+   This implements the svn_fs_fs__with_write_lock() 'body' callback
+   type, and assumes that the write lock is held.
+ */
+static svn_error_t *
+migrate_locks_body(void *baton,
+                   apr_pool_t *pool)
+{
+  migrate_locks_baton_t *b = baton;
+  svn_fs_t *fs = b->fs;
+  const char *db_path = svn_dirent_join(fs->path, PATH_LOCKS_DB, pool);
+  const char *tmp_path = apr_pstrcat(pool, db_path, ".tmp", SVN_VA_NULL);
+  const char *digest_path;
+  svn_sqlite__db_t *sdb;
+
+  /* Nothing to do if we already use a lock database. */
+  SVN_ERR(get_lock_db(&sdb, fs, pool));
+  if (sdb)
+    return SVN_NO_ERROR;
+
+  /* Fill the database under a temporary name, so readers keep using the
+     digest files until it is complete.  The digest file of the root
+     lists all locks in the repository.  Expired locks get removed. */
+  SVN_ERR(svn_io_remove_file2(tmp_path, TRUE, pool));
+  SVN_ERR(open_lock_db(&sdb, fs->path, tmp_path, svn_sqlite__mode_rwcreate,
+                       pool, pool));
+  SVN_ERR(digest_path_from_path(&digest_path, fs->path, "/", pool));
+  SVN_SQLITE__WITH_TXN(walk_digest_locks(fs, digest_path, migrate_lock, sdb,
+                                         TRUE, pool),
+                       sdb);
+  SVN_ERR(svn_sqlite__close(sdb));
+  SVN_ERR(svn_io_file_rename2(tmp_path, db_path, TRUE, pool));
+
+  /* From now on, the digest files are no longer being used. */
+  return svn_error_trace(svn_io_remove_dir2(svn_dirent_join(fs->path,
+                                                            PATH_LOCKS_DIR,
+                                                            pool),
+                                            TRUE, b->cancel_func,
+                                            b->cancel_baton, pool));
+}
+
+svn_error_t *
+svn_fs_fs__migrate_locks(svn_fs_t *fs,
+                         svn_cancel_func_t cancel_func,
+                         void *cancel_baton,
+                         apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  migrate_locks_baton_t baton;
+
+  SVN_ERR(svn_fs__check_fs(fs, TRUE));
+  if (ffd->format < SVN_FS_FS__MIN_LOCK_DB_FORMAT)
+    return svn_error_createf(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                             _("FSFS format (%d) too old for a lock "
+                               "database; please upgrade the filesystem."),
+                             ffd->format);
+
+  baton.fs = fs;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+
+  return svn_error_trace(svn_fs_fs__with_write_lock(fs, migrate_locks_body,
+                                                    &baton, scratch_pool));
+}
@@ -61,6 +61,9 @@
 /* Kinds of representation. */
 #define REP_PLAIN          "PLAIN"
 #define REP_DELTA          "DELTA"
+#define REP_EXTERNAL       "EXTERNAL"
+#define REP_CHUNKED        "CHUNKED"
+#define REP_SIZE           "SIZE"
 
 /* An arbitrary maximum path length, so clients can't run us out of memory
  * by giving us arbitrarily large paths. */
@@ -1245,6 +1248,32 @@ svn_fs_fs__write_noderev(svn_stream_t *outfile,
   return svn_stream_puts(outfile, "\n");
 }
 
+/* Parse the optional "SIZE <size>" suffix of a DELTA representation
+ * header in *TEXT and store its value in HEADER. */
+static svn_error_t *
+parse_rep_size(svn_fs_fs__rep_header_t *header,
+               char **text)
+{
+  apr_int64_t val;
+  char *str = svn_cstring_tokenize(" ", text);
+  if (! str)
+    return SVN_NO_ERROR;
+
+  if (strcmp(str, REP_SIZE) == 0)
+    {
+      str = svn_cstring_tokenize(" ", text);
+      if (str)
+        {
+          SVN_ERR(svn_cstring_atoi64(&val, str));
+          header->size = (svn_filesize_t)val;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                          _("Malformed representation header"));
+}
+
 svn_error_t *
 svn_fs_fs__read_rep_header(svn_fs_fs__rep_header_t **header,
                            svn_stream_t *stream,
@@ -1273,14 +1302,53 @@ svn_fs_fs__read_rep_header(svn_fs_fs__rep_header_t **header,
       return SVN_NO_ERROR;
     }
 
-  (*header)->type = svn_fs_fs__rep_delta;
-
-  /* We have hopefully a DELTA vs. a non-empty base revision. */
   last_str = buffer->data;
   str = svn_cstring_tokenize(" ", &last_str);
+  if (str && (   strcmp(str, REP_EXTERNAL) == 0
+              || strcmp(str, REP_CHUNKED) == 0))
+    {
+      svn_checksum_t *checksum;
+
+      /* The fulltext has been stored outside the rev / pack file,
+         either as a whole or split into chunks. */
+      (*header)->type = strcmp(str, REP_EXTERNAL) == 0
+                      ? svn_fs_fs__rep_external
+                      : svn_fs_fs__rep_chunked;
+
+      str = svn_cstring_tokenize(" ", &last_str);
+      if (! str)
+        goto error;
+      SVN_ERR(svn_checksum_parse_hex(&checksum, svn_checksum_sha1, str,
+                                     scratch_pool));
+      if (! checksum)
+        goto error;
+      memcpy((*header)->sha1_digest, checksum->digest,
+             sizeof((*header)->sha1_digest));
+
+      str = svn_cstring_tokenize(" ", &last_str);
+      if (! str)
+        goto error;
+      SVN_ERR(svn_cstring_atoi64(&val, str));
+      (*header)->expanded_size = (svn_filesize_t)val;
+
+      return SVN_NO_ERROR;
+    }
+
   if (! str || (strcmp(str, REP_DELTA) != 0))
     goto error;
 
+  /* A recompressed delta against the empty stream. */
+  if (strncmp(last_str, REP_SIZE " ", sizeof(REP_SIZE)) == 0)
+    {
+      (*header)->type = svn_fs_fs__rep_self_delta;
+      SVN_ERR(parse_rep_size(*header, &last_str));
+
+      return SVN_NO_ERROR;
+    }
+
+  /* We have hopefully a DELTA vs. a non-empty base revision. */
+  (*header)->type = svn_fs_fs__rep_delta;
+
   SVN_ERR(parse_revnum(&(*header)->base_revision, (const char **)&last_str));
 
   str = svn_cstring_tokenize(" ", &last_str);
@@ -1295,6 +1363,8 @@ svn_fs_fs__read_rep_header(svn_fs_fs__rep_header_t **header,
   SVN_ERR(svn_cstring_atoi64(&val, str));
   (*header)->base_length = (svn_filesize_t)val;
 
+  SVN_ERR(parse_rep_size(*header, &last_str));
+
   return SVN_NO_ERROR;
 
  error:
@@ -1316,15 +1386,123 @@ svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
         break;
 
       case svn_fs_fs__rep_self_delta:
-        text = REP_DELTA "\n";
+        text = header->size
+             ? apr_psprintf(scratch_pool, REP_DELTA " " REP_SIZE
+                                          " %" SVN_FILESIZE_T_FMT "\n",
+                            header->size)
+             : REP_DELTA "\n";
+        break;
+
+      case svn_fs_fs__rep_external:
+      case svn_fs_fs__rep_chunked:
+        {
+          svn_checksum_t checksum;
+          checksum.digest = header->sha1_digest;
+          checksum.kind = svn_checksum_sha1;
+
+          text = apr_psprintf(scratch_pool, "%s %s %" SVN_FILESIZE_T_FMT "\n",
+                              header->type == svn_fs_fs__rep_external
+                                ? REP_EXTERNAL
+                                : REP_CHUNKED,
+                              svn_checksum_to_cstring_display(&checksum,
+                                                              scratch_pool),
+                              header->expanded_size);
+        }
         break;
 
       default:
         text = apr_psprintf(scratch_pool, REP_DELTA " %ld %" APR_OFF_T_FMT
-                                          " %" SVN_FILESIZE_T_FMT "\n",
+                                          " %" SVN_FILESIZE_T_FMT,
                             header->base_revision, header->base_item_index,
                             header->base_length);
+        text = header->size
+             ? apr_psprintf(scratch_pool, "%s " REP_SIZE
+                                          " %" SVN_FILESIZE_T_FMT "\n",
+                            text, header->size)
+             : apr_pstrcat(scratch_pool, text, "\n", SVN_VA_NULL);
     }
 
   return svn_error_trace(svn_stream_puts(stream, text));
 }
+
+svn_error_t *
+svn_fs_fs__read_chunk_list(apr_array_header_t **chunks,
+                           svn_stream_t *stream,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_boolean_t eof = FALSE;
+
+  *chunks = apr_array_make(result_pool, 16, sizeof(svn_fs_fs__chunk_t));
+  while (TRUE)
+    {
+      svn_stringbuf_t *line;
+      svn_fs_fs__chunk_t *chunk;
+      svn_checksum_t *checksum;
+      char *str, *last_str;
+      apr_uint64_t val;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, iterpool));
+      if (eof && line->len == 0)
+        break;
+
+      /* Each line is "<sha1> <size>". */
+      last_str = line->data;
+      str = svn_cstring_tokenize(" ", &last_str);
+      if (! str)
+        goto error;
+      SVN_ERR(svn_checksum_parse_hex(&checksum, svn_checksum_sha1, str,
+                                     iterpool));
+      if (! checksum)
+        goto error;
+
+      str = svn_cstring_tokenize(" ", &last_str);
+      if (! str)
+        goto error;
+      SVN_ERR(svn_cstring_strtoui64(&val, str, 1, APR_SIZE_MAX, 10));
+
+      chunk = apr_array_push(*chunks);
+      memcpy(chunk->sha1_digest, checksum->digest,
+             sizeof(chunk->sha1_digest));
+      chunk->size = (apr_size_t)val;
+
+      if (eof)
+        break;
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+
+ error:
+  return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                          _("Malformed chunk list"));
+}
+
+svn_error_t *
+svn_fs_fs__write_chunk_list(const apr_array_header_t *chunks,
+                            svn_stream_t *stream,
+                            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      const svn_fs_fs__chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_fs_fs__chunk_t);
+      svn_checksum_t checksum;
+      checksum.digest = chunk->sha1_digest;
+      checksum.kind = svn_checksum_sha1;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_printf(stream, iterpool, "%s %" APR_SIZE_T_FMT "\n",
+                                svn_checksum_to_cstring_display(&checksum,
+                                                                iterpool),
+                                chunk->size));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
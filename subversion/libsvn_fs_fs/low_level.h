@@ -189,7 +189,15 @@ typedef enum svn_fs_fs__rep_type_t
   svn_fs_fs__rep_self_delta,
 
   /* this is a DELTA representation against some base representation */
-  svn_fs_fs__rep_delta
+  svn_fs_fs__rep_delta,
+
+  /* this is an EXTERNAL representation, i.e. the fulltext is stored in
+   * a separate file outside the rev / pack file */
+  svn_fs_fs__rep_external,
+
+  /* this is a CHUNKED representation, i.e. the fulltext is stored outside
+   * the rev / pack file as a list of content-defined, shared chunks */
+  svn_fs_fs__rep_chunked
 } svn_fs_fs__rep_type_t;
 
 /* This structure is used to hold the information stored in a representation
@@ -212,6 +220,20 @@ typedef struct svn_fs_fs__rep_header_t
    * size of that base rep.  Should be 0 if there is no base rep. */
   svn_filesize_t base_length;
 
+  /* if this is an EXTERNAL or CHUNKED rep, the SHA1 digest of its
+   * fulltext, which also names the file containing it or its chunk list.
+   * All 0 for other reps. */
+  unsigned char sha1_digest[APR_SHA1_DIGESTSIZE];
+
+  /* if this is an EXTERNAL or CHUNKED rep, the size of its fulltext.
+   * Should be 0 for other reps. */
+  svn_filesize_t expanded_size;
+
+  /* if this DELTA rep has been recompressed after it had been written,
+   * the size of its svndiff data, which then differs from what the
+   * node-revs and delta headers that refer to it record.  0 otherwise. */
+  svn_filesize_t size;
+
   /* length of the textual representation of the header in the rep or pack
    * file, including EOL.  Only valid after reading it from disk.
    * Should be 0 otherwise. */
@@ -233,3 +255,29 @@ svn_error_t *
 svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
                             svn_stream_t *stream,
                             apr_pool_t *scratch_pool);
+
+/* One chunk of a CHUNKED representation's fulltext. */
+typedef struct svn_fs_fs__chunk_t
+{
+  /* SHA1 digest of the chunk contents, which also names the chunk file. */
+  unsigned char sha1_digest[APR_SHA1_DIGESTSIZE];
+
+  /* Number of fulltext bytes in this chunk. */
+  apr_size_t size;
+} svn_fs_fs__chunk_t;
+
+/* Parse the chunk list of a CHUNKED representation from STREAM and return
+ * it as an array of svn_fs_fs__chunk_t in *CHUNKS, allocated in
+ * RESULT_POOL.  Perform temporary allocations in SCRATCH_POOL. */
+svn_error_t *
+svn_fs_fs__read_chunk_list(apr_array_header_t **chunks,
+                           svn_stream_t *stream,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
+
+/* Write the svn_fs_fs__chunk_t array CHUNKS to STREAM.
+ * Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__write_chunk_list(const apr_array_header_t *chunks,
+                            svn_stream_t *stream,
+                            apr_pool_t *scratch_pool);
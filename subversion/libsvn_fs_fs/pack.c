@@ -119,6 +119,10 @@ typedef struct path_order_t
 
   /* item ID of the representation containing the new data. May be (0, 0). */
   svn_fs_fs__id_part_t rep_id;
+
+  /* position of the first access to the noderev or its data in the access
+   * trace, starting at 1.  0, if the node does not appear in the trace. */
+  int access_rank;
 } path_order_t;
 
 /* Represents a reference from item FROM to item TO.  FROM may be a noderev
@@ -230,6 +234,11 @@ typedef struct pack_context_t
    * Will be filled in phase 2 and be cleared after each revision range.*/
   apr_file_t *reps_file;
 
+  /* svn_fs_fs__id_part_t -> int * hash mapping the items of this shard
+   * found in the configured access trace to the position of their first
+   * access.  NULL if there is no access trace. */
+  apr_hash_t *access_ranks;
+
   /* pool used for temporary data structures that will be cleaned up when
    * the next range of revisions is being processed */
   apr_pool_t *info_pool;
@@ -238,6 +247,97 @@ typedef struct pack_context_t
   svn_boolean_t flush_to_disk;
 } pack_context_t;
 
+/* Return the access rank of ITEM as recorded in CONTEXT->ACCESS_RANKS,
+ * or 0 if ITEM has not been accessed.
+ */
+static int
+get_access_rank(pack_context_t *context,
+                const svn_fs_fs__id_part_t *item)
+{
+  svn_fs_fs__id_part_t key;
+  int *rank;
+
+  if (context->access_ranks == NULL)
+    return 0;
+
+  /* Hash keys must not contain undefined padding bytes. */
+  memset(&key, 0, sizeof(key));
+  key.revision = item->revision;
+  key.number = item->number;
+  rank = apr_hash_get(context->access_ranks, &key, sizeof(key));
+
+  return rank ? *rank : 0;
+}
+
+/* Read the access trace configured for CONTEXT->FS, if any, and set
+ * CONTEXT->ACCESS_RANKS to the order in which the items of CONTEXT's
+ * shard have first been accessed.  A missing trace file is not an error.
+ * Lines that can't be parsed, e.g. truncated ones, will be ignored.
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+read_access_trace(pack_context_t *context,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = context->fs->fsap_data;
+  apr_pool_t *iterpool;
+  svn_stream_t *stream;
+  svn_boolean_t eof = FALSE;
+  svn_error_t *err;
+  int rank = 0;
+
+  context->access_ranks = NULL;
+  if (ffd->pack_access_trace == NULL)
+    return SVN_NO_ERROR;
+
+  err = svn_stream_open_readonly(&stream, ffd->pack_access_trace,
+                                 scratch_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  context->access_ranks = apr_hash_make(result_pool);
+  iterpool = svn_pool_create(scratch_pool);
+  while (!eof)
+    {
+      svn_stringbuf_t *line;
+      svn_fs_fs__id_part_t key;
+      const char *end;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, iterpool));
+
+      /* Parse "<revision> <item index>". */
+      memset(&key, 0, sizeof(key));
+      key.revision = (svn_revnum_t)svn__strtoul(line->data, &end);
+      if (end == line->data || *end != ' ')
+        continue;
+
+      key.number = svn__strtoul(end + 1, &end);
+      if (*end != '\0')
+        continue;
+
+      /* Only the first access to items of this shard is relevant. */
+      if (   key.revision < context->shard_rev
+          || key.revision >= context->shard_end_rev
+          || apr_hash_get(context->access_ranks, &key, sizeof(key)))
+        continue;
+
+      ++rank;
+      apr_hash_set(context->access_ranks,
+                   apr_pmemdup(result_pool, &key, sizeof(key)), sizeof(key),
+                   apr_pmemdup(result_pool, &rank, sizeof(rank)));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
 /* Create and initialize a new pack context for packing shard SHARD_REV in
  * SHARD_DIR into PACK_FILE_DIR within filesystem FS.  Allocate it in POOL
  * and return the structure in *CONTEXT.
@@ -259,6 +359,7 @@ initialize_pack_context(pack_context_t *context,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   const char *temp_dir;
+  apr_pool_t *temp_pool;
   int max_revs = MIN(ffd->max_files_per_dir, max_items);
 
   SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_LOG_ADDRESSING_FORMAT);
@@ -277,6 +378,11 @@ initialize_pack_context(pack_context_t *context,
   context->end_rev = shard_rev;
   context->shard_end_rev = shard_rev + ffd->max_files_per_dir;
 
+  /* what has been read together, shall be stored together */
+  temp_pool = svn_pool_create(pool);
+  SVN_ERR(read_access_trace(context, pool, temp_pool));
+  svn_pool_destroy(temp_pool);
+
   /* the pool used for temp structures */
   context->info_pool = svn_pool_create(pool);
   context->paths = svn_prefix_tree__create(context->info_pool);
@@ -773,6 +879,18 @@ copy_node_to_temp(pack_context_t *context,
   path_order->revision = svn_fs_fs__id_rev(noderev->id);
   path_order->predecessor_count = noderev->predecessor_count;
   path_order->noderev_id = *svn_fs_fs__id_rev_item(noderev->id);
+
+  /* The node was needed as soon as either of its items has been read. */
+  if (context->access_ranks)
+    {
+      int noderev_rank = get_access_rank(context, &path_order->noderev_id);
+      int rep_rank = get_access_rank(context, &path_order->rep_id);
+
+      path_order->access_rank = noderev_rank && rep_rank
+                              ? MIN(noderev_rank, rep_rank)
+                              : MAX(noderev_rank, rep_rank);
+    }
+
   APR_ARRAY_PUSH(context->path_order, path_order_t *) = path_order;
 
   return SVN_NO_ERROR;
@@ -805,6 +923,22 @@ compare_path_order(const path_order_t * const * lhs_p,
   return 0;
 }
 
+/* qsort()-compatible comparison function ordering path_order_t * by
+ * ascending ACCESS_RANK.
+ */
+static int
+compare_access_rank(const void *lhs_p,
+                    const void *rhs_p)
+{
+  const path_order_t * lhs = *(const path_order_t * const *)lhs_p;
+  const path_order_t * rhs = *(const path_order_t * const *)rhs_p;
+
+  if (lhs->access_rank != rhs->access_rank)
+    return lhs->access_rank < rhs->access_rank ? -1 : 1;
+
+  return 0;
+}
+
 /* implements compare_fn_t.  Sort ascendingly by FROM, TO.
  */
 static int
@@ -893,6 +1027,7 @@ sort_reps_range(pack_context_t *context,
 
   /* Re-order noderevs like this:
    *
+   * (0) Nodes found in the access trace, in the order of their first access
    * (1) Most likely to be referenced by future pack files, in path order.
    * (2) highest revision rep per path + dependency chain
    * (3) Remaining reps in path, rev order
@@ -901,6 +1036,18 @@ sort_reps_range(pack_context_t *context,
    */
   dest = first;
 
+  /* (0) If we know which nodes actually get read, put them first.  Items
+   * read shortly after one another will then often share the same block.
+   */
+  for (i = first; i < last; ++i)
+    if (path_order[i]->access_rank)
+      {
+        temp[dest++] = path_order[i];
+        path_order[i] = NULL;
+      }
+
+  qsort(temp + first, dest - first, sizeof(*temp), compare_access_rank);
+
   /* (1) There are two classes of representations that are likely to be
    * referenced from future shards.  These form a "hot zone" of mostly
    * relevant data, i.e. we try to include as many reps as possible that
@@ -917,7 +1064,15 @@ sort_reps_range(pack_context_t *context,
    */
   for (i = first; i < last; ++i)
     {
-      int round = roundness(path_order[i]->predecessor_count);
+      int round;
+      svn_boolean_t likely_target;
+      svn_boolean_t likely_head;
+
+      /* Already placed in (0)? */
+      if (path_order[i] == NULL)
+        continue;
+
+      round = roundness(path_order[i]->predecessor_count);
 
       /* Class 1:
        * Pretty round _and_ a significant stop in the node's delta chain.
@@ -928,7 +1083,7 @@ sort_reps_range(pack_context_t *context,
        * Larger values increase the number of items in the "hot zone".
        * Smaller values make delta chains at HEAD more likely to contain
        * "cold zone" representations. */
-      svn_boolean_t likely_target
+      likely_target
         =    (round >= ffd->max_linear_deltification)
           && (round >= path_order[i]->predecessor_count / 4);
 
@@ -936,7 +1091,7 @@ sort_reps_range(pack_context_t *context,
        * Anything from short node chains.  The default of 16 is generous
        * but we'd rather include too many than too few nodes here to keep
        * seeks between different regions of this pack file at a minimum. */
-      svn_boolean_t likely_head
+      likely_head
         =   path_order[i]->predecessor_count
           < ffd->max_linear_deltification;
 
@@ -1208,7 +1363,8 @@ copy_reps_from_temp(pack_context_t *context,
   apr_array_header_t *path_order = context->path_order;
   int i;
 
-  /* copy items in path order.  Exclude the non-HEAD noderevs. */
+  /* copy items in path order.  Exclude the non-HEAD noderevs that have
+   * not been accessed according to the access trace. */
   for (i = 0; i < path_order->nelts; ++i)
     {
       path_order_t *current_path;
@@ -1218,7 +1374,7 @@ copy_reps_from_temp(pack_context_t *context,
       svn_pool_clear(iterpool);
 
       current_path = APR_ARRAY_IDX(path_order, i, path_order_t *);
-      if (current_path->is_head)
+      if (current_path->is_head || current_path->access_rank)
         {
           node_part = get_item(context, &current_path->noderev_id, TRUE);
           if (node_part)
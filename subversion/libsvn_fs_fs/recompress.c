@@ -0,0 +1,485 @@
+/* recompress.c -- implements the svn_fs_fs__recompress private API
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_checksum.h"
+#include "svn_delta.h"
+#include "svn_dirent_uri.h"
+#include "svn_pools.h"
+
+#include "private/svn_delta_private.h"
+#include "private/svn_fs_fs_private.h"
+
+#include "fs_fs.h"
+#include "index.h"
+#include "low_level.h"
+#include "rev_file.h"
+#include "transaction.h"
+#include "util.h"
+
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* Representations larger than this will be copied as they are instead of
+ * being re-encoded in memory. */
+#define MAX_RECOMPRESSED_REP_SIZE 0x4000000
+
+/* The trailer of every representation. */
+#define REP_TRAILER "ENDREP\n"
+#define REP_TRAILER_LEN (sizeof(REP_TRAILER) - 1)
+
+/* Shared state of all recompress_shard() calls. */
+typedef struct recompress_baton_t
+{
+  /* The filesystem to recompress. */
+  svn_fs_t *fs;
+
+  /* svndiff version and compression level to re-encode the deltas with. */
+  int svndiff_version;
+  int compression_level;
+
+  /* Shard to process next. */
+  apr_int64_t shard;
+
+  /* Notification and cancellation support as passed to
+   * svn_fs_fs__recompress. */
+  svn_fs_pack_notify_t notify_func;
+  void *notify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} recompress_baton_t;
+
+/* Baton type used with recode_window(). */
+typedef struct recode_baton_t
+{
+  /* Digest over all windows seen so far. */
+  svn_checksum_ctx_t *context;
+
+  /* Largest view the target svndiff version can take. */
+  apr_size_t max_window_size;
+
+  /* Set once we encountered a window that exceeds MAX_WINDOW_SIZE. */
+  svn_boolean_t too_large;
+
+  /* Encoder to pass the windows on to.  May be NULL. */
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+} recode_baton_t;
+
+/* Feed all parts of WINDOW that determine its effect into CONTEXT. */
+static svn_error_t *
+digest_window(svn_checksum_ctx_t *context,
+              const svn_txdelta_window_t *window)
+{
+  apr_uint64_t values[5];
+  int i;
+
+  values[0] = window->sview_offset;
+  values[1] = window->sview_len;
+  values[2] = window->tview_len;
+  values[3] = window->num_ops;
+  values[4] = window->src_ops;
+  SVN_ERR(svn_checksum_update(context, values, sizeof(values)));
+
+  for (i = 0; i < window->num_ops; ++i)
+    {
+      values[0] = window->ops[i].action_code;
+      values[1] = window->ops[i].offset;
+      values[2] = window->ops[i].length;
+      SVN_ERR(svn_checksum_update(context, values, 3 * sizeof(values[0])));
+    }
+
+  if (window->new_data)
+    SVN_ERR(svn_checksum_update(context, window->new_data->data,
+                                window->new_data->len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_txdelta_window_handler_t.  Digest WINDOW and pass it on
+ * to the encoder in the recode_baton_t BATON, if the latter can take it.
+ */
+static svn_error_t *
+recode_window(svn_txdelta_window_t *window,
+              void *baton)
+{
+  recode_baton_t *b = baton;
+
+  if (window)
+    {
+      SVN_ERR(digest_window(b->context, window));
+      if (   window->sview_len > b->max_window_size
+          || window->tview_len > b->max_window_size)
+        b->too_large = TRUE;
+    }
+
+  if (b->too_large || b->handler == NULL)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(b->handler(window, b->handler_baton));
+}
+
+/* Parse the LEN bytes of svndiff DATA and send the windows to HANDLER
+ * with BATON.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+parse_svndiff(const char *data,
+              apr_size_t len,
+              svn_txdelta_window_handler_t handler,
+              void *baton,
+              apr_pool_t *scratch_pool)
+{
+  svn_stream_t *stream = svn_txdelta_parse_svndiff(handler, baton, TRUE,
+                                                   scratch_pool);
+  SVN_ERR(svn_stream_write(stream, data, &len));
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* ITEM is a representation as found in a rev / pack file, i.e. including
+ * its header and trailer.  If it is a DELTA representation and re-encoding
+ * its svndiff data in the format given by RB makes it smaller, return the
+ * re-encoded representation in *RESULT, allocated in RESULT_POOL.  Set it
+ * to NULL otherwise.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+recompress_rep(svn_stringbuf_t **result,
+               const svn_stringbuf_t *item,
+               recompress_baton_t *rb,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__rep_header_t *header;
+  svn_string_t item_string;
+  svn_stringbuf_t *svndiff;
+  svn_stream_t *stream;
+  recode_baton_t old_windows = { 0 };
+  recode_baton_t new_windows = { 0 };
+  svn_checksum_t *old_digest, *new_digest;
+  const char *data;
+  apr_size_t len;
+
+  *result = NULL;
+
+  item_string.data = item->data;
+  item_string.len = item->len;
+  SVN_ERR(svn_fs_fs__read_rep_header(&header,
+                                     svn_stream_from_string(&item_string,
+                                                            scratch_pool),
+                                     scratch_pool, scratch_pool));
+
+  if (   header->type != svn_fs_fs__rep_delta
+      && header->type != svn_fs_fs__rep_self_delta)
+    return SVN_NO_ERROR;
+
+  if (   item->len < header->header_size + REP_TRAILER_LEN
+      || memcmp(item->data + item->len - REP_TRAILER_LEN, REP_TRAILER,
+                REP_TRAILER_LEN))
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed representation trailer"));
+
+  data = item->data + header->header_size;
+  len = item->len - header->header_size - REP_TRAILER_LEN;
+
+  /* Nothing to gain for empty deltas. */
+  if (len <= 4)
+    return SVN_NO_ERROR;
+
+  /* Re-encode the windows. */
+  svndiff = svn_stringbuf_create_ensure(len, scratch_pool);
+  old_windows.context = svn_checksum_ctx_create(svn_checksum_md5,
+                                                scratch_pool);
+  old_windows.max_window_size
+    = svn_txdelta__max_window_size(rb->svndiff_version);
+  svn_txdelta_to_svndiff3(&old_windows.handler, &old_windows.handler_baton,
+                          svn_stream_from_stringbuf(svndiff, scratch_pool),
+                          rb->svndiff_version, rb->compression_level,
+                          scratch_pool);
+  SVN_ERR(parse_svndiff(data, len, recode_window, &old_windows,
+                        scratch_pool));
+
+  if (old_windows.too_large || svndiff->len >= len)
+    return SVN_NO_ERROR;
+
+  /* Make sure that the new svndiff data describes the very same deltas. */
+  new_windows.context = svn_checksum_ctx_create(svn_checksum_md5,
+                                                scratch_pool);
+  new_windows.max_window_size = APR_SIZE_MAX;
+  SVN_ERR(parse_svndiff(svndiff->data, svndiff->len, recode_window,
+                        &new_windows, scratch_pool));
+
+  SVN_ERR(svn_checksum_final(&old_digest, old_windows.context,
+                             scratch_pool));
+  SVN_ERR(svn_checksum_final(&new_digest, new_windows.context,
+                             scratch_pool));
+  if (!svn_checksum_match(old_digest, new_digest))
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Recompressed representation does not match "
+                              "the original"));
+
+  /* Construct the new representation. */
+  header->size = svndiff->len;
+  *result = svn_stringbuf_create_ensure(header->header_size + svndiff->len
+                                        + REP_TRAILER_LEN + 32,
+                                        result_pool);
+  stream = svn_stream_from_stringbuf(*result, scratch_pool);
+  SVN_ERR(svn_fs_fs__write_rep_header(header, stream, scratch_pool));
+  svn_stringbuf_appendbytes(*result, svndiff->data, svndiff->len);
+  svn_stringbuf_appendbytes(*result, REP_TRAILER, REP_TRAILER_LEN);
+
+  return SVN_NO_ERROR;
+}
+
+/* Append the SIZE bytes starting at OFFSET in SOURCE to DEST.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+copy_item(apr_file_t *dest,
+          apr_file_t *source,
+          apr_off_t offset,
+          apr_off_t size,
+          apr_pool_t *scratch_pool)
+{
+  char buffer[0x10000];
+
+  SVN_ERR(svn_io_file_seek(source, APR_SET, &offset, scratch_pool));
+  while (size > 0)
+    {
+      apr_size_t to_copy = size > sizeof(buffer)
+                         ? sizeof(buffer)
+                         : (apr_size_t)size;
+
+      SVN_ERR(svn_io_file_read_full2(source, buffer, to_copy, NULL, NULL,
+                                     scratch_pool));
+      SVN_ERR(svn_io_file_write_full(dest, buffer, to_copy, NULL,
+                                     scratch_pool));
+      size -= to_copy;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_fs_fs__dump_index_func_t, appending a copy of ENTRY to
+ * the svn_fs_fs__p2l_entry_t * array BATON. */
+static svn_error_t *
+collect_entry(const svn_fs_fs__p2l_entry_t *entry,
+              void *baton,
+              apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *entries = baton;
+  APR_ARRAY_PUSH(entries, svn_fs_fs__p2l_entry_t *)
+    = apr_pmemdup(entries->pool, entry, sizeof(*entry));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if items of TYPE are representations. */
+static svn_boolean_t
+is_rep(apr_uint32_t type)
+{
+  return type == SVN_FS_FS__ITEM_TYPE_FILE_REP
+      || type == SVN_FS_FS__ITEM_TYPE_DIR_REP
+      || type == SVN_FS_FS__ITEM_TYPE_FILE_PROPS
+      || type == SVN_FS_FS__ITEM_TYPE_DIR_PROPS;
+}
+
+/* Rewrite the pack file of shard BATON->SHARD with recompressed
+ * representations and new index data.  BATON is a recompress_baton_t.
+ * This implements the svn_fs_fs__with_pack_lock() 'body' callback type.
+ */
+static svn_error_t *
+recompress_shard(void *baton,
+                 apr_pool_t *pool)
+{
+  recompress_baton_t *rb = baton;
+  svn_fs_t *fs = rb->fs;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_revnum_t start_rev = (svn_revnum_t)(rb->shard
+                                          * ffd->max_files_per_dir);
+  const char *pack_path = svn_fs_fs__path_rev_packed(fs, start_rev,
+                                                     PATH_PACKED, pool);
+  apr_array_header_t *entries
+    = apr_array_make(pool, 1024, sizeof(svn_fs_fs__p2l_entry_t *));
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__revision_file_t *new_file;
+  const char *temp_path;
+  const char *l2p_proto_index;
+  const char *p2l_proto_index;
+  apr_off_t offset = 0;
+  int i;
+
+  /* All items in the current pack file in offset order. */
+  SVN_ERR(svn_fs_fs__dump_index(fs, start_rev, collect_entry, entries,
+                                rb->cancel_func, rb->cancel_baton, pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, start_rev,
+                                           pool, iterpool));
+
+  /* The new pack file will be created next to the old one. */
+  new_file = apr_pcalloc(pool, sizeof(*new_file));
+  new_file->start_revision = start_rev;
+  new_file->is_packed = TRUE;
+  new_file->block_size = ffd->block_size;
+  new_file->pool = pool;
+  SVN_ERR(svn_io_open_unique_file3(&new_file->file, &temp_path,
+                                   svn_dirent_dirname(pack_path, pool),
+                                   svn_io_file_del_on_pool_cleanup,
+                                   pool, iterpool));
+
+  /* Copy all items, recompressing representations as we go, and update
+   * the ENTRIES to match the new layout. */
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_fs_fs__p2l_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t *);
+      svn_stringbuf_t *item = NULL;
+
+      svn_pool_clear(iterpool);
+      if (rb->cancel_func)
+        SVN_ERR(rb->cancel_func(rb->cancel_baton));
+
+      if (is_rep(entry->type) && entry->size <= MAX_RECOMPRESSED_REP_SIZE)
+        {
+          svn_stringbuf_t *data
+            = svn_stringbuf_create_ensure((apr_size_t)entry->size, iterpool);
+
+          SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &entry->offset,
+                                   iterpool));
+          SVN_ERR(svn_io_file_read_full2(rev_file->file, data->data,
+                                         (apr_size_t)entry->size, NULL, NULL,
+                                         iterpool));
+          data->len = (apr_size_t)entry->size;
+          data->data[data->len] = '\0';
+
+          SVN_ERR(recompress_rep(&item, data, rb, iterpool, iterpool));
+          if (item == NULL)
+            item = data;
+        }
+
+      if (item)
+        {
+          SVN_ERR(svn_io_file_write_full(new_file->file, item->data,
+                                         item->len, NULL, iterpool));
+          entry->size = item->len;
+        }
+      else
+        {
+          SVN_ERR(copy_item(new_file->file, rev_file->file, entry->offset,
+                            entry->size, iterpool));
+        }
+
+      entry->offset = offset;
+      offset += entry->size;
+    }
+
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Append new indexes.  This also re-calculates the item checksums. */
+  SVN_ERR(svn_fs_fs__p2l_index_from_p2l_entries(&p2l_proto_index, fs,
+                                                new_file, entries,
+                                                pool, iterpool));
+  SVN_ERR(svn_fs_fs__l2p_index_from_p2l_entries(&l2p_proto_index, fs,
+                                                entries, pool, iterpool));
+  SVN_ERR(svn_fs_fs__add_index_data(fs, new_file->file, l2p_proto_index,
+                                    p2l_proto_index, start_rev, iterpool));
+  if (ffd->flush_to_disk)
+    SVN_ERR(svn_io_file_flush_to_disk(new_file->file, iterpool));
+  SVN_ERR(svn_io_file_close(new_file->file, iterpool));
+
+  /* Atomically replace the old pack file. */
+  SVN_ERR(svn_fs_fs__move_into_place(temp_path, pack_path, pack_path,
+                                     ffd->flush_to_disk, iterpool));
+  svn_fs_fs__forget_pack_generation(fs, start_rev);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__recompress(svn_fs_t *fs,
+                      const char *compression,
+                      svn_fs_pack_notify_t notify_func,
+                      void *notify_baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  recompress_baton_t rb = { 0 };
+  compression_type_t compression_type;
+  apr_int64_t shards;
+
+  /* Check the FS format. */
+  if (   ffd->format < SVN_FS_FS__MIN_RECOMPRESSED_REP_FORMAT
+      || ! svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_FS_UNSUPPORTED_FORMAT, NULL, NULL);
+
+  SVN_ERR(svn_fs_fs__parse_compression_option(&compression_type,
+                                              &rb.compression_level,
+                                              compression));
+  switch (compression_type)
+    {
+      /* The windows keep their standard size.  Like txdelta_to_svndiff,
+         don't use svndiff3 for them, or storaged_delta_is_usable would
+         stop passing them through as delta streams. */
+      case compression_type_lz4:
+        rb.svndiff_version = 2;
+        break;
+
+      case compression_type_zlib:
+        rb.svndiff_version = 1;
+        break;
+
+      default:
+        rb.svndiff_version = 0;
+    }
+
+  rb.fs = fs;
+  rb.notify_func = notify_func;
+  rb.notify_baton = notify_baton;
+  rb.cancel_func = cancel_func;
+  rb.cancel_baton = cancel_baton;
+
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, scratch_pool));
+  shards = ffd->max_files_per_dir
+         ? ffd->min_unpacked_rev / ffd->max_files_per_dir
+         : 0;
+
+  for (rb.shard = 0; rb.shard < shards; ++rb.shard)
+    {
+      svn_pool_clear(iterpool);
+
+      if (notify_func)
+        SVN_ERR(notify_func(notify_baton, rb.shard, svn_fs_pack_notify_start,
+                            iterpool));
+
+      SVN_ERR(svn_fs_fs__with_pack_lock(fs, recompress_shard, &rb,
+                                        iterpool));
+
+      if (notify_func)
+        SVN_ERR(notify_func(notify_baton, rb.shard, svn_fs_pack_notify_end,
+                            iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
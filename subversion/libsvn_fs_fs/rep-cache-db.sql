@@ -70,6 +70,22 @@ SELECT hash, revision, offset, size, expanded_size
 FROM rep_cache
 WHERE revision >= ?1 AND revision <= ?2
 
+-- STMT_CREATE_SIZE_INDEX
+/* Speeds up STMT_GET_REPS_BY_SIZE.  Older binaries simply ignore it.
+
+   Works for both V1 and V2 schemas. */
+CREATE INDEX IF NOT EXISTS I_EXPANDED_SIZE
+ON rep_cache (expanded_size, revision);
+
+-- STMT_GET_REPS_BY_SIZE
+/* Works for both V1 and V2 schemas. */
+SELECT hash, revision, offset, size, expanded_size
+FROM rep_cache
+WHERE expanded_size >= ?3 AND expanded_size <= ?4
+  AND revision >= ?1 AND revision <= ?2
+ORDER BY revision DESC
+LIMIT ?5
+
 -- STMT_GET_MAX_REV
 /* Works for both V1 and V2 schemas. */
 SELECT MAX(revision)
@@ -33,6 +33,7 @@
 #include "svn_path.h"
 
 #include "private/svn_sqlite.h"
+#include "private/svn_subr_private.h"
 
 #include "rep-cache-db.h"
 
@@ -112,6 +113,19 @@ open_rep_cache(void *baton,
       SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(sdb, stmt), sdb);
     }
 
+  /* Looking up delta base candidates by size needs an index.  Older rep
+     caches don't have it, so add it on demand.  A read-only database
+     is fine as we can't commit to such a repository anyway. */
+  if (ffd->delta_base_candidates > 1)
+    {
+      svn_error_t *err = svn_sqlite__exec_statements(sdb,
+                                                     STMT_CREATE_SIZE_INDEX);
+      if (err && err->apr_err == SVN_ERR_SQLITE_READONLY)
+        svn_error_clear(err);
+      else
+        SVN_SQLITE__ERR_CLOSE(err, sdb);
+    }
+
   /* This is used as a flag that the database is available so don't
      set it earlier. */
   ffd->rep_cache_db = sdb;
@@ -321,6 +335,83 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__get_rep_references_by_size(apr_array_header_t **reps,
+                                      svn_fs_t *fs,
+                                      svn_revnum_t min_revision,
+                                      svn_filesize_t min_size,
+                                      svn_filesize_t max_size,
+                                      int limit,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_boolean_t exists;
+  svn_revnum_t youngest;
+  int i;
+
+  *reps = apr_array_make(result_pool, limit, sizeof(representation_t *));
+
+  /* Don't create a rep cache just to find nothing in it. */
+  if (! ffd->rep_cache_db)
+    {
+      SVN_ERR(svn_fs_fs__exists_rep_cache(&exists, fs, scratch_pool));
+      if (! exists)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(svn_fs_fs__open_rep_cache(fs, scratch_pool));
+    }
+
+  /* Entries beyond HEAD may be left over from failed commits. */
+  SVN_ERR(svn_fs_fs__youngest_rev(&youngest, fs, scratch_pool));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                    STMT_GET_REPS_BY_SIZE));
+  SVN_ERR(svn_sqlite__bindf(stmt, "rriid", min_revision, youngest,
+                            (apr_int64_t)min_size, (apr_int64_t)max_size,
+                            limit));
+
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      representation_t *rep;
+      svn_checksum_t *checksum;
+      svn_error_t *err;
+
+      err = svn_checksum_parse_hex(&checksum, svn_checksum_sha1,
+                                   svn_sqlite__column_text(stmt, 0, NULL),
+                                   scratch_pool);
+      if (err)
+        return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+
+      rep = apr_pcalloc(result_pool, sizeof(*rep));
+      svn_fs_fs__id_txn_reset(&rep->txn_id);
+      rep->has_sha1 = TRUE;
+      memcpy(rep->sha1_digest, checksum->digest, sizeof(rep->sha1_digest));
+      rep->revision = svn_sqlite__column_revnum(stmt, 1);
+      rep->item_index = svn_sqlite__column_int64(stmt, 2);
+      rep->size = svn_sqlite__column_int64(stmt, 3);
+      rep->expanded_size = svn_sqlite__column_int64(stmt, 4);
+      APR_ARRAY_PUSH(*reps, representation_t *) = rep;
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  /* The query already skipped entries beyond HEAD, so unlike
+     svn_fs_fs__get_rep_reference, we don't need to check for them. */
+  for (i = 0; i < (*reps)->nelts; ++i)
+    {
+      representation_t *rep = APR_ARRAY_IDX(*reps, i, representation_t *);
+      SVN_ERR(svn_fs_fs__fixup_expanded_size(fs, rep, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__set_rep_reference(svn_fs_t *fs,
                              representation_t *rep,
@@ -73,6 +73,23 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
                              svn_checksum_t *checksum,
                              apr_pool_t *pool);
 
+/* Set *REPS to an array of up to LIMIT representation_t * from FS's
+   rep cache that have been added in revision MIN_REVISION or later, but
+   not after HEAD, and whose expanded size is between MIN_SIZE and
+   MAX_SIZE, inclusively.
+   The youngest ones are returned first.  If the rep cache database
+   does not exist, *REPS will be empty.  Allocate *REPS in RESULT_POOL
+   and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__get_rep_references_by_size(apr_array_header_t **reps,
+                                      svn_fs_t *fs,
+                                      svn_revnum_t min_revision,
+                                      svn_filesize_t min_size,
+                                      svn_filesize_t max_size,
+                                      int limit,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool);
+
 /* Set the representation REP in FS, using REP->CHECKSUM.
    Use POOL for temporary allocations.  Returns SVN_ERR_FS_CORRUPT if
    an existing reference beyond HEAD is detected.
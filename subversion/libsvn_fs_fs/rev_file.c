@@ -20,6 +20,8 @@
  * ====================================================================
  */
 
+#include <apr_mmap.h>
+
 #include "rev_file.h"
 #include "fs_fs.h"
 #include "index.h"
@@ -28,9 +30,333 @@
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 #include "svn_private_config.h"
 
+/* A rev / pack file mapped into memory.  Instances get created on demand
+ * by map_file() and are owned by a svn_fs_fs__file_mappings_t.
+ */
+struct svn_fs_fs__file_mapping_t
+{
+  /* Path of the mapped file.  Key in OWNER->MAPPINGS. */
+  const char *path;
+
+  /* Identity of the file at the time it got mapped.  If any of this
+   * changes, the file has been replaced or modified and the mapping
+   * must not be used anymore. */
+  apr_off_t size;
+  apr_time_t mtime;
+  apr_ino_t inode;
+  apr_dev_t device;
+
+  /* The first SIZE bytes of the file. */
+  const char *data;
+
+  /* Number of revision file structures currently using DATA. */
+  int ref_count;
+
+  /* TRUE while this is listed in OWNER.  Superseded mappings will be
+   * removed from OWNER immediately but remain valid until their
+   * REF_COUNT drops to 0. */
+  svn_boolean_t in_cache;
+
+  /* Neighbours in OWNER's LRU list. */
+  svn_fs_fs__file_mapping_t *previous;
+  svn_fs_fs__file_mapping_t *next;
+
+  /* The container. */
+  svn_fs_fs__file_mappings_t *owner;
+
+  /* Pool containing this structure and the memory mapping.  Destroying
+   * it will unmap the file. */
+  apr_pool_t *pool;
+};
+
+struct svn_fs_fs__file_mappings_t
+{
+  /* const char *path -> svn_fs_fs__file_mapping_t * */
+  apr_hash_t *mappings;
+
+  /* Most recently and least recently used entry in MAPPINGS. */
+  svn_fs_fs__file_mapping_t *first;
+  svn_fs_fs__file_mapping_t *last;
+
+  /* Unmap unused files if MAPPINGS contains more than this. */
+  int max_mappings;
+
+  /* Parent pool for all mappings. */
+  apr_pool_t *pool;
+};
+
+svn_fs_fs__file_mappings_t *
+svn_fs_fs__file_mappings_create(int max_mappings,
+                                apr_pool_t *result_pool)
+{
+  svn_fs_fs__file_mappings_t *result = apr_pcalloc(result_pool,
+                                                   sizeof(*result));
+  result->mappings = svn_hash__make(result_pool);
+  result->max_mappings = max_mappings;
+  result->pool = result_pool;
+
+  return result;
+}
+
+/* Remove MAPPING from its owner's LRU list. */
+static void
+lru_unlink(svn_fs_fs__file_mapping_t *mapping)
+{
+  svn_fs_fs__file_mappings_t *owner = mapping->owner;
+
+  if (mapping->previous)
+    mapping->previous->next = mapping->next;
+  else
+    owner->first = mapping->next;
+
+  if (mapping->next)
+    mapping->next->previous = mapping->previous;
+  else
+    owner->last = mapping->previous;
+
+  mapping->previous = NULL;
+  mapping->next = NULL;
+}
+
+/* Make MAPPING the most recently used entry in its owner's LRU list. */
+static void
+lru_push_front(svn_fs_fs__file_mapping_t *mapping)
+{
+  svn_fs_fs__file_mappings_t *owner = mapping->owner;
+
+  mapping->next = owner->first;
+  if (owner->first)
+    owner->first->previous = mapping;
+  else
+    owner->last = mapping;
+
+  owner->first = mapping;
+}
+
+/* Remove MAPPING from its owner.  Unmap it unless it is still in use. */
+static void
+drop_mapping(svn_fs_fs__file_mapping_t *mapping)
+{
+  svn_hash_sets(mapping->owner->mappings, mapping->path, NULL);
+  lru_unlink(mapping);
+  mapping->in_cache = FALSE;
+
+  if (mapping->ref_count == 0)
+    svn_pool_destroy(mapping->pool);
+}
+
+/* Unmap the least recently used files in MAPPINGS until it is within
+ * its size limit again.  Files that are still in use will be skipped. */
+static void
+evict_mappings(svn_fs_fs__file_mappings_t *mappings)
+{
+  svn_fs_fs__file_mapping_t *mapping = mappings->last;
+
+  while (   mapping
+         && apr_hash_count(mappings->mappings) > mappings->max_mappings)
+    {
+      svn_fs_fs__file_mapping_t *previous = mapping->previous;
+      if (mapping->ref_count == 0)
+        drop_mapping(mapping);
+
+      mapping = previous;
+    }
+}
+
+/* APR pool cleanup function releasing the mapping referenced by the
+ * svn_fs_fs__revision_file_t given as BATON. */
+static apr_status_t
+release_mapping(void *baton)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  svn_fs_fs__file_mapping_t *mapping = file->mapping;
+
+  file->mapping = NULL;
+  file->mapped_data = NULL;
+  file->mapped_size = 0;
+
+  if (--mapping->ref_count == 0)
+    {
+      if (mapping->in_cache)
+        evict_mappings(mapping->owner);
+      else
+        svn_pool_destroy(mapping->pool);
+    }
+
+  return APR_SUCCESS;
+}
+
+/* If PATH in MAPPINGS is currently mapped, make sure that mapping won't
+ * be handed out again.  Use this before modifying the file at PATH. */
+static void
+forget_mapping(svn_fs_fs__file_mappings_t *mappings,
+               const char *path)
+{
+  svn_fs_fs__file_mapping_t *mapping = svn_hash_gets(mappings->mappings,
+                                                     path);
+  if (mapping)
+    drop_mapping(mapping);
+}
+
+/* Return the generation of a rev / pack file with the properties FINFO.
+ * Replacing the file changes its inode / file index.  Mix in the size and
+ * modification time since not all platforms provide the former. */
+static apr_uint64_t
+file_generation(const apr_finfo_t *finfo)
+{
+  apr_uint64_t generation = (apr_uint64_t)finfo->inode;
+  generation = generation * APR_UINT64_C(0x100000001b3)
+             ^ (apr_uint64_t)finfo->size;
+  generation = generation * APR_UINT64_C(0x100000001b3)
+             ^ (apr_uint64_t)finfo->mtime;
+
+  return generation;
+}
+
+/* Set the generation of the pack file containing REV in FS to GENERATION,
+ * as returned by svn_fs_fs__pack_generation. */
+static void
+set_pack_generation(svn_fs_t *fs,
+                    svn_revnum_t rev,
+                    apr_uint64_t generation)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int shard = (int)(rev / ffd->max_files_per_dir);
+
+  if (ffd->pack_generations == NULL)
+    ffd->pack_generations = apr_array_make(fs->pool, shard + 1,
+                                           sizeof(apr_uint64_t));
+
+  while (ffd->pack_generations->nelts <= shard)
+    APR_ARRAY_PUSH(ffd->pack_generations, apr_uint64_t) = 0;
+
+  APR_ARRAY_IDX(ffd->pack_generations, shard, apr_uint64_t) = generation;
+}
+
+apr_uint64_t
+svn_fs_fs__pack_generation(svn_fs_t *fs,
+                           svn_revnum_t rev)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int shard;
+
+  if (ffd->pack_generations == NULL || !svn_fs_fs__is_packed_rev(fs, rev))
+    return 0;
+
+  shard = (int)(rev / ffd->max_files_per_dir);
+  return shard < ffd->pack_generations->nelts
+       ? APR_ARRAY_IDX(ffd->pack_generations, shard, apr_uint64_t)
+       : 0;
+}
+
+void
+svn_fs_fs__forget_pack_generation(svn_fs_t *fs,
+                                  svn_revnum_t rev)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->pack_generations && svn_fs_fs__is_packed_rev(fs, rev))
+    set_pack_generation(fs, rev, 0);
+}
+
+/* Make FILE->MAPPED_DATA point to the contents of the rev / pack file at
+ * PATH which has just been opened as FILE->FILE and has the properties
+ * FINFO.  Reuse existing mappings from MAPPINGS where possible.
+ *
+ * Accessing pages beyond EOF of a mapped file triggers SIGBUS, which we
+ * can't handle safely in a library.  Therefore, rev and pack files must
+ * never be truncated in place: re-writing their indexes and recompressing
+ * them replaces the file with a new one, leaving all existing mappings of
+ * the old one intact.  To be sure, compare the identity of the newly opened
+ * file with that of the existing mapping and never use mappings beyond
+ * the size of the file at that time.
+ *
+ * The only file modified in place is the one returned by
+ * svn_fs_fs__open_pack_or_rev_file_writable(), which never gets mapped.
+ *
+ * Mapping is an optimization only.  If it fails for whatever reason,
+ * we silently fall back to file I/O.
+ */
+static void
+map_file(svn_fs_fs__revision_file_t *file,
+         svn_fs_fs__file_mappings_t *mappings,
+         const char *path,
+         const apr_finfo_t *finfo)
+{
+#if APR_HAS_MMAP
+  svn_fs_fs__file_mapping_t *mapping;
+  apr_status_t status;
+
+  if ((finfo->valid & APR_FINFO_SIZE) == 0)
+    return;
+
+  mapping = svn_hash_gets(mappings->mappings, path);
+  if (   mapping
+      && (   mapping->size != finfo->size
+          || mapping->mtime != finfo->mtime
+          || mapping->inode != finfo->inode
+          || mapping->device != finfo->device))
+    {
+      drop_mapping(mapping);
+      mapping = NULL;
+    }
+
+  if (mapping)
+    {
+      lru_unlink(mapping);
+    }
+  else
+    {
+      apr_pool_t *pool;
+      apr_mmap_t *mm;
+
+      if (finfo->size <= 0 || (apr_uint64_t)finfo->size > APR_SIZE_MAX)
+        return;
+
+      pool = svn_pool_create(mappings->pool);
+      status = apr_mmap_create(&mm, file->file, 0, (apr_size_t)finfo->size,
+                               APR_MMAP_READ, pool);
+      if (status != APR_SUCCESS)
+        {
+          svn_pool_destroy(pool);
+          return;
+        }
+
+      mapping = apr_pcalloc(pool, sizeof(*mapping));
+      mapping->path = apr_pstrdup(pool, path);
+      mapping->size = finfo->size;
+      mapping->mtime = finfo->mtime;
+      mapping->inode = finfo->inode;
+      mapping->device = finfo->device;
+      mapping->data = mm->mm;
+      mapping->in_cache = TRUE;
+      mapping->owner = mappings;
+      mapping->pool = pool;
+
+      svn_hash_sets(mappings->mappings, mapping->path, mapping);
+    }
+
+  lru_push_front(mapping);
+  mapping->ref_count++;
+
+  file->mapping = mapping;
+  file->mapped_data = mapping->data;
+  file->mapped_size = mapping->size;
+  apr_pool_cleanup_register(file->pool, file, release_mapping,
+                            apr_pool_cleanup_null);
+
+  evict_mappings(mappings);
+#endif
+}
+
 /* Initialize the *FILE structure for REVISION in filesystem FS.  Set its
  * pool member to the provided POOL. */
 static void
@@ -43,6 +369,7 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
 
   file->is_packed = svn_fs_fs__is_packed_rev(fs, revision);
   file->start_revision = svn_fs_fs__packed_base_rev(fs, revision);
+  file->generation = 0;
 
   file->file = NULL;
   file->stream = NULL;
@@ -54,6 +381,9 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
   file->p2l_offset = -1;
   file->p2l_checksum = NULL;
   file->footer_offset = -1;
+  file->mapped_data = NULL;
+  file->mapped_size = 0;
+  file->mapping = NULL;
   file->pool = pool;
 }
 
@@ -144,7 +474,11 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                         ? APR_READ | APR_WRITE | APR_BUFFERED
                         : APR_READ | APR_BUFFERED;
 
-      /* We may have to *temporarily* enable write access. */
+      /* We may have to *temporarily* enable write access.  Any existing
+       * mapping of the file may become invalid as we modify it. */
+      if (writable && ffd->file_mappings)
+        forget_mapping(ffd->file_mappings, path);
+
       err = writable ? auto_make_writable(path, result_pool, scratch_pool)
                      : SVN_NO_ERROR;
 
@@ -155,11 +489,39 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
 
       if (!err)
         {
+          apr_finfo_t finfo;
+          apr_status_t status;
+
           file->file = apr_file;
           file->stream = svn_stream_from_aprfile2(apr_file, TRUE,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
+          status = apr_file_info_get(&finfo, APR_FINFO_SIZE | APR_FINFO_MTIME
+                                             | APR_FINFO_INODE
+                                             | APR_FINFO_DEV,
+                                     apr_file);
+          if (status != APR_SUCCESS && status != APR_INCOMPLETE)
+            return svn_error_wrap_apr(status, _("Can't stat '%s'"),
+                                      svn_dirent_local_style(path,
+                                                             scratch_pool));
+
+          if ((finfo.valid & APR_FINFO_SIZE) == 0)
+            finfo.size = 0;
+          if ((finfo.valid & APR_FINFO_INODE) == 0)
+            finfo.inode = 0;
+          if ((finfo.valid & APR_FINFO_DEV) == 0)
+            finfo.device = 0;
+          if ((finfo.valid & APR_FINFO_MTIME) == 0)
+            finfo.mtime = 0;
+
+          file->generation = file_generation(&finfo);
+          if (file->is_packed)
+            set_pack_generation(fs, rev, file->generation);
+
+          if (!writable && ffd->file_mappings)
+            map_file(file, ffd->file_mappings, path, &finfo);
+
           return SVN_NO_ERROR;
         }
 
@@ -227,6 +589,20 @@ svn_fs_fs__open_pack_or_rev_file_writable(svn_fs_fs__revision_file_t** file,
                                                result_pool, scratch_pool));
 }
 
+const char *
+svn_fs_fs__mapped_data(svn_fs_fs__revision_file_t *file,
+                       apr_off_t offset,
+                       apr_size_t len)
+{
+  if (   file->mapped_data
+      && offset >= 0
+      && offset <= file->mapped_size
+      && len <= file->mapped_size - offset)
+    return file->mapped_data + offset;
+
+  return NULL;
+}
+
 svn_error_t *
 svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
 {
@@ -235,25 +611,49 @@ svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
       apr_off_t filesize = 0;
       unsigned char footer_length;
       svn_stringbuf_t *footer;
+      const char *mapped;
 
       /* Determine file size. */
-      SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize, file->pool));
+      if (file->mapped_data)
+        filesize = file->mapped_size;
+      else
+        SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize,
+                                 file->pool));
 
       /* Read last byte (containing the length of the footer). */
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1, file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
-                                     sizeof(footer_length), NULL, NULL,
-                                     file->pool));
+      mapped = svn_fs_fs__mapped_data(file, filesize - 1, 1);
+      if (mapped)
+        {
+          footer_length = (unsigned char)*mapped;
+        }
+      else
+        {
+          SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size,
+                                           NULL, filesize - 1, file->pool));
+          SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
+                                         sizeof(footer_length), NULL, NULL,
+                                         file->pool));
+        }
 
       /* Read footer. */
-      footer = svn_stringbuf_create_ensure(footer_length, file->pool);
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1 - footer_length,
-                                       file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, footer->data, footer_length,
-                                     &footer->len, NULL, file->pool));
-      footer->data[footer->len] = '\0';
+      mapped = svn_fs_fs__mapped_data(file, filesize - 1 - footer_length,
+                                      footer_length);
+      if (mapped)
+        {
+          footer = svn_stringbuf_ncreate(mapped, footer_length, file->pool);
+        }
+      else
+        {
+          footer = svn_stringbuf_create_ensure(footer_length, file->pool);
+          SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size,
+                                           NULL,
+                                           filesize - 1 - footer_length,
+                                           file->pool));
+          SVN_ERR(svn_io_file_read_full2(file->file, footer->data,
+                                         footer_length, &footer->len, NULL,
+                                         file->pool));
+          footer->data[footer->len] = '\0';
+        }
 
       /* Extract index locations. */
       SVN_ERR(svn_fs_fs__parse_footer(&file->l2p_offset, &file->l2p_checksum,
@@ -290,6 +690,35 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__open_large_file(svn_fs_fs__revision_file_t **file,
+                           svn_fs_t *fs,
+                           const svn_fs_fs__id_part_t *txn_id,
+                           const unsigned char *sha1,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *path = txn_id
+                   ? svn_fs_fs__path_txn_large_file(fs, txn_id, sha1,
+                                                    scratch_pool)
+                   : svn_fs_fs__path_large_file(fs, sha1, scratch_pool);
+  apr_file_t *apr_file;
+
+  SVN_ERR(svn_io_file_open(&apr_file, path, APR_READ | APR_BUFFERED,
+                           APR_OS_DEFAULT, result_pool));
+
+  *file = apr_pcalloc(result_pool, sizeof(**file));
+  (*file)->file = apr_file;
+  (*file)->is_packed = FALSE;
+  (*file)->start_revision = SVN_INVALID_REVNUM;
+  (*file)->stream = svn_stream_from_aprfile2(apr_file, TRUE, result_pool);
+  (*file)->block_size = ffd->block_size;
+  (*file)->pool = result_pool;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
@@ -297,6 +726,8 @@ svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
     SVN_ERR(svn_stream_close(file->stream));
   if (file->file)
     SVN_ERR(svn_io_file_close(file->file, file->pool));
+  if (file->mapping)
+    apr_pool_cleanup_run(file->pool, file, release_mapping);
 
   file->file = NULL;
   file->stream = NULL;
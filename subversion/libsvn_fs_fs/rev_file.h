@@ -38,6 +38,16 @@
 typedef struct svn_fs_fs__packed_number_stream_t
   svn_fs_fs__packed_number_stream_t;
 
+/* Opaque read-only memory mapping of a whole rev / pack file, owned by
+ * the filesystem's svn_fs_fs__file_mappings_t.
+ */
+typedef struct svn_fs_fs__file_mapping_t svn_fs_fs__file_mapping_t;
+
+/* Bounded, LRU-managed set of file mappings shared by all rev / pack files
+ * opened through the same svn_fs_t.
+ */
+typedef struct svn_fs_fs__file_mappings_t svn_fs_fs__file_mappings_t;
+
 /* Data file, including indexes data, and associated properties for
  * START_REVISION.  As the FILE is kept open, background pack operations
  * will not cause access to this file to fail.
@@ -51,6 +61,12 @@ typedef struct svn_fs_fs__revision_file_t
   /* the revision was packed when the first file / stream got opened */
   svn_boolean_t is_packed;
 
+  /* Identifies the version of FILE on disk.  Rev and pack files may get
+   * replaced by files with a different layout, e.g. by re-writing their
+   * indexes or by recompressing them.  Cache keys for all data that
+   * depends on the file layout contain this value.  0 for txn files. */
+  apr_uint64_t generation;
+
   /* rev / pack file */
   apr_file_t *file;
 
@@ -90,10 +106,63 @@ typedef struct svn_fs_fs__revision_file_t
    * been called, yet. */
   apr_off_t footer_offset;
 
+  /* If not NULL, the contents of FILE mapped into memory.  Only ever set
+   * for rev / pack files opened read-only while file mappings have been
+   * enabled for the filesystem.  Remains valid until this structure gets
+   * closed or its POOL gets cleaned up.  Use svn_fs_fs__mapped_data() to
+   * access it. */
+  const char *mapped_data;
+
+  /* Number of bytes available in MAPPED_DATA.  0 if that is NULL. */
+  apr_off_t mapped_size;
+
+  /* Reference to the file mapping providing MAPPED_DATA.  NULL if there
+   * is none. */
+  svn_fs_fs__file_mapping_t *mapping;
+
   /* pool containing this object */
   apr_pool_t *pool;
 } svn_fs_fs__revision_file_t;
 
+/* Return a new mapping cache that keeps up to MAX_MAPPINGS rev / pack
+ * files mapped into memory.  Files still in use by some revision file
+ * structure may exceed that limit temporarily.  Allocate the result in
+ * RESULT_POOL, which must outlive all revision files using it.
+ */
+svn_fs_fs__file_mappings_t *
+svn_fs_fs__file_mappings_create(int max_mappings,
+                                apr_pool_t *result_pool);
+
+/* If FILE has been mapped into memory and all LEN bytes starting at
+ * OFFSET are within the mapped range, return a pointer to them.  Return
+ * NULL otherwise.  In the latter case, callers have to read the data
+ * through FILE->FILE.
+ *
+ * Note that this does not change the file pointer of FILE->FILE.
+ */
+const char *
+svn_fs_fs__mapped_data(svn_fs_fs__revision_file_t *file,
+                       apr_off_t offset,
+                       apr_size_t len);
+
+/* Return the generation of the pack file containing REV in FS as of the
+ * last time that file has been opened through FS.  Return 0 if REV has
+ * not been packed or its pack file has not been opened, yet.
+ *
+ * This allows for looking up data cached for packed revisions without
+ * opening the pack file first.  Other processes replacing the pack file
+ * will only be noticed the next time we open it.
+ */
+apr_uint64_t
+svn_fs_fs__pack_generation(svn_fs_t *fs,
+                           svn_revnum_t rev);
+
+/* Forget the generation of the pack file containing REV in FS.  Call this
+ * after replacing that file. */
+void
+svn_fs_fs__forget_pack_generation(svn_fs_t *fs,
+                                  svn_revnum_t rev);
+
 /* Open the correct revision file for REV.  If the filesystem FS has
  * been packed, *FILE will be set to the packed file; otherwise, set *FILE
  * to the revision file for REV.  Return SVN_ERR_FS_NO_SUCH_REVISION if the
@@ -137,6 +206,18 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool);
 
+/* Open the file containing the out-of-line fulltext with the given SHA1
+ * digest in FS and return it in *FILE.  If TXN_ID is not NULL, the file
+ * is still part of that transaction.  Allocate *FILE in RESULT_POOL and
+ * use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_fs_fs__open_large_file(svn_fs_fs__revision_file_t **file,
+                           svn_fs_t *fs,
+                           const svn_fs_fs__id_part_t *txn_id,
+                           const unsigned char *sha1,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
+
 /* Close all files and streams in FILE.
  */
 svn_error_t *
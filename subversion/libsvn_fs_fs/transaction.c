@@ -43,6 +43,7 @@
 #include "lock.h"
 #include "rep-cache.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -1917,6 +1918,12 @@ struct rep_write_baton
      deltified, then eventually written to rep_stream. */
   svn_stream_t *delta_stream;
 
+  /* While we are still choosing between delta base candidates, the first
+     bytes of the contents get collected here and DELTA_STREAM is NULL.
+     BASE_REP is the default delta base in that case. */
+  svn_stringbuf_t *probe;
+  representation_t *base_rep;
+
   /* Where is this representation header stored. */
   apr_off_t rep_offset;
 
@@ -1948,6 +1955,18 @@ struct rep_write_baton
   apr_pool_t *result_pool;
 };
 
+/* When comparing delta base candidates, estimate the delta size from
+   this many bytes at the start of the new contents. */
+#define DELTA_PROBE_SIZE 0x10000
+
+/* Only contents committed within this many revisions before HEAD are
+   considered as delta bases for nodes without history. */
+#define DELTA_RECENT_REVS 1000
+
+static svn_error_t *
+finish_probe(struct rep_write_baton *b,
+             svn_boolean_t complete);
+
 /* Handler for the write method of the representation writable stream.
    BATON is a rep_write_baton, DATA is the data to write, and *LEN is
    the length of this data. */
@@ -1962,6 +1981,20 @@ rep_write_contents(void *baton,
   SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
   b->rep_size += *len;
 
+  /* Still collecting the data to pick the delta base with? */
+  if (b->probe)
+    {
+      apr_size_t probe_len = MIN(*len, DELTA_PROBE_SIZE - b->probe->len);
+      apr_size_t remaining = *len - probe_len;
+
+      svn_stringbuf_appendbytes(b->probe, data, probe_len);
+      if (b->probe->len < DELTA_PROBE_SIZE)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(finish_probe(b, FALSE));
+      return svn_stream_write(b->delta_stream, data + probe_len, &remaining);
+    }
+
   /* If we are writing a delta, use that stream. */
   if (b->delta_stream)
     return svn_stream_write(b->delta_stream, data, len);
@@ -2005,6 +2038,69 @@ shards_spanned(int *spanned,
   return SVN_NO_ERROR;
 }
 
+/* Set *REP to NULL if it is not suitable as a delta base in FS.  PROPS
+   tells whether we are about to write a props representation.  Perform
+   temporary allocations in POOL. */
+static svn_error_t *
+check_delta_base(representation_t **rep,
+                 svn_fs_t *fs,
+                 svn_boolean_t props,
+                 apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (*rep)
+    {
+      int chain_length = 0;
+      int shard_count = 0;
+
+      /* Very short rep bases are simply not worth it as we are unlikely
+       * to re-coup the deltification space overhead of 20+ bytes. */
+      svn_filesize_t rep_size = (*rep)->expanded_size;
+      if (rep_size < 64)
+        {
+          *rep = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      /* Fulltexts stored outside the rev files are never used as delta
+       * base.  Reading them would defeat the purpose of storing them
+       * separately. */
+      if (!props && ffd->format >= SVN_FS_FS__MIN_LARGE_FILE_FORMAT)
+        {
+          svn_boolean_t is_external;
+          SVN_ERR(svn_fs_fs__rep_is_external(&is_external, *rep, fs, pool));
+          if (is_external)
+            {
+              *rep = NULL;
+              return SVN_NO_ERROR;
+            }
+        }
+
+      /* Check whether the length of the deltification chain is acceptable.
+       * Otherwise, shared reps may form a non-skipping delta chain in
+       * extreme cases. */
+      SVN_ERR(svn_fs_fs__rep_chain_length(&chain_length, &shard_count,
+                                          *rep, fs, pool));
+
+      /* Some reasonable limit, depending on how acceptable longer linear
+       * chains are in this repo.  Also, allow for some minimal chain. */
+      if (chain_length >= 2 * (int)ffd->max_linear_deltification + 2)
+        *rep = NULL;
+      else
+        /* To make it worth opening additional shards / pack files, we
+         * require that the reps have a certain minimal size.  To deltify
+         * against a rep in different shard, the lower limit is 512 bytes
+         * and doubles with every extra shard to visit along the delta
+         * chain. */
+        if (   shard_count > 1
+            && ((svn_filesize_t)128 << shard_count) >= rep_size)
+          *rep = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Given a node-revision NODEREV in filesystem FS, return the
    representation in *REP to use as the base for a text representation
    delta if PROPS is FALSE.  If PROPS has been set, a suitable props
@@ -2088,42 +2184,7 @@ choose_delta_base(representation_t **rep,
 
   /* if we encountered a shared rep, its parent chain may be different
    * from the node-rev parent chain. */
-  if (*rep)
-    {
-      int chain_length = 0;
-      int shard_count = 0;
-
-      /* Very short rep bases are simply not worth it as we are unlikely
-       * to re-coup the deltification space overhead of 20+ bytes. */
-      svn_filesize_t rep_size = (*rep)->expanded_size;
-      if (rep_size < 64)
-        {
-          *rep = NULL;
-          return SVN_NO_ERROR;
-        }
-
-      /* Check whether the length of the deltification chain is acceptable.
-       * Otherwise, shared reps may form a non-skipping delta chain in
-       * extreme cases. */
-      SVN_ERR(svn_fs_fs__rep_chain_length(&chain_length, &shard_count,
-                                          *rep, fs, pool));
-
-      /* Some reasonable limit, depending on how acceptable longer linear
-       * chains are in this repo.  Also, allow for some minimal chain. */
-      if (chain_length >= 2 * (int)ffd->max_linear_deltification + 2)
-        *rep = NULL;
-      else
-        /* To make it worth opening additional shards / pack files, we
-         * require that the reps have a certain minimal size.  To deltify
-         * against a rep in different shard, the lower limit is 512 bytes
-         * and doubles with every extra shard to visit along the delta
-         * chain. */
-        if (   shard_count > 1
-            && ((svn_filesize_t)128 << shard_count) >= rep_size)
-          *rep = NULL;
-    }
-
-  return SVN_NO_ERROR;
+  return svn_error_trace(check_delta_base(rep, fs, props, pool));
 }
 
 /* Something went wrong and the pool for the rep write is being
@@ -2159,9 +2220,13 @@ rep_write_cleanup(void *data)
   return APR_SUCCESS;
 }
 
+/* Set *HANDLER and *HANDLER_BATON to write svndiff data to OUTPUT in
+   the format configured for FS.  Set *WINDOW_SIZE to the size of the
+   delta windows that format can take. */
 static void
 txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
                    void **handler_baton,
+                   apr_size_t *window_size,
                    svn_stream_t *output,
                    svn_fs_t *fs,
                    apr_pool_t *pool)
@@ -2169,7 +2234,12 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
   fs_fs_data_t *ffd = fs->fsap_data;
   int svndiff_version;
 
-  if (ffd->delta_compression_type == compression_type_lz4)
+  if (ffd->large_delta_windows)
+    {
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+      svndiff_version = 3;
+    }
+  else if (ffd->delta_compression_type == compression_type_lz4)
     {
       SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
       svndiff_version = 2;
@@ -2186,6 +2256,218 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
 
   svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
                           ffd->delta_compression_level, pool);
+  *window_size = svn_txdelta__max_window_size(svndiff_version);
+}
+
+/* Window handler adding a rough estimate of the encoded size of each
+   delta window to the apr_size_t in BATON. */
+static svn_error_t *
+count_delta_size(svn_txdelta_window_t *window,
+                 void *baton)
+{
+  apr_size_t *size = baton;
+
+  /* Instructions take about 2 bytes each. */
+  if (window)
+    *size += window->new_data->len + 2 * window->num_ops;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *SIZE to the estimated size of the delta of PROBE against the start
+   of the contents of BASE_REP in FS.  BASE_REP may be NULL, in which case
+   the estimate is for a self-delta.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+estimate_delta_size(apr_size_t *size,
+                    svn_fs_t *fs,
+                    representation_t *base_rep,
+                    const svn_stringbuf_t *probe,
+                    apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *prefix = svn_stringbuf_create_ensure(probe->len,
+                                                        scratch_pool);
+
+  if (base_rep)
+    {
+      svn_stream_t *stream;
+      apr_size_t len = probe->len;
+
+      SVN_ERR(svn_fs_fs__get_contents(&stream, fs, base_rep, FALSE,
+                                      scratch_pool));
+      SVN_ERR(svn_stream_read_full(stream, prefix->data, &len));
+      SVN_ERR(svn_stream_close(stream));
+      prefix->len = len;
+      prefix->data[len] = '\0';
+    }
+
+  *size = 0;
+  return svn_error_trace(svn_txdelta_run(
+                           svn_stream_from_stringbuf(prefix, scratch_pool),
+                           svn_stream_from_string(
+                             svn_stringbuf__morph_into_string(
+                               svn_stringbuf_dup(probe, scratch_pool)),
+                             scratch_pool),
+                           count_delta_size, size, svn_checksum_md5, NULL,
+                           NULL, NULL, scratch_pool, scratch_pool));
+}
+
+/* Return in *REP the best base for the new text representation of NODEREV
+   in FS whose first bytes are PROBE.  COMPLETE tells whether PROBE holds
+   the whole contents.  DEFAULT_REP is the base chosen by
+   choose_delta_base.
+
+   Up to ffd->delta_base_candidates candidates are compared:  DEFAULT_REP,
+   the immediate predecessor's text (which is the copy source for nodes
+   copied in this txn) and, for nodes without history, contents of similar
+   size committed recently, as found in the rep-cache.  The one with the
+   smallest estimated delta for PROBE wins, DEFAULT_REP in case of a tie.
+   Perform temporary allocations in POOL. */
+static svn_error_t *
+select_delta_base(representation_t **rep,
+                  svn_fs_t *fs,
+                  node_revision_t *noderev,
+                  representation_t *default_rep,
+                  const svn_stringbuf_t *probe,
+                  svn_boolean_t complete,
+                  apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int limit = (int)MIN(ffd->delta_base_candidates, INT_MAX);
+  apr_array_header_t *candidates = apr_array_make(pool, 4,
+                                                  sizeof(representation_t *));
+  apr_pool_t *iterpool;
+  apr_size_t best_size;
+  int i;
+
+  APR_ARRAY_PUSH(candidates, representation_t *) = default_rep;
+
+  if (noderev->predecessor_count && candidates->nelts < limit)
+    {
+      node_revision_t *predecessor;
+      representation_t *candidate;
+
+      SVN_ERR(svn_fs_fs__get_node_revision(&predecessor, fs,
+                                           noderev->predecessor_id,
+                                           pool, pool));
+      candidate = predecessor->data_rep;
+      SVN_ERR(check_delta_base(&candidate, fs, FALSE, pool));
+      if (   candidate
+          && !svn_fs_fs__noderev_same_rep_key(candidate, default_rep))
+        APR_ARRAY_PUSH(candidates, representation_t *) = candidate;
+    }
+  else if (   !noderev->predecessor_count
+           && ffd->rep_sharing_allowed
+           && candidates->nelts < limit)
+    {
+      apr_array_header_t *reps;
+      svn_revnum_t min_revision = ffd->youngest_rev_cache - DELTA_RECENT_REVS;
+
+      /* If we don't know the full size yet, any larger contents may do. */
+      SVN_ERR(svn_fs_fs__get_rep_references_by_size(
+                &reps, fs, MAX(min_revision, 0),
+                complete ? probe->len - probe->len / 4 : probe->len,
+                complete ? probe->len + probe->len / 4 : APR_INT64_MAX,
+                limit - candidates->nelts, pool, pool));
+
+      for (i = 0; i < reps->nelts; ++i)
+        {
+          representation_t *candidate
+            = APR_ARRAY_IDX(reps, i, representation_t *);
+
+          SVN_ERR(check_delta_base(&candidate, fs, FALSE, pool));
+          if (candidate)
+            APR_ARRAY_PUSH(candidates, representation_t *) = candidate;
+        }
+    }
+
+  /* Nothing to choose from? */
+  *rep = default_rep;
+  if (candidates->nelts == 1)
+    return SVN_NO_ERROR;
+
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(estimate_delta_size(&best_size, fs, default_rep, probe, iterpool));
+  for (i = 1; i < candidates->nelts; ++i)
+    {
+      representation_t *candidate
+        = APR_ARRAY_IDX(candidates, i, representation_t *);
+      apr_size_t size;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(estimate_delta_size(&size, fs, candidate, probe, iterpool));
+      if (size < best_size)
+        {
+          *rep = candidate;
+          best_size = size;
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the rep header for a delta against BASE_REP to B's rep stream and
+   set up B's delta stream for the contents to follow. */
+static svn_error_t *
+start_delta(struct rep_write_baton *b,
+            representation_t *base_rep)
+{
+  svn_stream_t *source;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  apr_size_t window_size;
+  svn_fs_fs__rep_header_t header = { 0 };
+
+  SVN_ERR(svn_fs_fs__get_contents(&source, b->fs, base_rep, TRUE,
+                                  b->scratch_pool));
+
+  /* Write out the rep header. */
+  if (base_rep)
+    {
+      header.base_revision = base_rep->revision;
+      header.base_item_index = base_rep->item_index;
+      header.base_length = base_rep->size;
+      header.type = svn_fs_fs__rep_delta;
+    }
+  else
+    {
+      header.type = svn_fs_fs__rep_self_delta;
+    }
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+
+  /* Now determine the offset of the actual svndiff data. */
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  /* Prepare to write the svndiff data. */
+  txdelta_to_svndiff(&wh, &whb, &window_size, b->rep_stream, b->fs,
+                     b->result_pool);
+
+  b->delta_stream = svn_txdelta__target_push(wh, whb, source, window_size,
+                                             b->scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pick the delta base for the contents written to B based on the data
+   collected in B->PROBE, start the delta and pass the collected data on.
+   COMPLETE tells whether there will be no further contents. */
+static svn_error_t *
+finish_probe(struct rep_write_baton *b,
+             svn_boolean_t complete)
+{
+  svn_stringbuf_t *probe = b->probe;
+  representation_t *base_rep;
+  apr_size_t len = probe->len;
+
+  SVN_ERR(select_delta_base(&base_rep, b->fs, b->noderev, b->base_rep,
+                            probe, complete, b->scratch_pool));
+  SVN_ERR(start_delta(b, base_rep));
+
+  b->probe = NULL;
+  return svn_error_trace(svn_stream_write(b->delta_stream, probe->data,
+                                          &len));
 }
 
 /* Get a rep_write_baton and store it in *WB_P for the representation
@@ -2198,13 +2480,10 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
                     node_revision_t *noderev,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_write_baton *b;
   apr_file_t *file;
   representation_t *base_rep;
-  svn_stream_t *source;
-  svn_txdelta_window_handler_t wh;
-  void *whb;
-  svn_fs_fs__rep_header_t header = { 0 };
 
   b = apr_pcalloc(pool, sizeof(*b));
 
@@ -2230,39 +2509,25 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 
   SVN_ERR(svn_io_file_get_offset(&b->rep_offset, file, b->scratch_pool));
 
+  /* Cleanup in case something goes wrong. */
+  apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
+                            apr_pool_cleanup_null);
+
   /* Get the base for this delta. */
   SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->scratch_pool));
-  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
-                                  b->scratch_pool));
 
-  /* Write out the rep header. */
-  if (base_rep)
+  /* If there are other candidates to compare, we need to see the first
+     part of the contents before we can write the rep header. */
+  if (ffd->delta_base_candidates > 1)
     {
-      header.base_revision = base_rep->revision;
-      header.base_item_index = base_rep->item_index;
-      header.base_length = base_rep->size;
-      header.type = svn_fs_fs__rep_delta;
+      b->base_rep = base_rep;
+      b->probe = svn_stringbuf_create_ensure(DELTA_PROBE_SIZE,
+                                             b->scratch_pool);
     }
   else
     {
-      header.type = svn_fs_fs__rep_self_delta;
+      SVN_ERR(start_delta(b, base_rep));
     }
-  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
-                                      b->scratch_pool));
-
-  /* Now determine the offset of the actual svndiff data. */
-  SVN_ERR(svn_io_file_get_offset(&b->delta_start, file,
-                                 b->scratch_pool));
-
-  /* Cleanup in case something goes wrong. */
-  apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
-                            apr_pool_cleanup_null);
-
-  /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
-
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
 
   *wb_p = b;
 
@@ -2507,37 +2772,299 @@ digests_final(representation_t *rep,
   return SVN_NO_ERROR;
 }
 
-/* Close handler for the representation write stream.  BATON is a
-   rep_write_baton.  Writes out a new node-rev that correctly
-   references the representation we just finished writing. */
-static svn_error_t *
-rep_write_contents_close(void *baton)
+/* Parameters of the content-defined chunking of out-of-line fulltexts.
+   Chunk boundaries are placed where the rolling hash has all bits of
+   CHUNK_BOUNDARY_MASK cleared, but chunks are never smaller than
+   CHUNK_MIN_SIZE or larger than CHUNK_MAX_SIZE, except for the last one.
+   This gives an average chunk size of about 80 kB. */
+#define CHUNK_MIN_SIZE      0x4000
+#define CHUNK_MAX_SIZE      0x40000
+#define CHUNK_BOUNDARY_MASK 0xffff0000
+
+/* Fill TABLE with the pseudo-random per-byte values of the "gear" rolling
+   hash used to find chunk boundaries.  These must never change for
+   existing repositories to keep sharing chunks with new contents. */
+static void
+init_gear_table(apr_uint32_t table[256])
 {
-  struct rep_write_baton *b = baton;
-  representation_t *rep;
-  representation_t *old_rep;
-  apr_off_t offset;
+  apr_uint32_t i;
 
-  rep = apr_pcalloc(b->result_pool, sizeof(*rep));
+  for (i = 0; i < 256; ++i)
+    {
+      /* murmur3's finalizer */
+      apr_uint32_t h = (i + 1) * 0x9e3779b9;
+      h ^= h >> 16;
+      h *= 0x85ebca6b;
+      h ^= h >> 13;
+      h *= 0xc2b2ae35;
+      h ^= h >> 16;
+      table[i] = h;
+    }
+}
 
-  /* Close our delta stream so the last bits of svndiff are written
-     out. */
-  if (b->delta_stream)
-    SVN_ERR(svn_stream_close(b->delta_stream));
+/* Return the length of the first chunk in DATA of LEN bytes, using the
+   gear hash values in TABLE. */
+static apr_size_t
+find_chunk_boundary(const unsigned char *data,
+                    apr_size_t len,
+                    const apr_uint32_t table[256])
+{
+  apr_uint32_t hash = 0;
+  apr_size_t i;
 
-  /* Determine the length of the svndiff data. */
-  SVN_ERR(svn_io_file_get_offset(&offset, b->file, b->scratch_pool));
-  rep->size = offset - b->delta_start;
+  if (len <= CHUNK_MIN_SIZE)
+    return len;
 
-  /* Fill in the rest of the representation field. */
-  rep->expanded_size = b->rep_size;
-  rep->txn_id = *svn_fs_fs__id_txn_id(b->noderev->id);
-  SVN_ERR(set_uniquifier(b->fs, rep, b->scratch_pool));
-  rep->revision = SVN_INVALID_REVNUM;
+  len = MIN(len, CHUNK_MAX_SIZE);
 
-  /* Finalize the checksum. */
-  SVN_ERR(digests_final(rep, b->md5_checksum_ctx, b->sha1_checksum_ctx,
-                        b->result_pool));
+  /* Each byte contributes to the upper bits of HASH for 32 steps.
+     Start hashing that many bytes before the minimum chunk length. */
+  for (i = CHUNK_MIN_SIZE - 32; i < len; ++i)
+    {
+      hash = (hash << 1) + table[data[i]];
+      if (i >= CHUNK_MIN_SIZE && (hash & CHUNK_BOUNDARY_MASK) == 0)
+        return i;
+    }
+
+  return len;
+}
+
+/* Add the fulltext chunk DATA of LEN bytes to the chunk store of FS,
+   unless a chunk with the same contents is already there, and return
+   its description in *CHUNK.  TXN_ID is the transaction that needs it.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+store_chunk(svn_fs_fs__chunk_t *chunk,
+            svn_fs_t *fs,
+            const svn_fs_fs__id_part_t *txn_id,
+            const char *data,
+            apr_size_t len,
+            apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_checksum_t *checksum;
+  const char *path, *tmp_path;
+  svn_node_kind_t kind;
+  apr_file_t *file;
+  svn_error_t *err;
+
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, data, len,
+                       scratch_pool));
+  memcpy(chunk->sha1_digest, checksum->digest, sizeof(chunk->sha1_digest));
+  chunk->size = len;
+
+  /* Chunks are addressed by their SHA1, i.e. an existing file already
+     holds the same data. */
+  path = svn_fs_fs__path_chunk(fs, chunk->sha1_digest, scratch_pool);
+  SVN_ERR(svn_io_check_path(path, &kind, scratch_pool));
+  if (kind == svn_node_file)
+    return SVN_NO_ERROR;
+
+  /* Create the containing folder on demand. */
+  err = svn_io_make_dir_recursively(svn_dirent_dirname(path, scratch_pool),
+                                    scratch_pool);
+  if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+    return svn_error_trace(err);
+  svn_error_clear(err);
+
+  /* Chunks are immutable and don't depend on the transaction, so they
+     go straight into the store.  Only complete files become visible
+     there and concurrent writers of the same chunk write the same data. */
+  SVN_ERR(svn_io_open_unique_file3(&file, &tmp_path,
+                                   svn_fs_fs__path_txn_dir(fs, txn_id,
+                                                           scratch_pool),
+                                   svn_io_file_del_none,
+                                   scratch_pool, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, data, len, NULL, scratch_pool));
+
+  /* Chunks are not part of any commit's flush list, so make sure that
+     their contents are on disk before their names are. */
+  if (ffd->flush_to_disk)
+    SVN_ERR(svn_io_file_flush_to_disk(file, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+  SVN_ERR(svn_io_file_rename2(tmp_path, path, ffd->flush_to_disk,
+                              scratch_pool));
+  SVN_ERR(svn_io_set_file_read_only(path, FALSE, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Split the fulltext read from SOURCE into content-defined chunks, add
+   them to the chunk store of FS for transaction TXN_ID and write the
+   resulting chunk list to TARGET.  Close both streams.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_chunks(svn_fs_t *fs,
+             const svn_fs_fs__id_part_t *txn_id,
+             svn_stream_t *source,
+             svn_stream_t *target,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *chunks = apr_array_make(scratch_pool, 16,
+                                               sizeof(svn_fs_fs__chunk_t));
+  apr_uint32_t table[256];
+  char *buffer = apr_palloc(scratch_pool, CHUNK_MAX_SIZE);
+  apr_size_t buffered = 0;
+  svn_boolean_t eof = FALSE;
+
+  init_gear_table(table);
+  while (!eof || buffered)
+    {
+      apr_size_t len;
+
+      svn_pool_clear(iterpool);
+
+      /* Top up the buffer such that it holds the longest possible chunk. */
+      if (!eof)
+        {
+          len = CHUNK_MAX_SIZE - buffered;
+          SVN_ERR(svn_stream_read_full(source, buffer + buffered, &len));
+          eof = buffered + len < CHUNK_MAX_SIZE;
+          buffered += len;
+        }
+
+      if (buffered == 0)
+        break;
+
+      len = find_chunk_boundary((const unsigned char *)buffer, buffered,
+                                table);
+      SVN_ERR(store_chunk(apr_array_push(chunks), fs, txn_id, buffer, len,
+                          iterpool));
+
+      buffered -= len;
+      memmove(buffer, buffer + len, buffered);
+    }
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_stream_close(source));
+  SVN_ERR(svn_fs_fs__write_chunk_list(chunks, target, scratch_pool));
+
+  return svn_error_trace(svn_stream_close(target));
+}
+
+/* B has just written the new representation REP to the proto-rev file.
+   Move its fulltext into a separate file within the transaction and
+   replace the rep's data in the proto-rev file with an EXTERNAL rep
+   header that refers to that file.  If large file chunking has been
+   enabled, store the fulltext in the chunk store instead, put the chunk
+   list into that file and write a CHUNKED rep header. */
+static svn_error_t *
+write_external_rep(struct rep_write_baton *b,
+                   representation_t *rep)
+{
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+  svn_fs_fs__rep_header_t header = { 0 };
+  const char *path;
+  svn_node_kind_t kind;
+
+  if (ffd->large_file_chunking)
+    {
+      header.type = svn_fs_fs__rep_chunked;
+      path = svn_fs_fs__path_txn_chunk_list(b->fs, &rep->txn_id,
+                                            rep->sha1_digest,
+                                            b->scratch_pool);
+    }
+  else
+    {
+      header.type = svn_fs_fs__rep_external;
+      path = svn_fs_fs__path_txn_large_file(b->fs, &rep->txn_id,
+                                            rep->sha1_digest,
+                                            b->scratch_pool);
+    }
+
+  /* Contents are addressed by their SHA1, i.e. if the file already exists,
+     it contains our fulltext or chunk list already. */
+  SVN_ERR(svn_io_check_path(path, &kind, b->scratch_pool));
+  if (kind == svn_node_none)
+    {
+      svn_stream_t *source, *target;
+      apr_file_t *file;
+
+      /* Reconstruct the fulltext from the delta we just wrote.  This will
+         also verify its checksum.  Note that out-of-line storage and
+         chunking therefore add I/O to the commit: the whole delta has been
+         written to the proto-rev file before we get here and is read back
+         now, only to be dropped afterwards. */
+      SVN_ERR(svn_fs_fs__get_contents_from_file(&source, b->fs, rep,
+                                                b->file, b->rep_offset,
+                                                b->scratch_pool));
+      SVN_ERR(svn_io_file_open(&file, path,
+                               APR_WRITE | APR_CREATE | APR_TRUNCATE
+                               | APR_BUFFERED,
+                               APR_OS_DEFAULT, b->scratch_pool));
+      target = svn_stream_from_aprfile2(file, TRUE, b->scratch_pool);
+      if (header.type == svn_fs_fs__rep_chunked)
+        SVN_ERR(write_chunks(b->fs, &rep->txn_id, source, target,
+                             b->scratch_pool));
+      else
+        SVN_ERR(svn_stream_copy3(source, target, NULL, NULL,
+                                 b->scratch_pool));
+
+      /* The file will simply be renamed into place upon commit, so its
+         contents must be on disk before that. */
+      if (ffd->flush_to_disk)
+        SVN_ERR(svn_io_file_flush_to_disk(file, b->scratch_pool));
+      SVN_ERR(svn_io_file_close(file, b->scratch_pool));
+    }
+
+  /* Drop the delta from the proto-rev file and start over with a new
+     on-disk checksum. */
+  SVN_ERR(svn_io_file_trunc(b->file, b->rep_offset, b->scratch_pool));
+  SVN_ERR(svn_io_file_seek(b->file, APR_SET, &b->rep_offset,
+                           b->scratch_pool));
+
+  b->rep_stream = svn_stream_from_aprfile2(b->file, TRUE, b->scratch_pool);
+  if (svn_fs_fs__use_log_addressing(b->fs))
+    b->rep_stream = fnv1a_wrap_stream(&b->fnv1a_checksum_ctx, b->rep_stream,
+                                      b->scratch_pool);
+
+  memcpy(header.sha1_digest, rep->sha1_digest, sizeof(header.sha1_digest));
+  header.expanded_size = rep->expanded_size;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+
+  /* There is no data following the header. */
+  rep->size = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Close handler for the representation write stream.  BATON is a
+   rep_write_baton.  Writes out a new node-rev that correctly
+   references the representation we just finished writing. */
+static svn_error_t *
+rep_write_contents_close(void *baton)
+{
+  struct rep_write_baton *b = baton;
+  representation_t *rep;
+  representation_t *old_rep;
+  apr_off_t offset;
+
+  rep = apr_pcalloc(b->result_pool, sizeof(*rep));
+
+  /* Small contents may not have reached the end of the probe, yet. */
+  if (b->probe)
+    SVN_ERR(finish_probe(b, TRUE));
+
+  /* Close our delta stream so the last bits of svndiff are written
+     out. */
+  if (b->delta_stream)
+    SVN_ERR(svn_stream_close(b->delta_stream));
+
+  /* Determine the length of the svndiff data. */
+  SVN_ERR(svn_io_file_get_offset(&offset, b->file, b->scratch_pool));
+  rep->size = offset - b->delta_start;
+
+  /* Fill in the rest of the representation field. */
+  rep->expanded_size = b->rep_size;
+  rep->txn_id = *svn_fs_fs__id_txn_id(b->noderev->id);
+  SVN_ERR(set_uniquifier(b->fs, rep, b->scratch_pool));
+  rep->revision = SVN_INVALID_REVNUM;
+
+  /* Finalize the checksum. */
+  SVN_ERR(digests_final(rep, b->md5_checksum_ctx, b->sha1_checksum_ctx,
+                        b->result_pool));
 
   /* Check and see if we already have a representation somewhere that's
      identical to the one we just wrote out. */
@@ -2554,6 +3081,13 @@ rep_write_contents_close(void *baton)
     }
   else
     {
+      fs_fs_data_t *ffd = b->fs->fsap_data;
+
+      /* Very large contents get stored outside the rev file. */
+      if (   ffd->large_file_threshold
+          && rep->size >= ffd->large_file_threshold)
+        SVN_ERR(write_external_rep(b, rep));
+
       /* Write out our cosmetic end marker. */
       SVN_ERR(svn_stream_puts(b->rep_stream, "ENDREP\n"));
       SVN_ERR(allocate_item_index(&rep->item_index, b->fs, &rep->txn_id,
@@ -2902,6 +3436,7 @@ write_container_delta_rep(representation_t *rep,
 {
   svn_txdelta_window_handler_t diff_wh;
   void *diff_whb;
+  apr_size_t window_size;
 
   svn_stream_t *file_stream;
   svn_stream_t *stream;
@@ -2947,11 +3482,12 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_io_file_get_offset(&delta_start, file, scratch_pool));
 
   /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&diff_wh, &diff_whb, file_stream, fs, scratch_pool);
+  txdelta_to_svndiff(&diff_wh, &diff_whb, &window_size, file_stream, fs,
+                     scratch_pool);
 
   whb = apr_pcalloc(scratch_pool, sizeof(*whb));
-  whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
-                                        scratch_pool);
+  whb->stream = svn_txdelta__target_push(diff_wh, diff_whb, source,
+                                         window_size, scratch_pool);
   whb->size = 0;
   whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
   if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
@@ -3100,6 +3636,124 @@ get_final_id(svn_fs_fs__id_part_t *part,
     }
 }
 
+/* Maximum number of mutable nodes whose data will be read into memory
+   before acquiring the write lock.  Larger commits read the remaining
+   nodes under the lock, keeping memory usage bounded. */
+#define COMMIT_STAGE_MAX_NODES 0x4000
+
+/* The data of a mutable node in the transaction that write_final_rev
+   needs.  It does not depend on the revision number being committed. */
+typedef struct staged_node_t
+{
+  /* The node-revision as stored in the transaction. */
+  node_revision_t *noderev;
+
+  /* For directories, the svn_fs_dirent_t * array of entries.
+     NULL otherwise. */
+  apr_array_header_t *entries;
+
+  /* If the node has a property list that is new in this transaction,
+     that property list.  NULL otherwise. */
+  apr_hash_t *proplist;
+} staged_node_t;
+
+/* Everything about a transaction that commit_body needs and that can be
+   read before acquiring the write lock. */
+typedef struct commit_stage_t
+{
+  /* The changed paths of the transaction. */
+  apr_hash_t *changed_paths;
+
+  /* CHANGED_PATHS serialized as they are to be written to the rev file. */
+  svn_stringbuf_t *changes;
+
+  /* Maps the unparsed ID of mutable nodes to their staged_node_t.
+     Nodes that are not in here will be read by write_final_rev. */
+  apr_hash_t *nodes;
+} commit_stage_t;
+
+/* Read the node ID and, recursively, all mutable nodes below it from
+   transaction in FS and add them to STAGE.  Allocate the data in
+   RESULT_POOL and use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+stage_node(commit_stage_t *stage,
+           svn_fs_t *fs,
+           const svn_fs_id_t *id,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  staged_node_t *node;
+  apr_pool_t *iterpool;
+  int i;
+
+  if (   ! svn_fs_fs__id_is_txn(id)
+      || apr_hash_count(stage->nodes) >= COMMIT_STAGE_MAX_NODES)
+    return SVN_NO_ERROR;
+
+  node = apr_pcalloc(result_pool, sizeof(*node));
+  SVN_ERR(svn_fs_fs__get_node_revision(&node->noderev, fs, id,
+                                       result_pool, scratch_pool));
+  if (node->noderev->prop_rep && is_txn_rep(node->noderev->prop_rep))
+    SVN_ERR(svn_fs_fs__get_proplist(&node->proplist, fs, node->noderev,
+                                    result_pool));
+
+  svn_hash_sets(stage->nodes, svn_fs_fs__id_unparse(id, result_pool)->data,
+                node);
+
+  if (node->noderev->kind != svn_node_dir)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__rep_contents_dir(&node->entries, fs, node->noderev,
+                                      result_pool, scratch_pool));
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < node->entries->nelts; ++i)
+    {
+      svn_fs_dirent_t *dirent
+        = APR_ARRAY_IDX(node->entries, i, svn_fs_dirent_t *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(stage_node(stage, fs, dirent->id, result_pool, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read everything about transaction TXN in FS that commit_body needs and
+   that does not depend on the revision number it will get into a new
+   commit stage and return that in *STAGE_P.  This is meant to be called
+   without holding the write lock to keep the time spent under that lock
+   short.  Allocate the result in RESULT_POOL and use SCRATCH_POOL for
+   temporaries. */
+static svn_error_t *
+stage_commit(commit_stage_t **stage_p,
+             svn_fs_t *fs,
+             svn_fs_txn_t *txn,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(txn);
+  commit_stage_t *stage = apr_pcalloc(result_pool, sizeof(*stage));
+
+  SVN_ERR(svn_fs_fs__txn_changes_fetch(&stage->changed_paths, fs, txn_id,
+                                       result_pool));
+  stage->changes = svn_stringbuf_create_empty(result_pool);
+  SVN_ERR(svn_fs_fs__write_changes(svn_stream_from_stringbuf(stage->changes,
+                                                             scratch_pool),
+                                   fs, stage->changed_paths, TRUE,
+                                   scratch_pool));
+
+  stage->nodes = apr_hash_make(result_pool);
+  SVN_ERR(stage_node(stage, fs, svn_fs_fs__id_txn_create_root(txn_id,
+                                                               scratch_pool),
+                     result_pool, scratch_pool));
+
+  *stage_p = stage;
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy a node-revision specified by id ID in fileystem FS from a
    transaction into the proto-rev-file FILE.  Set *NEW_ID_P to a
    pointer to the new node-id which will be allocated in POOL.
@@ -3117,6 +3771,9 @@ get_final_id(svn_fs_fs__id_part_t *part,
    Collect the pair_cache_key_t of all directories written to the
    committed cache in DIRECTORY_IDS.
 
+   STAGE provides the data of mutable nodes that has been read before
+   acquiring the write lock.
+
    If REPS_TO_CACHE is not NULL, append to it a copy (allocated in
    REPS_POOL) of each data rep that is new in this revision.
 
@@ -3139,6 +3796,7 @@ write_final_rev(const svn_fs_id_t **new_id_p,
                 apr_uint64_t start_copy_id,
                 apr_off_t initial_offset,
                 apr_array_header_t *directory_ids,
+                const commit_stage_t *stage,
                 apr_array_header_t *reps_to_cache,
                 apr_hash_t *reps_hash,
                 apr_pool_t *reps_pool,
@@ -3146,6 +3804,7 @@ write_final_rev(const svn_fs_id_t **new_id_p,
                 apr_pool_t *pool)
 {
   node_revision_t *noderev;
+  staged_node_t *staged;
   apr_off_t my_offset;
   const svn_fs_id_t *new_id;
   svn_fs_fs__id_part_t node_id, copy_id, rev_item;
@@ -3162,7 +3821,12 @@ write_final_rev(const svn_fs_id_t **new_id_p,
     return SVN_NO_ERROR;
 
   subpool = svn_pool_create(pool);
-  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, subpool));
+  staged = svn_hash_gets(stage->nodes,
+                         svn_fs_fs__id_unparse(id, subpool)->data);
+  if (staged)
+    noderev = staged->noderev;
+  else
+    SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, subpool));
 
   if (noderev->kind == svn_node_dir)
     {
@@ -3171,8 +3835,11 @@ write_final_rev(const svn_fs_id_t **new_id_p,
 
       /* This is a directory.  Write out all the children first. */
 
-      SVN_ERR(svn_fs_fs__rep_contents_dir(&entries, fs, noderev, pool,
-                                          subpool));
+      if (staged)
+        entries = staged->entries;
+      else
+        SVN_ERR(svn_fs_fs__rep_contents_dir(&entries, fs, noderev, pool,
+                                            subpool));
       for (i = 0; i < entries->nelts; ++i)
         {
           svn_fs_dirent_t *dirent
@@ -3181,8 +3848,8 @@ write_final_rev(const svn_fs_id_t **new_id_p,
           svn_pool_clear(subpool);
           SVN_ERR(write_final_rev(&new_id, file, rev, fs, dirent->id,
                                   start_node_id, start_copy_id, initial_offset,
-                                  directory_ids, reps_to_cache, reps_hash,
-                                  reps_pool, FALSE, subpool));
+                                  directory_ids, stage, reps_to_cache,
+                                  reps_hash, reps_pool, FALSE, subpool));
           if (new_id && (svn_fs_fs__id_rev(new_id) == rev))
             dirent->id = svn_fs_fs__id_copy(new_id, pool);
         }
@@ -3260,7 +3927,10 @@ write_final_rev(const svn_fs_id_t **new_id_p,
       apr_uint32_t item_type = noderev->kind == svn_node_dir
                              ? SVN_FS_FS__ITEM_TYPE_DIR_PROPS
                              : SVN_FS_FS__ITEM_TYPE_FILE_PROPS;
-      SVN_ERR(svn_fs_fs__get_proplist(&proplist, fs, noderev, pool));
+      if (staged)
+        proplist = staged->proplist;
+      else
+        SVN_ERR(svn_fs_fs__get_proplist(&proplist, fs, noderev, pool));
       noderev->prop_rep->txn_id = *txn_id;
       SVN_ERR(set_uniquifier(fs, noderev->prop_rep, pool));
       noderev->prop_rep->revision = rev;
@@ -3395,21 +4065,22 @@ write_final_rev(const svn_fs_id_t **new_id_p,
   return SVN_NO_ERROR;
 }
 
-/* Write the changed path info CHANGED_PATHS from transaction TXN_ID to the
-   permanent rev-file FILE in filesystem FS.  *OFFSET_P is set the to offset
-   in the file of the beginning of this information.  Perform temporary
-   allocations in POOL. */
+/* Write the changed path info CHANGES, already serialized, from
+   transaction TXN_ID to the permanent rev-file FILE in filesystem FS.
+   *OFFSET_P is set the to offset in the file of the beginning of this
+   information.  Perform temporary allocations in POOL. */
 static svn_error_t *
 write_final_changed_path_info(apr_off_t *offset_p,
                               apr_file_t *file,
                               svn_fs_t *fs,
                               const svn_fs_fs__id_part_t *txn_id,
-                              apr_hash_t *changed_paths,
+                              const svn_stringbuf_t *changes,
                               apr_pool_t *pool)
 {
   apr_off_t offset;
   svn_stream_t *stream;
   svn_checksum_ctx_t *fnv1a_checksum_ctx;
+  apr_size_t len = changes->len;
 
   SVN_ERR(svn_io_file_get_offset(&offset, file, pool));
 
@@ -3420,7 +4091,7 @@ write_final_changed_path_info(apr_off_t *offset_p,
   else
     fnv1a_checksum_ctx = NULL;
 
-  SVN_ERR(svn_fs_fs__write_changes(stream, fs, changed_paths, TRUE, pool));
+  SVN_ERR(svn_stream_write(stream, changes->data, &len));
 
   *offset_p = offset;
 
@@ -3724,77 +4395,218 @@ promote_cached_directories(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Files and directories whose changes shall be flushed to disk in one go
+   by flush_scheduled, instead of one by one while they get written.
+
+   This requires POSIX semantics:  New files have their names stored in
+   their directories and may be flushed through read-only handles. */
+typedef struct flush_list_t
+{
+  /* Paths of the files and directories, each mapped to itself. */
+  apr_hash_t *files;
+  apr_hash_t *dirs;
+
+  /* Pool for all of the above. */
+  apr_pool_t *pool;
+} flush_list_t;
+
+/* Return a new, empty flush list allocated in RESULT_POOL. */
+static flush_list_t *
+create_flush_list(apr_pool_t *result_pool)
+{
+  flush_list_t *list = apr_pcalloc(result_pool, sizeof(*list));
+  list->files = apr_hash_make(result_pool);
+  list->dirs = apr_hash_make(result_pool);
+  list->pool = result_pool;
+
+  return list;
+}
+
+/* Schedule the file or directory at PATH, which has just been created or
+   renamed to PATH, in LIST.  If IS_DIR is set, PATH is a directory. */
+static void
+schedule_new_path(flush_list_t *list,
+                  const char *path,
+                  svn_boolean_t is_dir)
+{
+  /* The name of PATH is stored in its parent directory. */
+  const char *dirname = svn_dirent_dirname(path, list->pool);
+  svn_hash_sets(list->dirs, dirname, dirname);
+
+  if (!is_dir)
+    {
+      path = apr_pstrdup(list->pool, path);
+      svn_hash_sets(list->files, path, path);
+    }
+}
+
+/* Flush all files and directories in LIST to disk.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+flush_scheduled(flush_list_t *list,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_hash_index_t *hi;
+  int i;
+
+  /* Flush the files first, such that their contents are on disk before
+     their names are. */
+  for (i = 0; i < 2; ++i)
+    for (hi = apr_hash_first(scratch_pool, i ? list->dirs : list->files);
+         hi;
+         hi = apr_hash_next(hi))
+      {
+        apr_file_t *file;
+
+        svn_pool_clear(iterpool);
+        SVN_ERR(svn_io_file_open(&file, apr_hash_this_key(hi), APR_READ,
+                                 APR_OS_DEFAULT, iterpool));
+        SVN_ERR(svn_io_file_flush_to_disk(file, iterpool));
+        SVN_ERR(svn_io_file_close(file, iterpool));
+      }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton used for commit_body below. */
 struct commit_baton {
   svn_revnum_t *new_rev_p;
   svn_fs_t *fs;
   svn_fs_txn_t *txn;
+  const commit_stage_t *stage;
   apr_array_header_t *reps_to_cache;
   apr_hash_t *reps_hash;
   apr_pool_t *reps_pool;
 };
 
-/* The work-horse for svn_fs_fs__commit, called with the FS write lock.
-   This implements the svn_fs_fs__with_write_lock() 'body' callback
-   type.  BATON is a 'struct commit_baton *'. */
+/* Move all out-of-line fulltexts and chunk lists written in transaction
+   TXN_ID of FS to their final location.  If FLUSH_LIST is not NULL,
+   schedule them there instead of flushing them to disk immediately.
+   Use POOL for temporary allocations. */
 static svn_error_t *
-commit_body(void *baton, apr_pool_t *pool)
+move_large_files_into_place(svn_fs_t *fs,
+                            const svn_fs_fs__id_part_t *txn_id,
+                            flush_list_t *flush_list,
+                            apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *txn_dir;
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool;
+
+  if (ffd->format < SVN_FS_FS__MIN_LARGE_FILE_FORMAT)
+    return SVN_NO_ERROR;
+
+  txn_dir = svn_fs_fs__path_txn_dir(fs, txn_id, pool);
+  SVN_ERR(svn_io_get_dirents3(&dirents, txn_dir, TRUE, pool, pool));
+
+  iterpool = svn_pool_create(pool);
+  for (hi = apr_hash_first(pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      apr_size_t len = apr_hash_this_key_len(hi);
+      apr_size_t ext_len;
+      svn_boolean_t is_chunk_list;
+      svn_checksum_t *sha1;
+      const char *target;
+      svn_node_kind_t kind;
+      svn_error_t *err;
+
+      if (   len > sizeof(PATH_EXT_LARGE) - 1
+          && !strcmp(name + len - (sizeof(PATH_EXT_LARGE) - 1),
+                     PATH_EXT_LARGE))
+        {
+          ext_len = sizeof(PATH_EXT_LARGE) - 1;
+          is_chunk_list = FALSE;
+        }
+      else if (   len > sizeof(PATH_EXT_CHUNKS) - 1
+               && !strcmp(name + len - (sizeof(PATH_EXT_CHUNKS) - 1),
+                          PATH_EXT_CHUNKS))
+        {
+          ext_len = sizeof(PATH_EXT_CHUNKS) - 1;
+          is_chunk_list = TRUE;
+        }
+      else
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_checksum_parse_hex(&sha1, svn_checksum_sha1,
+                                     apr_pstrmemdup(iterpool, name,
+                                                    len - ext_len),
+                                     iterpool));
+      if (sha1 == NULL)
+        continue;
+
+      /* Files are addressed by content, i.e. an existing file already
+         holds the same fulltext or chunk list. */
+      target = is_chunk_list
+             ? svn_fs_fs__path_chunk_list(fs, sha1->digest, iterpool)
+             : svn_fs_fs__path_large_file(fs, sha1->digest, iterpool);
+      SVN_ERR(svn_io_check_path(target, &kind, iterpool));
+      if (kind == svn_node_file)
+        continue;
+
+      /* Create the containing folder on demand. */
+      err = svn_io_make_dir_recursively(svn_dirent_dirname(target, iterpool),
+                                        iterpool);
+      if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+        return svn_error_trace(err);
+      svn_error_clear(err);
+
+      SVN_ERR(svn_io_file_rename2(svn_dirent_join(txn_dir, name, iterpool),
+                                  target,
+                                  ffd->flush_to_disk && !flush_list,
+                                  iterpool));
+      SVN_ERR(svn_io_set_file_read_only(target, FALSE, iterpool));
+      if (flush_list)
+        schedule_new_path(flush_list, target, FALSE);
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write transaction CB->TXN of CB->FS as the revision following OLD_REV,
+   set *NEW_REV_P to that revision and run the paranoia checks on it, but
+   don't update the 'current' file yet.  START_NODE_ID and START_COPY_ID
+   are the first available node and copy ids for older FS formats.
+
+   Collect the pair_cache_key_t of all directories written to the
+   committed cache in DIRECTORY_IDS.  If FLUSH_LIST is not NULL, schedule
+   all new files in there instead of flushing them to disk immediately.
+
+   The FS write lock is assumed to be held by the caller.  Use POOL for
+   temporary allocations. */
+static svn_error_t *
+write_revision(svn_revnum_t *new_rev_p,
+               struct commit_baton *cb,
+               svn_revnum_t old_rev,
+               apr_uint64_t start_node_id,
+               apr_uint64_t start_copy_id,
+               apr_array_header_t *directory_ids,
+               flush_list_t *flush_list,
+               apr_pool_t *pool)
 {
-  struct commit_baton *cb = baton;
   fs_fs_data_t *ffd = cb->fs->fsap_data;
   const char *old_rev_filename, *rev_filename, *proto_filename;
   const char *revprop_filename;
   const svn_fs_id_t *root_id, *new_root_id;
-  apr_uint64_t start_node_id;
-  apr_uint64_t start_copy_id;
-  svn_revnum_t old_rev, new_rev;
+  svn_revnum_t new_rev;
   apr_file_t *proto_file;
   void *proto_file_lockcookie;
   apr_off_t initial_offset, changed_path_offset;
   const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
-  apr_hash_t *changed_paths;
-  apr_array_header_t *directory_ids = apr_array_make(pool, 4,
-                                                     sizeof(pair_cache_key_t));
+  svn_boolean_t flush_to_disk = ffd->flush_to_disk && !flush_list;
 
-  /* Re-Read the current repository format.  All our repo upgrade and
-     config evaluation strategies are such that existing information in
-     FS and FFD remains valid.
-
-     Although we don't recommend upgrading hot repositories, people may
-     still do it and we must make sure to either handle them gracefully
-     or to error out.
-
-     Committing pre-format 3 txns will fail after upgrade to format 3+
-     because the proto-rev cannot be found; no further action needed.
-     Upgrades from pre-f7 to f7+ means a potential change in addressing
-     mode for the final rev.  We must be sure to detect that cause because
-     the failure would only manifest once the new revision got committed.
-   */
-  SVN_ERR(svn_fs_fs__read_format_file(cb->fs, pool));
-
-  /* Read the current youngest revision and, possibly, the next available
-     node id and copy id (for old format filesystems).  Update the cached
-     value for the youngest revision, because we have just checked it. */
-  SVN_ERR(svn_fs_fs__read_current(&old_rev, &start_node_id, &start_copy_id,
-                                  cb->fs, pool));
-  ffd->youngest_rev_cache = old_rev;
-
-  /* Check to make sure this transaction is based off the most recent
-     revision. */
-  if (cb->txn->base_rev != old_rev)
-    return svn_error_create(SVN_ERR_FS_TXN_OUT_OF_DATE, NULL,
-                            _("Transaction out of date"));
-
-  /* We need the changes list for verification as well as for writing it
-     to the final rev file. */
-  SVN_ERR(svn_fs_fs__txn_changes_fetch(&changed_paths, cb->fs, txn_id,
-                                       pool));
-
-  /* Locks may have been added (or stolen) between the calling of
-     previous svn_fs.h functions and svn_fs_commit_txn(), so we need
-     to re-examine every changed-path in the txn and re-verify all
-     discovered locks. */
-  SVN_ERR(verify_locks(cb->fs, txn_id, changed_paths, pool));
+  /* Locks may have been added (or stolen) between the calling of
+     previous svn_fs.h functions and svn_fs_commit_txn(), so we need
+     to re-examine every changed-path in the txn and re-verify all
+     discovered locks. */
+  SVN_ERR(verify_locks(cb->fs, txn_id, cb->stage->changed_paths, pool));
 
   /* We are going to be one better than this puny old revision. */
   new_rev = old_rev + 1;
@@ -3808,12 +4620,12 @@ commit_body(void *baton, apr_pool_t *pool)
   root_id = svn_fs_fs__id_txn_create_root(txn_id, pool);
   SVN_ERR(write_final_rev(&new_root_id, proto_file, new_rev, cb->fs, root_id,
                           start_node_id, start_copy_id, initial_offset,
-                          directory_ids, cb->reps_to_cache, cb->reps_hash,
-                          cb->reps_pool, TRUE, pool));
+                          directory_ids, cb->stage, cb->reps_to_cache,
+                          cb->reps_hash, cb->reps_pool, TRUE, pool));
 
   /* Write the changed-path information. */
   SVN_ERR(write_final_changed_path_info(&changed_path_offset, proto_file,
-                                        cb->fs, txn_id, changed_paths,
+                                        cb->fs, txn_id, cb->stage->changes,
                                         pool));
 
   if (svn_fs_fs__use_log_addressing(cb->fs))
@@ -3837,7 +4649,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                      NULL, pool));
     }
 
-  if (ffd->flush_to_disk)
+  if (flush_to_disk)
     SVN_ERR(svn_io_file_flush_to_disk(proto_file, pool));
   SVN_ERR(svn_io_file_close(proto_file, pool));
 
@@ -3863,6 +4675,8 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVS_DIR,
                                                     pool),
                                     new_dir, pool));
+          if (flush_list)
+            schedule_new_path(flush_list, new_dir, TRUE);
         }
 
       /* Create the revprops shard. */
@@ -3879,9 +4693,15 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVPROPS_DIR,
                                                     pool),
                                     new_dir, pool));
+          if (flush_list)
+            schedule_new_path(flush_list, new_dir, TRUE);
         }
     }
 
+  /* The rev file will refer to the out-of-line fulltexts, so these must
+     be in place first. */
+  SVN_ERR(move_large_files_into_place(cb->fs, txn_id, flush_list, pool));
+
   /* Move the finished rev file into place.
 
      ### This "breaks" the transaction by removing the protorev file
@@ -3891,8 +4711,10 @@ commit_body(void *baton, apr_pool_t *pool)
   rev_filename = svn_fs_fs__path_rev(cb->fs, new_rev, pool);
   proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
   SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename,
-                                     old_rev_filename, ffd->flush_to_disk,
+                                     old_rev_filename, flush_to_disk,
                                      pool));
+  if (flush_list)
+    schedule_new_path(flush_list, rev_filename, FALSE);
 
   /* Now that we've moved the prototype revision file out of the way,
      we can unlock it (since further attempts to write to the file
@@ -3904,7 +4726,9 @@ commit_body(void *baton, apr_pool_t *pool)
   SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
   revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
   SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
-                              cb->txn, ffd->flush_to_disk, pool));
+                              cb->txn, flush_to_disk, pool));
+  if (flush_list)
+    schedule_new_path(flush_list, revprop_filename, FALSE);
 
   /* Run paranoia checks. */
   if (ffd->verify_before_commit)
@@ -3912,6 +4736,58 @@ commit_body(void *baton, apr_pool_t *pool)
       SVN_ERR(verify_before_commit(cb->fs, new_rev, pool));
     }
 
+  *new_rev_p = new_rev;
+
+  return SVN_NO_ERROR;
+}
+
+/* The work-horse for svn_fs_fs__commit, called with the FS write lock.
+   This implements the svn_fs_fs__with_write_lock() 'body' callback
+   type.  BATON is a 'struct commit_baton *'. */
+static svn_error_t *
+commit_body(void *baton, apr_pool_t *pool)
+{
+  struct commit_baton *cb = baton;
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
+  apr_uint64_t start_node_id;
+  apr_uint64_t start_copy_id;
+  svn_revnum_t old_rev, new_rev;
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
+  apr_array_header_t *directory_ids = apr_array_make(pool, 4,
+                                                     sizeof(pair_cache_key_t));
+
+  /* Re-Read the current repository format.  All our repo upgrade and
+     config evaluation strategies are such that existing information in
+     FS and FFD remains valid.
+
+     Although we don't recommend upgrading hot repositories, people may
+     still do it and we must make sure to either handle them gracefully
+     or to error out.
+
+     Committing pre-format 3 txns will fail after upgrade to format 3+
+     because the proto-rev cannot be found; no further action needed.
+     Upgrades from pre-f7 to f7+ means a potential change in addressing
+     mode for the final rev.  We must be sure to detect that cause because
+     the failure would only manifest once the new revision got committed.
+   */
+  SVN_ERR(svn_fs_fs__read_format_file(cb->fs, pool));
+
+  /* Read the current youngest revision and, possibly, the next available
+     node id and copy id (for old format filesystems).  Update the cached
+     value for the youngest revision, because we have just checked it. */
+  SVN_ERR(svn_fs_fs__read_current(&old_rev, &start_node_id, &start_copy_id,
+                                  cb->fs, pool));
+  ffd->youngest_rev_cache = old_rev;
+
+  /* Check to make sure this transaction is based off the most recent
+     revision. */
+  if (cb->txn->base_rev != old_rev)
+    return svn_error_create(SVN_ERR_FS_TXN_OUT_OF_DATE, NULL,
+                            _("Transaction out of date"));
+
+  SVN_ERR(write_revision(&new_rev, cb, old_rev, start_node_id,
+                         start_copy_id, directory_ids, NULL, pool));
+
   /* Update the 'current' file. */
   SVN_ERR(write_final_current(cb->fs, txn_id, new_rev, start_node_id,
                               start_copy_id, pool));
@@ -3954,6 +4830,44 @@ write_reps_to_cache(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Add the representations in REPS_TO_CACHE (an array of representation_t *)
+ * of committed revisions to the rep-cache database of FS.  Use SCRATCH_POOL
+ * for temporary allocations. */
+static svn_error_t *
+update_rep_cache(svn_fs_t *fs,
+                 const apr_array_header_t *reps_to_cache,
+                 apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
+
+  SVN_ERR(svn_fs_fs__open_rep_cache(fs, scratch_pool));
+
+  /* Write new entries to the rep-sharing database.
+   *
+   * We use an sqlite transaction to speed things up;
+   * see <http://www.sqlite.org/faq.html#q19>.
+   */
+  /* ### A commit that touches thousands of files will starve other
+         (reader/writer) commits for the duration of the below call.
+         Maybe write in batches? */
+  SVN_ERR(svn_sqlite__begin_transaction(ffd->rep_cache_db));
+  err = write_reps_to_cache(fs, reps_to_cache, scratch_pool);
+  err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
+
+  if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
+    {
+      /* Failed rollback means that our db connection is unusable, and
+         the only thing we can do is close it.  The connection will be
+         reopened during the next operation with rep-cache.db. */
+      return svn_error_trace(
+          svn_error_compose_create(err,
+                                   svn_fs_fs__close_rep_cache(fs)));
+    }
+
+  return svn_error_trace(err);
+}
+
 svn_error_t *
 svn_fs_fs__commit(svn_revnum_t *new_rev_p,
                   svn_fs_t *fs,
@@ -3961,12 +4875,26 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
                   apr_pool_t *pool)
 {
   struct commit_baton cb;
+  commit_stage_t *stage;
+  svn_revnum_t youngest;
   fs_fs_data_t *ffd = fs->fsap_data;
 
   cb.new_rev_p = new_rev_p;
   cb.fs = fs;
   cb.txn = txn;
 
+  /* The youngest revision never goes backwards.  So, if TXN is out of
+     date now, it will be when we get the write lock as well. */
+  SVN_ERR(svn_fs_fs__youngest_rev(&youngest, fs, pool));
+  if (txn->base_rev != youngest)
+    return svn_error_create(SVN_ERR_FS_TXN_OUT_OF_DATE, NULL,
+                            _("Transaction out of date"));
+
+  /* Do as much of the work as possible before we get the write lock,
+     such that concurrent commits don't have to wait for it. */
+  SVN_ERR(stage_commit(&stage, fs, txn, pool, pool));
+  cb.stage = stage;
+
   if (ffd->rep_sharing_allowed)
     {
       cb.reps_to_cache = apr_array_make(pool, 5, sizeof(representation_t *));
@@ -3986,39 +4914,493 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
      the success of the commit.  (See svn_fs_commit_txn().)  */
 
   if (ffd->rep_sharing_allowed)
+    SVN_ERR(update_rep_cache(fs, cb.reps_to_cache, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* A transaction waiting for a group commit, see svn_fs_fs__group_commit.
+   Entries are allocated by the committer that queued them.  Since pools
+   are not thread-safe, other threads must not allocate from there. */
+struct fs_fs_queued_commit_t
+{
+  /* Name of the transaction to commit. */
+  const char *txn_name;
+
+  /* Access context of the committer to verify the locks against.
+     May be NULL. */
+  svn_fs_access_t *access_ctx;
+
+  /* Set by the group commit that processed this entry.  Until then, the
+     members below are invalid. */
+  svn_boolean_t done;
+
+  /* The revision created from the transaction or SVN_INVALID_REVNUM. */
+  svn_revnum_t new_rev;
+
+  /* The error to return to the committer. */
+  svn_error_t *err;
+
+  /* If ERR is a merge conflict, the conflicting path, allocated in the
+     pool of ERR.  NULL otherwise. */
+  const char *conflict;
+
+  /* Next entry in the queue.  NULL at its end. */
+  fs_fs_queued_commit_t *next;
+};
+
+/* Baton used for group_commit_body below. */
+typedef struct group_commit_baton_t
+{
+  /* The filesystem to commit to. */
+  svn_fs_t *fs;
+
+  /* Brings queued transactions up to date. */
+  svn_fs_fs__txn_merge_func_t merge_func;
+
+  /* The representations in all revisions created by the group commit.
+     NULL if rep-sharing has been disabled. */
+  apr_array_header_t *reps_to_cache;
+  apr_pool_t *reps_pool;
+} group_commit_baton_t;
+
+/* Wake up all threads waiting for FFSD->COMMIT_QUEUE_COND.  The caller
+   must hold FFSD->COMMIT_QUEUE_LOCK. */
+static svn_error_t *
+signal_queued_commits(fs_fs_shared_data_t *ffsd)
+{
+#if APR_HAS_THREADS
+  apr_status_t status = apr_thread_cond_broadcast(ffsd->commit_queue_cond);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't broadcast condition variable"));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Append ENTRY to the commit queue in FFSD.
+   The caller must hold FFSD->COMMIT_QUEUE_LOCK. */
+static svn_error_t *
+queue_commit(fs_fs_shared_data_t *ffsd,
+             fs_fs_queued_commit_t *entry)
+{
+  if (ffsd->commit_queue_last)
+    ffsd->commit_queue_last->next = entry;
+  else
+    ffsd->commit_queue = entry;
+
+  ffsd->commit_queue_last = entry;
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait until either ENTRY has been processed by a group commit or no
+   group commit is running in FFSD.  In the latter case, become the thread
+   running the next group commit and set *LEAD.  Otherwise, clear it.
+   The caller must hold FFSD->COMMIT_QUEUE_LOCK. */
+static svn_error_t *
+wait_for_group_commit(svn_boolean_t *lead,
+                      fs_fs_shared_data_t *ffsd,
+                      fs_fs_queued_commit_t *entry)
+{
+  /* This loop implicitly handles spurious wake-ups. */
+  while (!entry->done && ffsd->group_committing)
     {
-      svn_error_t *err;
+#if APR_HAS_THREADS
+      apr_status_t status
+        = apr_thread_cond_wait(ffsd->commit_queue_cond,
+                               svn_mutex__get(ffsd->commit_queue_lock));
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't wait for condition variable"));
+#else
+      SVN_ERR_MALFUNCTION();
+#endif
+    }
 
-      SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+  *lead = !entry->done;
+  if (*lead)
+    ffsd->group_committing = TRUE;
 
-      /* Write new entries to the rep-sharing database.
-       *
-       * We use an sqlite transaction to speed things up;
-       * see <http://www.sqlite.org/faq.html#q19>.
-       */
-      /* ### A commit that touches thousands of files will starve other
-             (reader/writer) commits for the duration of the below call.
-             Maybe write in batches? */
-      SVN_ERR(svn_sqlite__begin_transaction(ffd->rep_cache_db));
-      err = write_reps_to_cache(fs, cb.reps_to_cache, pool);
-      err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
-
-      if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
+  return SVN_NO_ERROR;
+}
+
+/* Set *ENTRIES to the list of all transactions in the commit queue of
+   FFSD and empty the queue.
+   The caller must hold FFSD->COMMIT_QUEUE_LOCK. */
+static svn_error_t *
+take_queued_commits(fs_fs_queued_commit_t **entries,
+                    fs_fs_shared_data_t *ffsd)
+{
+  *entries = ffsd->commit_queue;
+  ffsd->commit_queue = NULL;
+  ffsd->commit_queue_last = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark all ENTRIES as done and wake up their committers in FFSD.  They
+   may release the ENTRIES as soon as the caller gives up
+   FFSD->COMMIT_QUEUE_LOCK, which it must hold. */
+static svn_error_t *
+finish_queued_commits(fs_fs_shared_data_t *ffsd,
+                      fs_fs_queued_commit_t *entries)
+{
+  while (entries)
+    {
+      fs_fs_queued_commit_t *next = entries->next;
+      entries->done = TRUE;
+      entries = next;
+    }
+
+  return svn_error_trace(signal_queued_commits(ffsd));
+}
+
+/* End the group commit that this thread ran in FFSD and let the next
+   waiting thread, if any, run the next one.  If ENTRY has not been
+   processed, remove it from the commit queue and set *REMOVED.
+   Otherwise, clear it.
+   The caller must hold FFSD->COMMIT_QUEUE_LOCK. */
+static svn_error_t *
+end_group_commit(svn_boolean_t *removed,
+                 fs_fs_shared_data_t *ffsd,
+                 fs_fs_queued_commit_t *entry)
+{
+  fs_fs_queued_commit_t **link;
+  fs_fs_queued_commit_t *previous = NULL;
+
+  ffsd->group_committing = FALSE;
+  *removed = FALSE;
+
+  if (!entry->done)
+    for (link = &ffsd->commit_queue; *link; link = &(*link)->next)
+      {
+        if (*link == entry)
+          {
+            *link = entry->next;
+            if (ffsd->commit_queue_last == entry)
+              ffsd->commit_queue_last = previous;
+
+            *removed = TRUE;
+            break;
+          }
+
+        previous = *link;
+      }
+
+  return svn_error_trace(signal_queued_commits(ffsd));
+}
+
+/* Set *BATCH_FS to a new instance of FS that shares no cached data with
+   any other instance, allocated in RESULT_POOL.
+
+   Merging the later transactions of a group commit reads revisions that
+   have not been published yet.  Should the group commit fail, those
+   revision numbers will be reused, so no shared cache must have picked
+   up any of their contents. */
+static svn_error_t *
+open_batch_fs(svn_fs_t **batch_fs,
+              svn_fs_t *fs,
+              apr_pool_t *result_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_hash_t *fs_config = fs->config
+                        ? apr_hash_copy(result_pool, fs->config)
+                        : apr_hash_make(result_pool);
+
+  SVN_ERR_ASSERT(ffd->svn_fs_open_);
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(result_pool));
+  SVN_ERR(ffd->svn_fs_open_(batch_fs, fs->path, fs_config, result_pool,
+                            result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the transaction TXN_NAME in FS, bring it up to date with revision
+   YOUNGEST using GB->MERGE_FUNC and write it as the next revision like
+   commit_body does, but without updating the 'current' file.  Set
+   *NEW_REV_P to the new revision and record merge conflicts in CONFLICT.
+   See write_revision for DIRECTORY_IDS and FLUSH_LIST.  Use SCRATCH_POOL
+   for temporary allocations. */
+static svn_error_t *
+commit_queued_txn(svn_revnum_t *new_rev_p,
+                  group_commit_baton_t *gb,
+                  svn_fs_t *fs,
+                  const char *txn_name,
+                  svn_revnum_t youngest,
+                  svn_stringbuf_t *conflict,
+                  apr_array_header_t *directory_ids,
+                  flush_list_t *flush_list,
+                  apr_pool_t *scratch_pool)
+{
+  struct commit_baton cb;
+  svn_fs_txn_t *txn;
+  commit_stage_t *stage;
+
+  /* The committer's svn_fs_txn_t belongs to another thread. */
+  SVN_ERR(svn_fs_fs__open_txn(&txn, fs, txn_name, scratch_pool));
+  if (txn->base_rev != youngest)
+    SVN_ERR(gb->merge_func(txn, youngest, conflict, scratch_pool));
+
+  /* Merging modifies the transaction, so we can only stage it now. */
+  SVN_ERR(stage_commit(&stage, fs, txn, scratch_pool, scratch_pool));
+
+  cb.new_rev_p = new_rev_p;
+  cb.fs = fs;
+  cb.txn = txn;
+  cb.stage = stage;
+  cb.reps_to_cache = gb->reps_to_cache;
+  cb.reps_hash = gb->reps_to_cache ? apr_hash_make(scratch_pool) : NULL;
+  cb.reps_pool = gb->reps_pool;
+
+  return svn_error_trace(write_revision(new_rev_p, &cb, youngest, 0, 0,
+                                        directory_ids, flush_list,
+                                        scratch_pool));
+}
+
+/* Commit the queued ENTRIES in the group commit described by GB as
+   consecutive revisions, skipping those that fail, and store the outcome
+   in each entry.  Then, make all new revisions durable with a single round
+   of flushes and visible with a single update of the 'current' file.
+   Return an error only if none of the ENTRIES could be processed.
+
+   The FS write lock is assumed to be held by the caller.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+commit_queued(group_commit_baton_t *gb,
+              fs_fs_queued_commit_t *entries,
+              apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = gb->fs;
+  fs_fs_data_t *ffd;
+  svn_fs_access_t *access_ctx;
+  apr_array_header_t *directory_ids
+    = apr_array_make(scratch_pool, 4, sizeof(pair_cache_key_t));
+  apr_array_header_t *committed
+    = apr_array_make(scratch_pool, 4, sizeof(fs_fs_queued_commit_t *));
+  flush_list_t *flush_list = NULL;
+  apr_pool_t *iterpool;
+  fs_fs_queued_commit_t *entry;
+  apr_uint64_t start_node_id, start_copy_id;
+  svn_revnum_t old_rev, youngest;
+  svn_error_t *err;
+  int i;
+
+  /* Only the first transaction is merged with published revisions. */
+  if (entries->next)
+    SVN_ERR(open_batch_fs(&fs, gb->fs, scratch_pool));
+
+  ffd = fs->fsap_data;
+  access_ctx = fs->access_ctx;
+
+  /* See commit_body.  We only get here for formats without global ids,
+     i.e. START_NODE_ID and START_COPY_ID are unused. */
+  SVN_ERR(svn_fs_fs__read_format_file(fs, scratch_pool));
+  SVN_ERR(svn_fs_fs__read_current(&old_rev, &start_node_id, &start_copy_id,
+                                  fs, scratch_pool));
+  SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT);
+
+#ifdef SVN_ON_POSIX
+  /* Elsewhere, flush the files as they get written and only share the
+     update of 'current'. */
+  if (ffd->flush_to_disk)
+    flush_list = create_flush_list(scratch_pool);
+#endif
+
+  youngest = old_rev;
+  ffd->youngest_rev_cache = youngest;
+  iterpool = svn_pool_create(scratch_pool);
+  for (entry = entries; entry; entry = entry->next)
+    {
+      int reps_count = gb->reps_to_cache ? gb->reps_to_cache->nelts : 0;
+      int directories_count = directory_ids->nelts;
+      svn_stringbuf_t *conflict;
+
+      svn_pool_clear(iterpool);
+      conflict = svn_stringbuf_create_empty(iterpool);
+
+      /* Locks must be held by the user that wants to commit ENTRY. */
+      fs->access_ctx = entry->access_ctx;
+      entry->err = commit_queued_txn(&entry->new_rev, gb, fs,
+                                     entry->txn_name, youngest, conflict,
+                                     directory_ids, flush_list, iterpool);
+      fs->access_ctx = access_ctx;
+
+      if (entry->err)
         {
-          /* Failed rollback means that our db connection is unusable, and
-             the only thing we can do is close it.  The connection will be
-             reopened during the next operation with rep-cache.db. */
-          return svn_error_trace(
-              svn_error_compose_create(err,
-                                       svn_fs_fs__close_rep_cache(fs)));
+          if (entry->err->apr_err == SVN_ERR_FS_CONFLICT)
+            entry->conflict = apr_pstrdup(entry->err->pool, conflict->data);
+
+          /* The revision will be overwritten by the next one. */
+          if (gb->reps_to_cache)
+            gb->reps_to_cache->nelts = reps_count;
+          directory_ids->nelts = directories_count;
+          entry->new_rev = SVN_INVALID_REVNUM;
+          continue;
         }
-      else if (err)
-        return svn_error_trace(err);
+
+      /* The next transaction needs to be merged with this revision. */
+      youngest = entry->new_rev;
+      ffd->youngest_rev_cache = youngest;
+      APR_ARRAY_PUSH(committed, fs_fs_queued_commit_t *) = entry;
     }
+  svn_pool_destroy(iterpool);
+
+  if (youngest == old_rev)
+    return SVN_NO_ERROR;
+
+  /* Update the 'current' file once all new revisions are on disk. */
+  err = flush_list ? flush_scheduled(flush_list, scratch_pool)
+                   : SVN_NO_ERROR;
+  if (!err)
+    err = svn_fs_fs__write_current(fs, youngest, 0, 0, scratch_pool);
+
+  if (err)
+    {
+      /* The next commit will overwrite the new revisions.  As with
+         commit_body, GB->FS did not cache anything for them except for
+         directories marked as stale. */
+      ffd->youngest_rev_cache = old_rev;
+      for (i = 0; i < committed->nelts; ++i)
+        {
+          entry = APR_ARRAY_IDX(committed, i, fs_fs_queued_commit_t *);
+          entry->new_rev = SVN_INVALID_REVNUM;
+          entry->err = svn_error_dup(err);
+        }
+
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  /* At this point the new revisions are committed and globally visible.
+     Errors below don't change that, see commit_body. */
+  ffd = gb->fs->fsap_data;
+  ffd->youngest_rev_cache = youngest;
+  err = promote_cached_directories(fs, directory_ids, scratch_pool);
+  for (i = 0; i < committed->nelts; ++i)
+    {
+      entry = APR_ARRAY_IDX(committed, i, fs_fs_queued_commit_t *);
+      entry->err = svn_error_compose_create(
+                     err ? svn_error_dup(err) : SVN_NO_ERROR,
+                     svn_fs_fs__purge_txn(fs, entry->txn_name,
+                                          scratch_pool));
+    }
+  svn_error_clear(err);
 
   return SVN_NO_ERROR;
 }
 
+/* Commit all transactions queued for group commits of GB->FS.  This
+   implements the svn_fs_fs__with_write_lock() 'body' callback type.
+   BATON is a 'group_commit_baton_t *'. */
+static svn_error_t *
+group_commit_body(void *baton, apr_pool_t *pool)
+{
+  group_commit_baton_t *gb = baton;
+  fs_fs_data_t *ffd = gb->fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  fs_fs_queued_commit_t *entries;
+  fs_fs_queued_commit_t *entry;
+  svn_error_t *err;
+
+  SVN_MUTEX__WITH_LOCK(ffsd->commit_queue_lock,
+                       take_queued_commits(&entries, ffsd));
+
+  /* Whatever happens, every committer must learn what became of its
+     transaction. */
+  err = commit_queued(gb, entries, pool);
+  if (err)
+    {
+      for (entry = entries; entry; entry = entry->next)
+        if (!entry->err)
+          {
+            entry->new_rev = SVN_INVALID_REVNUM;
+            entry->err = svn_error_dup(err);
+          }
+
+      svn_error_clear(err);
+    }
+
+  SVN_MUTEX__WITH_LOCK(ffsd->commit_queue_lock,
+                       finish_queued_commits(ffsd, entries));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__group_commit(const char **conflict_p,
+                        svn_revnum_t *new_rev_p,
+                        svn_fs_t *fs,
+                        svn_fs_txn_t *txn,
+                        svn_fs_fs__txn_merge_func_t merge_func,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  fs_fs_queued_commit_t *entry = apr_pcalloc(scratch_pool, sizeof(*entry));
+  group_commit_baton_t gb = { 0 };
+  svn_boolean_t lead;
+  svn_error_t *err;
+
+  *new_rev_p = SVN_INVALID_REVNUM;
+  *conflict_p = NULL;
+
+  entry->txn_name = txn->id;
+  entry->access_ctx = fs->access_ctx;
+  entry->new_rev = SVN_INVALID_REVNUM;
+
+  gb.fs = fs;
+  gb.merge_func = merge_func;
+  if (ffd->rep_sharing_allowed)
+    {
+      gb.reps_to_cache = apr_array_make(scratch_pool, 5,
+                                        sizeof(representation_t *));
+      gb.reps_pool = scratch_pool;
+    }
+
+  SVN_MUTEX__WITH_LOCK(ffsd->commit_queue_lock, queue_commit(ffsd, entry));
+
+  /* Only one thread at a time competes for the write lock and commits
+     everything that has been queued up to then.  All others wait for it
+     to finish.  If that did not cover ENTRY, run the next group commit. */
+  SVN_ERR(svn_mutex__lock(ffsd->commit_queue_lock));
+  SVN_ERR(svn_mutex__unlock(ffsd->commit_queue_lock,
+                            wait_for_group_commit(&lead, ffsd, entry)));
+  if (lead)
+    {
+      svn_boolean_t removed;
+
+      err = svn_fs_fs__with_write_lock(fs, group_commit_body, &gb,
+                                       scratch_pool);
+
+      /* If we failed to get the write lock, ENTRY is still queued. */
+      SVN_MUTEX__WITH_LOCK(ffsd->commit_queue_lock,
+                           end_group_commit(&removed, ffsd, entry));
+      if (removed)
+        return svn_error_trace(err);
+
+      svn_error_clear(err);
+    }
+
+  *new_rev_p = entry->new_rev;
+  if (entry->conflict)
+    *conflict_p = apr_pstrdup(result_pool, entry->conflict);
+
+  /* If we ran the group commit, the rep-cache needs to learn about the
+     new revisions of all of its committers. */
+  err = entry->err;
+  if (gb.reps_to_cache && gb.reps_to_cache->nelts)
+    err = svn_error_compose_create(err,
+                                   update_rep_cache(fs, gb.reps_to_cache,
+                                                    scratch_pool));
+
+  return svn_error_trace(err);
+}
+
 
 svn_error_t *
 svn_fs_fs__list_transactions(apr_array_header_t **names_p,
@@ -220,6 +220,38 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
                   svn_fs_txn_t *txn,
                   apr_pool_t *pool);
 
+/* Callback type used by svn_fs_fs__group_commit.  Merge the changes
+   between the base revision of TXN and REVISION into TXN and make
+   REVISION its new base revision.  If a conflict results, return
+   SVN_ERR_FS_CONFLICT and set CONFLICT to the conflicting path.
+   Use SCRATCH_POOL for temporary allocations. */
+typedef svn_error_t *
+(*svn_fs_fs__txn_merge_func_t)(svn_fs_txn_t *txn,
+                               svn_revnum_t revision,
+                               svn_stringbuf_t *conflict,
+                               apr_pool_t *scratch_pool);
+
+/* Like svn_fs_fs__commit but let the commit of transaction TXN share its
+   flushes to disk and its update of the 'current' file with the commits
+   of other threads of this process that want to commit at the same time.
+   One thread at a time takes the write lock and commits all waiting
+   transactions as consecutive revisions, using MERGE_FUNC to bring them
+   up to date with the revisions committed before them.  The others wait
+   for it to finish.  Hence, TXN does not need to be based on the youngest
+   revision.  Requires format 3 or newer.
+
+   If merging results in a conflict, return SVN_ERR_FS_CONFLICT and set
+   *CONFLICT_P to the conflicting path, allocated in RESULT_POOL.  Use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__group_commit(const char **conflict_p,
+                        svn_revnum_t *new_rev_p,
+                        svn_fs_t *fs,
+                        svn_fs_txn_t *txn,
+                        svn_fs_fs__txn_merge_func_t merge_func,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool);
+
 /* Set *NAMES_P to an array of names which are all the active
    transactions in filesystem FS.  Allocate the array from POOL. */
 svn_error_t *
@@ -2196,6 +2196,25 @@ merge_changes(dag_node_t *ancestor_node,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_fs_fs__txn_merge_func_t, merging the changes up to
+   REVISION into TXN. */
+static svn_error_t *
+merge_with_revision(svn_fs_txn_t *txn,
+                    svn_revnum_t revision,
+                    svn_stringbuf_t *conflict,
+                    apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root;
+  dag_node_t *root_node;
+
+  SVN_ERR(svn_fs_fs__revision_root(&root, txn->fs, revision, scratch_pool));
+  SVN_ERR(get_root(&root_node, root, scratch_pool));
+  SVN_ERR(merge_changes(NULL, root_node, txn, conflict, scratch_pool));
+  txn->base_rev = revision;
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_fs_fs__commit_txn(const char **conflict_p,
@@ -2297,6 +2316,20 @@ svn_fs_fs__commit_txn(const char **conflict_p,
         }
       txn->base_rev = youngish_rev;
 
+      /* Group commits merge with any revisions committed in the meantime
+         themselves, i.e. they don't get out of date. */
+      if (ffd->group_commit)
+        {
+          const char *group_conflict;
+
+          err = svn_fs_fs__group_commit(&group_conflict, new_rev, fs, txn,
+                                        merge_with_revision, pool,
+                                        iterpool);
+          if (err && (err->apr_err == SVN_ERR_FS_CONFLICT) && conflict_p)
+            *conflict_p = group_conflict;
+          goto cleanup;
+        }
+
       /* Try to commit. */
       err = svn_fs_fs__commit(new_rev, fs, txn, iterpool);
       if (err && (err->apr_err == SVN_ERR_FS_TXN_OUT_OF_DATE))
@@ -350,6 +350,77 @@ svn_fs_fs__path_txn_node_children(svn_fs_t *fs,
                      PATH_EXT_CHILDREN, SVN_VA_NULL);
 }
 
+/* Return the hex representation of the SHA1 DIGEST, allocated in POOL. */
+static const char *
+sha1_to_cstring(const unsigned char *digest,
+                apr_pool_t *pool)
+{
+  svn_checksum_t checksum;
+  checksum.digest = digest;
+  checksum.kind = svn_checksum_sha1;
+
+  return svn_checksum_to_cstring_display(&checksum, pool);
+}
+
+const char *
+svn_fs_fs__path_large_file(svn_fs_t *fs,
+                           const unsigned char *sha1,
+                           apr_pool_t *pool)
+{
+  const char *name = sha1_to_cstring(sha1, pool);
+
+  /* Spread the files over up to 256 sub-folders. */
+  return svn_dirent_join_many(pool, fs->path, PATH_LARGE_DIR,
+                              apr_pstrmemdup(pool, name, 2), name,
+                              SVN_VA_NULL);
+}
+
+const char *
+svn_fs_fs__path_txn_large_file(svn_fs_t *fs,
+                               const svn_fs_fs__id_part_t *txn_id,
+                               const unsigned char *sha1,
+                               apr_pool_t *pool)
+{
+  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, txn_id, pool),
+                         apr_pstrcat(pool, sha1_to_cstring(sha1, pool),
+                                     PATH_EXT_LARGE, SVN_VA_NULL),
+                         pool);
+}
+
+const char *
+svn_fs_fs__path_chunk_list(svn_fs_t *fs,
+                           const unsigned char *sha1,
+                           apr_pool_t *pool)
+{
+  return apr_pstrcat(pool, svn_fs_fs__path_large_file(fs, sha1, pool),
+                     PATH_EXT_CHUNKS, SVN_VA_NULL);
+}
+
+const char *
+svn_fs_fs__path_txn_chunk_list(svn_fs_t *fs,
+                               const svn_fs_fs__id_part_t *txn_id,
+                               const unsigned char *sha1,
+                               apr_pool_t *pool)
+{
+  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, txn_id, pool),
+                         apr_pstrcat(pool, sha1_to_cstring(sha1, pool),
+                                     PATH_EXT_CHUNKS, SVN_VA_NULL),
+                         pool);
+}
+
+const char *
+svn_fs_fs__path_chunk(svn_fs_t *fs,
+                      const unsigned char *sha1,
+                      apr_pool_t *pool)
+{
+  const char *name = sha1_to_cstring(sha1, pool);
+
+  /* Spread the files over up to 256 sub-folders. */
+  return svn_dirent_join_many(pool, fs->path, PATH_CHUNKS_DIR,
+                              apr_pstrmemdup(pool, name, 2), name,
+                              SVN_VA_NULL);
+}
+
 const char *
 svn_fs_fs__path_node_origin(svn_fs_t *fs,
                             const svn_fs_fs__id_part_t *node_id,
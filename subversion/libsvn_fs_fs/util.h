@@ -279,6 +279,52 @@ svn_fs_fs__path_txn_item_index(svn_fs_t *fs,
                                const svn_fs_fs__id_part_t *txn_id,
                                apr_pool_t *pool);
 
+/* Return the path of the file that holds the out-of-line fulltext with
+ * the given SHA1 digest once it has been committed to FS.
+ * The result will be allocated in POOL.
+ */
+const char *
+svn_fs_fs__path_large_file(svn_fs_t *fs,
+                           const unsigned char *sha1,
+                           apr_pool_t *pool);
+
+/* Return the path of the file that holds the out-of-line fulltext with
+ * the given SHA1 digest while it is still part of transaction TXN_ID
+ * in FS.  The result will be allocated in POOL.
+ */
+const char *
+svn_fs_fs__path_txn_large_file(svn_fs_t *fs,
+                               const svn_fs_fs__id_part_t *txn_id,
+                               const unsigned char *sha1,
+                               apr_pool_t *pool);
+
+/* Return the path of the file that holds the chunk list of the CHUNKED
+ * fulltext with the given SHA1 digest once it has been committed to FS.
+ * The result will be allocated in POOL.
+ */
+const char *
+svn_fs_fs__path_chunk_list(svn_fs_t *fs,
+                           const unsigned char *sha1,
+                           apr_pool_t *pool);
+
+/* Return the path of the file that holds the chunk list of the CHUNKED
+ * fulltext with the given SHA1 digest while it is still part of
+ * transaction TXN_ID in FS.  The result will be allocated in POOL.
+ */
+const char *
+svn_fs_fs__path_txn_chunk_list(svn_fs_t *fs,
+                               const svn_fs_fs__id_part_t *txn_id,
+                               const unsigned char *sha1,
+                               apr_pool_t *pool);
+
+/* Return the path of the file that holds the fulltext chunk with the
+ * given SHA1 digest in FS.  The result will be allocated in POOL.
+ */
+const char *
+svn_fs_fs__path_chunk(svn_fs_t *fs,
+                      const unsigned char *sha1,
+                      apr_pool_t *pool);
+
 /* Return the path of the file containing the node origins cachs for
  * the given NODE_ID in FS.  The result will be allocated in POOL.
  */
@@ -365,6 +365,9 @@ compare_p2l_to_l2p_index(svn_fs_t *fs,
   for (offset = 0; offset < max_offset; )
     {
       apr_array_header_t *entries;
+      apr_array_header_t *items;
+      apr_array_header_t *used_entries;
+      apr_off_t *l2p_offsets;
       svn_fs_fs__p2l_entry_t *last_entry;
       int i;
 
@@ -386,6 +389,10 @@ compare_p2l_to_l2p_index(svn_fs_t *fs,
         = &APR_ARRAY_IDX(entries, entries->nelts-1, svn_fs_fs__p2l_entry_t);
       offset = last_entry->offset + last_entry->size;
 
+      items = apr_array_make(iterpool, entries->nelts,
+                             sizeof(svn_fs_fs__id_part_t));
+      used_entries = apr_array_make(iterpool, entries->nelts,
+                                    sizeof(svn_fs_fs__p2l_entry_t *));
       for (i = 0; i < entries->nelts; ++i)
         {
           svn_fs_fs__p2l_entry_t *entry
@@ -411,24 +418,34 @@ compare_p2l_to_l2p_index(svn_fs_t *fs,
             }
           else
             {
-              apr_off_t l2p_offset;
-              SVN_ERR(svn_fs_fs__item_offset(&l2p_offset, fs, rev_file,
-                                             entry->item.revision, NULL,
-                                             entry->item.number, iterpool));
-
-              if (l2p_offset != entry->offset)
-                return svn_error_createf(SVN_ERR_FS_INDEX_INCONSISTENT,
-                                         NULL,
-                                         _("l2p index entry PHYS %s"
-                                           "does not match p2l index value "
-                                           "LOG r%ld:i%ld for PHYS %s"),
-                                         apr_off_t_toa(pool, l2p_offset),
-                                         entry->item.revision,
-                                         (long)entry->item.number,
-                                         apr_off_t_toa(pool, entry->offset));
+              APR_ARRAY_PUSH(items, svn_fs_fs__id_part_t) = entry->item;
+              APR_ARRAY_PUSH(used_entries, svn_fs_fs__p2l_entry_t *) = entry;
             }
         }
 
+      /* Look up all items of this block in one go. */
+      l2p_offsets = apr_palloc(iterpool,
+                               items->nelts * sizeof(*l2p_offsets));
+      SVN_ERR(svn_fs_fs__item_offsets(l2p_offsets, fs, rev_file, items,
+                                      iterpool));
+
+      for (i = 0; i < used_entries->nelts; ++i)
+        {
+          svn_fs_fs__p2l_entry_t *entry
+            = APR_ARRAY_IDX(used_entries, i, svn_fs_fs__p2l_entry_t *);
+
+          if (l2p_offsets[i] != entry->offset)
+            return svn_error_createf(SVN_ERR_FS_INDEX_INCONSISTENT,
+                                     NULL,
+                                     _("l2p index entry PHYS %s"
+                                       "does not match p2l index value "
+                                       "LOG r%ld:i%ld for PHYS %s"),
+                                     apr_off_t_toa(pool, l2p_offsets[i]),
+                                     entry->item.revision,
+                                     (long)entry->item.number,
+                                     apr_off_t_toa(pool, entry->offset));
+        }
+
       if (cancel_func)
         SVN_ERR(cancel_func(cancel_baton));
     }
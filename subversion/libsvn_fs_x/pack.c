@@ -65,6 +65,9 @@
  * revision files to temporary files.  The latter serve as buckets for a
  * very coarse bucket presort:  Separate change lists, file properties,
  * directory properties and noderevs + representations from one another.
+ * To keep the I/O on the revision files sequential, we first read the
+ * whole P2L index of a revision and then its contents in large chunks
+ * that get parsed and distributed to the buckets from memory.
  *
  * The third step will determine an optimized placement for the items in
  * each of the 4 buckets separately.  The first three will simply order
@@ -90,6 +93,12 @@
  */
 #define DEFAULT_MAX_MEM (64 * 1024 * 1024)
 
+/* Maximum number of bytes of revision contents that we read in one go
+ * during phase 2.  Items larger than this will be streamed directly from
+ * the revision file.
+ */
+#define STAGING_BUFFER_SIZE (4 * 1024 * 1024)
+
 /* Data structure describing a node change at PATH, REVISION.
  * We will sort these instances by PATH and NODE_ID such that we can combine
  * similar nodes in the same reps container and store containers in path
@@ -225,6 +234,13 @@ typedef struct pack_context_t
    * Will be filled in phase 2 and be cleared after each revision range.*/
   apr_file_t *reps_file;
 
+  /* STAGING_BUFFER_SIZE bytes of buffer receiving the revision contents
+   * in phase 2.  Allocated upon first use. */
+  char *staging_buffer;
+
+  /* pool to allocate STAGING_BUFFER in */
+  apr_pool_t *staging_pool;
+
   /* pool used for temporary data structures that will be cleaned up when
    * the next range of revisions is being processed */
   apr_pool_t *info_pool;
@@ -319,6 +335,7 @@ initialize_pack_context(pack_context_t *context,
   /* the pool used for temp structures */
   context->info_pool = svn_pool_create(pool);
   context->paths = svn_prefix_tree__create(context->info_pool);
+  context->staging_pool = pool;
 
   return SVN_NO_ERROR;
 }
@@ -461,10 +478,66 @@ write_null_bytes(apr_file_t *dest,
   return SVN_NO_ERROR;
 }
 
+/* Set *STREAM to a stream returning the contents of the item described
+ * by ENTRY.  If DATA is not NULL, it contains the item in memory.
+ * Otherwise, read it from REV_FILE.  Allocate the stream in RESULT_POOL.
+ */
+static svn_error_t *
+get_item_stream(svn_stream_t **stream,
+                svn_fs_x__revision_file_t *rev_file,
+                const char *data,
+                svn_fs_x__p2l_entry_t *entry,
+                apr_pool_t *result_pool)
+{
+  if (data)
+    {
+      svn_string_t *contents = apr_palloc(result_pool, sizeof(*contents));
+      contents->data = data;
+      contents->len = (apr_size_t)entry->size;
+
+      *stream = svn_stream_from_string(contents, result_pool);
+    }
+  else
+    {
+      SVN_ERR(svn_fs_x__rev_file_seek(rev_file, NULL, entry->offset));
+      SVN_ERR(svn_fs_x__rev_file_stream(stream, rev_file));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Append the contents of the item described by ENTRY to TEMP_FILE.  If
+ * DATA is not NULL, it contains the item in memory.  Otherwise, copy it
+ * from REV_FILE.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+copy_item_data(pack_context_t *context,
+               apr_file_t *temp_file,
+               svn_fs_x__revision_file_t *rev_file,
+               const char *data,
+               svn_fs_x__p2l_entry_t *entry,
+               apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+
+  if (data)
+    return svn_error_trace(svn_io_file_write_full(temp_file, data,
+                                                  (apr_size_t)entry->size,
+                                                  NULL, scratch_pool));
+
+  SVN_ERR(svn_fs_x__rev_file_seek(rev_file, NULL, entry->offset));
+  SVN_ERR(svn_fs_x__rev_file_get(&file, rev_file));
+  SVN_ERR(copy_file_data(context, temp_file, file, entry->size,
+                         scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy the "simple" item (changed paths list or property representation)
- * from the current position in REV_FILE to TEMP_FILE using CONTEXT.  Add
- * a copy of ENTRY to ENTRIES but with an updated offset value that points
- * to the copy destination in TEMP_FILE.
+ * described by ENTRY to TEMP_FILE using CONTEXT.  DATA and REV_FILE are
+ * the item source as in copy_item_data.  Add a copy of ENTRY to ENTRIES
+ * but with an updated offset value that points to the copy destination
+ * in TEMP_FILE.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
@@ -472,10 +545,10 @@ copy_item_to_temp(pack_context_t *context,
                   apr_array_header_t *entries,
                   apr_file_t *temp_file,
                   svn_fs_x__revision_file_t *rev_file,
+                  const char *data,
                   svn_fs_x__p2l_entry_t *entry,
                   apr_pool_t *scratch_pool)
 {
-  apr_file_t *file;
   svn_fs_x__p2l_entry_t *new_entry
     = svn_fs_x__p2l_entry_dup(entry, context->info_pool);
 
@@ -483,8 +556,7 @@ copy_item_to_temp(pack_context_t *context,
                                  scratch_pool));
   APR_ARRAY_PUSH(entries, svn_fs_x__p2l_entry_t *) = new_entry;
 
-  SVN_ERR(svn_fs_x__rev_file_get(&file, rev_file));
-  SVN_ERR(copy_file_data(context, temp_file, file, entry->size,
+  SVN_ERR(copy_item_data(context, temp_file, rev_file, data, entry,
                          scratch_pool));
 
   return SVN_NO_ERROR;
@@ -554,21 +626,21 @@ get_item(pack_context_t *context,
   return result;
 }
 
-/* Copy representation item identified by ENTRY from the current position
- * in REV_FILE into CONTEXT->REPS_FILE.  Add all tracking into needed by
- * our placement algorithm to CONTEXT.
+/* Copy representation item identified by ENTRY into CONTEXT->REPS_FILE.
+ * DATA and REV_FILE are the item source as in copy_item_data.  Add all
+ * tracking into needed by our placement algorithm to CONTEXT.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 copy_rep_to_temp(pack_context_t *context,
                  svn_fs_x__revision_file_t *rev_file,
+                 const char *data,
                  svn_fs_x__p2l_entry_t *entry,
                  apr_pool_t *scratch_pool)
 {
   svn_fs_x__rep_header_t *rep_header;
   svn_stream_t *stream;
-  apr_file_t *file;
-  apr_off_t source_offset = entry->offset;
+  svn_fs_x__p2l_entry_t *source_entry = entry;
 
   /* create a copy of ENTRY, make it point to the copy destination and
    * store it in CONTEXT */
@@ -578,7 +650,8 @@ copy_rep_to_temp(pack_context_t *context,
   add_item_rep_mapping(context, entry);
 
   /* read & parse the representation header */
-  SVN_ERR(svn_fs_x__rev_file_stream(&stream, rev_file));
+  SVN_ERR(get_item_stream(&stream, rev_file, data, source_entry,
+                          scratch_pool));
   SVN_ERR(svn_fs_x__read_rep_header(&rep_header, stream,
                                     scratch_pool, scratch_pool));
 
@@ -596,10 +669,8 @@ copy_rep_to_temp(pack_context_t *context,
     }
 
   /* copy the whole rep (including header!) to our temp file */
-  SVN_ERR(svn_fs_x__rev_file_seek(rev_file, NULL, source_offset));
-  SVN_ERR(svn_fs_x__rev_file_get(&file, rev_file));
-  SVN_ERR(copy_file_data(context, context->reps_file, file, entry->size,
-                         scratch_pool));
+  SVN_ERR(copy_item_data(context, context->reps_file, rev_file, data,
+                         source_entry, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -672,14 +743,15 @@ tweak_path_for_ordering(const char *original,
    return path;
 }
 
-/* Copy node revision item identified by ENTRY from the current position
- * in REV_FILE into CONTEXT->REPS_FILE.  Add all tracking into needed by
- * our placement algorithm to CONTEXT.
+/* Copy node revision item identified by ENTRY into CONTEXT->REPS_FILE.
+ * DATA and REV_FILE are the item source as in copy_item_data.  Add all
+ * tracking into needed by our placement algorithm to CONTEXT.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 copy_node_to_temp(pack_context_t *context,
                   svn_fs_x__revision_file_t *rev_file,
+                  const char *data,
                   svn_fs_x__p2l_entry_t *entry,
                   apr_pool_t *scratch_pool)
 {
@@ -687,12 +759,12 @@ copy_node_to_temp(pack_context_t *context,
                                          sizeof(*path_order));
   svn_fs_x__noderev_t *noderev;
   svn_stream_t *stream;
-  apr_file_t *file;
   const char *sort_path;
-  apr_off_t source_offset = entry->offset;
+  svn_fs_x__p2l_entry_t *source_entry = entry;
 
   /* read & parse noderev */
-  SVN_ERR(svn_fs_x__rev_file_stream(&stream, rev_file));
+  SVN_ERR(get_item_stream(&stream, rev_file, data, source_entry,
+                          scratch_pool));
   SVN_ERR(svn_fs_x__read_noderev(&noderev, stream, scratch_pool,
                                  scratch_pool));
 
@@ -704,10 +776,8 @@ copy_node_to_temp(pack_context_t *context,
   add_item_rep_mapping(context, entry);
 
   /* copy the noderev to our temp file */
-  SVN_ERR(svn_fs_x__rev_file_seek(rev_file, NULL, source_offset));
-  SVN_ERR(svn_fs_x__rev_file_get(&file, rev_file));
-  SVN_ERR(copy_file_data(context, context->reps_file, file, entry->size,
-                         scratch_pool));
+  SVN_ERR(copy_item_data(context, context->reps_file, rev_file, data,
+                         source_entry, scratch_pool));
 
   /* if the node has a data representation, make that the node's "base".
    * This will (often) cause the noderev to be placed right in front of
@@ -1702,6 +1772,173 @@ write_l2p_index(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
+/* Read the P2L index of REVISION in REV_FILE for all items before
+ * DATA_END and return them in *ENTRIES as svn_fs_x__p2l_entry_t, in
+ * ascending offset order.  Use CONTEXT for cancellation checks.
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+read_p2l_entries(apr_array_header_t **entries,
+                 pack_context_t *context,
+                 svn_fs_x__revision_file_t *rev_file,
+                 svn_revnum_t revision,
+                 apr_off_t data_end,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = context->fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_off_t offset = 0;
+
+  *entries = apr_array_make(result_pool, 16, sizeof(svn_fs_x__p2l_entry_t));
+
+  /* read the phys-to-log index file until we covered the whole rev file.
+   * That index contains enough info to build both target indexes from it. */
+  while (offset < data_end)
+    {
+      /* read one cluster */
+      int i;
+      apr_array_header_t *cluster;
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_x__p2l_index_lookup(&cluster, context->fs, rev_file,
+                                         revision, offset,
+                                         ffd->p2l_page_size, result_pool,
+                                         iterpool));
+
+      for (i = 0; i < cluster->nelts; ++i)
+        {
+          svn_fs_x__p2l_entry_t *entry
+            = &APR_ARRAY_IDX(cluster, i, svn_fs_x__p2l_entry_t);
+
+          /* skip first entry if that was duplicated due crossing a
+             cluster boundary */
+          if (offset > entry->offset)
+            continue;
+
+          /* collect entry while inside the rev file */
+          offset = entry->offset;
+          if (offset < data_end)
+            {
+              APR_ARRAY_PUSH(*entries, svn_fs_x__p2l_entry_t) = *entry;
+              offset += entry->size;
+            }
+        }
+
+      if (context->cancel_func)
+        SVN_ERR(context->cancel_func(context->cancel_baton));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Copy the item described by ENTRY into the respective bucket of CONTEXT.
+ * If DATA is not NULL, it contains the item in memory.  Otherwise, read
+ * it from REV_FILE.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+copy_entry_to_temp(pack_context_t *context,
+                   svn_fs_x__revision_file_t *rev_file,
+                   const char *data,
+                   svn_fs_x__p2l_entry_t *entry,
+                   apr_pool_t *scratch_pool)
+{
+  if (entry->type == SVN_FS_X__ITEM_TYPE_CHANGES)
+    SVN_ERR(copy_item_to_temp(context, context->changes,
+                              context->changes_file, rev_file, data, entry,
+                              scratch_pool));
+  else if (entry->type == SVN_FS_X__ITEM_TYPE_FILE_PROPS)
+    SVN_ERR(copy_item_to_temp(context, context->file_props,
+                              context->file_props_file, rev_file, data,
+                              entry, scratch_pool));
+  else if (entry->type == SVN_FS_X__ITEM_TYPE_DIR_PROPS)
+    SVN_ERR(copy_item_to_temp(context, context->dir_props,
+                              context->dir_props_file, rev_file, data,
+                              entry, scratch_pool));
+  else if (   entry->type == SVN_FS_X__ITEM_TYPE_FILE_REP
+           || entry->type == SVN_FS_X__ITEM_TYPE_DIR_REP)
+    SVN_ERR(copy_rep_to_temp(context, rev_file, data, entry, scratch_pool));
+  else if (entry->type == SVN_FS_X__ITEM_TYPE_NODEREV)
+    SVN_ERR(copy_node_to_temp(context, rev_file, data, entry, scratch_pool));
+  else
+    SVN_ERR_ASSERT(entry->type == SVN_FS_X__ITEM_TYPE_UNUSED);
+
+  return SVN_NO_ERROR;
+}
+
+/* Copy all items given as svn_fs_x__p2l_entry_t in ENTRIES from REV_FILE
+ * into the buckets of CONTEXT.  ENTRIES must be contiguous and sorted by
+ * offset.  Read the data in chunks of up to STAGING_BUFFER_SIZE bytes,
+ * i.e. strictly sequentially and with few but large reads.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+copy_entries_to_temp(pack_context_t *context,
+                     svn_fs_x__revision_file_t *rev_file,
+                     apr_array_header_t *entries,
+                     apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int first = 0;
+
+  while (first < entries->nelts)
+    {
+      svn_fs_x__p2l_entry_t *entry
+        = &APR_ARRAY_IDX(entries, first, svn_fs_x__p2l_entry_t);
+      apr_off_t chunk_start = entry->offset;
+      apr_off_t chunk_end = entry->offset;
+      int last;
+
+      svn_pool_clear(iterpool);
+
+      /* Stream items that don't fit into the buffer. */
+      if (entry->size > STAGING_BUFFER_SIZE)
+        {
+          SVN_ERR(copy_entry_to_temp(context, rev_file, NULL, entry,
+                                     iterpool));
+          ++first;
+          continue;
+        }
+
+      /* Read as many of the following items as fit into the buffer. */
+      for (last = first; last < entries->nelts; ++last)
+        {
+          entry = &APR_ARRAY_IDX(entries, last, svn_fs_x__p2l_entry_t);
+          if (entry->offset + entry->size - chunk_start > STAGING_BUFFER_SIZE)
+            break;
+
+          chunk_end = entry->offset + entry->size;
+        }
+
+      if (context->staging_buffer == NULL)
+        context->staging_buffer = apr_palloc(context->staging_pool,
+                                             STAGING_BUFFER_SIZE);
+
+      SVN_ERR(svn_fs_x__rev_file_seek(rev_file, NULL, chunk_start));
+      SVN_ERR(svn_fs_x__rev_file_read(rev_file, context->staging_buffer,
+                                      (apr_size_t)(chunk_end - chunk_start)));
+
+      /* Distribute the items from memory. */
+      for (; first < last; ++first)
+        {
+          entry = &APR_ARRAY_IDX(entries, first, svn_fs_x__p2l_entry_t);
+          SVN_ERR(copy_entry_to_temp(context, rev_file,
+                                     context->staging_buffer
+                                       + (entry->offset - chunk_start),
+                                     entry, iterpool));
+        }
+
+      if (context->cancel_func)
+        SVN_ERR(context->cancel_func(context->cancel_baton));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Pack the current revision range of CONTEXT, i.e. this covers phases 2
  * to 4.  Use SCRATCH_POOL for temporary allocations.
  */
@@ -1709,7 +1946,6 @@ static svn_error_t *
 pack_range(pack_context_t *context,
            apr_pool_t *scratch_pool)
 {
-  svn_fs_x__data_t *ffd = context->fs->fsap_data;
   apr_pool_t *revpool = svn_pool_create(scratch_pool);
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
 
@@ -1717,9 +1953,9 @@ pack_range(pack_context_t *context,
   svn_revnum_t revision;
   for (revision = context->start_rev; revision < context->end_rev; ++revision)
     {
-      apr_off_t offset = 0;
       svn_fs_x__revision_file_t *rev_file;
       svn_fs_x__index_info_t l2p_index_info;
+      apr_array_header_t *entries;
 
       /* Get the rev file dimensions (mainly index locations). */
       SVN_ERR(svn_fs_x__rev_file_init(&rev_file, context->fs, revision,
@@ -1729,69 +1965,13 @@ pack_range(pack_context_t *context,
       /* store the indirect array index */
       APR_ARRAY_PUSH(context->rev_offsets, int) = context->reps->nelts;
 
-      /* read the phys-to-log index file until we covered the whole rev file.
-       * That index contains enough info to build both target indexes from it. */
-      while (offset < l2p_index_info.start)
-        {
-          /* read one cluster */
-          int i;
-          apr_array_header_t *entries;
-          svn_pool_clear(iterpool);
-
-          SVN_ERR(svn_fs_x__p2l_index_lookup(&entries, context->fs,
-                                             rev_file, revision, offset,
-                                             ffd->p2l_page_size, iterpool,
-                                             iterpool));
-
-          for (i = 0; i < entries->nelts; ++i)
-            {
-              svn_fs_x__p2l_entry_t *entry
-                = &APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t);
-
-              /* skip first entry if that was duplicated due crossing a
-                 cluster boundary */
-              if (offset > entry->offset)
-                continue;
-
-              /* process entry while inside the rev file */
-              offset = entry->offset;
-              if (offset < l2p_index_info.start)
-                {
-                  SVN_ERR(svn_fs_x__rev_file_seek(rev_file, NULL, offset));
-
-                  if (entry->type == SVN_FS_X__ITEM_TYPE_CHANGES)
-                    SVN_ERR(copy_item_to_temp(context,
-                                              context->changes,
-                                              context->changes_file,
-                                              rev_file, entry, iterpool));
-                  else if (entry->type == SVN_FS_X__ITEM_TYPE_FILE_PROPS)
-                    SVN_ERR(copy_item_to_temp(context,
-                                              context->file_props,
-                                              context->file_props_file,
-                                              rev_file, entry, iterpool));
-                  else if (entry->type == SVN_FS_X__ITEM_TYPE_DIR_PROPS)
-                    SVN_ERR(copy_item_to_temp(context,
-                                              context->dir_props,
-                                              context->dir_props_file,
-                                              rev_file, entry, iterpool));
-                  else if (   entry->type == SVN_FS_X__ITEM_TYPE_FILE_REP
-                           || entry->type == SVN_FS_X__ITEM_TYPE_DIR_REP)
-                    SVN_ERR(copy_rep_to_temp(context, rev_file, entry,
-                                             iterpool));
-                  else if (entry->type == SVN_FS_X__ITEM_TYPE_NODEREV)
-                    SVN_ERR(copy_node_to_temp(context, rev_file, entry,
-                                              iterpool));
-                  else
-                    SVN_ERR_ASSERT(entry->type == SVN_FS_X__ITEM_TYPE_UNUSED);
-
-                  offset += entry->size;
-                }
-            }
-
-          if (context->cancel_func)
-            SVN_ERR(context->cancel_func(context->cancel_baton));
-        }
+      /* Read the index first and then the data in one sequential pass
+       * instead of alternating between the two. */
+      SVN_ERR(read_p2l_entries(&entries, context, rev_file, revision,
+                               l2p_index_info.start, revpool, iterpool));
+      SVN_ERR(copy_entries_to_temp(context, rev_file, entries, iterpool));
 
+      svn_pool_clear(iterpool);
       svn_pool_clear(revpool);
     }
 
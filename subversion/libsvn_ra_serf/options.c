@@ -242,6 +242,11 @@ capabilities_headers_iterator_callback(void *baton,
           /* Same for svndiff2. */
           session->supports_svndiff2 = TRUE;
         }
+      if (svn_cstring_match_list(SVN_DAV_NS_DAV_SVN_SVNDIFF3, vals))
+        {
+          /* And for svndiff3. */
+          session->supports_svndiff3 = TRUE;
+        }
       if (svn_cstring_match_list(SVN_DAV_NS_DAV_SVN_PUT_RESULT_CHECKSUM, vals))
         {
           session->supports_put_result_checksum = TRUE;
@@ -293,6 +298,10 @@ capabilities_headers_iterator_callback(void *baton,
         {
           session->rev_root_stub = apr_pstrdup(session->pool, val);
         }
+      else if (svn_cstring_casecmp(key, SVN_DAV_SHA1_STUB_HEADER) == 0)
+        {
+          session->sha1_stub = apr_pstrdup(session->pool, val);
+        }
       else if (svn_cstring_casecmp(key, SVN_DAV_TXN_STUB_HEADER) == 0)
         {
           session->txn_stub = apr_pstrdup(session->pool, val);
@@ -82,6 +82,11 @@ typedef struct svn_ra_serf__connection_t {
 
   svn_ra_serf__session_t *session;
 
+  /* Response body bytes still to be received on this connection, as far as
+     announced in the Content-Length of update GETs.  Lets the update
+     report steer new requests around connections busy with large files. */
+  apr_off_t pending_bytes;
+
 } svn_ra_serf__connection_t;
 
 /** Maximum value we'll allow for the http-max-connections config option.
@@ -91,6 +96,12 @@ typedef struct svn_ra_serf__connection_t {
  */
 #define SVN_RA_SERF__MAX_CONNECTIONS_LIMIT 8
 
+/** Size limit (in bytes) up to which we ask the server to send file texts
+ * inline in an update report that is not in "send-all" mode.  Larger
+ * files are fetched by separate GET requests.
+ */
+#define SVN_RA_SERF__INLINE_TEXT_SIZE 16384
+
 /*
  * The master serf RA session.
  *
@@ -167,6 +178,10 @@ struct svn_ra_serf__session_t {
   svn_ra_progress_notify_func_t progress_func;
   void *progress_baton;
 
+  /* Estimated number of bytes still to be received by the running update
+     report, -1 if unknown.  Turned into the total passed to PROGRESS_FUNC. */
+  apr_off_t progress_remaining;
+
   /* Callback function to handle cancellation */
   svn_cancel_func_t cancel_func;
   void *cancel_baton;
@@ -234,6 +249,7 @@ struct svn_ra_serf__session_t {
   const char *txn_root_stub;    /* for accessing TXN/PATH pairs */
   const char *vtxn_stub;        /* for accessing transactions (i.e. txnprops) */
   const char *vtxn_root_stub;   /* for accessing TXN/PATH pairs */
+  const char *sha1_stub;        /* for accessing texts by SHA-1, if enabled */
 
   /* Hash mapping const char * server-supported POST types to
      disinteresting-but-non-null values. */
@@ -269,6 +285,9 @@ struct svn_ra_serf__session_t {
   /* Indicates whether the server can understand svndiff version 2. */
   svn_boolean_t supports_svndiff2;
 
+  /* Indicates whether the server can understand svndiff version 3. */
+  svn_boolean_t supports_svndiff3;
+
   /* Indicates whether the server sends the result checksum in the response
    * to a successful PUT request. */
   svn_boolean_t supports_put_result_checksum;
@@ -715,6 +734,19 @@ svn_ra_serf__create_expat_handler(svn_ra_serf__session_t *session,
                                   const int *expected_status,
                                   apr_pool_t *result_pool);
 
+/* Parse the LEN bytes at DATA as a complete XML document using XMLCTX,
+   just like the handler created by svn_ra_serf__create_expat_handler()
+   would parse a response body.  Use SCRATCH_POOL for temporary
+   allocations.
+
+   This is mostly useful for testing and benchmarking the parser on
+   captured response bodies.  */
+svn_error_t *
+svn_ra_serf__xml_parse_buffer(svn_ra_serf__xml_context_t *xmlctx,
+                              const char *data,
+                              apr_size_t len,
+                              apr_pool_t *scratch_pool);
+
 
 /* Allocated within XES->STATE_POOL. Changes are not allowd (callers
    should make a deep copy if they need to make changes).
@@ -454,7 +454,12 @@ svn_ra_serf__progress(void *progress_baton, apr_off_t bytes_read,
   const svn_ra_serf__session_t *serf_sess = progress_baton;
   if (serf_sess->progress_func)
     {
-      serf_sess->progress_func(bytes_read + bytes_written, -1,
+      apr_off_t progress = bytes_read + bytes_written;
+
+      serf_sess->progress_func(progress,
+                               serf_sess->progress_remaining >= 0
+                                 ? progress + serf_sess->progress_remaining
+                                 : -1,
                                serf_sess->progress_baton,
                                serf_sess->pool);
     }
@@ -504,6 +509,7 @@ svn_ra_serf__open(svn_ra_session_t *session,
   serf_sess->auth_baton = auth_baton;
   serf_sess->progress_func = callbacks->progress_func;
   serf_sess->progress_baton = callbacks->progress_baton;
+  serf_sess->progress_remaining = -1;
   serf_sess->cancel_func = callbacks->cancel_func;
   serf_sess->cancel_baton = callback_baton;
 
@@ -661,6 +667,7 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
 
   /* progress_func */
   /* progress_baton */
+  new_sess->progress_remaining = -1;
 
   /* cancel_func */
   /* cancel_baton */
@@ -725,6 +732,8 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   if (new_sess->vtxn_root_stub)
     new_sess->vtxn_root_stub = apr_pstrdup(result_pool,
                                            new_sess->vtxn_root_stub);
+  if (new_sess->sha1_stub)
+    new_sess->sha1_stub = apr_pstrdup(result_pool, new_sess->sha1_stub);
 
   /* Keys and values are static */
   if (new_sess->supported_posts)
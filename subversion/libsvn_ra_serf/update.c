@@ -103,7 +103,7 @@ typedef enum report_state_e {
 #define V_ SVN_DAV_PROP_NS_DAV
 static const svn_ra_serf__xml_transition_t update_ttable[] = {
   { INITIAL, S_, "update-report", UPDATE_REPORT,
-    FALSE, { "?inline-props", "?send-all", NULL }, TRUE },
+    FALSE, { "?inline-props", "?send-all", "?inline-texts", NULL }, TRUE },
 
   { UPDATE_REPORT, S_, "target-revision", TARGET_REVISION,
     FALSE, { "rev", NULL }, TRUE },
@@ -388,6 +388,18 @@ typedef struct fetch_ctx_t {
   /* The base-rev header  */
   const char *delta_base;
 
+  /* The content locator header, if we fetch the text through its SHA-1
+     checksum.  */
+  const char *content_locator;
+
+  /* When the request got queued and when its response headers arrived. */
+  apr_time_t queued;
+  apr_time_t first_byte;
+
+  /* Body bytes still expected according to the Content-Length header.
+     These are accounted for in the connection's PENDING_BYTES. */
+  apr_off_t expected_bytes;
+
 } fetch_ctx_t;
 
 /*
@@ -408,6 +420,10 @@ struct report_context_t {
   /* What is the target revision that we want for this REPORT? */
   svn_revnum_t target_rev;
 
+  /* The revision the server actually reports for; SVN_INVALID_REVNUM
+     until we've seen it.  */
+  svn_revnum_t report_rev;
+
   /* Where are we (used while parsing) */
   dir_baton_t *cur_dir;
   file_baton_t *cur_file;
@@ -426,6 +442,18 @@ struct report_context_t {
      files/dirs? */
   svn_boolean_t add_props_included;
 
+  /* Is the server including the texts of small files inline although
+     not in "send-all" mode? */
+  svn_boolean_t texts_included;
+
+  /* May we ask the server to include small texts inline?  We only do that
+     if the report doesn't describe any existing working copy nodes,
+     i.e. on checkout.  Otherwise we want the server to tell us the
+     checksums of all new texts, so that we can take those that we have
+     already from the pristine store instead of receiving them. */
+  svn_boolean_t may_inline_texts;
+  svn_boolean_t have_local_texts;
+
   /* Path -> const char *repos_relpath mapping */
   apr_hash_t *switched_paths;
 
@@ -445,6 +473,16 @@ struct report_context_t {
   /* number of pending PROPFIND requests */
   unsigned int num_active_propfinds;
 
+  /* Statistics on the GET requests completed so far: their number, their
+     total body size, the sum of the times from the first to the last byte
+     of their responses, and the shortest time from queueing a request to
+     receiving its response headers (an upper bound for the round trip
+     time; 0 if not known yet).  */
+  unsigned int fetches_done;
+  apr_int64_t fetch_bytes;
+  apr_interval_time_t fetch_transfer_time;
+  apr_interval_time_t fetch_rtt;
+
   /* Are we done parsing the REPORT response? */
   svn_boolean_t done;
 
@@ -544,21 +582,128 @@ create_file_baton(file_baton_t **new_file,
   return SVN_NO_ERROR;
 }
 
-/** Minimum nr. of outstanding requests needed before a new connection is
- *  opened. */
+/** Nr. of outstanding requests per connection needed before a new connection
+ *  is opened, as long as we know nothing about the server's response times.
+ *  This is also the upper limit for the adaptive value, see reqs_per_conn().
+ */
 #define REQS_PER_CONN 8
 
+/** Lower limit for the adaptive nr. of requests per connection. */
+#define MIN_REQS_PER_CONN 2
+
+/** Nr. of completed GETs required before we trust our statistics. */
+#define FETCHES_FOR_STATS 8
+
+/** Assumed body size of a GET response, before we know better. */
+#define DEFAULT_FETCH_SIZE 16384
+
+/* Return the average body size of the GETs completed in CTX so far. */
+static apr_off_t
+avg_fetch_size(const report_context_t *ctx)
+{
+  if (ctx->fetches_done < FETCHES_FOR_STATS)
+    return DEFAULT_FETCH_SIZE;
+
+  return (apr_off_t)(ctx->fetch_bytes / ctx->fetches_done) + 1;
+}
+
+/* Return the nr. of outstanding requests per connection at which another
+ * connection should be opened for CTX.
+ *
+ * A GET costs roughly one round trip plus the time to transfer its body.
+ * While round trips dominate, e.g. many small files over a high-latency
+ * link, each connection sits idle most of the time and more connections
+ * pay off early.  While transfer times dominate, a deeper pipeline keeps
+ * the existing connections busy just as well.
+ */
+static int
+reqs_per_conn(const report_context_t *ctx)
+{
+  apr_interval_time_t transfer_time;
+
+  if (ctx->fetches_done < FETCHES_FOR_STATS || ctx->fetch_rtt <= 0)
+    return REQS_PER_CONN;
+
+  transfer_time = ctx->fetch_transfer_time / ctx->fetches_done;
+
+  return MIN_REQS_PER_CONN
+         + (int)((REQS_PER_CONN - MIN_REQS_PER_CONN) * transfer_time
+                 / (transfer_time + ctx->fetch_rtt));
+}
+
+/* Update the estimate of the bytes still to be received by CTX, which the
+   session reports as the total to the RA progress callback. */
+static void
+update_progress_estimate(report_context_t *ctx)
+{
+  svn_ra_serf__session_t *sess = ctx->sess;
+  apr_off_t unknown_size = avg_fetch_size(ctx);
+  apr_off_t remaining = 0;
+  int i;
+
+  /* Use the announced sizes where we have them. */
+  for (i = 0; i < sess->num_conns; i++)
+    remaining += sess->conns[i]->pending_bytes;
+
+  remaining += (apr_off_t)ctx->num_active_fetches * unknown_size;
+  sess->progress_remaining = remaining;
+}
+
+/* Note that LEN bytes of the response body for FETCH_CTX have been
+   received. */
+static void
+consume_expected_bytes(fetch_ctx_t *fetch_ctx,
+                       apr_off_t len)
+{
+  if (len > fetch_ctx->expected_bytes)
+    len = fetch_ctx->expected_bytes;
+
+  fetch_ctx->expected_bytes -= len;
+  fetch_ctx->handler->conn->pending_bytes -= len;
+}
+
+/* Note that the response body for FETCH_CTX won't deliver any more of the
+   bytes that its Content-Length announced. */
+static void
+drop_expected_bytes(fetch_ctx_t *fetch_ctx)
+{
+  consume_expected_bytes(fetch_ctx, fetch_ctx->expected_bytes);
+}
+
+/* Record the statistics for the completed GET FETCH_CTX in CTX. */
+static void
+record_fetch(report_context_t *ctx,
+             fetch_ctx_t *fetch_ctx)
+{
+  /* Whatever was announced but not received isn't pending anymore. */
+  drop_expected_bytes(fetch_ctx);
+
+  ctx->fetches_done++;
+  ctx->fetch_bytes += fetch_ctx->read_size;
+
+  if (fetch_ctx->first_byte)
+    {
+      apr_interval_time_t rtt = fetch_ctx->first_byte - fetch_ctx->queued;
+
+      ctx->fetch_transfer_time += apr_time_now() - fetch_ctx->first_byte;
+      if (ctx->fetch_rtt <= 0 || rtt < ctx->fetch_rtt)
+        ctx->fetch_rtt = rtt;
+    }
+}
+
 /** This function creates a new connection for this serf session, but only
- * if the number of NUM_ACTIVE_REQS > REQS_PER_CONN or if there currently is
- * only one main connection open.
+ * if the number of NUM_ACTIVE_REQS > REQS_PER_CONN * number of connections,
+ * or if there currently is only one main connection open.
  */
 static svn_error_t *
-open_connection_if_needed(svn_ra_serf__session_t *sess, int num_active_reqs)
+open_connection_if_needed(svn_ra_serf__session_t *sess,
+                          int num_active_reqs,
+                          int reqs_per_conn)
 {
   /* For each REQS_PER_CONN outstanding requests open a new connection, with
    * a minimum of 1 extra connection. */
   if (sess->num_conns == 1 ||
-      ((num_active_reqs / REQS_PER_CONN) > sess->num_conns))
+      ((num_active_reqs / reqs_per_conn) > sess->num_conns))
     {
       int cur = sess->num_conns;
       apr_status_t status;
@@ -624,15 +769,20 @@ get_best_connection(report_context_t *ctx)
          requests.
 
          The method used here selects the connection with the least amount of
-         pending requests, thereby giving more work to lightly loaded server
-         processes.
+         pending work, thereby giving more work to lightly loaded server
+         processes.  A request counts as much as an average response, but
+         the remaining bodies of large responses are counted by their size.
+         That spreads large files over the connections and keeps small ones
+         from queueing up behind them.
        */
       int i, best_conn = first_conn;
-      unsigned int min = INT_MAX;
+      apr_off_t unit = avg_fetch_size(ctx);
+      apr_off_t min = APR_INT64_MAX;
       for (i = first_conn; i < ctx->sess->num_conns; i++)
         {
           serf_connection_t *sc = ctx->sess->conns[i]->conn;
-          unsigned int pending = serf_connection_pending_requests(sc);
+          apr_off_t pending = serf_connection_pending_requests(sc) * unit
+                              + ctx->sess->conns[i]->pending_bytes;
           if (pending < min)
             {
               min = pending;
@@ -792,6 +942,10 @@ headers_fetch(serf_bucket_t *headers,
 {
   fetch_ctx_t *fetch_ctx = baton;
 
+  if (fetch_ctx->content_locator)
+    serf_bucket_headers_setn(headers, SVN_DAV_CONTENT_LOCATOR_HEADER,
+                             fetch_ctx->content_locator);
+
   /* note that we have old VC URL */
   if (fetch_ctx->delta_base)
     {
@@ -822,6 +976,10 @@ cancel_fetch(serf_request_t *request,
    */
   if (!response)
     {
+      /* The resent request doesn't parse its headers again, so it isn't
+         accounted for in the connection's pending bytes either. */
+      drop_expected_bytes(fetch_ctx);
+
       /* If we already started the fetch and opened the file handle, we need
        * to hold subsequent read() ops until we get back to where we were
        * before the close and we can then resume the textdelta() calls.
@@ -972,6 +1130,24 @@ handle_fetch(serf_request_t *request,
         }
 
       hdrs = serf_bucket_response_get_headers(response);
+
+      fetch_ctx->first_byte = apr_time_now();
+      val = serf_bucket_headers_get(hdrs, "Content-Length");
+      if (val)
+        {
+          apr_int64_t content_length;
+          svn_error_t *err = svn_cstring_atoi64(&content_length, val);
+
+          /* The size is just a hint for scheduling. */
+          if (err)
+            svn_error_clear(err);
+          else if (content_length > 0)
+            {
+              fetch_ctx->expected_bytes = (apr_off_t)content_length;
+              fetch_ctx->handler->conn->pending_bytes += content_length;
+            }
+        }
+
       val = serf_bucket_headers_get(hdrs, "Content-Type");
 
       if (val && svn_cstring_casecmp(val, SVN_SVNDIFF_MIME_TYPE) == 0)
@@ -1020,6 +1196,7 @@ handle_fetch(serf_request_t *request,
         }
 
       fetch_ctx->read_size += len;
+      consume_expected_bytes(fetch_ctx, len);
 
       if (fetch_ctx->aborted_read)
         {
@@ -1182,6 +1359,9 @@ file_fetch_done(serf_request_t *request,
   file_baton_t *file = fetch_ctx->file;
   svn_ra_serf__handler_t *handler = fetch_ctx->handler;
 
+  /* Nothing more will arrive for this request, whether it failed or not. */
+  drop_expected_bytes(fetch_ctx);
+
   if (handler->server_error)
       return svn_error_trace(svn_ra_serf__server_error_create(handler,
                                                               scratch_pool));
@@ -1190,6 +1370,8 @@ file_fetch_done(serf_request_t *request,
     return svn_error_trace(svn_ra_serf__unexpected_status(handler));
 
   file->parent_dir->ctx->num_active_fetches--;
+  record_fetch(file->parent_dir->ctx, fetch_ctx);
+  update_progress_estimate(file->parent_dir->ctx);
 
   file->fetch_file = FALSE;
 
@@ -1218,7 +1400,8 @@ fetch_for_file(file_baton_t *file,
   /* Open extra connections if we have enough requests to send. */
   if (ctx->sess->num_conns < ctx->sess->max_connections)
     SVN_ERR(open_connection_if_needed(ctx->sess, ctx->num_active_fetches +
-                                                 ctx->num_active_propfinds));
+                                                 ctx->num_active_propfinds,
+                                      reqs_per_conn(ctx)));
 
   /* What connection should we go on? */
   conn = get_best_connection(ctx);
@@ -1329,6 +1512,26 @@ fetch_for_file(file_baton_t *file,
           handler->method = "GET";
           handler->path = file->url;
 
+          /* If we need the full text anyway, prefer the content-addressed
+             URL if the server offers one.  Caching proxies can then serve
+             identical texts from all over the repository. */
+          if (!fetch_ctx->delta_base
+              && ctx->sess->sha1_stub
+              && file->final_sha1_checksum
+              && SVN_IS_VALID_REVNUM(ctx->report_rev))
+            {
+              handler->path = apr_pstrcat(file->pool, ctx->sess->sha1_stub,
+                                          "/",
+                                          svn_checksum_to_cstring(
+                                            file->final_sha1_checksum,
+                                            scratch_pool),
+                                          SVN_VA_NULL);
+              fetch_ctx->content_locator
+                = apr_psprintf(file->pool, "%ld/%s", ctx->report_rev,
+                               svn_path_uri_encode(file->repos_relpath,
+                                                   scratch_pool));
+            }
+
           handler->conn = conn; /* Explicit scheduling */
 
           handler->custom_accept_encoding = TRUE;
@@ -1346,10 +1549,12 @@ fetch_for_file(file_baton_t *file,
           handler->done_delegate_baton = fetch_ctx;
 
           fetch_ctx->handler = handler;
+          fetch_ctx->queued = apr_time_now();
 
           svn_ra_serf__request_create(handler);
 
           ctx->num_active_fetches++;
+          update_progress_estimate(ctx);
         }
     }
 
@@ -1446,7 +1651,8 @@ fetch_for_dir(dir_baton_t *dir,
   /* Open extra connections if we have enough requests to send. */
   if (ctx->sess->num_conns < ctx->sess->max_connections)
     SVN_ERR(open_connection_if_needed(ctx->sess, ctx->num_active_fetches +
-                                                 ctx->num_active_propfinds));
+                                                 ctx->num_active_propfinds,
+                                      reqs_per_conn(ctx)));
 
   /* What connection should we go on? */
   conn = get_best_connection(ctx);
@@ -1502,6 +1708,11 @@ update_opened(svn_ra_serf__xml_estate_t *xes,
           if (val && (strcmp(val, "true") == 0))
             ctx->add_props_included = TRUE;
 
+          val = svn_hash_gets(attrs, "inline-texts");
+
+          if (val && (strcmp(val, "true") == 0))
+            ctx->texts_included = TRUE;
+
           val = svn_hash_gets(attrs, "send-all");
 
           if (val && (strcmp(val, "true") == 0))
@@ -1640,8 +1851,9 @@ update_opened(svn_ra_serf__xml_estate_t *xes,
           /* Pre 1.2, mod_dav_svn was using <txdelta> tags (in
              addition to <fetch-file>s and such) when *not* in
              "send-all" mode.  As a client, we're smart enough to know
-             that's wrong, so we'll just ignore these tags. */
-          if (! ctx->send_all_mode)
+             that's wrong, so we'll just ignore these tags -- unless the
+             server told us that it inlines the texts of small files. */
+          if (! ctx->send_all_mode && ! ctx->texts_included)
             break;
 
           file->fetch_file = FALSE;
@@ -1720,6 +1932,7 @@ update_closed(svn_ra_serf__xml_estate_t *xes,
 
           SVN_ERR(svn_cstring_atoi64(&rev, revstr));
 
+          ctx->report_rev = (svn_revnum_t)rev;
           SVN_ERR(ctx->editor->set_target_revision(ctx->editor_baton,
                                                    (svn_revnum_t)rev,
                                                    scratch_pool));
@@ -2070,6 +2283,9 @@ set_path(void *report_baton,
   report_context_t *report = report_baton;
   svn_stringbuf_t *buf = NULL;
 
+  if (! start_empty)
+    report->have_local_texts = TRUE;
+
   svn_xml_make_open_tag(&buf, pool, svn_xml_protect_pcdata, "S:entry",
                         "rev", apr_ltoa(pool, revision),
                         "lock-token", lock_token,
@@ -2131,6 +2347,9 @@ link_path(void *report_baton,
 
   link = apr_pstrcat(pool, "/", link, SVN_VA_NULL);
 
+  if (! start_empty)
+    report->have_local_texts = TRUE;
+
   svn_xml_make_open_tag(&buf, pool, svn_xml_protect_pcdata, "S:entry",
                         "rev", apr_ltoa(pool, revision),
                         "lock-token", lock_token,
@@ -2384,11 +2603,11 @@ process_pending(update_delay_baton_t *udb,
   return SVN_NO_ERROR;
 }
 
-/* Process the 'update' editor report */
+/* The body of process_editor_report(). */
 static svn_error_t *
-process_editor_report(report_context_t *ctx,
-                      svn_ra_serf__handler_t *handler,
-                      apr_pool_t *scratch_pool)
+drive_editor_report(report_context_t *ctx,
+                    svn_ra_serf__handler_t *handler,
+                    apr_pool_t *scratch_pool)
 {
   svn_ra_serf__session_t *sess = ctx->sess;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
@@ -2407,7 +2626,7 @@ process_editor_report(report_context_t *ctx,
   handler->response_baton = ud;
 
   /* Open the first extra connection. */
-  SVN_ERR(open_connection_if_needed(sess, 0));
+  SVN_ERR(open_connection_if_needed(sess, 0, REQS_PER_CONN));
 
   sess->cur_conn = 1;
 
@@ -2450,6 +2669,7 @@ process_editor_report(report_context_t *ctx,
     }
 
   svn_pool_clear(iterpool);
+  sess->progress_remaining = -1;
 
   /* If we got a complete report, close the edit.  Otherwise, abort it. */
   if (ctx->done)
@@ -2462,6 +2682,25 @@ process_editor_report(report_context_t *ctx,
   return SVN_NO_ERROR;
 }
 
+/* Process the 'update' editor report */
+static svn_error_t *
+process_editor_report(report_context_t *ctx,
+                      svn_ra_serf__handler_t *handler,
+                      apr_pool_t *scratch_pool)
+{
+  svn_ra_serf__session_t *sess = ctx->sess;
+  svn_error_t *err = drive_editor_report(ctx, handler, scratch_pool);
+  int i;
+
+  /* Whether the report completed or not, the session must not keep
+     reporting our estimate, nor steer later requests by it. */
+  sess->progress_remaining = -1;
+  for (i = 0; i < sess->num_conns; i++)
+    sess->conns[i]->pending_bytes = 0;
+
+  return svn_error_trace(err);
+}
+
 static svn_error_t *
 finish_report(void *report_baton,
               apr_pool_t *pool)
@@ -2475,6 +2714,15 @@ finish_report(void *report_baton,
   apr_pool_t *scratch_pool = svn_pool_create(pool);
   svn_error_t *err;
 
+  /* Subversion 1.11+ servers can be told to send the texts of small
+     files inline, leaving only the larger ones for us to fetch with GET
+     requests.  Older servers ignore this element. */
+  if (report->may_inline_texts && ! report->have_local_texts)
+    make_simple_xml_tag(&buf, "S:inline-text-size",
+                        apr_itoa(scratch_pool,
+                                 SVN_RA_SERF__INLINE_TEXT_SIZE),
+                        scratch_pool);
+
   svn_xml_make_close_tag(&buf, scratch_pool, "S:update-report");
   SVN_ERR(svn_stream_write(report->body_template, buf->data, &buf->len));
   SVN_ERR(svn_stream_close(report->body_template));
@@ -2592,6 +2840,7 @@ make_update_reporter(svn_ra_session_t *ra_session,
   report->pool = result_pool;
   report->sess = sess;
   report->target_rev = revision;
+  report->report_rev = SVN_INVALID_REVNUM;
   report->ignore_ancestry = ignore_ancestry;
   report->send_copyfrom_args = send_copyfrom_args;
   report->text_deltas = text_deltas;
@@ -2688,6 +2937,9 @@ make_update_reporter(svn_ra_session_t *ra_session,
       /* Subversion 1.8+ servers can be told to send properties for newly
          added items inline even when doing a skelta response. */
       make_simple_xml_tag(&buf, "S:include-props", "yes", scratch_pool);
+
+      /* We may also ask for small texts inline; see finish_report(). */
+      report->may_inline_texts = text_deltas;
     }
 
   make_simple_xml_tag(&buf, "S:src-path", report->source, scratch_pool);
@@ -2041,10 +2041,11 @@ svn_ra_serf__setup_svndiff_accept_encoding(serf_bucket_t *headers,
       /* With http-compression=auto, advertise that we prefer svndiff2
          to svndiff1 with a low latency connection (assuming the underlying
          network has high bandwidth), as it is faster and in this case, we
-         don't care about worse compression ratio. */
+         don't care about worse compression ratio.  svndiff3 uses the same
+         compression as svndiff2 with more compact instructions. */
       serf_bucket_headers_setn(
         headers, "Accept-Encoding",
-        "gzip,svndiff2;q=0.9,svndiff1;q=0.8,svndiff;q=0.7");
+        "gzip,svndiff3;q=0.95,svndiff2;q=0.9,svndiff1;q=0.8,svndiff;q=0.7");
     }
   else
     {
@@ -2055,7 +2056,7 @@ svn_ra_serf__setup_svndiff_accept_encoding(serf_bucket_t *headers,
          above), we can't do this generally. */
       serf_bucket_headers_setn(
         headers, "Accept-Encoding",
-        "gzip,svndiff1;q=0.9,svndiff2;q=0.8,svndiff;q=0.7");
+        "gzip,svndiff1;q=0.9,svndiff3;q=0.85,svndiff2;q=0.8,svndiff;q=0.7");
     }
 }
 
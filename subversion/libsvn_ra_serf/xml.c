@@ -59,6 +59,13 @@ struct svn_ra_serf__xml_context_t {
   /* The transition table.  */
   const svn_ra_serf__xml_transition_t *ttable;
 
+  /* TTABLE compiled into a dense lookup table: for every state S up to
+     and including MAX_STATE, STATE_TRANSITIONS[S] is a NULL-terminated
+     list of the transitions leaving S, in table order.  This saves us
+     from scanning the whole table for every element.  */
+  const svn_ra_serf__xml_transition_t ***state_transitions;
+  int max_state;
+
   /* The callback information.  */
   svn_ra_serf__xml_opened_t opened_cb;
   svn_ra_serf__xml_closed_t closed_cb;
@@ -118,8 +125,17 @@ struct svn_ra_serf__xml_estate_t {
      local list. The parent will be unaffected by our locally-scoped data. */
   svn_ra_serf__ns_t *ns_list;
 
-  /* Any collected attribute values. char * -> svn_string_t *. May be NULL
-     if no attributes have been collected.  */
+  /* The names of the attributes to collect for this state, as in the
+     COLLECT_ATTRS member of the transition, and their collected values
+     (NULL for absent optional ones).  Both are NULL if this state does
+     not collect any attributes.  */
+  const char *const *attr_names;
+  const char **attr_values;
+
+  /* The collected attribute values plus anything added by
+     svn_ra_serf__xml_note(). char * -> char *.  Created on demand from
+     ATTR_NAMES and ATTR_VALUES, so that we don't pay for a hash for every
+     element we parse.  See get_attrs().  */
   apr_hash_t *attrs;
 
   /* Any collected cdata. May be NULL if no cdata is being collected.  */
@@ -473,6 +489,39 @@ lazy_create_pool(void *baton)
   return xes->state_pool;
 }
 
+/* Return the attributes of XES as a hash, creating it in XES's state pool
+   from the attributes collected at the time the element was opened if
+   necessary.  If XES doesn't collect any attributes, return NULL unless
+   CREATE is TRUE, in which case an empty hash will be returned.  */
+static apr_hash_t *
+get_attrs(svn_ra_serf__xml_estate_t *xes,
+          svn_boolean_t create)
+{
+  if (xes->attrs == NULL && (xes->attr_names != NULL || create))
+    {
+      ensure_pool(xes);
+      xes->attrs = apr_hash_make(xes->state_pool);
+
+      if (xes->attr_names != NULL)
+        {
+          int i;
+
+          for (i = 0; xes->attr_names[i] != NULL; ++i)
+            if (xes->attr_values[i] != NULL)
+              {
+                const char *name = xes->attr_names[i];
+
+                if (*name == '?')
+                  ++name;
+
+                svn_hash_sets(xes->attrs, name, xes->attr_values[i]);
+              }
+        }
+    }
+
+  return xes->attrs;
+}
+
 svn_error_t *
 svn_ra_serf__xml_context_done(svn_ra_serf__xml_context_t *xmlctx)
 {
@@ -530,9 +579,46 @@ svn_ra_serf__xml_context_create(
 {
   svn_ra_serf__xml_context_t *xmlctx;
   svn_ra_serf__xml_estate_t *xes;
+  const svn_ra_serf__xml_transition_t *scan;
+  const svn_ra_serf__xml_transition_t **next;
+  int *counts;
+  int count = 0;
+  int state;
 
   xmlctx = apr_pcalloc(result_pool, sizeof(*xmlctx));
   xmlctx->ttable = ttable;
+
+  /* Compile TTABLE into per-state lists of transitions.  They are all
+     allocated in one block, with a NULL terminator after each list.  */
+  for (scan = ttable; scan->ns != NULL; ++scan)
+    {
+      if (scan->from_state > xmlctx->max_state)
+        xmlctx->max_state = scan->from_state;
+      ++count;
+    }
+
+  counts = apr_pcalloc(result_pool,
+                       (xmlctx->max_state + 1) * sizeof(*counts));
+  for (scan = ttable; scan->ns != NULL; ++scan)
+    ++counts[scan->from_state];
+
+  xmlctx->state_transitions
+    = apr_palloc(result_pool, (xmlctx->max_state + 1)
+                              * sizeof(*xmlctx->state_transitions));
+  next = apr_pcalloc(result_pool,
+                     (count + xmlctx->max_state + 1) * sizeof(*next));
+  for (state = 0; state <= xmlctx->max_state; ++state)
+    {
+      xmlctx->state_transitions[state] = next;
+      next += counts[state] + 1;
+
+      /* Reuse COUNTS as fill level for the next loop.  */
+      counts[state] = 0;
+    }
+
+  for (scan = ttable; scan->ns != NULL; ++scan)
+    xmlctx->state_transitions[scan->from_state][counts[scan->from_state]++]
+      = scan;
   xmlctx->opened_cb = opened_cb;
   xmlctx->closed_cb = closed_cb;
   xmlctx->cdata_cb = cdata_cb;
@@ -567,7 +653,24 @@ svn_ra_serf__xml_gather_since(svn_ra_serf__xml_estate_t *xes,
 
   for (; xes != NULL; xes = xes->prev)
     {
-      if (xes->attrs != NULL)
+      if (xes->attrs == NULL && xes->attr_names != NULL)
+        {
+          int i;
+
+          /* Nothing has been added to the collected attributes, so
+             there is no need to construct a hash for them.  */
+          for (i = 0; xes->attr_names[i] != NULL; ++i)
+            if (xes->attr_values[i] != NULL)
+              {
+                const char *name = xes->attr_names[i];
+
+                if (*name == '?')
+                  ++name;
+
+                svn_hash_sets(data, name, xes->attr_values[i]);
+              }
+        }
+      else if (xes->attrs != NULL)
         {
           apr_hash_index_t *hi;
 
@@ -605,12 +708,9 @@ svn_ra_serf__xml_note(svn_ra_serf__xml_estate_t *xes,
 
   SVN_ERR_ASSERT_NO_RETURN(scan != NULL);
 
-  /* Make sure the target state has a pool.  */
-  ensure_pool(scan);
-
-  /* ... and attribute storage.  */
-  if (scan->attrs == NULL)
-    scan->attrs = apr_hash_make(scan->state_pool);
+  /* Make sure the target state has attribute storage (and thereby a
+     pool).  */
+  get_attrs(scan, TRUE);
 
   /* In all likelihood, NAME is a string constant. But we can't really
      be sure. And it isn't like we're storing a billion of these into
@@ -638,7 +738,8 @@ xml_cb_start(svn_ra_serf__xml_context_t *xmlctx,
 {
   svn_ra_serf__xml_estate_t *current = xmlctx->current;
   svn_ra_serf__dav_props_t elemname;
-  const svn_ra_serf__xml_transition_t *scan;
+  const svn_ra_serf__xml_transition_t *const *transitions;
+  const svn_ra_serf__xml_transition_t *scan = NULL;
   apr_pool_t *new_pool;
   svn_ra_serf__xml_estate_t *new_xes;
 
@@ -656,21 +757,28 @@ xml_cb_start(svn_ra_serf__xml_context_t *xmlctx,
 
   expand_ns(&elemname, current->ns_list, raw_name);
 
-  for (scan = xmlctx->ttable; scan->ns != NULL; ++scan)
-    {
-      if (scan->from_state != current->state)
-        continue;
-
-      /* Wildcard tag match.  */
-      if (*scan->name == '*')
-        break;
-
-      /* Found a specific transition.  */
-      if (strcmp(elemname.name, scan->name) == 0
-          && strcmp(elemname.xmlns, scan->ns) == 0)
-        break;
-    }
-  if (scan->ns == NULL)
+  if (current->state <= xmlctx->max_state)
+    for (transitions = xmlctx->state_transitions[current->state];
+         *transitions != NULL;
+         ++transitions)
+      {
+        /* Wildcard tag match.  */
+        if (*(*transitions)->name == '*')
+          {
+            scan = *transitions;
+            break;
+          }
+
+        /* Found a specific transition.  */
+        if (strcmp(elemname.name, (*transitions)->name) == 0
+            && strcmp(elemname.xmlns, (*transitions)->ns) == 0)
+          {
+            scan = *transitions;
+            break;
+          }
+      }
+
+  if (scan == NULL)
     {
       if (current->state == XML_STATE_INITIAL)
         {
@@ -716,21 +824,28 @@ xml_cb_start(svn_ra_serf__xml_context_t *xmlctx,
       if (scan->collect_attrs[0] != NULL)
         {
           const char *const *saveattr = &scan->collect_attrs[0];
-
-          new_xes->attrs = apr_hash_make(new_pool);
-          for (; *saveattr != NULL; ++saveattr)
+          int i;
+
+          /* Just remember the values.  We'll put them into a hash only
+             if somebody asks for that.  */
+          new_xes->attr_names = saveattr;
+          new_xes->attr_values
+            = apr_palloc(new_pool, sizeof(scan->collect_attrs)
+                                   / sizeof(scan->collect_attrs[0])
+                                   * sizeof(*new_xes->attr_values));
+          for (i = 0; saveattr[i] != NULL; ++i)
             {
               const char *name;
               const char *value;
 
-              if (**saveattr == '?')
+              if (*saveattr[i] == '?')
                 {
-                  name = *saveattr + 1;
+                  name = saveattr[i] + 1;
                   value = svn_xml_get_attr_value(name, attrs);
                 }
               else
                 {
-                  name = *saveattr;
+                  name = saveattr[i];
                   value = svn_xml_get_attr_value(name, attrs);
                   if (value == NULL)
                     return svn_error_createf(
@@ -740,9 +855,8 @@ xml_cb_start(svn_ra_serf__xml_context_t *xmlctx,
                                 name, scan->name);
                 }
 
-              if (value)
-                svn_hash_sets(new_xes->attrs, name,
-                              apr_pstrdup(new_pool, value));
+              new_xes->attr_values[i] = value ? apr_pstrdup(new_pool, value)
+                                              : NULL;
             }
         }
     }
@@ -755,8 +869,17 @@ xml_cb_start(svn_ra_serf__xml_context_t *xmlctx,
 
   /* Some basic copies to set up the new estate.  */
   new_xes->state = scan->to_state;
-  new_xes->tag.name = apr_pstrdup(new_pool, elemname.name);
-  new_xes->tag.xmlns = apr_pstrdup(new_pool, elemname.xmlns);
+  if (*scan->name != '*')
+    {
+      /* No need to copy what's already in the (static) table.  */
+      new_xes->tag.name = scan->name;
+      new_xes->tag.xmlns = scan->ns;
+    }
+  else
+    {
+      new_xes->tag.name = apr_pstrdup(new_pool, elemname.name);
+      new_xes->tag.xmlns = apr_pstrdup(new_pool, elemname.xmlns);
+    }
   new_xes->custom_close = scan->custom_close;
 
   /* Start with the parent's namespace set.  */
@@ -811,7 +934,7 @@ xml_cb_end(svn_ra_serf__xml_context_t *xmlctx,
 
       START_CALLBACK(xmlctx);
       SVN_ERR(xmlctx->closed_cb(xes, xmlctx->baton, xes->state,
-                                cdata, xes->attrs,
+                                cdata, get_attrs(xes, FALSE),
                                 xmlctx->scratch_pool));
       END_CALLBACK(xmlctx);
       svn_pool_clear(xmlctx->scratch_pool);
@@ -1028,3 +1151,24 @@ svn_ra_serf__create_expat_handler(svn_ra_serf__session_t *session,
 
   return handler;
 }
+
+svn_error_t *
+svn_ra_serf__xml_parse_buffer(svn_ra_serf__xml_context_t *xmlctx,
+                              const char *data,
+                              apr_size_t len,
+                              apr_pool_t *scratch_pool)
+{
+  struct expat_ctx_t ectx = { 0 };
+
+  ectx.xmlctx = xmlctx;
+  ectx.cleanup_pool = scratch_pool;
+  ectx.parser = svn_xml_make_parser(&ectx, expat_start, expat_end,
+                                    expat_cdata, scratch_pool);
+
+  SVN_ERR(parse_xml(&ectx, data, len, TRUE /* isFinal */));
+  SVN_ERR(svn_ra_serf__xml_context_done(xmlctx));
+
+  svn_xml_free_parser(ectx.parser);
+
+  return SVN_NO_ERROR;
+}
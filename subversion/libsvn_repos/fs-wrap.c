@@ -51,7 +51,7 @@ svn_repos_fs_commit_txn(const char **conflict_p,
                         svn_fs_txn_t *txn,
                         apr_pool_t *pool)
 {
-  svn_error_t *err, *err2;
+  svn_error_t *err, *err2, *err3;
   const char *txn_name;
   apr_hash_t *props;
   apr_pool_t *iterpool;
@@ -111,6 +111,15 @@ svn_repos_fs_commit_txn(const char **conflict_p,
       return err;
     }
 
+  /* Keep the optional log index up to date.  Failing to do so does not
+     invalidate the commit; log will simply not use the index until the
+     next successful update. */
+  err3 = svn_repos__log_index_update(repos, *new_rev, pool);
+  if (err3)
+    err3 = svn_error_quick_wrap(err3,
+                                _("Commit succeeded, but updating the "
+                                  "log index failed"));
+
   /* Run post-commit hooks. */
   if ((err2 = svn_repos__hooks_post_commit(repos, hooks_env,
                                            *new_rev, txn_name, pool)))
@@ -120,7 +129,8 @@ svn_repos_fs_commit_txn(const char **conflict_p,
                 _("Commit succeeded, but post-commit hook failed"));
     }
 
-  return svn_error_compose_create(err, err2);
+  return svn_error_compose_create(svn_error_compose_create(err, err3),
+                                  err2);
 }
 
 
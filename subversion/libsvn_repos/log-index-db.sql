@@ -0,0 +1,129 @@
+/* log-index-db.sql -- schema for the optional repository log index
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+/* One row per (PATH, REVISION) where REVISION changed PATH itself or any
+   node below it.  Every parent of a changed path gets a row as well, so
+   that finding the previous change "at or below" a path is a single
+   range lookup on the primary key. */
+CREATE TABLE path_rev (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  PRIMARY KEY (path, revision)
+  ) WITHOUT ROWID;
+
+CREATE INDEX i_path_rev_revision ON path_rev (revision);
+
+/* One row per (PATH, REVISION) where PATH got added or replaced in
+   REVISION, with or without history.  Those are the points at which
+   node history may change its path or end. */
+CREATE TABLE path_add (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  PRIMARY KEY (path, revision)
+  ) WITHOUT ROWID;
+
+CREATE INDEX i_path_add_revision ON path_add (revision);
+
+/* One row per REVISION that changed any svn:mergeinfo property.  CHANGES
+   holds the deleted and added mergeinfo per changed path, serialized as
+   svn_packed__data_t.  Revisions without such a row did not change any
+   mergeinfo. */
+CREATE TABLE mergeinfo_rev (
+  revision INTEGER NOT NULL PRIMARY KEY,
+  changes BLOB NOT NULL
+  );
+
+/* Single-row table.  All revisions up to and including YOUNGEST have been
+   indexed; -1 means "none". */
+CREATE TABLE log_index_info (
+  id INTEGER NOT NULL PRIMARY KEY,
+  youngest INTEGER NOT NULL
+  );
+
+INSERT INTO log_index_info (id, youngest) VALUES (0, -1);
+
+PRAGMA USER_VERSION = 1;
+
+-- STMT_GET_YOUNGEST
+SELECT youngest
+FROM log_index_info
+WHERE id = 0
+
+-- STMT_SET_YOUNGEST
+UPDATE log_index_info
+SET youngest = ?1
+WHERE id = 0
+
+-- STMT_INSERT_PATH_REV
+INSERT OR IGNORE INTO path_rev (path, revision)
+VALUES (?1, ?2)
+
+-- STMT_INSERT_PATH_ADD
+INSERT OR IGNORE INTO path_add (path, revision)
+VALUES (?1, ?2)
+
+-- STMT_GET_PREV_PATH_REV
+SELECT revision
+FROM path_rev
+WHERE path = ?1 AND revision >= ?2 AND revision <= ?3
+ORDER BY revision DESC
+LIMIT 1
+
+-- STMT_GET_PREV_PATH_ADD
+SELECT revision
+FROM path_add
+WHERE path = ?1 AND revision >= ?2 AND revision <= ?3
+ORDER BY revision DESC
+LIMIT 1
+
+-- STMT_INSERT_MERGEINFO_REV
+INSERT OR REPLACE INTO mergeinfo_rev (revision, changes)
+VALUES (?1, ?2)
+
+-- STMT_GET_MERGEINFO_REV
+SELECT changes
+FROM mergeinfo_rev
+WHERE revision = ?1
+
+-- STMT_GET_PATH_REVS_IN_REV
+SELECT path
+FROM path_rev
+WHERE revision = ?1
+
+-- STMT_GET_PATH_ADDS_IN_REV
+SELECT path
+FROM path_add
+WHERE revision = ?1
+
+-- STMT_DEL_PATH_REVS_YOUNGER_THAN_REV
+DELETE FROM path_rev
+WHERE revision > ?1
+
+-- STMT_DEL_PATH_ADDS_YOUNGER_THAN_REV
+DELETE FROM path_add
+WHERE revision > ?1
+
+-- STMT_DEL_MERGEINFO_REVS_YOUNGER_THAN_REV
+DELETE FROM mergeinfo_rev
+WHERE revision > ?1
@@ -0,0 +1,960 @@
+/* log-index.c --- the optional path and mergeinfo index used by log
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_private_config.h"
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+#include "repos.h"
+
+#include "private/svn_fspath.h"
+#include "private/svn_packed_data.h"
+#include "private/svn_sorts_private.h"
+#include "private/svn_sqlite.h"
+#include "private/svn_subr_private.h"
+
+#include "log-index-db.h"
+
+LOG_INDEX_DB_SQL_DECLARE_STATEMENTS(statements);
+
+/* Schema version of the log index database. */
+#define LOG_INDEX_SCHEMA_FORMAT 1
+
+struct svn_repos__log_index_t
+{
+  /* The open database. */
+  svn_sqlite__db_t *sdb;
+
+  /* All revisions up to and including this one have been indexed. */
+  svn_revnum_t youngest;
+};
+
+
+/** Helper functions. **/
+
+/* Return the path to the log index database of REPOS. */
+static const char *
+path_log_index_db(svn_repos_t *repos,
+                  apr_pool_t *result_pool)
+{
+  return svn_dirent_join(repos->db_path, SVN_REPOS__LOG_INDEX_DB_NAME,
+                         result_pool);
+}
+
+/* Set *EXISTS to TRUE if REPOS has a log index database. */
+static svn_error_t *
+log_index_exists(svn_boolean_t *exists,
+                 svn_repos_t *repos,
+                 apr_pool_t *scratch_pool)
+{
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_io_check_path(path_log_index_db(repos, scratch_pool),
+                            &kind, scratch_pool));
+  *exists = (kind != svn_node_none);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the log index database of REPOS in *SDB using MODE.  If MODE is
+   svn_sqlite__mode_rwcreate, create the database and its schema if they
+   don't exist yet.  The database will be closed when RESULT_POOL gets
+   cleaned up.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+open_log_index_db(svn_sqlite__db_t **sdb,
+                  svn_repos_t *repos,
+                  svn_sqlite__mode_t mode,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  const char *db_path = path_log_index_db(repos, scratch_pool);
+  int version;
+
+#ifndef WIN32
+  if (mode == svn_sqlite__mode_rwcreate)
+    {
+      /* Extend the permissions that apply to the repository as a whole
+         to the new database instead of simply defaulting to umask. */
+      svn_boolean_t exists;
+
+      SVN_ERR(log_index_exists(&exists, repos, scratch_pool));
+      if (!exists)
+        {
+          const char *format_path = svn_dirent_join(repos->path,
+                                                    SVN_REPOS__FORMAT,
+                                                    scratch_pool);
+          svn_error_t *err = svn_io_file_create_empty(db_path, scratch_pool);
+
+          if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+            return svn_error_trace(err);
+          else if (err)
+            svn_error_clear(err);
+          else
+            SVN_ERR(svn_io_copy_perms(format_path, db_path, scratch_pool));
+        }
+    }
+#endif
+
+  SVN_ERR(svn_sqlite__open(sdb, db_path, mode, statements, 0, NULL, 0,
+                           result_pool, scratch_pool));
+
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, *sdb,
+                                                        scratch_pool),
+                        *sdb);
+  if (version <= 0 && mode == svn_sqlite__mode_rwcreate)
+    SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(*sdb,
+                                                      STMT_CREATE_SCHEMA),
+                          *sdb);
+  else if (version != LOG_INDEX_SCHEMA_FORMAT)
+    return svn_error_createf(SVN_ERR_SQLITE_UNSUPPORTED_SCHEMA,
+                             svn_sqlite__close(*sdb),
+                             _("Log index '%s' has unsupported schema "
+                               "version %d"),
+                             svn_dirent_local_style(db_path, scratch_pool),
+                             version);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *YOUNGEST to the youngest revision that has been indexed in SDB. */
+static svn_error_t *
+get_youngest(svn_revnum_t *youngest,
+             svn_sqlite__db_t *sdb)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_YOUNGEST));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  *youngest = have_row ? svn_sqlite__column_revnum(stmt, 0)
+                       : SVN_INVALID_REVNUM;
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Collect the index entries for REVISION in FS.  Set *TOUCHED to a hash
+   of all paths changed in REVISION plus all their parents and *ADDED to
+   the paths that got added or replaced in REVISION.  Both hashes map
+   const char * fspaths to themselves and are allocated in RESULT_POOL.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+collect_changes(apr_hash_t **touched,
+                apr_hash_t **added,
+                svn_fs_t *fs,
+                svn_revnum_t revision,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root;
+  svn_fs_path_change_iterator_t *iterator;
+  svn_fs_path_change3_t *change;
+
+  *touched = svn_hash__make(result_pool);
+  *added = svn_hash__make(result_pool);
+
+  /* Every revision creates a new root node, even if it is empty. */
+  svn_hash_sets(*touched, "/", "/");
+  if (revision == 0)
+    svn_hash_sets(*added, "/", "/");
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, revision, scratch_pool));
+  SVN_ERR(svn_fs_paths_changed3(&iterator, root, scratch_pool,
+                                scratch_pool));
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+  while (change)
+    {
+      const char *path = svn_fspath__canonicalize(change->path.data,
+                                                  result_pool);
+
+      if (   change->change_kind == svn_fs_path_change_add
+          || change->change_kind == svn_fs_path_change_replace)
+        svn_hash_sets(*added, path, path);
+
+      /* Record PATH and its parents, stopping at the first one that
+         has already been recorded for this revision. */
+      while (!svn_hash_gets(*touched, path))
+        {
+          svn_hash_sets(*touched, path, path);
+          path = svn_fspath__dirname(path, result_pool);
+        }
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* The streams used to serialize the mergeinfo changes of one revision. */
+typedef struct mergeinfo_streams_t
+{
+  /* Changed paths, each followed by the merge source paths of its
+     deleted and then its added mergeinfo. */
+  svn_packed__byte_stream_t *paths;
+
+  /* Number of deleted and added merge sources per changed path and
+     number of ranges per merge source, in the order of PATHS. */
+  svn_packed__int_stream_t *counts;
+
+  /* START, END - START and INHERITABLE per range. */
+  svn_packed__int_stream_t *starts;
+  svn_packed__int_stream_t *lengths;
+  svn_packed__int_stream_t *inheritable;
+} mergeinfo_streams_t;
+
+/* Append MERGEINFO to STREAMS, sorted by merge source path.  Use
+   SCRATCH_POOL for temporary allocations. */
+static void
+write_mergeinfo(mergeinfo_streams_t *streams,
+                svn_mergeinfo_t mergeinfo,
+                apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *sources
+    = svn_sort__hash(mergeinfo, svn_sort_compare_items_as_paths,
+                     scratch_pool);
+  int i, k;
+
+  for (i = 0; i < sources->nelts; ++i)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(sources, i, svn_sort__item_t);
+      svn_rangelist_t *rangelist = item->value;
+
+      svn_packed__add_bytes(streams->paths, item->key, item->klen);
+      svn_packed__add_uint(streams->counts, rangelist->nelts);
+      for (k = 0; k < rangelist->nelts; ++k)
+        {
+          const svn_merge_range_t *range
+            = APR_ARRAY_IDX(rangelist, k, const svn_merge_range_t *);
+
+          svn_packed__add_int(streams->starts, range->start);
+          svn_packed__add_int(streams->lengths, range->end - range->start);
+          svn_packed__add_uint(streams->inheritable, range->inheritable);
+        }
+    }
+}
+
+/* Serialize the mergeinfo catalogs DELETED and ADDED, as returned by
+   svn_repos__mergeinfo_changed(), into *DATA, allocated in RESULT_POOL.
+   The result only depends on the contents of the catalogs.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+serialize_mergeinfo_changes(svn_stringbuf_t **data,
+                            svn_mergeinfo_catalog_t deleted,
+                            svn_mergeinfo_catalog_t added,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  svn_packed__data_root_t *root = svn_packed__data_create_root(scratch_pool);
+  apr_array_header_t *paths;
+  mergeinfo_streams_t streams;
+  int i;
+
+  streams.paths = svn_packed__create_bytes_stream(root);
+  streams.counts = svn_packed__create_int_stream(root, FALSE, FALSE);
+  streams.starts = svn_packed__create_int_stream(root, TRUE, TRUE);
+  streams.lengths = svn_packed__create_int_stream(root, FALSE, TRUE);
+  streams.inheritable = svn_packed__create_int_stream(root, FALSE, FALSE);
+
+  /* Both catalogs use the same keys. */
+  paths = svn_sort__hash(added, svn_sort_compare_items_as_paths,
+                         scratch_pool);
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(paths, i, svn_sort__item_t);
+      svn_mergeinfo_t deleted_mergeinfo = svn_hash_gets(deleted, item->key);
+      svn_mergeinfo_t added_mergeinfo = item->value;
+
+      if (!deleted_mergeinfo)
+        deleted_mergeinfo = svn_hash__make(scratch_pool);
+
+      svn_packed__add_bytes(streams.paths, item->key, item->klen);
+      svn_packed__add_uint(streams.counts,
+                           apr_hash_count(deleted_mergeinfo));
+      svn_packed__add_uint(streams.counts, apr_hash_count(added_mergeinfo));
+      write_mergeinfo(&streams, deleted_mergeinfo, scratch_pool);
+      write_mergeinfo(&streams, added_mergeinfo, scratch_pool);
+    }
+
+  *data = svn_stringbuf_create_empty(result_pool);
+  SVN_ERR(svn_packed__data_write(svn_stream_from_stringbuf(*data,
+                                                           scratch_pool),
+                                 root, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Read COUNT merge sources from STREAMS and return them as mergeinfo in
+   *MERGEINFO, allocated in RESULT_POOL. */
+static svn_error_t *
+read_mergeinfo(svn_mergeinfo_t *mergeinfo,
+               mergeinfo_streams_t *streams,
+               apr_uint64_t count,
+               apr_pool_t *result_pool)
+{
+  *mergeinfo = svn_hash__make(result_pool);
+  for (; count > 0; --count)
+    {
+      apr_size_t len;
+      const char *source = svn_packed__get_bytes(streams->paths, &len);
+      apr_uint64_t range_count = svn_packed__get_uint(streams->counts);
+      svn_rangelist_t *rangelist;
+
+      if (range_count > svn_packed__int_count(streams->starts))
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Corrupt mergeinfo in log index"));
+
+      rangelist = apr_array_make(result_pool, (int)range_count,
+                                 sizeof(svn_merge_range_t *));
+      for (; range_count > 0; --range_count)
+        {
+          svn_merge_range_t *range = apr_palloc(result_pool, sizeof(*range));
+
+          range->start = (svn_revnum_t)svn_packed__get_int(streams->starts);
+          range->end = range->start
+                     + (svn_revnum_t)svn_packed__get_int(streams->lengths);
+          range->inheritable
+            = (svn_boolean_t)svn_packed__get_uint(streams->inheritable);
+          APR_ARRAY_PUSH(rangelist, svn_merge_range_t *) = range;
+        }
+
+      apr_hash_set(*mergeinfo, apr_pstrmemdup(result_pool, source, len),
+                   len, rangelist);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Inverse of serialize_mergeinfo_changes(): parse DATA of LEN bytes into
+   the catalogs *DELETED and *ADDED, allocated in RESULT_POOL.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+deserialize_mergeinfo_changes(svn_mergeinfo_catalog_t *deleted,
+                              svn_mergeinfo_catalog_t *added,
+                              const void *data,
+                              apr_size_t len,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  svn_packed__data_root_t *root;
+  svn_string_t buffer;
+  mergeinfo_streams_t streams;
+
+  buffer.data = data;
+  buffer.len = len;
+  SVN_ERR(svn_packed__data_read(&root,
+                                svn_stream_from_string(&buffer,
+                                                       scratch_pool),
+                                scratch_pool, scratch_pool));
+
+  streams.paths = svn_packed__first_byte_stream(root);
+  streams.counts = svn_packed__first_int_stream(root);
+  streams.starts = streams.counts
+                 ? svn_packed__next_int_stream(streams.counts) : NULL;
+  streams.lengths = streams.starts
+                  ? svn_packed__next_int_stream(streams.starts) : NULL;
+  streams.inheritable = streams.lengths
+                      ? svn_packed__next_int_stream(streams.lengths) : NULL;
+  if (!streams.paths || !streams.inheritable)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Corrupt mergeinfo in log index"));
+
+  *deleted = svn_hash__make(result_pool);
+  *added = svn_hash__make(result_pool);
+  while (svn_packed__byte_block_count(streams.paths))
+    {
+      apr_size_t path_len;
+      const char *path = svn_packed__get_bytes(streams.paths, &path_len);
+      apr_uint64_t deleted_count = svn_packed__get_uint(streams.counts);
+      apr_uint64_t added_count = svn_packed__get_uint(streams.counts);
+      svn_mergeinfo_t mergeinfo;
+
+      path = apr_pstrmemdup(result_pool, path, path_len);
+      SVN_ERR(read_mergeinfo(&mergeinfo, &streams, deleted_count,
+                             result_pool));
+      svn_hash_sets(*deleted, path, mergeinfo);
+      SVN_ERR(read_mergeinfo(&mergeinfo, &streams, added_count,
+                             result_pool));
+      svn_hash_sets(*added, path, mergeinfo);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *DATA to the serialized mergeinfo changes of REVISION in FS or to
+   NULL if REVISION does not change any mergeinfo.  Like log does, treat
+   unparsable mergeinfo as "no change".  Allocate *DATA in RESULT_POOL and
+   use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+collect_mergeinfo_changes(svn_stringbuf_t **data,
+                          svn_fs_t *fs,
+                          svn_revnum_t revision,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_mergeinfo_catalog_t deleted, added;
+  svn_error_t *err;
+
+  *data = NULL;
+  err = svn_repos__mergeinfo_changed(&deleted, &added, fs, revision,
+                                     scratch_pool, scratch_pool);
+  if (err && err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  if (apr_hash_count(added) == 0 && apr_hash_count(deleted) == 0)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(serialize_mergeinfo_changes(data, deleted, added,
+                                                     result_pool,
+                                                     scratch_pool));
+}
+
+/* Insert all keys of PATHS together with REVISION into SDB using the
+   insert statement STMT_IDX. */
+static svn_error_t *
+insert_paths(svn_sqlite__db_t *sdb,
+             int stmt_idx,
+             apr_hash_t *paths,
+             svn_revnum_t revision,
+             apr_pool_t *scratch_pool)
+{
+  apr_hash_index_t *hi;
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, stmt_idx));
+  for (hi = apr_hash_first(scratch_pool, paths); hi; hi = apr_hash_next(hi))
+    {
+      SVN_ERR(svn_sqlite__bindf(stmt, "sr", apr_hash_this_key(hi),
+                                revision));
+      SVN_ERR(svn_sqlite__insert(NULL, stmt));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for add_revision(). */
+typedef struct add_revision_baton_t
+{
+  /* The revision to add and its index entries. */
+  svn_revnum_t revision;
+  apr_hash_t *touched;
+  apr_hash_t *added;
+
+  /* Serialized mergeinfo changes of REVISION.  NULL if there are none. */
+  svn_stringbuf_t *mergeinfo;
+
+  /* Output: TRUE, if REVISION has been added.  FALSE, if the index did
+     not end at REVISION-1, e.g. because some concurrent process already
+     added it. */
+  svn_boolean_t done;
+} add_revision_baton_t;
+
+/* Implements svn_sqlite__transaction_callback_t.  Add the revision
+   described by the add_revision_baton_t BATON to SDB, if SDB currently
+   ends just before it. */
+static svn_error_t *
+add_revision(void *baton,
+             svn_sqlite__db_t *sdb,
+             apr_pool_t *scratch_pool)
+{
+  add_revision_baton_t *b = baton;
+  svn_revnum_t youngest;
+  svn_sqlite__stmt_t *stmt;
+
+  b->done = FALSE;
+  SVN_ERR(get_youngest(&youngest, sdb));
+  if (youngest != b->revision - 1)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(insert_paths(sdb, STMT_INSERT_PATH_REV, b->touched, b->revision,
+                       scratch_pool));
+  SVN_ERR(insert_paths(sdb, STMT_INSERT_PATH_ADD, b->added, b->revision,
+                       scratch_pool));
+  if (b->mergeinfo)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                        STMT_INSERT_MERGEINFO_REV));
+      SVN_ERR(svn_sqlite__bindf(stmt, "rb", b->revision,
+                                b->mergeinfo->data, b->mergeinfo->len));
+      SVN_ERR(svn_sqlite__insert(NULL, stmt));
+    }
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SET_YOUNGEST));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, b->revision));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  b->done = TRUE;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_sqlite__transaction_callback_t.  Remove all index
+   entries for revisions younger than *(svn_revnum_t *)BATON from SDB. */
+static svn_error_t *
+truncate_index(void *baton,
+               svn_sqlite__db_t *sdb,
+               apr_pool_t *scratch_pool)
+{
+  svn_revnum_t revision = *(svn_revnum_t *)baton;
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_DEL_PATH_REVS_YOUNGER_THAN_REV));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_DEL_PATH_ADDS_YOUNGER_THAN_REV));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_DEL_MERGEINFO_REVS_YOUNGER_THAN_REV));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SET_YOUNGEST));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  return SVN_NO_ERROR;
+}
+
+/* Add all revisions of REPOS up to and including END to the index in SDB.
+   If the index covers revisions younger than END, drop them first if
+   TRUNCATE is set and leave the index untouched otherwise.  NOTIFY_FUNC,
+   NOTIFY_BATON, CANCEL_FUNC and CANCEL_BATON are as for
+   svn_repos_log_index_build().  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+catch_up(svn_sqlite__db_t *sdb,
+         svn_repos_t *repos,
+         svn_revnum_t end,
+         svn_boolean_t truncate,
+         svn_repos_notify_func_t notify_func,
+         void *notify_baton,
+         svn_cancel_func_t cancel_func,
+         void *cancel_baton,
+         apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t youngest;
+
+  SVN_ERR(get_youngest(&youngest, sdb));
+  if (youngest > end && truncate)
+    {
+      SVN_ERR(svn_sqlite__with_immediate_transaction(sdb, truncate_index,
+                                                     &end, iterpool));
+      youngest = end;
+    }
+
+  while (youngest < end)
+    {
+      add_revision_baton_t baton;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      /* Read the FS outside the SQLite transaction to keep the time we
+         hold the database lock short. */
+      baton.revision = youngest + 1;
+      SVN_ERR(collect_changes(&baton.touched, &baton.added, repos->fs,
+                              baton.revision, iterpool, iterpool));
+      SVN_ERR(collect_mergeinfo_changes(&baton.mergeinfo, repos->fs,
+                                        baton.revision, iterpool, iterpool));
+      SVN_ERR(svn_sqlite__with_immediate_transaction(sdb, add_revision,
+                                                     &baton, iterpool));
+
+      if (baton.done && notify_func)
+        {
+          svn_repos_notify_t *notify
+            = svn_repos_notify_create(svn_repos_notify_log_index_rev_end,
+                                      iterpool);
+          notify->revision = baton.revision;
+          notify_func(notify_baton, notify, iterpool);
+        }
+
+      SVN_ERR(get_youngest(&youngest, sdb));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the rows returned by the single-column query STMT_IDX for
+   REVISION in SDB match the keys of EXPECTED.  TABLE names the table for
+   error messages. */
+static svn_error_t *
+verify_paths(svn_sqlite__db_t *sdb,
+             int stmt_idx,
+             const char *table,
+             apr_hash_t *expected,
+             svn_revnum_t revision,
+             apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  unsigned int count = 0;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, stmt_idx));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      const char *path = svn_sqlite__column_text(stmt, 0, scratch_pool);
+
+      if (!svn_hash_gets(expected, path))
+        return svn_error_createf(SVN_ERR_FS_CORRUPT,
+                                 svn_sqlite__reset(stmt),
+                                 _("Log index contains unexpected %s "
+                                   "entry '%s' in revision %ld"),
+                                 table, path, revision);
+
+      ++count;
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  if (count != apr_hash_count(expected))
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Log index lacks %u %s entries "
+                               "in revision %ld"),
+                             apr_hash_count(expected) - count, table,
+                             revision);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the mergeinfo changes stored for REVISION in SDB match
+   the serialized EXPECTED data, which may be NULL. */
+static svn_error_t *
+verify_mergeinfo(svn_sqlite__db_t *sdb,
+                 const svn_stringbuf_t *expected,
+                 svn_revnum_t revision)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_boolean_t match;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_MERGEINFO_REV));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row && expected)
+    {
+      apr_size_t len;
+      const void *data = svn_sqlite__column_blob(stmt, 0, &len, NULL);
+
+      match = (len == expected->len)
+           && (memcmp(data, expected->data, len) == 0);
+    }
+  else
+    match = (have_row == (expected != NULL));
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  if (!match)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Log index has wrong mergeinfo changes "
+                               "for revision %ld"),
+                             revision);
+
+  return SVN_NO_ERROR;
+}
+
+
+/** Library-private API's. **/
+
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index_p,
+                          svn_repos_t *repos,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_repos__log_index_t *index;
+  svn_boolean_t exists;
+  svn_revnum_t head;
+
+  *index_p = NULL;
+
+  SVN_ERR(log_index_exists(&exists, repos, scratch_pool));
+  if (!exists)
+    return SVN_NO_ERROR;
+
+  index = apr_pcalloc(result_pool, sizeof(*index));
+  SVN_ERR(open_log_index_db(&index->sdb, repos, svn_sqlite__mode_readonly,
+                            result_pool, scratch_pool));
+  SVN_SQLITE__ERR_CLOSE(get_youngest(&index->youngest, index->sdb),
+                        index->sdb);
+
+  /* An index that claims to know revisions which the repository doesn't
+     have (e.g. after restoring an older backup) cannot be trusted.
+     Don't keep the database open for it. */
+  SVN_SQLITE__ERR_CLOSE(svn_fs_youngest_rev(&head, repos->fs, scratch_pool),
+                        index->sdb);
+  if (!SVN_IS_VALID_REVNUM(index->youngest) || index->youngest > head)
+    return svn_error_trace(svn_sqlite__close(index->sdb));
+
+  *index_p = index;
+  return SVN_NO_ERROR;
+}
+
+svn_revnum_t
+svn_repos__log_index_youngest(const svn_repos__log_index_t *index)
+{
+  return index->youngest;
+}
+
+svn_error_t *
+svn_repos__log_index_prev_change(svn_revnum_t *revision,
+                                 svn_boolean_t *added,
+                                 svn_repos__log_index_t *index,
+                                 const char *path,
+                                 svn_revnum_t start,
+                                 svn_revnum_t end,
+                                 apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_revnum_t changed_rev = SVN_INVALID_REVNUM;
+  svn_revnum_t added_rev = SVN_INVALID_REVNUM;
+  svn_revnum_t lower_bound = start;
+
+  SVN_ERR_ASSERT(end <= index->youngest);
+
+  path = svn_fspath__canonicalize(path, scratch_pool);
+
+  /* Youngest change at or below PATH. */
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_GET_PREV_PATH_REV));
+  SVN_ERR(svn_sqlite__bindf(stmt, "srr", path, start, end));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row)
+    changed_rev = svn_sqlite__column_revnum(stmt, 0);
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  /* Youngest addition of PATH or any of its parents.  Anything older than
+     CHANGED_REV is of no interest. */
+  if (SVN_IS_VALID_REVNUM(changed_rev))
+    lower_bound = changed_rev;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_GET_PREV_PATH_ADD));
+  while (TRUE)
+    {
+      SVN_ERR(svn_sqlite__bindf(stmt, "srr", path, lower_bound, end));
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+      if (have_row)
+        {
+          added_rev = svn_sqlite__column_revnum(stmt, 0);
+          lower_bound = added_rev;
+        }
+      SVN_ERR(svn_sqlite__reset(stmt));
+
+      if (svn_fspath__is_root(path, strlen(path)))
+        break;
+
+      path = svn_fspath__dirname(path, scratch_pool);
+    }
+
+  if (SVN_IS_VALID_REVNUM(added_rev) && added_rev >= changed_rev)
+    {
+      *revision = added_rev;
+      *added = TRUE;
+    }
+  else
+    {
+      *revision = changed_rev;
+      *added = FALSE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__log_index_mergeinfo_changed(
+  svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+  svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+  svn_repos__log_index_t *index,
+  svn_revnum_t revision,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR_ASSERT(revision <= index->youngest);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_GET_MERGEINFO_REV));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row)
+    {
+      apr_size_t len;
+      const void *data = svn_sqlite__column_blob(stmt, 0, &len, NULL);
+
+      err = deserialize_mergeinfo_changes(deleted_mergeinfo_catalog,
+                                          added_mergeinfo_catalog,
+                                          data, len,
+                                          result_pool, scratch_pool);
+    }
+  else
+    {
+      *deleted_mergeinfo_catalog = svn_hash__make(result_pool);
+      *added_mergeinfo_catalog = svn_hash__make(result_pool);
+    }
+
+  return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+}
+
+svn_error_t *
+svn_repos__log_index_update(svn_repos_t *repos,
+                            svn_revnum_t revision,
+                            apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  svn_boolean_t exists;
+
+  SVN_ERR(log_index_exists(&exists, repos, scratch_pool));
+  if (!exists)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(open_log_index_db(&sdb, repos, svn_sqlite__mode_readwrite,
+                            scratch_pool, scratch_pool));
+  /* Concurrent post-commit updates may already have indexed REVISION
+     and beyond.  Never drop their work here. */
+  SVN_ERR(catch_up(sdb, repos, revision, FALSE, NULL, NULL, NULL, NULL,
+                   scratch_pool));
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
+
+
+/** Public API's. **/
+
+svn_error_t *
+svn_repos_log_index_build(svn_repos_t *repos,
+                          svn_repos_notify_func_t notify_func,
+                          void *notify_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  svn_revnum_t head;
+
+  SVN_ERR(open_log_index_db(&sdb, repos, svn_sqlite__mode_rwcreate,
+                            scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_youngest_rev(&head, repos->fs, scratch_pool));
+  SVN_ERR(catch_up(sdb, repos, head, TRUE, notify_func, notify_baton,
+                   cancel_func, cancel_baton, scratch_pool));
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
+
+svn_error_t *
+svn_repos_log_index_verify(svn_repos_t *repos,
+                           svn_revnum_t start_rev,
+                           svn_revnum_t end_rev,
+                           svn_repos_notify_func_t notify_func,
+                           void *notify_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  svn_sqlite__db_t *sdb;
+  svn_boolean_t exists;
+  svn_revnum_t youngest, head, revision;
+
+  SVN_ERR(log_index_exists(&exists, repos, scratch_pool));
+  if (!exists)
+    return svn_error_create(SVN_ERR_REPOS_DISABLED_FEATURE, NULL,
+                            _("The repository has no log index"));
+
+  SVN_ERR(open_log_index_db(&sdb, repos, svn_sqlite__mode_readonly,
+                            scratch_pool, scratch_pool));
+  SVN_ERR(get_youngest(&youngest, sdb));
+  SVN_ERR(svn_fs_youngest_rev(&head, repos->fs, scratch_pool));
+
+  if (youngest > head)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Log index covers revision %ld but the "
+                               "youngest revision is %ld"),
+                             youngest, head);
+
+  if (!SVN_IS_VALID_REVNUM(start_rev))
+    start_rev = 0;
+  if (!SVN_IS_VALID_REVNUM(end_rev))
+    end_rev = youngest;
+
+  if (end_rev > youngest)
+    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
+                             _("Revision %ld has not been indexed yet"),
+                             end_rev);
+  if (start_rev > end_rev)
+    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
+                             _("Start revision %ld"
+                               " is greater than end revision %ld"),
+                             start_rev, end_rev);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (revision = start_rev; revision <= end_rev; ++revision)
+    {
+      apr_hash_t *touched, *added;
+      svn_stringbuf_t *mergeinfo;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(collect_changes(&touched, &added, repos->fs, revision,
+                              iterpool, iterpool));
+      SVN_ERR(verify_paths(sdb, STMT_GET_PATH_REVS_IN_REV, "path_rev",
+                           touched, revision, iterpool));
+      SVN_ERR(verify_paths(sdb, STMT_GET_PATH_ADDS_IN_REV, "path_add",
+                           added, revision, iterpool));
+      SVN_ERR(collect_mergeinfo_changes(&mergeinfo, repos->fs, revision,
+                                        iterpool, iterpool));
+      SVN_ERR(verify_mergeinfo(sdb, mergeinfo, revision));
+
+      if (notify_func)
+        {
+          svn_repos_notify_t *notify
+            = svn_repos_notify_create(svn_repos_notify_verify_rev_end,
+                                      iterpool);
+          notify->revision = revision;
+          notify_func(notify_baton, notify, iterpool);
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
@@ -56,6 +56,9 @@ typedef struct log_callbacks_t
   void *revision_receiver_baton;
   svn_repos_authz_func_t authz_read_func;
   void *authz_read_baton;
+
+  /* Optional log index of the repository.  NULL if not available. */
+  svn_repos__log_index_t *log_index;
 } log_callbacks_t;
 
 
@@ -421,6 +424,12 @@ struct path_info
   svn_boolean_t done;
   svn_boolean_t first_time;
 
+  /* Only used when following history through the log index:  If set,
+     the last location found was a point at which PATH or one of its
+     parents got added or replaced.  Since history may continue at a
+     different path from there, take the next step through the FS. */
+  svn_boolean_t fs_step_needed;
+
   /* If possible, we like to keep open the history object for each path,
      since it avoids needed to open and close it many times as we walk
      backwards in time.  To do so we need two pools, so that we can clear
@@ -431,7 +440,90 @@ struct path_info
   apr_pool_t *oldpool;
 };
 
+/* Check whether INFO->PATH in INFO->HISTORY_REV is readable using
+ * AUTHZ_READ_FUNC and AUTHZ_READ_BATON.  If it is not, set INFO->DONE.
+ */
+static svn_error_t *
+check_history_readable(struct path_info *info,
+                       svn_fs_t *fs,
+                       svn_repos_authz_func_t authz_read_func,
+                       void *authz_read_baton,
+                       apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *history_root;
+  svn_boolean_t readable;
+
+  SVN_ERR(svn_fs_revision_root(&history_root, fs,
+                               info->history_rev,
+                               scratch_pool));
+  SVN_ERR(authz_read_func(&readable, history_root,
+                          info->path->data,
+                          authz_read_baton,
+                          scratch_pool));
+  if (! readable)
+    info->done = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Like get_history() but use LOG_INDEX to find the next revision in which
+ * INFO->PATH or any node below it got changed, instead of walking the node
+ * history in the filesystem.
+ *
+ * This is only valid as long as neither INFO->PATH nor any of its parents
+ * got added or replaced since INFO->HISTORY_REV.  If the revision found
+ * is such a point, set INFO->FS_STEP_NEEDED.
+ */
+static svn_error_t *
+get_history_from_index(struct path_info *info,
+                       svn_fs_t *fs,
+                       svn_repos__log_index_t *log_index,
+                       svn_repos_authz_func_t authz_read_func,
+                       void *authz_read_baton,
+                       svn_revnum_t start,
+                       apr_pool_t *scratch_pool)
+{
+  svn_revnum_t end = info->history_rev;
+  svn_revnum_t revision;
+  svn_boolean_t added;
+
+  /* The first time around, the current revision itself may be of
+     interest.  Afterwards, it has already been reported. */
+  if (info->first_time)
+    info->first_time = FALSE;
+  else
+    --end;
+
+  if (end < start)
+    {
+      info->done = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_repos__log_index_prev_change(&revision, &added, log_index,
+                                           info->path->data, start, end,
+                                           scratch_pool));
+  if (! SVN_IS_VALID_REVNUM(revision))
+    {
+      info->done = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  info->history_rev = revision;
+  info->fs_step_needed = added;
+
+  /* Is the history item readable?  If not, done with path. */
+  if (authz_read_func)
+    SVN_ERR(check_history_readable(info, fs, authz_read_func,
+                                   authz_read_baton, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Advance to the next history for the path.
+ *
+ * If LOG_INDEX is not NULL, use it to find the next history location
+ * unless INFO->FS_STEP_NEEDED is set.
  *
  * If INFO->HIST is not NULL we do this using that existing history object,
  * otherwise we open a new one.
@@ -451,6 +543,7 @@ static svn_error_t *
 get_history(struct path_info *info,
             svn_fs_t *fs,
             svn_boolean_t strict,
+            svn_repos__log_index_t *log_index,
             svn_repos_authz_func_t authz_read_func,
             void *authz_read_baton,
             svn_revnum_t start,
@@ -462,6 +555,13 @@ get_history(struct path_info *info,
   apr_pool_t *subpool;
   const char *path;
 
+  if (log_index && ! info->fs_step_needed)
+    return svn_error_trace(get_history_from_index(info, fs, log_index,
+                                                  authz_read_func,
+                                                  authz_read_baton,
+                                                  start, scratch_pool));
+
+  info->fs_step_needed = FALSE;
   if (info->hist)
     {
       subpool = info->newpool;
@@ -520,18 +620,8 @@ get_history(struct path_info *info,
 
   /* Is the history item readable?  If not, done with path. */
   if (authz_read_func)
-    {
-      svn_boolean_t readable;
-      SVN_ERR(svn_fs_revision_root(&history_root, fs,
-                                   info->history_rev,
-                                   scratch_pool));
-      SVN_ERR(authz_read_func(&readable, history_root,
-                              info->path->data,
-                              authz_read_baton,
-                              scratch_pool));
-      if (! readable)
-        info->done = TRUE;
-    }
+    SVN_ERR(check_history_readable(info, fs, authz_read_func,
+                                   authz_read_baton, scratch_pool));
 
   if (! info->hist)
     {
@@ -563,6 +653,7 @@ check_history(svn_boolean_t *changed,
               svn_fs_t *fs,
               svn_revnum_t current,
               svn_boolean_t strict,
+              svn_repos__log_index_t *log_index,
               svn_repos_authz_func_t authz_read_func,
               void *authz_read_baton,
               svn_revnum_t start,
@@ -585,7 +676,7 @@ check_history(svn_boolean_t *changed,
      then set *CHANGED to true and get the next history
      rev where this path was changed. */
   *changed = TRUE;
-  return get_history(info, fs, strict, authz_read_func,
+  return get_history(info, fs, strict, log_index, authz_read_func,
                      authz_read_baton, start, result_pool, scratch_pool);
 }
 
@@ -609,18 +700,15 @@ next_history_rev(const apr_array_header_t *histories)
   return next_rev;
 }
 
-/* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to
-   catalogs describing how mergeinfo values on paths (which are the
-   keys of those catalogs) were changed in REV. */
 /* ### TODO: This would make a *great*, useful public function,
    ### svn_repos_fs_mergeinfo_changed()!  -- cmpilato  */
-static svn_error_t *
-fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
-                     svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
-                     svn_fs_t *fs,
-                     svn_revnum_t rev,
-                     apr_pool_t *result_pool,
-                     apr_pool_t *scratch_pool)
+svn_error_t *
+svn_repos__mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+                             svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+                             svn_fs_t *fs,
+                             svn_revnum_t rev,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
 {
   svn_fs_root_t *root;
   apr_pool_t *iterpool, *iterator_pool;
@@ -877,11 +965,15 @@ fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
 
 /* Determine what (if any) mergeinfo for PATHS was modified in
    revision REV, returning the differences for added mergeinfo in
-   *ADDED_MERGEINFO and deleted mergeinfo in *DELETED_MERGEINFO. */
+   *ADDED_MERGEINFO and deleted mergeinfo in *DELETED_MERGEINFO.
+
+   If LOG_INDEX is not NULL and covers REV, take the per-revision
+   mergeinfo changes from it instead of scanning REV in FS. */
 static svn_error_t *
 get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
                                svn_mergeinfo_t *deleted_mergeinfo,
                                svn_fs_t *fs,
+                               svn_repos__log_index_t *log_index,
                                const apr_array_header_t *paths,
                                svn_revnum_t rev,
                                apr_pool_t *result_pool,
@@ -907,10 +999,16 @@ get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
     return SVN_NO_ERROR;
 
   /* Fetch the mergeinfo changes for REV. */
-  err = fs_mergeinfo_changed(&deleted_mergeinfo_catalog,
-                             &added_mergeinfo_catalog,
-                             fs, rev,
-                             scratch_pool, scratch_pool);
+  if (log_index && rev <= svn_repos__log_index_youngest(log_index))
+    err = svn_repos__log_index_mergeinfo_changed(&deleted_mergeinfo_catalog,
+                                                 &added_mergeinfo_catalog,
+                                                 log_index, rev,
+                                                 scratch_pool, scratch_pool);
+  else
+    err = svn_repos__mergeinfo_changed(&deleted_mergeinfo_catalog,
+                                       &added_mergeinfo_catalog,
+                                       fs, rev,
+                                       scratch_pool, scratch_pool);
   if (err)
     {
       if (err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
@@ -1390,7 +1488,10 @@ send_log(svn_revnum_t rev,
 /* Get the histories for PATHS, and store them in *HISTORIES.
 
    If IGNORE_MISSING_LOCATIONS is set, don't treat requests for bogus
-   repository locations as fatal -- just ignore them.  */
+   repository locations as fatal -- just ignore them.
+
+   If LOG_INDEX is not NULL, it covers HIST_END and will be used to follow
+   the histories; no history objects will be kept open in that case.  */
 static svn_error_t *
 get_path_histories(apr_array_header_t **histories,
                    svn_fs_t *fs,
@@ -1399,6 +1500,7 @@ get_path_histories(apr_array_header_t **histories,
                    svn_revnum_t hist_end,
                    svn_boolean_t strict_node_history,
                    svn_boolean_t ignore_missing_locations,
+                   svn_repos__log_index_t *log_index,
                    svn_repos_authz_func_t authz_read_func,
                    void *authz_read_baton,
                    apr_pool_t *pool)
@@ -1442,8 +1544,31 @@ get_path_histories(apr_array_header_t **histories,
       info->done = FALSE;
       info->history_rev = hist_end;
       info->first_time = TRUE;
+      info->fs_step_needed = FALSE;
+
+      if (log_index)
+        {
+          /* Without a history object, nobody checks that the path exists.
+             Do it here, reporting the same error as the FS would. */
+          svn_node_kind_t kind;
+
+          SVN_ERR(svn_fs_check_path(&kind, root, this_path, iterpool));
+          if (kind == svn_node_none)
+            {
+              if (ignore_missing_locations)
+                continue;
+
+              return svn_error_createf(SVN_ERR_FS_NOT_FOUND, NULL,
+                                       _("File not found: revision %ld, "
+                                         "path '%s'"),
+                                       hist_end, this_path);
+            }
 
-      if (i < MAX_OPEN_HISTORIES)
+          info->hist = NULL;
+          info->oldpool = NULL;
+          info->newpool = NULL;
+        }
+      else if (i < MAX_OPEN_HISTORIES)
         {
           err = svn_fs_node_history2(&info->hist, root, this_path, pool,
                                      iterpool);
@@ -1468,7 +1593,7 @@ get_path_histories(apr_array_header_t **histories,
         }
 
       err = get_history(info, fs,
-                        strict_node_history,
+                        strict_node_history, log_index,
                         authz_read_func, authz_read_baton,
                         hist_start, pool, iterpool);
       if (err
@@ -1991,6 +2116,7 @@ do_logs(svn_fs_t *fs,
   svn_revnum_t current;
   apr_array_header_t *histories;
   svn_boolean_t any_histories_left = TRUE;
+  svn_repos__log_index_t *log_index = NULL;
   int send_count = 0;
   int i;
 
@@ -2008,12 +2134,18 @@ do_logs(svn_fs_t *fs,
   if (processed)
     SVN_ERR(store_search(processed, paths, hist_start, hist_end, pool));
 
+  /* The log index can only be used if it covers the whole range. */
+  if (   callbacks->log_index
+      && hist_end <= svn_repos__log_index_youngest(callbacks->log_index))
+    log_index = callbacks->log_index;
+
   /* We have a list of paths and a revision range.  But we don't care
      about all the revisions in the range -- only the ones in which
      one of our paths was changed.  So let's go figure out which
      revisions contain real changes to at least one of our paths.  */
   SVN_ERR(get_path_histories(&histories, fs, paths, hist_start, hist_end,
                              strict_node_history, ignore_missing_locations,
+                             log_index,
                              callbacks->authz_read_func,
                              callbacks->authz_read_baton, pool));
 
@@ -2039,7 +2171,7 @@ do_logs(svn_fs_t *fs,
 
           /* Check history for this path in current rev. */
           SVN_ERR(check_history(&changed, info, fs, current,
-                                strict_node_history,
+                                strict_node_history, log_index,
                                 callbacks->authz_read_func,
                                 callbacks->authz_read_baton,
                                 hist_start, pool, iterpool2));
@@ -2075,7 +2207,9 @@ do_logs(svn_fs_t *fs,
                 }
               SVN_ERR(get_combined_mergeinfo_changes(&added_mergeinfo,
                                                      &deleted_mergeinfo,
-                                                     fs, cur_paths,
+                                                     fs,
+                                                     callbacks->log_index,
+                                                     cur_paths,
                                                      current,
                                                      iterpool, iterpool));
               has_children = (apr_hash_count(added_mergeinfo) > 0
@@ -2332,6 +2466,7 @@ svn_repos_get_logs5(svn_repos_t *repos,
   callbacks.revision_receiver_baton = revision_receiver_baton;
   callbacks.authz_read_func = authz_read_func;
   callbacks.authz_read_baton = authz_read_baton;
+  callbacks.log_index = NULL;
 
   if (revprops)
     {
@@ -2443,6 +2578,11 @@ svn_repos_get_logs5(svn_repos_t *repos,
       return SVN_NO_ERROR;
     }
 
+  /* Walking node histories is the expensive part from here on.  Use the
+     log index to speed it up, if the repository has one. */
+  SVN_ERR(svn_repos__log_index_open(&callbacks.log_index, repos,
+                                    scratch_pool, scratch_pool));
+
   /* If we are including merged revisions, then create mergeinfo that
      represents all of PATHS' history between START and END.  We will use
      this later to squelch duplicate log revisions that might exist in
@@ -387,6 +387,91 @@ svn_repos__prev_location(svn_revnum_t *appeared_rev,
                          const char *path,
                          apr_pool_t *pool);
 
+/* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to
+   catalogs describing how mergeinfo values on paths (which are the
+   keys of those catalogs) were changed in REV in FS.  Allocate the
+   catalogs in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_repos__mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+                             svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+                             svn_fs_t *fs,
+                             svn_revnum_t rev,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+
+/*** Log index ***/
+
+/* The name of the optional log index database within the repository's
+   db directory. */
+#define SVN_REPOS__LOG_INDEX_DB_NAME "log-index.db"
+
+/* An open, read-only handle to the log index of a repository. */
+typedef struct svn_repos__log_index_t svn_repos__log_index_t;
+
+/* Set *INDEX_P to a read-only handle to the log index of REPOS, allocated
+   in RESULT_POOL.  If REPOS does not have a log index or if that index
+   claims to cover revisions not present in REPOS, set *INDEX_P to NULL.
+
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index_p,
+                          svn_repos_t *repos,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Return the youngest revision covered by INDEX. */
+svn_revnum_t
+svn_repos__log_index_youngest(const svn_repos__log_index_t *index);
+
+/* Set *REVISION to the youngest revision between START and END inclusive,
+   in which PATH or any node below it got changed, or in which PATH or any
+   of its parents got added or replaced.  If there is no such revision, set
+   *REVISION to SVN_INVALID_REVNUM.
+
+   Set *ADDED to TRUE, if PATH or any of its parents got added or replaced
+   in *REVISION, i.e. if PATH's node history may continue at a different
+   path or end there.  Set it to FALSE otherwise.
+
+   END must not exceed svn_repos__log_index_youngest() for INDEX.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_prev_change(svn_revnum_t *revision,
+                                 svn_boolean_t *added,
+                                 svn_repos__log_index_t *index,
+                                 const char *path,
+                                 svn_revnum_t start,
+                                 svn_revnum_t end,
+                                 apr_pool_t *scratch_pool);
+
+/* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to the
+   mergeinfo changes recorded in INDEX for REVISION, as they would have
+   been returned by svn_repos__mergeinfo_changed().  Revisions whose
+   mergeinfo could not be parsed are recorded as not changing any
+   mergeinfo.
+
+   REVISION must not exceed svn_repos__log_index_youngest() for INDEX.
+   Allocate the catalogs in RESULT_POOL and use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_repos__log_index_mergeinfo_changed(
+  svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+  svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+  svn_repos__log_index_t *index,
+  svn_revnum_t revision,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool);
+
+/* If REPOS has a log index, add all revisions up to and including
+   REVISION to it that have not been indexed yet.  Otherwise, do nothing.
+   Revisions younger than REVISION that are already in the index, e.g.
+   added by a concurrent commit, will be kept.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_update(svn_repos_t *repos,
+                            svn_revnum_t revision,
+                            apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -23,6 +23,8 @@
 
 #include <assert.h>
 
+#include "svn_io.h"
+
 #include "private/svn_subr_private.h"
 
 #include "svn_private_config.h"
@@ -127,6 +129,208 @@ svn__decompress_lz4(const void *data, apr_size_t len,
   return SVN_NO_ERROR;
 }
 
+
+/* Size of the uncompressed blocks used by svn__stream_compressed_lz4(). */
+#define LZ4_STREAM_BLOCK_SIZE 0x10000
+
+/* Baton for svn__stream_compressed_lz4(). */
+typedef struct lz4_baton_t
+{
+  /* The stream we read compressed data from or write it to. */
+  svn_stream_t *substream;
+
+  /* Uncompressed data: the pending part of the current block when
+     writing, the current block when reading. */
+  svn_stringbuf_t *plain;
+
+  /* Read position within PLAIN. */
+  apr_size_t plain_pos;
+
+  /* Buffer for the compressed form of the current block. */
+  svn_stringbuf_t *packed;
+
+  /* Whether data has been written to the stream. */
+  svn_boolean_t writing;
+} lz4_baton_t;
+
+/* Compress the LEN bytes at DATA as a single block and write it to the
+ * substream of BATON. */
+static svn_error_t *
+write_block_lz4(lz4_baton_t *baton,
+                const char *data,
+                apr_size_t len)
+{
+  unsigned char header[SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t header_len;
+  apr_size_t packed_len;
+
+  SVN_ERR(svn__compress_lz4(data, len, baton->packed));
+
+  header_len = svn__encode_uint(header, baton->packed->len) - header;
+  packed_len = baton->packed->len;
+  SVN_ERR(svn_stream_write(baton->substream, (const char *)header,
+                           &header_len));
+  SVN_ERR(svn_stream_write(baton->substream, baton->packed->data,
+                           &packed_len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t. */
+static svn_error_t *
+write_handler_lz4(void *baton, const char *data, apr_size_t *len)
+{
+  lz4_baton_t *btn = baton;
+  apr_size_t remaining = *len;
+
+  btn->writing = TRUE;
+  while (remaining > 0)
+    {
+      if (btn->plain->len == 0 && remaining >= LZ4_STREAM_BLOCK_SIZE)
+        {
+          /* Full blocks don't need to be copied to PLAIN first. */
+          SVN_ERR(write_block_lz4(btn, data, LZ4_STREAM_BLOCK_SIZE));
+          data += LZ4_STREAM_BLOCK_SIZE;
+          remaining -= LZ4_STREAM_BLOCK_SIZE;
+        }
+      else
+        {
+          apr_size_t to_copy = LZ4_STREAM_BLOCK_SIZE - btn->plain->len;
+          if (to_copy > remaining)
+            to_copy = remaining;
+
+          svn_stringbuf_appendbytes(btn->plain, data, to_copy);
+          data += to_copy;
+          remaining -= to_copy;
+
+          if (btn->plain->len == LZ4_STREAM_BLOCK_SIZE)
+            {
+              SVN_ERR(write_block_lz4(btn, btn->plain->data,
+                                      btn->plain->len));
+              svn_stringbuf_setempty(btn->plain);
+            }
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the next block from the substream of BTN and decompress it into
+ * BTN->PLAIN.  Leave BTN->PLAIN empty at the end of the stream. */
+static svn_error_t *
+read_block_lz4(lz4_baton_t *btn)
+{
+  unsigned char header[SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t header_len = 0;
+  apr_uint64_t packed_len;
+  apr_size_t len;
+
+  svn_stringbuf_setempty(btn->plain);
+  btn->plain_pos = 0;
+
+  /* Read the variable-length block size, one byte at a time. */
+  do
+    {
+      if (header_len == sizeof(header))
+        return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA,
+                                NULL, _("Invalid LZ4 block header"));
+
+      len = 1;
+      SVN_ERR(svn_stream_read_full(btn->substream,
+                                   (char *)header + header_len, &len));
+      if (len == 0)
+        {
+          if (header_len == 0)
+            return SVN_NO_ERROR;
+
+          return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
+                                  _("Unexpected end of LZ4 stream"));
+        }
+    }
+  while (header[header_len++] & 0x80);
+
+  svn__decode_uint(&packed_len, header, header + header_len);
+  if (packed_len > LZ4_STREAM_BLOCK_SIZE + SVN__MAX_ENCODED_UINT_LEN)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Invalid LZ4 block size"));
+
+  len = (apr_size_t)packed_len;
+  svn_stringbuf_ensure(btn->packed, len);
+  SVN_ERR(svn_stream_read_full(btn->substream, btn->packed->data, &len));
+  if (len != packed_len)
+    return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
+                            _("Unexpected end of LZ4 stream"));
+
+  return svn_error_trace(svn__decompress_lz4(btn->packed->data, len,
+                                             btn->plain,
+                                             LZ4_STREAM_BLOCK_SIZE));
+}
+
+/* Implements svn_read_fn_t. */
+static svn_error_t *
+read_handler_lz4(void *baton, char *buffer, apr_size_t *len)
+{
+  lz4_baton_t *btn = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining > 0)
+    {
+      apr_size_t to_copy;
+
+      if (btn->plain_pos == btn->plain->len)
+        {
+          SVN_ERR(read_block_lz4(btn));
+          if (btn->plain->len == 0)
+            break;
+        }
+
+      to_copy = btn->plain->len - btn->plain_pos;
+      if (to_copy > remaining)
+        to_copy = remaining;
+
+      memcpy(buffer, btn->plain->data + btn->plain_pos, to_copy);
+      btn->plain_pos += to_copy;
+      buffer += to_copy;
+      remaining -= to_copy;
+    }
+
+  *len -= remaining;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t. */
+static svn_error_t *
+close_handler_lz4(void *baton)
+{
+  lz4_baton_t *btn = baton;
+
+  /* Flush the last, partial block. */
+  if (btn->writing && btn->plain->len > 0)
+    SVN_ERR(write_block_lz4(btn, btn->plain->data, btn->plain->len));
+
+  return svn_error_trace(svn_stream_close(btn->substream));
+}
+
+svn_stream_t *
+svn__stream_compressed_lz4(svn_stream_t *stream,
+                           apr_pool_t *pool)
+{
+  lz4_baton_t *baton = apr_pcalloc(pool, sizeof(*baton));
+  svn_stream_t *lz4_stream;
+
+  baton->substream = stream;
+  baton->plain = svn_stringbuf_create_ensure(LZ4_STREAM_BLOCK_SIZE, pool);
+  baton->packed = svn_stringbuf_create_empty(pool);
+
+  lz4_stream = svn_stream_create(baton, pool);
+  svn_stream_set_read2(lz4_stream, NULL /* only full read support */,
+                       read_handler_lz4);
+  svn_stream_set_write(lz4_stream, write_handler_lz4);
+  svn_stream_set_close(lz4_stream, close_handler_lz4);
+
+  return lz4_stream;
+}
+
 const char *
 svn_lz4__compiled_version(void)
 {
@@ -1554,6 +1554,32 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### returning an error.  The default is 10000, i.e. 10 seconds."    NL
         "### Longer values may be useful when exclusive locking is enabled." NL
         "# busy-timeout = 10000"                                             NL
+        "### Set the number of threads used to install files from the"       NL
+        "### pristine store into the working copy, e.g. during checkout"     NL
+        "### and update.  The default is 1, i.e. files get installed one"    NL
+        "### after another.  Larger values may speed up checkouts on fast"   NL
+        "### storage.  This has no effect on platforms without thread"       NL
+        "### support."                                                       NL
+        "# install-threads = 1"                                              NL
+        "### Set the directory of a pristine store shared by all working"    NL
+        "### copies on this file system.  Pristine texts are then stored"    NL
+        "### only once and hard linked into each working copy, and a text"   NL
+        "### is deleted from the shared store when no working copy links"    NL
+        "### to it any more.  Working copies on a different file system"     NL
+        "### keep private copies of their pristine texts."                   NL
+        "# shared-pristine-store = /home/user/.subversion/pristine"          NL
+        "### Set this to 'yes' to store new pristine texts"                  NL
+        "### compressed with LZ4, roughly halving the disk space used"       NL
+        "### by typical source code in '.svn/pristine'.  This only"          NL
+        "### applies to working copies that were upgraded with"              NL
+        "### 'svn upgrade' while the option was set; older clients"          NL
+        "### cannot use such working copies.  Texts that external"           NL
+        "### tools need to access as a file, e.g. for merging, are"          NL
+        "### decompressed into temporary files on demand.  Pristine"         NL
+        "### texts stored before the upgrade are not converted, and"         NL
+        "### compressed texts are never shared through the"                  NL
+        "### shared-pristine-store.  The default is 'no'."                   NL
+        "# compress-pristines = no"                                          NL
         ;
 
       err = svn_io_file_open(&f, path,
@@ -69,6 +69,11 @@
 #include "private/svn_utf_private.h"
 #include "private/svn_dep_compat.h"
 
+#ifdef HAVE_LINUX_FS_H
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
 #define SVN_SLEEP_ENV_VAR "SVN_I_LOVE_CORRUPTED_WORKING_COPIES_SO_DISABLE_SLEEP_FOR_TIMESTAMPS"
 
 /*
@@ -870,6 +875,63 @@ copy_contents(apr_file_t *from_file,
 }
 
 
+svn_error_t *
+svn_io__file_link(const char *from_path,
+                  const char *to_path,
+                  apr_pool_t *scratch_pool)
+{
+  apr_status_t status;
+  const char *from_path_apr, *to_path_apr;
+
+  SVN_ERR(cstring_from_utf8(&from_path_apr, from_path, scratch_pool));
+  SVN_ERR(cstring_from_utf8(&to_path_apr, to_path, scratch_pool));
+
+  status = apr_file_link(from_path_apr, to_path_apr);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't link '%s' to '%s'"),
+                              svn_dirent_local_style(to_path, scratch_pool),
+                              svn_dirent_local_style(from_path,
+                                                     scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_io__file_clone(svn_boolean_t *cloned,
+                   apr_file_t *dst_file,
+                   apr_file_t *src_file,
+                   apr_pool_t *scratch_pool)
+{
+#if defined(HAVE_LINUX_FS_H) && defined(FICLONE)
+  apr_os_file_t src_fd;
+  apr_os_file_t dst_fd;
+  int rv;
+
+  SVN_ERR(svn_io_file_flush(dst_file, scratch_pool));
+
+  if (apr_os_file_get(&src_fd, src_file)
+      || apr_os_file_get(&dst_fd, dst_file))
+    {
+      *cloned = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  do
+    rv = ioctl(dst_fd, FICLONE, src_fd);
+  while (rv == -1 && errno == EINTR);
+
+  /* Any failure, most likely EOPNOTSUPP or EXDEV, leaves DST_FILE as it
+     was and the caller will simply copy the data. */
+  *cloned = (rv == 0);
+#else
+  *cloned = FALSE;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_io_copy_file(const char *src,
                  const char *dst,
@@ -22,6 +22,7 @@
  */
 #include <assert.h>
 #include <ctype.h>
+#include <string.h>
 
 #include "svn_path.h"
 #include "svn_types.h"
@@ -968,6 +969,282 @@ dual_dump(const char *prefix,
 }
 #endif
 
+/*** Compact rangelists ***/
+
+/* Rangelists with at least this many ranges in total get merged,
+   intersected etc. via svn_rangelist__compact_t.  Below that, the
+   per-range allocations of the classic implementation don't matter. */
+#define COMPACT_RANGELIST_THRESHOLD 64
+
+svn_rangelist__compact_t *
+svn_rangelist__compact_create(int nalloc,
+                              apr_pool_t *result_pool)
+{
+  svn_rangelist__compact_t *compact = apr_palloc(result_pool,
+                                                 sizeof(*compact));
+
+  nalloc = MAX(nalloc, 4);
+  compact->nelts = 0;
+  compact->nalloc = nalloc;
+  compact->start = apr_palloc(result_pool, nalloc * sizeof(svn_revnum_t));
+  compact->end = apr_palloc(result_pool, nalloc * sizeof(svn_revnum_t));
+  compact->inheritable = apr_palloc(result_pool,
+                                    nalloc * sizeof(svn_boolean_t));
+  compact->pool = result_pool;
+
+  return compact;
+}
+
+/* Append the range START to END with inheritability INHERITABLE to
+   COMPACT.  START must not be smaller than the end of the last range in
+   COMPACT.  If the new range adjoins the last one and COMBINE_ALL is TRUE
+   or both have the same inheritability, extend the last range instead;
+   the result is inheritable if either of them is. */
+static void
+compact_append(svn_rangelist__compact_t *compact,
+               svn_revnum_t start,
+               svn_revnum_t end,
+               svn_boolean_t inheritable,
+               svn_boolean_t combine_all)
+{
+  int last = compact->nelts - 1;
+
+  if (   last >= 0
+      && compact->end[last] == start
+      && (combine_all || compact->inheritable[last] == inheritable))
+    {
+      compact->end[last] = end;
+      compact->inheritable[last] |= inheritable;
+      return;
+    }
+
+  if (compact->nelts == compact->nalloc)
+    {
+      int nalloc = 2 * compact->nalloc;
+      svn_revnum_t *new_start
+        = apr_palloc(compact->pool, nalloc * sizeof(svn_revnum_t));
+      svn_revnum_t *new_end
+        = apr_palloc(compact->pool, nalloc * sizeof(svn_revnum_t));
+      svn_boolean_t *new_inheritable
+        = apr_palloc(compact->pool, nalloc * sizeof(svn_boolean_t));
+
+      memcpy(new_start, compact->start,
+             compact->nelts * sizeof(svn_revnum_t));
+      memcpy(new_end, compact->end, compact->nelts * sizeof(svn_revnum_t));
+      memcpy(new_inheritable, compact->inheritable,
+             compact->nelts * sizeof(svn_boolean_t));
+
+      compact->start = new_start;
+      compact->end = new_end;
+      compact->inheritable = new_inheritable;
+      compact->nalloc = nalloc;
+    }
+
+  compact->start[compact->nelts] = start;
+  compact->end[compact->nelts] = end;
+  compact->inheritable[compact->nelts] = inheritable;
+  compact->nelts++;
+}
+
+svn_error_t *
+svn_rangelist__compact_from_rangelist(svn_rangelist__compact_t **compact,
+                                      const svn_rangelist_t *rangelist,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool)
+{
+  svn_rangelist__compact_t *result;
+  int i;
+
+  if (!svn_rangelist__is_canonical(rangelist))
+    {
+      svn_rangelist_t *canonical = svn_rangelist_dup(rangelist, scratch_pool);
+      SVN_ERR(svn_rangelist__canonicalize(canonical, scratch_pool));
+      rangelist = canonical;
+    }
+
+  result = svn_rangelist__compact_create(rangelist->nelts, result_pool);
+  for (i = 0; i < rangelist->nelts; ++i)
+    {
+      const svn_merge_range_t *range
+        = APR_ARRAY_IDX(rangelist, i, const svn_merge_range_t *);
+
+      result->start[i] = range->start;
+      result->end[i] = range->end;
+      result->inheritable[i] = range->inheritable;
+    }
+  result->nelts = rangelist->nelts;
+
+  *compact = result;
+  return SVN_NO_ERROR;
+}
+
+/* Replace the contents of RANGELIST with COMPACT.  The new elements are
+   allocated in RESULT_POOL as a single block. */
+static void
+compact_to_rangelist(svn_rangelist_t *rangelist,
+                     const svn_rangelist__compact_t *compact,
+                     apr_pool_t *result_pool)
+{
+  svn_merge_range_t *ranges
+    = apr_palloc(result_pool, MAX(compact->nelts, 1) * sizeof(*ranges));
+  int i;
+
+  rangelist->nelts = 0;
+  for (i = 0; i < compact->nelts; ++i)
+    {
+      ranges[i].start = compact->start[i];
+      ranges[i].end = compact->end[i];
+      ranges[i].inheritable = compact->inheritable[i];
+      APR_ARRAY_PUSH(rangelist, svn_merge_range_t *) = &ranges[i];
+    }
+}
+
+svn_rangelist_t *
+svn_rangelist__compact_to_rangelist(const svn_rangelist__compact_t *compact,
+                                    apr_pool_t *result_pool)
+{
+  svn_rangelist_t *rangelist
+    = apr_array_make(result_pool, compact->nelts,
+                     sizeof(svn_merge_range_t *));
+
+  compact_to_rangelist(rangelist, compact, result_pool);
+  return rangelist;
+}
+
+/* The set operations supported by compact_combine(). */
+typedef enum compact_op_t
+{
+  compact_op_merge,
+  compact_op_intersect,
+  compact_op_remove
+} compact_op_t;
+
+/* Set *OUTPUT to the result of applying OP to the compact rangelists
+   LHS and RHS, allocated in RESULT_POOL.  For compact_op_remove, LHS is
+   the eraser and RHS the whiteboard.
+
+   We sweep over both inputs in parallel, cutting them into segments
+   that are either fully covered by a range of LHS, RHS or both, or by
+   neither.  Each segment is then kept or dropped and gets its
+   inheritability according to OP. */
+static void
+compact_combine(svn_rangelist__compact_t **output,
+                const svn_rangelist__compact_t *lhs,
+                const svn_rangelist__compact_t *rhs,
+                compact_op_t op,
+                apr_pool_t *result_pool)
+{
+  svn_rangelist__compact_t *result
+    = svn_rangelist__compact_create(op == compact_op_intersect
+                                      ? MIN(lhs->nelts, rhs->nelts)
+                                      : lhs->nelts + rhs->nelts,
+                                    result_pool);
+  svn_boolean_t combine_all = (op != compact_op_merge);
+  svn_revnum_t pos = SVN_INVALID_REVNUM;
+  int i = 0, j = 0;
+
+  while (i < lhs->nelts || j < rhs->nelts)
+    {
+      svn_boolean_t in_lhs = FALSE, in_rhs = FALSE;
+      svn_revnum_t lhs_start = SVN_INVALID_REVNUM;
+      svn_revnum_t rhs_start = SVN_INVALID_REVNUM;
+      svn_revnum_t seg_start, seg_end;
+
+      /* Where do the remainders of the current ranges begin? */
+      if (i < lhs->nelts)
+        lhs_start = MAX(lhs->start[i], pos);
+      if (j < rhs->nelts)
+        rhs_start = MAX(rhs->start[j], pos);
+
+      if (i >= lhs->nelts)
+        seg_start = rhs_start;
+      else if (j >= rhs->nelts)
+        seg_start = lhs_start;
+      else
+        seg_start = MIN(lhs_start, rhs_start);
+
+      /* The segment ends at the next range boundary of either side. */
+      seg_end = SVN_INVALID_REVNUM;
+      if (i < lhs->nelts)
+        {
+          in_lhs = (lhs_start == seg_start);
+          seg_end = in_lhs ? lhs->end[i] : lhs_start;
+        }
+      if (j < rhs->nelts)
+        {
+          svn_revnum_t boundary;
+
+          in_rhs = (rhs_start == seg_start);
+          boundary = in_rhs ? rhs->end[j] : rhs_start;
+          seg_end = SVN_IS_VALID_REVNUM(seg_end) ? MIN(seg_end, boundary)
+                                                 : boundary;
+        }
+
+      switch (op)
+        {
+          case compact_op_merge:
+            compact_append(result, seg_start, seg_end,
+                           (in_lhs && lhs->inheritable[i])
+                           || (in_rhs && rhs->inheritable[j]),
+                           combine_all);
+            break;
+
+          case compact_op_intersect:
+            if (in_lhs && in_rhs)
+              compact_append(result, seg_start, seg_end,
+                             lhs->inheritable[i] || rhs->inheritable[j],
+                             combine_all);
+            break;
+
+          case compact_op_remove:
+            if (in_rhs && !in_lhs)
+              compact_append(result, seg_start, seg_end,
+                             rhs->inheritable[j], combine_all);
+            break;
+        }
+
+      /* Advance past all ranges that end within the segment. */
+      pos = seg_end;
+      if (i < lhs->nelts && lhs->end[i] <= pos)
+        ++i;
+      if (j < rhs->nelts && rhs->end[j] <= pos)
+        ++j;
+    }
+
+  *output = result;
+}
+
+void
+svn_rangelist__compact_merge(svn_rangelist__compact_t **output,
+                             const svn_rangelist__compact_t *rangelist1,
+                             const svn_rangelist__compact_t *rangelist2,
+                             apr_pool_t *result_pool)
+{
+  compact_combine(output, rangelist1, rangelist2, compact_op_merge,
+                  result_pool);
+}
+
+void
+svn_rangelist__compact_intersect(svn_rangelist__compact_t **output,
+                                 const svn_rangelist__compact_t *rangelist1,
+                                 const svn_rangelist__compact_t *rangelist2,
+                                 apr_pool_t *result_pool)
+{
+  compact_combine(output, rangelist1, rangelist2, compact_op_intersect,
+                  result_pool);
+}
+
+void
+svn_rangelist__compact_remove(svn_rangelist__compact_t **output,
+                              const svn_rangelist__compact_t *eraser,
+                              const svn_rangelist__compact_t *whiteboard,
+                              apr_pool_t *result_pool)
+{
+  compact_combine(output, eraser, whiteboard, compact_op_remove,
+                  result_pool);
+}
+
+
 svn_error_t *
 svn_rangelist_merge2(svn_rangelist_t *rangelist,
                      const svn_rangelist_t *chg,
@@ -980,6 +1257,25 @@ svn_rangelist_merge2(svn_rangelist_t *rangelist,
 
   SVN_ERR(svn_rangelist__canonicalize(rangelist, scratch_pool));
 
+  /* For long rangelists, avoid the per-range allocations and array
+     insertions below and do a single linear merge instead. */
+  if (rangelist->nelts + chg->nelts >= COMPACT_RANGELIST_THRESHOLD)
+    {
+      svn_rangelist__compact_t *compact_rangelist, *compact_changes;
+
+      SVN_ERR(svn_rangelist__compact_from_rangelist(&compact_rangelist,
+                                                    rangelist, scratch_pool,
+                                                    scratch_pool));
+      SVN_ERR(svn_rangelist__compact_from_rangelist(&compact_changes, chg,
+                                                    scratch_pool,
+                                                    scratch_pool));
+      svn_rangelist__compact_merge(&compact_rangelist, compact_rangelist,
+                                   compact_changes, scratch_pool);
+      compact_to_rangelist(rangelist, compact_rangelist, result_pool);
+
+      return SVN_NO_ERROR;
+    }
+
   /* We may modify CHANGES, so make a copy in SCRATCH_POOL. */
   changes = svn_rangelist_dup(chg, scratch_pool);
   SVN_ERR(svn_rangelist__canonicalize(changes, scratch_pool));
@@ -1381,6 +1677,35 @@ rangelist_intersect_or_remove(svn_rangelist_t **output,
   int i1, i2, lasti2;
   svn_merge_range_t working_elt2;
 
+  /* Without inheritance to consider, long canonical rangelists can be
+     processed in a single linear pass. */
+  if (   !consider_inheritance
+      && rangelist1->nelts + rangelist2->nelts >= COMPACT_RANGELIST_THRESHOLD
+      && svn_rangelist__is_canonical(rangelist1)
+      && svn_rangelist__is_canonical(rangelist2))
+    {
+      apr_pool_t *scratch_pool = svn_pool_create(pool);
+      svn_rangelist__compact_t *compact1, *compact2, *result;
+
+      SVN_ERR(svn_rangelist__compact_from_rangelist(&compact1, rangelist1,
+                                                    scratch_pool,
+                                                    scratch_pool));
+      SVN_ERR(svn_rangelist__compact_from_rangelist(&compact2, rangelist2,
+                                                    scratch_pool,
+                                                    scratch_pool));
+      if (do_remove)
+        svn_rangelist__compact_remove(&result, compact1, compact2,
+                                      scratch_pool);
+      else
+        svn_rangelist__compact_intersect(&result, compact1, compact2,
+                                         scratch_pool);
+
+      *output = svn_rangelist__compact_to_rangelist(result, pool);
+      svn_pool_destroy(scratch_pool);
+
+      return SVN_NO_ERROR;
+    }
+
   *output = apr_array_make(pool, 1, sizeof(svn_merge_range_t *));
 
   i1 = 0;
@@ -2699,17 +3024,43 @@ svn_rangelist__merge_many(svn_rangelist_t *merged_rangelist,
     {
       apr_pool_t *iterpool = svn_pool_create(scratch_pool);
       apr_hash_index_t *hi;
+      svn_rangelist__compact_t *merged;
+
+      /* Accumulate everything in a compact rangelist and convert back
+         only once at the end.  MERGED alternates between two pools. */
+      apr_pool_t *merged_pool = svn_pool_create(scratch_pool);
+      apr_pool_t *next_pool = svn_pool_create(scratch_pool);
+
+      SVN_ERR(svn_rangelist__canonicalize(merged_rangelist, scratch_pool));
+      SVN_ERR(svn_rangelist__compact_from_rangelist(&merged,
+                                                    merged_rangelist,
+                                                    merged_pool,
+                                                    scratch_pool));
 
       for (hi = apr_hash_first(scratch_pool, merge_history);
            hi;
            hi = apr_hash_next(hi))
         {
           svn_rangelist_t *subtree_rangelist = apr_hash_this_val(hi);
+          svn_rangelist__compact_t *subtree;
+          apr_pool_t *tmp_pool;
 
           svn_pool_clear(iterpool);
-          SVN_ERR(svn_rangelist_merge2(merged_rangelist, subtree_rangelist,
-                                       result_pool, iterpool));
+          svn_pool_clear(next_pool);
+          SVN_ERR(svn_rangelist__compact_from_rangelist(&subtree,
+                                                        subtree_rangelist,
+                                                        iterpool, iterpool));
+          svn_rangelist__compact_merge(&merged, merged, subtree, next_pool);
+
+          tmp_pool = merged_pool;
+          merged_pool = next_pool;
+          next_pool = tmp_pool;
         }
+
+      compact_to_rangelist(merged_rangelist, merged, result_pool);
+
+      svn_pool_destroy(next_pool);
+      svn_pool_destroy(merged_pool);
       svn_pool_destroy(iterpool);
     }
   return SVN_NO_ERROR;
@@ -261,6 +261,10 @@ struct edit_baton
   /* After closing the root directory a copy of its edited value */
   svn_boolean_t edited;
 
+  /* Whether this edit collects its DB changes in a bulk operation, see
+     svn_wc__db_bulk_begin(). */
+  svn_boolean_t bulk;
+
   apr_pool_t *pool;
 };
 
@@ -480,6 +484,14 @@ cleanup_edit_baton(void *edit_baton)
   err = svn_wc__wq_run(eb->db, eb->wcroot_abspath,
                        NULL /* cancel_func */, NULL /* cancel_baton */,
                        pool);
+  if (eb->bulk)
+    {
+      eb->bulk = FALSE;
+      err = svn_error_compose_create(err,
+                                     svn_wc__db_bulk_end(eb->db,
+                                                         eb->wcroot_abspath,
+                                                         pool));
+    }
 
   if (err)
     {
@@ -490,6 +502,29 @@ cleanup_edit_baton(void *edit_baton)
   return APR_SUCCESS;
 }
 
+/* Run the work queue for WRI_ABSPATH in the edit of EB.  In bulk mode,
+   only do that once the bulk operation has collected enough changes, so
+   that it doesn't get committed after every directory.  */
+static svn_error_t *
+run_work_queue(struct edit_baton *eb,
+               const char *wri_abspath,
+               apr_pool_t *scratch_pool)
+{
+  if (eb->bulk)
+    {
+      svn_boolean_t full;
+
+      SVN_ERR(svn_wc__db_bulk_is_full(&full, eb->db, wri_abspath,
+                                      scratch_pool));
+      if (! full)
+        return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_wc__wq_run(eb->db, wri_abspath,
+                                        eb->cancel_func, eb->cancel_baton,
+                                        scratch_pool));
+}
+
 /* Calculate the new repos_relpath for a directory or file */
 static svn_error_t *
 calculate_repos_relpath(const char **new_repos_relpath,
@@ -1169,6 +1204,16 @@ open_root(void *edit_baton,
      edit run. */
   eb->root_opened = TRUE;
 
+  /* Collect our DB changes in a few large transactions, instead of
+     committing every node on its own.  A conflict resolver might want to
+     change the working copy through a DB handle of its own, though, which
+     would be locked out by that.  */
+  if (! eb->conflict_func && ! eb->bulk)
+    {
+      SVN_ERR(svn_wc__db_bulk_begin(eb->db, eb->wcroot_abspath, pool));
+      eb->bulk = TRUE;
+    }
+
   SVN_ERR(make_dir_baton(&db, NULL, eb, NULL, FALSE, pool));
   *dir_baton = db;
 
@@ -1803,6 +1848,8 @@ delete_entry(const char *path,
         }
     }
 
+  /* Always run the queue here, even in bulk mode: a replacement or an
+     obstruction check that follows needs the node gone from disk.  */
   SVN_ERR(svn_wc__wq_run(eb->db, pb->local_abspath,
                          eb->cancel_func, eb->cancel_baton,
                          scratch_pool));
@@ -2808,9 +2855,7 @@ close_directory(void *dir_baton,
     }
 
   /* Process all of the queued work items for this directory.  */
-  SVN_ERR(svn_wc__wq_run(eb->db, db->local_abspath,
-                         eb->cancel_func, eb->cancel_baton,
-                         scratch_pool));
+  SVN_ERR(run_work_queue(eb, db->local_abspath, scratch_pool));
 
   if (db->parent_baton)
     svn_hash_sets(db->parent_baton->not_present_nodes, db->name, NULL);
@@ -4635,6 +4680,10 @@ close_file(void *file_baton,
       eb->notify_func(eb->notify_baton, notify, scratch_pool);
     }
 
+  /* Large directories shouldn't make the bulk operation grow unbounded. */
+  if (eb->bulk)
+    SVN_ERR(run_work_queue(eb, eb->wcroot_abspath, scratch_pool));
+
   svn_pool_destroy(fb->pool); /* Destroy scratch_pool */
 
   /* We have one less referrer to the directory */
@@ -4723,6 +4772,7 @@ close_edit(void *edit_baton,
 {
   struct edit_baton *eb = edit_baton;
   apr_pool_t *scratch_pool = eb->pool;
+  svn_error_t *err;
 
   /* The editor didn't even open the root; we have to take care of
      some cleanup stuffs. */
@@ -4838,9 +4888,18 @@ close_edit(void *edit_baton,
      cleanup at the end of this function. */
   apr_pool_cleanup_kill(eb->pool, eb, cleanup_edit_baton);
 
-  SVN_ERR(svn_wc__wq_run(eb->db, eb->wcroot_abspath,
-                         eb->cancel_func, eb->cancel_baton,
-                         eb->pool));
+  err = svn_wc__wq_run(eb->db, eb->wcroot_abspath,
+                       eb->cancel_func, eb->cancel_baton,
+                       eb->pool);
+  if (eb->bulk)
+    {
+      eb->bulk = FALSE;
+      err = svn_error_compose_create(err,
+                                     svn_wc__db_bulk_end(eb->db,
+                                                         eb->wcroot_abspath,
+                                                         eb->pool));
+    }
+  SVN_ERR(err);
 
   /* The edit is over, free its pool.
      ### No, this is wrong.  Who says this editor/baton won't be used
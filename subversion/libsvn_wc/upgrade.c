@@ -1425,6 +1425,15 @@ bump_to_31(void *baton,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+bump_to_32(void *baton,
+           svn_sqlite__db_t *sdb,
+           apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_sqlite__exec_statements(sdb, STMT_UPGRADE_TO_32));
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 upgrade_apply_dav_cache(svn_sqlite__db_t *sdb,
                         const char *dir_relpath,
@@ -1633,6 +1642,7 @@ svn_wc__upgrade_sdb(int *result_format,
                     const char *wcroot_abspath,
                     svn_sqlite__db_t *sdb,
                     int start_format,
+                    svn_boolean_t compress_pristines,
                     apr_pool_t *scratch_pool)
 {
   struct bump_baton bb;
@@ -1696,8 +1706,18 @@ svn_wc__upgrade_sdb(int *result_format,
         /* FALLTHROUGH  */
 #endif
       case SVN_WC__VERSION:
+        /* Only go to the optional format when explicitly asked to. */
+        if (compress_pristines)
+          SVN_ERR(svn_sqlite__with_transaction(sdb, bump_to_32, &bb,
+                                               scratch_pool));
+        /* FALLTHROUGH  */
+      case SVN_WC__COMPRESSED_PRISTINES:
         /* already upgraded */
-        *result_format = SVN_WC__VERSION;
+        if (compress_pristines
+            || start_format == SVN_WC__COMPRESSED_PRISTINES)
+          *result_format = SVN_WC__COMPRESSED_PRISTINES;
+        else
+          *result_format = SVN_WC__VERSION;
 
         SVN_SQLITE__WITH_LOCK(
             svn_wc__db_install_schema_statistics(sdb, scratch_pool),
@@ -1912,8 +1932,9 @@ svn_wc_upgrade(svn_wc_context_t *wc_ctx,
                           scratch_pool, scratch_pool));
 
 
+  /* Only WC_CTX's DB knows whether the user wants compressed pristines. */
   err = svn_wc__db_bump_format(&result_format, &bumped_format,
-                               db, local_abspath,
+                               wc_ctx->db, local_abspath,
                                scratch_pool);
   if (err)
     {
@@ -1933,7 +1954,7 @@ svn_wc_upgrade(svn_wc_context_t *wc_ctx,
       /* Auto-upgrade worked! */
       SVN_ERR(svn_wc__db_close(db));
 
-      SVN_ERR_ASSERT(result_format == SVN_WC__VERSION);
+      SVN_ERR_ASSERT(result_format >= SVN_WC__VERSION);
 
       if (bumped_format && notify_func)
         {
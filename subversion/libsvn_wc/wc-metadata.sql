@@ -79,8 +79,6 @@ CREATE UNIQUE INDEX I_LOCAL_ABSPATH ON WCROOT (local_abspath);
    single pristine text.  The text itself is stored in a file whose name is
    derived from the 'checksum' column.  Each pristine text is referenced by
    any number of rows in the NODES and ACTUAL_NODE tables.
-
-   In future, the pristine text file may be compressed.
  */
 CREATE TABLE PRISTINE (
   /* The SHA-1 checksum of the pristine text. This is a unique key. The
@@ -88,13 +86,15 @@ CREATE TABLE PRISTINE (
      pristine texts referenced from this database. */
   checksum  TEXT NOT NULL PRIMARY KEY,
 
-  /* Enumerated values specifying type of compression. The only value
-     supported so far is NULL, meaning that no compression has been applied
-     and the pristine text is stored verbatim in the file. */
+  /* Enumerated values specifying type of compression. NULL means that no
+     compression has been applied and the pristine text is stored verbatim
+     in the file. 1 means that the file holds the text compressed with LZ4,
+     in the block format of svn__stream_compressed_lz4(). */
   compression  INTEGER,
 
-  /* The size in bytes of the file in which the pristine text is stored.
-     Used to verify the pristine file is "proper". */
+  /* The size in bytes of the pristine text, i.e. of the file in which it is
+     stored if it isn't compressed.  Used to verify the pristine file is
+     "proper". */
   size  INTEGER NOT NULL,
 
   /* The number of rows in the NODES table that have a 'checksum' column
@@ -699,9 +699,15 @@ WHERE l.op_depth = 0
 
 
 /* ------------------------------------------------------------------------- */
-/* Format 32 ....  */
-/* -- STMT_UPGRADE_TO_32
-PRAGMA user_version = 32; */
+/* Format 32 is optional, see SVN_WC__COMPRESSED_PRISTINES.  It allows
+   compressed pristine texts, without any change to the schema.  */
+-- STMT_UPGRADE_TO_32
+PRAGMA user_version = 32;
+
+/* ------------------------------------------------------------------------- */
+/* Format 33 ....  */
+/* -- STMT_UPGRADE_TO_33
+PRAGMA user_version = 33; */
 
 
 /* ------------------------------------------------------------------------- */
@@ -161,11 +161,21 @@ extern "C" {
  * == 1.9.x shipped with format 31
  * == 1.10.x shipped with format 31
  *
+ * Format 32 allows pristine texts to be stored compressed, as marked in the
+ * PRISTINE.compression column.  The schema is unchanged, but older clients
+ * would read compressed pristine texts verbatim, so they must not open such
+ * working copies.  Unlike the other formats, this one is optional: working
+ * copies only get it through an explicit upgrade with the
+ * compress-pristines option enabled, see svn_wc__upgrade_sdb().
+ *
  * Please document any further format changes here.
  */
 
 #define SVN_WC__VERSION 31
 
+/* The optional format in which pristine texts may be stored compressed. */
+#define SVN_WC__COMPRESSED_PRISTINES 32
+
 
 /* Formats <= this have no concept of "revert text-base/props".  */
 #define SVN_WC__NO_REVERT_FILES 4
@@ -586,13 +596,15 @@ svn_wc__internal_get_origin(svn_boolean_t *is_copy,
 /* Upgrade the wc sqlite database given in SDB for the wc located at
    WCROOT_ABSPATH. It's current/starting format is given by START_FORMAT.
    After the upgrade is complete (to as far as the automatic upgrade will
-   perform), the resulting format is RESULT_FORMAT. All allocations are
-   performed in SCRATCH_POOL.  */
+   perform), the resulting format is RESULT_FORMAT. If COMPRESS_PRISTINES
+   is TRUE, continue to the optional SVN_WC__COMPRESSED_PRISTINES format.
+   All allocations are performed in SCRATCH_POOL.  */
 svn_error_t *
 svn_wc__upgrade_sdb(int *result_format,
                     const char *wcroot_abspath,
                     svn_sqlite__db_t *sdb,
                     int start_format,
+                    svn_boolean_t compress_pristines,
                     apr_pool_t *scratch_pool);
 
 /* Create a conflict skel from the old separated data */
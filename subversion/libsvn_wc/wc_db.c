@@ -1689,9 +1689,11 @@ svn_wc__db_base_add_directory(svn_wc__db_t *db,
 
      Note: old children can stick around, even if they are no longer present
      in this directory's revision.  */
+  SVN_ERR(svn_wc__db_bulk_start_change(wcroot));
   SVN_WC__DB_WITH_TXN(
             insert_base_node(&ibb, wcroot, local_relpath, scratch_pool),
             wcroot);
+  SVN_ERR(svn_wc__db_bulk_note_change(wcroot));
 
   SVN_ERR(flush_entries(wcroot, local_abspath, depth, scratch_pool));
   return SVN_NO_ERROR;
@@ -1828,9 +1830,11 @@ svn_wc__db_base_add_file(svn_wc__db_t *db,
   ibb.conflict = conflict;
   ibb.work_items = work_items;
 
+  SVN_ERR(svn_wc__db_bulk_start_change(wcroot));
   SVN_WC__DB_WITH_TXN(
             insert_base_node(&ibb, wcroot, local_relpath, scratch_pool),
             wcroot);
+  SVN_ERR(svn_wc__db_bulk_note_change(wcroot));
 
   /* If this used to be a directory we should remove children so pass
    * depth infinity. */
@@ -1915,9 +1919,11 @@ svn_wc__db_base_add_symlink(svn_wc__db_t *db,
   ibb.conflict = conflict;
   ibb.work_items = work_items;
 
+  SVN_ERR(svn_wc__db_bulk_start_change(wcroot));
   SVN_WC__DB_WITH_TXN(
             insert_base_node(&ibb, wcroot, local_relpath, scratch_pool),
             wcroot);
+  SVN_ERR(svn_wc__db_bulk_note_change(wcroot));
 
   /* If this used to be a directory we should remove children so pass
    * depth infinity. */
@@ -13423,6 +13429,141 @@ svn_wc__db_upgrade_insert_external(svn_wc__db_t *db,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_bulk_begin(svn_wc__db_t *db,
+                      const char *wri_abspath,
+                      apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  /* The transaction only gets started with the first change. */
+  ++wcroot->bulk_depth;
+
+  return SVN_NO_ERROR;
+}
+
+/* Commit the transaction of the bulk operation on WCROOT, if any. */
+static svn_error_t *
+bulk_commit(svn_wc__db_wcroot_t *wcroot)
+{
+  if (! wcroot->bulk_txn)
+    return SVN_NO_ERROR;
+
+  /* A failed commit rolls back, which ends the transaction either way. */
+  wcroot->bulk_txn = FALSE;
+  wcroot->bulk_changes = 0;
+
+  return svn_error_trace(svn_sqlite__finish_transaction(wcroot->sdb,
+                                                        SVN_NO_ERROR));
+}
+
+svn_error_t *
+svn_wc__db_bulk_start_change(svn_wc__db_wcroot_t *wcroot)
+{
+  if (wcroot->bulk_depth > 0 && ! wcroot->bulk_txn)
+    {
+      /* Take the write lock right away, just like pristine installs do. */
+      SVN_ERR(svn_sqlite__begin_immediate_transaction(wcroot->sdb));
+      wcroot->bulk_txn = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_bulk_note_change(svn_wc__db_wcroot_t *wcroot)
+{
+  if (wcroot->bulk_txn)
+    ++wcroot->bulk_changes;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_bulk_is_full(svn_boolean_t *full,
+                        svn_wc__db_t *db,
+                        const char *wri_abspath,
+                        apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+
+  *full = (wcroot->bulk_txn
+           && wcroot->bulk_changes >= SVN_WC__BULK_MAX_CHANGES);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_bulk_suspend(int *bulk_depth,
+                        svn_wc__db_t *db,
+                        const char *wri_abspath,
+                        apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+
+  *bulk_depth = wcroot->bulk_depth;
+  wcroot->bulk_depth = 0;
+
+  return svn_error_trace(bulk_commit(wcroot));
+}
+
+svn_error_t *
+svn_wc__db_bulk_resume(svn_wc__db_t *db,
+                       const char *wri_abspath,
+                       int bulk_depth,
+                       apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+
+  wcroot->bulk_depth += bulk_depth;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_bulk_end(svn_wc__db_t *db,
+                    const char *wri_abspath,
+                    apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+
+  if (wcroot->bulk_depth > 0 && --wcroot->bulk_depth == 0)
+    SVN_ERR(bulk_commit(wcroot));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_wc__db_wq_add_internal(svn_wc__db_wcroot_t *wcroot,
                            const svn_skel_t *work_item,
@@ -13533,6 +13674,59 @@ svn_wc__db_wq_fetch_next(apr_uint64_t *id,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_wq_fetch_following(apr_array_header_t **ids,
+                              apr_array_header_t **work_items,
+                              svn_wc__db_t *db,
+                              const char *wri_abspath,
+                              apr_uint64_t after_id,
+                              int max_items,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  *ids = apr_array_make(result_pool, max_items, sizeof(apr_uint64_t));
+  *work_items = apr_array_make(result_pool, max_items, sizeof(svn_skel_t *));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_WORK_ITEMS_AFTER));
+  SVN_ERR(svn_sqlite__bind_int64(stmt, 1, after_id));
+  SVN_ERR(svn_sqlite__bind_int(stmt, 2, max_items));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      apr_size_t len;
+      const void *val;
+
+      APR_ARRAY_PUSH(*ids, apr_uint64_t) = svn_sqlite__column_int64(stmt, 0);
+
+      val = svn_sqlite__column_blob(stmt, 1, &len, result_pool);
+      APR_ARRAY_PUSH(*work_items, svn_skel_t *)
+        = svn_skel__parse(val, len, result_pool);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+int
+svn_wc__db_get_install_threads(svn_wc__db_t *db)
+{
+  return db->install_threads;
+}
+
 /* Records timestamp and date for one or more files in wcroot */
 static svn_error_t *
 wq_record(svn_wc__db_wcroot_t *wcroot,
@@ -13564,6 +13758,56 @@ wq_record(svn_wc__db_wcroot_t *wcroot,
   return SVN_NO_ERROR;
 }
 
+/* The body of svn_wc__db_wq_record_and_complete().
+ */
+static svn_error_t *
+wq_record_and_complete(svn_wc__db_wcroot_t *wcroot,
+                       const apr_array_header_t *completed_ids,
+                       apr_hash_t *record_map,
+                       apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  int i;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_DELETE_WORK_ITEM));
+  for (i = 0; i < completed_ids->nelts; i++)
+    {
+      SVN_ERR(svn_sqlite__bind_int64(stmt, 1,
+                                     APR_ARRAY_IDX(completed_ids, i,
+                                                   apr_uint64_t)));
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  if (record_map)
+    SVN_ERR(wq_record(wcroot, record_map, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_wq_record_and_complete(svn_wc__db_t *db,
+                                  const char *wri_abspath,
+                                  const apr_array_header_t *completed_ids,
+                                  apr_hash_t *record_map,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  SVN_WC__DB_WITH_TXN(
+    wq_record_and_complete(wcroot, completed_ids, record_map, scratch_pool),
+    wcroot);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
                                     svn_skel_t **work_item,
@@ -16044,7 +16288,8 @@ svn_wc__db_bump_format(int *result_format,
 
   SVN_ERR(svn_sqlite__read_schema_version(&format, sdb, scratch_pool));
   err = svn_wc__upgrade_sdb(result_format, wcroot_abspath,
-                            sdb, format, scratch_pool);
+                            sdb, format, db->compress_pristines,
+                            scratch_pool);
 
   if (err == SVN_NO_ERROR && bumped_format)
     *bumped_format = (*result_format > format);
@@ -905,6 +905,12 @@ svn_wc__db_base_get_lock_tokens_recursive(apr_hash_t **lock_tokens,
    ### This is temporary - callers should not be looking at the file
    directly.
 
+   If the text is stored compressed, set *PRISTINE_ABSPATH to a temporary
+   file holding its uncompressed form instead, so that the file can be read
+   as is.  Neither the pristine store nor the DB are modified for that.
+   The file remains until svn_wc__db_pristine_remove_decompressed() gets
+   called, so work items may refer to it.
+
    Allocate the path in RESULT_POOL. */
 svn_error_t *
 svn_wc__db_pristine_get_path(const char **pristine_abspath,
@@ -914,6 +920,15 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
                              apr_pool_t *result_pool,
                              apr_pool_t *scratch_pool);
 
+/* Remove the decompressed copies of pristine texts that
+   svn_wc__db_pristine_get_path() created in the temporary area of the WC
+   identified by WRI_ABSPATH in DB.  The caller must make sure that they
+   are no longer used, e.g. by running the work queue first. */
+svn_error_t *
+svn_wc__db_pristine_remove_decompressed(svn_wc__db_t *db,
+                                        const char *wri_abspath,
+                                        apr_pool_t *scratch_pool);
+
 /* Set *PRISTINE_ABSPATH to the path under WCROOT_ABSPATH that will be
    used by the pristine text identified by SHA1_CHECKSUM.  The file
    need not exist.
@@ -925,6 +940,18 @@ svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool);
 
+/* Set *COMPRESSED to TRUE if the pristine text identified by SHA1_CHECKSUM
+   within the WC identified by WRI_ABSPATH in DB is stored compressed, so
+   that its file as returned by svn_wc__db_pristine_get_future_path() must
+   be read through svn__stream_compressed_lz4().  Set *COMPRESSED to FALSE
+   if it is stored verbatim or not stored at all. */
+svn_error_t *
+svn_wc__db_pristine_is_compressed(svn_boolean_t *compressed,
+                                  svn_wc__db_t *db,
+                                  const char *wri_abspath,
+                                  const svn_checksum_t *sha1_checksum,
+                                  apr_pool_t *scratch_pool);
+
 
 /* If requested set *CONTENTS to a readable stream that will yield the pristine
    text identified by SHA1_CHECKSUM (must be a SHA-1 checksum) within the WC
@@ -1040,7 +1067,9 @@ svn_wc__db_pristine_remove(svn_wc__db_t *db,
                            apr_pool_t *scratch_pool);
 
 
-/* Remove all unreferenced pristines in the WC of WRI_ABSPATH in DB. */
+/* Remove all unreferenced pristines in the WC of WRI_ABSPATH in DB.  If DB
+ * is configured to use a shared pristine store, also remove all texts from
+ * that store that are not used by any working copy. */
 svn_error_t *
 svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
                             const char *wri_abspath,
@@ -2965,6 +2994,9 @@ svn_wc__db_upgrade_insert_external(svn_wc__db_t *db,
  * If WCROOT_ABSPATH is not a working copy root SVN_ERR_WC_INVALID_OP_ON_CWD
  * is returned.
  *
+ * If DB is configured to compress pristine texts, continue to the optional
+ * SVN_WC__COMPRESSED_PRISTINES format; DB is not used otherwise.
+ *
  * If BUMPED_FORMAT is not NULL, set *BUMPED_FORMAT to TRUE if the format
  * was bumped or to FALSE if the wc was already at the resulting format.
  */
@@ -2978,6 +3010,73 @@ svn_wc__db_bump_format(int *result_format,
 /* @} */
 
 
+/* @defgroup svn_wc__db_bulk  Bulk operations
+   @{
+*/
+
+/* Number of changes after which the transaction of a bulk operation is
+   considered full, see svn_wc__db_bulk_is_full().  */
+#define SVN_WC__BULK_MAX_CHANGES 1024
+
+/* Start a bulk operation, like a checkout, on the working copy that
+   contains WRI_ABSPATH.
+
+   Until svn_wc__db_bulk_end() gets called, changes made through DB to
+   BASE nodes and pristines in that working copy are collected in one
+   large transaction instead of being committed one by one.  That
+   transaction gets started with the first change and is committed
+   whenever the work queue runs, so that no work item ever sees a change
+   that might still be rolled back.  The caller decides when to run the
+   work queue, see svn_wc__db_bulk_is_full().
+
+   While that transaction is open, it holds the write lock on the working
+   copy DB, so other DB handles can't make any changes to it.
+
+   Bulk operations may be nested; only the outermost one commits in
+   svn_wc__db_bulk_end().  */
+svn_error_t *
+svn_wc__db_bulk_begin(svn_wc__db_t *db,
+                      const char *wri_abspath,
+                      apr_pool_t *scratch_pool);
+
+/* Set *FULL to TRUE if a bulk operation on the working copy that contains
+   WRI_ABSPATH has collected at least SVN_WC__BULK_MAX_CHANGES changes
+   since its transaction got started, and to FALSE otherwise.  */
+svn_error_t *
+svn_wc__db_bulk_is_full(svn_boolean_t *full,
+                        svn_wc__db_t *db,
+                        const char *wri_abspath,
+                        apr_pool_t *scratch_pool);
+
+/* Commit all pending changes of the bulk operations on the working copy
+   that contains WRI_ABSPATH and make further changes be committed one by
+   one, until svn_wc__db_bulk_resume() gets called.  Set *BULK_DEPTH to
+   the number of bulk operations that were active.  */
+svn_error_t *
+svn_wc__db_bulk_suspend(int *bulk_depth,
+                        svn_wc__db_t *db,
+                        const char *wri_abspath,
+                        apr_pool_t *scratch_pool);
+
+/* Continue the BULK_DEPTH bulk operations on the working copy that
+   contains WRI_ABSPATH that svn_wc__db_bulk_suspend() has suspended.  */
+svn_error_t *
+svn_wc__db_bulk_resume(svn_wc__db_t *db,
+                       const char *wri_abspath,
+                       int bulk_depth,
+                       apr_pool_t *scratch_pool);
+
+/* End a bulk operation on the working copy that contains WRI_ABSPATH.
+   If that was the outermost one, commit all of its pending changes.  Do
+   nothing if no bulk operation is active.  */
+svn_error_t *
+svn_wc__db_bulk_end(svn_wc__db_t *db,
+                    const char *wri_abspath,
+                    apr_pool_t *scratch_pool);
+
+/* @} */
+
+
 /* @defgroup svn_wc__db_wq  Work queue manipulation. see workqueue.h
    @{
 */
@@ -3016,6 +3115,45 @@ svn_wc__db_wq_fetch_next(apr_uint64_t *id,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
+/* In the WCROOT associated with DB and WRI_ABSPATH, fetch up to MAX_ITEMS
+   work items that were queued directly after the item AFTER_ID, without
+   marking anything as completed.  Set *IDS to an array of apr_uint64_t
+   identifiers and *WORK_ITEMS to an array of the matching svn_skel_t *
+   items, both in queue order and allocated in RESULT_POOL.
+
+   This allows running a number of independent items at once, before
+   marking them all as completed with svn_wc__db_wq_record_and_complete().  */
+svn_error_t *
+svn_wc__db_wq_fetch_following(apr_array_header_t **ids,
+                              apr_array_header_t **work_items,
+                              svn_wc__db_t *db,
+                              const char *wri_abspath,
+                              apr_uint64_t after_id,
+                              int max_items,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
+/* In the WCROOT associated with DB and WRI_ABSPATH, mark the wq items
+   with the apr_uint64_t identifiers in COMPLETED_IDS as completed and, in
+   the same transaction, record the timestamps and sizes in RECORD_MAP
+   like svn_wc__db_wq_record_and_fetch_next() does.  RECORD_MAP may be
+   NULL.  Use SCRATCH_POOL for temporary allocations.  */
+svn_error_t *
+svn_wc__db_wq_record_and_complete(svn_wc__db_t *db,
+                                  const char *wri_abspath,
+                                  const apr_array_header_t *completed_ids,
+                                  apr_hash_t *record_map,
+                                  apr_pool_t *scratch_pool);
+
+/* Default and maximum for SVN_CONFIG_OPTION_INSTALL_THREADS. */
+#define SVN_WC__DEFAULT_INSTALL_THREADS 1
+#define SVN_WC__MAX_INSTALL_THREADS 64
+
+/* Return the number of threads that DB wants the work queue to use for
+   installing files, as configured by SVN_CONFIG_OPTION_INSTALL_THREADS. */
+int
+svn_wc__db_get_install_threads(svn_wc__db_t *db);
+
 /* Special variant of svn_wc__db_wq_fetch_next(), which in the same transaction
    also records timestamps and sizes for one or more nodes */
 svn_error_t *
@@ -25,11 +25,14 @@
 
 #define SVN_WC__I_AM_WC_DB
 
+#include <apr_sha1.h>
+
 #include "svn_pools.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -40,16 +43,62 @@
 #define PRISTINE_STORAGE_RELPATH "pristine"
 #define PRISTINE_TEMPDIR_RELPATH "tmp"
 
+/* Values of the PRISTINE.compression column; 0 stands for NULL. */
+#define PRISTINE_COMPRESSION_LZ4 1
+
+/* Like SVN_SQLITE__WITH_IMMEDIATE_TXN() on WCROOT's DB.  When a bulk
+   operation already keeps a transaction holding the 'RESERVED' lock open,
+   just use a savepoint within that.  */
+#define WITH_IMMEDIATE_TXN(expr, wcroot)                        \
+  do {                                                          \
+    if ((wcroot)->bulk_txn)                                     \
+      SVN_SQLITE__WITH_LOCK(expr, (wcroot)->sdb);               \
+    else                                                        \
+      SVN_SQLITE__WITH_IMMEDIATE_TXN(expr, (wcroot)->sdb);      \
+  } while (0)
+
 
 
 /* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
    holding the local absolute path to the file location that is dedicated
-   to hold CHECKSUM's pristine file, relating to the pristine store
-   configured for the working copy indicated by PDH. The returned path
-   does not necessarily currently exist.
+   to hold CHECKSUM's pristine file in the pristine store located at
+   BASE_DIR_ABSPATH.  The returned path does not necessarily currently
+   exist.
 
    Any other allocations are made in SCRATCH_POOL. */
 static svn_error_t *
+get_store_fname(const char **pristine_abspath,
+                const char *base_dir_abspath,
+                const svn_checksum_t *sha1_checksum,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  const char *hexdigest = svn_checksum_to_cstring(sha1_checksum, scratch_pool);
+  char subdir[3];
+
+  /* We should have a valid checksum and (thus) a valid digest. */
+  SVN_ERR_ASSERT(hexdigest != NULL);
+
+  /* Get the first two characters of the digest, for the subdir. */
+  subdir[0] = hexdigest[0];
+  subdir[1] = hexdigest[1];
+  subdir[2] = '\0';
+
+  hexdigest = apr_pstrcat(scratch_pool, hexdigest, PRISTINE_STORAGE_EXT,
+                          SVN_VA_NULL);
+
+  /* The file is located at DIR/.svn/pristine/XX/XXYYZZ...svn-base */
+  *pristine_abspath = svn_dirent_join_many(result_pool,
+                                           base_dir_abspath,
+                                           subdir,
+                                           hexdigest,
+                                           SVN_VA_NULL);
+  return SVN_NO_ERROR;
+}
+
+/* Like get_store_fname(), for the pristine store configured for the
+   working copy at WCROOT_ABSPATH. */
+static svn_error_t *
 get_pristine_fname(const char **pristine_abspath,
                    const char *wcroot_abspath,
                    const svn_checksum_t *sha1_checksum,
@@ -57,8 +106,6 @@ get_pristine_fname(const char **pristine_abspath,
                    apr_pool_t *scratch_pool)
 {
   const char *base_dir_abspath;
-  const char *hexdigest = svn_checksum_to_cstring(sha1_checksum, scratch_pool);
-  char subdir[3];
 
   /* ### code is in transition. make sure we have the proper data.  */
   SVN_ERR_ASSERT(pristine_abspath != NULL);
@@ -72,27 +119,245 @@ get_pristine_fname(const char **pristine_abspath,
                                           PRISTINE_STORAGE_RELPATH,
                                           SVN_VA_NULL);
 
-  /* We should have a valid checksum and (thus) a valid digest. */
-  SVN_ERR_ASSERT(hexdigest != NULL);
+  return svn_error_trace(get_store_fname(pristine_abspath, base_dir_abspath,
+                                         sha1_checksum,
+                                         result_pool, scratch_pool));
+}
 
-  /* Get the first two characters of the digest, for the subdir. */
-  subdir[0] = hexdigest[0];
-  subdir[1] = hexdigest[1];
-  subdir[2] = '\0';
+/* Return the absolute path to the temporary directory for pristine text
+   files within WCROOT. */
+static char *
+pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  return svn_dirent_join_many(result_pool, wcroot->abspath,
+                              svn_wc_get_adm_dir(scratch_pool),
+                              PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
+}
 
-  hexdigest = apr_pstrcat(scratch_pool, hexdigest, PRISTINE_STORAGE_EXT,
-                          SVN_VA_NULL);
+/* Make sure that the pristine text with checksum SHA1_CHECKSUM, which has
+ * just been installed at PRISTINE_ABSPATH, is stored on disk only once for
+ * all working copies that use the shared pristine store at
+ * SHARED_STORE_ABSPATH: replace PRISTINE_ABSPATH with a hard link to the
+ * shared copy if there is one, or else add a hard link to PRISTINE_ABSPATH
+ * to the shared store.
+ *
+ * The link count of a text in the shared store is thus one more than the
+ * number of pristine stores that use it, which is what
+ * unshare_pristine() relies on.
+ *
+ * Sharing is only an optimization: if the link can't be made, for example
+ * because the shared store lives on another file system, just keep the
+ * private copy.
+ */
+static svn_error_t *
+share_pristine(const char *shared_store_abspath,
+               const svn_checksum_t *sha1_checksum,
+               const char *pristine_abspath,
+               apr_pool_t *scratch_pool)
+{
+  const char *shared_abspath;
+  const char *tmp_abspath;
+  apr_finfo_t finfo, shared_finfo;
+  svn_boolean_t same;
+  svn_error_t *err;
+
+  SVN_ERR(get_store_fname(&shared_abspath, shared_store_abspath,
+                          sha1_checksum, scratch_pool, scratch_pool));
+
+  /* Publish our copy, if we are the first to store this text. */
+  err = svn_io__file_link(pristine_abspath, shared_abspath, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      err = svn_io_make_dir_recursively(svn_dirent_dirname(shared_abspath,
+                                                           scratch_pool),
+                                        scratch_pool);
+      if (!err)
+        err = svn_io__file_link(pristine_abspath, shared_abspath,
+                                scratch_pool);
+    }
+
+  if (!err)
+    return SVN_NO_ERROR;
+  else if (!APR_STATUS_IS_EEXIST(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  svn_error_clear(err);
+
+  /* The shared store has this text already; use its copy instead of ours,
+     unless it is obviously damaged. */
+  SVN_ERR(svn_io_stat(&finfo, pristine_abspath,
+                      APR_FINFO_SIZE | APR_FINFO_IDENT, scratch_pool));
+  err = svn_io_stat(&shared_finfo, shared_abspath,
+                    APR_FINFO_SIZE | APR_FINFO_IDENT, scratch_pool);
+  if (err)
+    {
+      /* Removed by a concurrent cleanup. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  if (finfo.size != shared_finfo.size
+      || (finfo.inode == shared_finfo.inode
+          && finfo.device == shared_finfo.device))
+    return SVN_NO_ERROR;
+
+  tmp_abspath = apr_pstrcat(scratch_pool, pristine_abspath, ".tmp",
+                            SVN_VA_NULL);
+  err = svn_io__file_link(shared_abspath, tmp_abspath, scratch_pool);
+  if (err && APR_STATUS_IS_EEXIST(err->apr_err))
+    {
+      /* Left behind by an interrupted install. */
+      svn_error_clear(err);
+      SVN_ERR(svn_io_remove_file2(tmp_abspath, TRUE, scratch_pool));
+      err = svn_io__file_link(shared_abspath, tmp_abspath, scratch_pool);
+    }
+
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  /* Anyone with write access to the shared store may have put that file
+     there, so only adopt it if it has exactly the text that we just
+     verified while installing our own copy.  Check the link we are about
+     to adopt rather than the name in the store, which might be replaced
+     in the meantime. */
+  err = svn_io_files_contents_same_p(&same, tmp_abspath, pristine_abspath,
+                                     scratch_pool);
+  if (err || !same)
+    {
+      svn_error_clear(err);
+      return svn_error_trace(svn_io_remove_file2(tmp_abspath, TRUE,
+                                                 scratch_pool));
+    }
+
+  return svn_error_trace(svn_io_file_rename2(tmp_abspath, pristine_abspath,
+                                             FALSE, scratch_pool));
+}
+
+/* Remove the text with checksum SHA1_CHECKSUM from the shared pristine
+ * store at SHARED_STORE_ABSPATH if no other pristine store links to it any
+ * more.  See share_pristine().
+ *
+ * This may race with another working copy that starts using the text at
+ * the same time.  That working copy then just keeps a private copy, as if
+ * it had never been shared. */
+static svn_error_t *
+unshare_pristine(const char *shared_store_abspath,
+                 const svn_checksum_t *sha1_checksum,
+                 apr_pool_t *scratch_pool)
+{
+  const char *shared_abspath;
+  apr_finfo_t finfo;
+  svn_error_t *err;
+
+  SVN_ERR(get_store_fname(&shared_abspath, shared_store_abspath,
+                          sha1_checksum, scratch_pool, scratch_pool));
+
+  err = svn_io_stat(&finfo, shared_abspath, APR_FINFO_NLINK, scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  if ((finfo.valid & APR_FINFO_NLINK) && finfo.nlink == 1)
+    SVN_ERR(svn_io_remove_file2(shared_abspath, TRUE, scratch_pool));
 
-  /* The file is located at DIR/.svn/pristine/XX/XXYYZZ...svn-base */
-  *pristine_abspath = svn_dirent_join_many(result_pool,
-                                           base_dir_abspath,
-                                           subdir,
-                                           hexdigest,
-                                           SVN_VA_NULL);
   return SVN_NO_ERROR;
 }
 
 
+/* Set *COMPRESSION to the PRISTINE.compression value of the pristine text
+ * with checksum SHA1_CHECKSUM in SDB, or to 0 if there is no such text. */
+static svn_error_t *
+get_pristine_compression(int *compression,
+                         svn_sqlite__db_t *sdb,
+                         const svn_checksum_t *sha1_checksum,
+                         apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_PRISTINE_SIZE));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  *compression = have_row ? svn_sqlite__column_int(stmt, 1) : 0;
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Set *TEXT_ABSPATH to a file that holds the uncompressed form of the
+ * pristine text with checksum SHA1_CHECKSUM, which is stored compressed at
+ * PRISTINE_ABSPATH in the pristine store of WCROOT.
+ *
+ * The pristine store and the DB stay untouched.  The file is created in
+ * the temporary area of WCROOT, where it lives until the work queue has
+ * been run and thus also for work items that refer to it.  If that area can't be
+ * written to, use a file in the system's temporary directory that gets
+ * removed when RESULT_POOL is cleared.
+ */
+static svn_error_t *
+get_decompressed_text(const char **text_abspath,
+                      svn_wc__db_wcroot_t *wcroot,
+                      const svn_checksum_t *sha1_checksum,
+                      const char *pristine_abspath,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  const char *temp_dir_abspath = pristine_get_tempdir(wcroot, scratch_pool,
+                                                      scratch_pool);
+  svn_stream_t *src_stream;
+  svn_stream_t *dst_stream;
+  svn_node_kind_t kind;
+  svn_error_t *err;
+
+  *text_abspath = svn_dirent_join(temp_dir_abspath,
+                                  apr_pstrcat(scratch_pool,
+                                              svn_checksum_to_cstring(
+                                                sha1_checksum, scratch_pool),
+                                              PRISTINE_STORAGE_EXT,
+                                              SVN_VA_NULL),
+                                  result_pool);
+
+  /* The name identifies the text, so an existing file is just as good. */
+  SVN_ERR(svn_io_check_path(*text_abspath, &kind, scratch_pool));
+  if (kind == svn_node_file)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_stream_open_readonly(&src_stream, pristine_abspath,
+                                   scratch_pool, scratch_pool));
+  src_stream = svn__stream_compressed_lz4(src_stream, scratch_pool);
+
+  err = svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
+                                       scratch_pool, scratch_pool);
+  if (err)
+    {
+      /* A read-only working copy; don't leave anything behind. */
+      svn_error_clear(err);
+      SVN_ERR(svn_stream_open_unique(&dst_stream, text_abspath, NULL,
+                                     svn_io_file_del_on_pool_cleanup,
+                                     result_pool, scratch_pool));
+      return svn_error_trace(svn_stream_copy3(src_stream, dst_stream,
+                                              NULL, NULL, scratch_pool));
+    }
+
+  /* Readers never see a partially written file. */
+  SVN_ERR(svn_stream_copy3(src_stream, dst_stream, NULL, NULL,
+                           scratch_pool));
+  SVN_ERR(svn_stream__install_stream(dst_stream, *text_abspath, FALSE,
+                                     scratch_pool));
+
+  return svn_error_trace(svn_io_set_file_read_only(*text_abspath, FALSE,
+                                                   scratch_pool));
+}
+
 svn_error_t *
 svn_wc__db_pristine_get_path(const char **pristine_abspath,
                              svn_wc__db_t *db,
@@ -134,6 +399,75 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
                              sha1_checksum,
                              result_pool, scratch_pool));
 
+  /* Our callers hand the path to code that doesn't know about compressed
+     pristines, such as external diff and merge tools. */
+  {
+    int compression;
+
+    SVN_ERR(get_pristine_compression(&compression, wcroot->sdb,
+                                     sha1_checksum, scratch_pool));
+    if (compression == PRISTINE_COMPRESSION_LZ4)
+      SVN_ERR(get_decompressed_text(pristine_abspath, wcroot, sha1_checksum,
+                                    *pristine_abspath,
+                                    result_pool, scratch_pool));
+  }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_pristine_remove_decompressed(svn_wc__db_t *db,
+                                        const char *wri_abspath,
+                                        apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+  const char *temp_dir_abspath;
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool;
+  apr_size_t name_len = 2 * APR_SHA1_DIGESTSIZE
+                        + sizeof(PRISTINE_STORAGE_EXT) - 1;
+  svn_error_t *err;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  /* Only compressed texts have decompressed copies. */
+  if (wcroot->format < SVN_WC__COMPRESSED_PRISTINES)
+    return SVN_NO_ERROR;
+
+  temp_dir_abspath = pristine_get_tempdir(wcroot, scratch_pool, scratch_pool);
+  err = svn_io_get_dirents3(&dirents, temp_dir_abspath, TRUE,
+                            scratch_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* Decompressed copies are named like the texts in the pristine store. */
+  iterpool = svn_pool_create(scratch_pool);
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+
+      svn_pool_clear(iterpool);
+      if (strlen(name) != name_len
+          || strcmp(name + name_len - (sizeof(PRISTINE_STORAGE_EXT) - 1),
+                    PRISTINE_STORAGE_EXT) != 0)
+        continue;
+
+      SVN_ERR(svn_io_remove_file2(svn_dirent_join(temp_dir_abspath, name,
+                                                  iterpool),
+                                  TRUE, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
   return SVN_NO_ERROR;
 }
 
@@ -150,11 +484,36 @@ svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_pristine_is_compressed(svn_boolean_t *compressed,
+                                  svn_wc__db_t *db,
+                                  const char *wri_abspath,
+                                  const svn_checksum_t *sha1_checksum,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+  int compression;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+  SVN_ERR_ASSERT(sha1_checksum->kind == svn_checksum_sha1);
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  SVN_ERR(get_pristine_compression(&compression, wcroot->sdb, sha1_checksum,
+                                   scratch_pool));
+  *compressed = (compression == PRISTINE_COMPRESSION_LZ4);
+
+  return SVN_NO_ERROR;
+}
+
 /* Set *CONTENTS to a readable stream from which the pristine text
  * identified by SHA1_CHECKSUM and PRISTINE_ABSPATH can be read from the
  * pristine store of WCROOT.  If SIZE is not null, set *SIZE to the size
  * in bytes of that text. If that text is not in the pristine store,
- * return an error.
+ * return an error.  Compressed texts are decompressed transparently.
  *
  * Even if the pristine text is removed from the store while it is being
  * read, the stream will remain valid and readable until it is closed.
@@ -176,6 +535,7 @@ pristine_read_txn(svn_stream_t **contents,
 {
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  int compression;
 
   /* Check that this pristine text is present in the store.  (The presence
    * of the file is not sufficient.) */
@@ -186,6 +546,7 @@ pristine_read_txn(svn_stream_t **contents,
 
   if (size)
     *size = svn_sqlite__column_int64(stmt, 0);
+  compression = svn_sqlite__column_int(stmt, 1);
 
   SVN_ERR(svn_sqlite__reset(stmt));
   if (! have_row)
@@ -209,6 +570,9 @@ pristine_read_txn(svn_stream_t **contents,
       SVN_ERR(svn_io_file_open(&file, pristine_abspath, APR_READ,
                                APR_OS_DEFAULT, result_pool));
       *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+
+      if (compression == PRISTINE_COMPRESSION_LZ4)
+        *contents = svn__stream_compressed_lz4(*contents, result_pool);
     }
 
   return SVN_NO_ERROR;
@@ -256,21 +620,11 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
 }
 
 
-/* Return the absolute path to the temporary directory for pristine text
-   files within WCROOT. */
-static char *
-pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
-                     apr_pool_t *result_pool,
-                     apr_pool_t *scratch_pool)
-{
-  return svn_dirent_join_many(result_pool, wcroot->abspath,
-                              svn_wc_get_adm_dir(scratch_pool),
-                              PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
-}
-
 /* Install the pristine text described by BATON into the pristine store of
  * SDB.  If it is already stored then just delete the new file
- * BATON->tempfile_abspath.
+ * BATON->tempfile_abspath.  If SHARED_STORE_ABSPATH is not NULL and the
+ * text is not compressed, store it in the shared pristine store at that
+ * location as well.
  *
  * This function expects to be executed inside a SQLite txn that has already
  * acquired a 'RESERVED' lock.
@@ -287,6 +641,12 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
                      const svn_checksum_t *sha1_checksum,
                      /* The pristine text's MD-5 checksum. */
                      const svn_checksum_t *md5_checksum,
+                     /* How INSTALL_STREAM's file is compressed. */
+                     int compression,
+                     /* The size of the text, if COMPRESSION is not 0. */
+                     svn_filesize_t text_size,
+                     /* The shared pristine store, if any. */
+                     const char *shared_store_abspath,
                      apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
@@ -302,24 +662,37 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
   if (have_row)
     {
 #ifdef SVN_DEBUG
-      /* Consistency checks.  Verify both files exist and match.
+      /* Consistency checks.  Verify both texts have the same size.
        * ### We could check much more. */
       {
-        apr_finfo_t finfo1, finfo2;
+        svn_filesize_t old_size;
 
-        SVN_ERR(svn_stream__install_get_info(&finfo1, install_stream, APR_FINFO_SIZE,
-                                             scratch_pool));
+        if (!compression)
+          {
+            apr_finfo_t finfo;
+
+            SVN_ERR(svn_stream__install_get_info(&finfo, install_stream,
+                                                 APR_FINFO_SIZE,
+                                                 scratch_pool));
+            text_size = finfo.size;
+          }
+
+        SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                          STMT_SELECT_PRISTINE_SIZE));
+        SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum,
+                                          scratch_pool));
+        SVN_ERR(svn_sqlite__step_row(stmt));
+        old_size = svn_sqlite__column_int64(stmt, 0);
+        SVN_ERR(svn_sqlite__reset(stmt));
 
-        SVN_ERR(svn_io_stat(&finfo2, pristine_abspath, APR_FINFO_SIZE,
-                            scratch_pool));
-        if (finfo1.size != finfo2.size)
+        if (text_size != old_size)
           {
             return svn_error_createf(
               SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
               _("New pristine text '%s' has different size: %s versus %s"),
               svn_checksum_to_cstring_display(sha1_checksum, scratch_pool),
-              apr_off_t_toa(scratch_pool, finfo1.size),
-              apr_off_t_toa(scratch_pool, finfo2.size));
+              apr_off_t_toa(scratch_pool, text_size),
+              apr_off_t_toa(scratch_pool, old_size));
           }
       }
 #endif
@@ -332,18 +705,29 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
   /* Move the file to its target location.  (If it is already there, it is
    * an orphan file and it doesn't matter if we overwrite it.) */
   {
-    apr_finfo_t finfo;
-    SVN_ERR(svn_stream__install_get_info(&finfo, install_stream,
-                                         APR_FINFO_SIZE, scratch_pool));
+    if (!compression)
+      {
+        apr_finfo_t finfo;
+
+        SVN_ERR(svn_stream__install_get_info(&finfo, install_stream,
+                                             APR_FINFO_SIZE, scratch_pool));
+        text_size = finfo.size;
+      }
     SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
                                        TRUE, scratch_pool));
 
     SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_INSERT_PRISTINE));
     SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
     SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
-    SVN_ERR(svn_sqlite__bind_int64(stmt, 3, finfo.size));
+    SVN_ERR(svn_sqlite__bind_int64(stmt, 3, text_size));
+    if (compression)
+      SVN_ERR(svn_sqlite__bind_int(stmt, 4, compression));
     SVN_ERR(svn_sqlite__insert(NULL, stmt));
 
+    if (shared_store_abspath && !compression)
+      SVN_ERR(share_pristine(shared_store_abspath, sha1_checksum,
+                             pristine_abspath, scratch_pool));
+
     SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE, scratch_pool));
   }
 
@@ -353,9 +737,40 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
 struct svn_wc__db_install_data_t
 {
   svn_wc__db_wcroot_t *wcroot;
+  const char *shared_store_abspath;
   svn_stream_t *inner_stream;
+
+  /* How INNER_STREAM's data is compressed.  If it is, COMPRESSED_STREAM
+     is the stream that compresses into INNER_STREAM, and TEXT_SIZE counts
+     the bytes written to it. */
+  int compression;
+  svn_stream_t *compressed_stream;
+  svn_filesize_t text_size;
 };
 
+/* Implements svn_write_fn_t.  Write to the COMPRESSED_STREAM of the
+   svn_wc__db_install_data_t in BATON, counting the bytes. */
+static svn_error_t *
+write_counted(void *baton, const char *data, apr_size_t *len)
+{
+  svn_wc__db_install_data_t *install_data = baton;
+
+  SVN_ERR(svn_stream_write(install_data->compressed_stream, data, len));
+  install_data->text_size += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t.  Close the COMPRESSED_STREAM of the
+   svn_wc__db_install_data_t in BATON. */
+static svn_error_t *
+close_counted(void *baton)
+{
+  svn_wc__db_install_data_t *install_data = baton;
+
+  return svn_error_trace(svn_stream_close(install_data->compressed_stream));
+}
+
 svn_error_t *
 svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
                                     svn_wc__db_install_data_t **install_data,
@@ -380,6 +795,7 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   *install_data = apr_pcalloc(result_pool, sizeof(**install_data));
   (*install_data)->wcroot = wcroot;
+  (*install_data)->shared_store_abspath = db->shared_pristine_abspath;
 
   SVN_ERR_W(svn_stream__create_for_install(stream,
                                            temp_dir_abspath,
@@ -388,6 +804,20 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   (*install_data)->inner_stream = *stream;
 
+  /* Older clients would read compressed texts verbatim, so only store
+     them in working copies that these clients refuse to open. */
+  if (db->compress_pristines
+      && wcroot->format >= SVN_WC__COMPRESSED_PRISTINES)
+    {
+      (*install_data)->compression = PRISTINE_COMPRESSION_LZ4;
+      (*install_data)->compressed_stream
+        = svn__stream_compressed_lz4(*stream, result_pool);
+
+      *stream = svn_stream_create(*install_data, result_pool);
+      svn_stream_set_write(*stream, write_counted);
+      svn_stream_set_close(*stream, close_counted);
+    }
+
   if (md5_checksum)
     *stream = svn_stream_checksummed2(*stream, NULL, md5_checksum,
                                       svn_checksum_md5, FALSE, result_pool);
@@ -418,14 +848,17 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
 
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
    * at the disk, to ensure no concurrent pristine install/delete txn. */
-  SVN_SQLITE__WITH_IMMEDIATE_TXN(
+  SVN_ERR(svn_wc__db_bulk_start_change(wcroot));
+  WITH_IMMEDIATE_TXN(
     pristine_install_txn(wcroot->sdb,
                          install_data->inner_stream, pristine_abspath,
                          sha1_checksum, md5_checksum,
+                         install_data->compression, install_data->text_size,
+                         install_data->shared_store_abspath,
                          scratch_pool),
-    wcroot->sdb);
+    wcroot);
 
-  return SVN_NO_ERROR;
+  return svn_error_trace(svn_wc__db_bulk_note_change(wcroot));
 }
 
 svn_error_t *
@@ -514,13 +947,17 @@ svn_wc__db_pristine_get_sha1(const svn_checksum_t **sha1_checksum,
 }
 
 /* Handle the moving of a pristine from SRC_WCROOT to DST_WCROOT. The existing
-   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM and SIZE */
+   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM, SIZE and
+   COMPRESSION.  If DST_WCROOT can't hold compressed texts, decompress it.
+   SHARED_STORE_ABSPATH is the shared pristine store, if any. */
 static svn_error_t *
 maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
                             svn_wc__db_wcroot_t *dst_wcroot,
                             const svn_checksum_t *checksum,
                             const svn_checksum_t *md5_checksum,
                             apr_int64_t size,
+                            int compression,
+                            const char *shared_store_abspath,
                             svn_cancel_func_t cancel_func,
                             void *cancel_baton,
                             apr_pool_t *scratch_pool)
@@ -531,14 +968,21 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
   svn_stream_t *dst_stream;
   const char *tmp_abspath;
   const char *src_abspath;
+  int dst_compression = compression;
   int affected_rows;
   svn_error_t *err;
 
+  /* Older clients would read compressed texts verbatim. */
+  if (dst_wcroot->format < SVN_WC__COMPRESSED_PRISTINES)
+    dst_compression = 0;
+
   SVN_ERR(svn_sqlite__get_statement(&stmt, dst_wcroot->sdb,
                                     STMT_INSERT_OR_IGNORE_PRISTINE));
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, checksum, scratch_pool));
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
   SVN_ERR(svn_sqlite__bind_int64(stmt, 3, size));
+  if (dst_compression)
+    SVN_ERR(svn_sqlite__bind_int(stmt, 4, dst_compression));
 
   SVN_ERR(svn_sqlite__update(&affected_rows, stmt));
 
@@ -557,6 +1001,8 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
 
   SVN_ERR(svn_stream_open_readonly(&src_stream, src_abspath,
                                    scratch_pool, scratch_pool));
+  if (compression != dst_compression)
+    src_stream = svn__stream_compressed_lz4(src_stream, scratch_pool);
 
   /* ### Should we verify the SHA1 or MD5 here, or is that too expensive? */
   SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
@@ -593,6 +1039,10 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
   else
     SVN_ERR(err);
 
+  if (shared_store_abspath && !dst_compression)
+    SVN_ERR(share_pristine(shared_store_abspath, checksum, pristine_abspath,
+                           scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -603,6 +1053,7 @@ static svn_error_t *
 pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
                        svn_wc__db_wcroot_t *dst_wcroot,
                        const char *src_relpath,
+                       const char *shared_store_abspath,
                        svn_cancel_func_t cancel_func,
                        void *cancel_baton,
                        apr_pool_t *scratch_pool)
@@ -623,6 +1074,7 @@ pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
       const svn_checksum_t *checksum;
       const svn_checksum_t *md5_checksum;
       apr_int64_t size;
+      int compression;
       svn_error_t *err;
 
       svn_pool_clear(iterpool);
@@ -630,9 +1082,11 @@ pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
       SVN_ERR(svn_sqlite__column_checksum(&checksum, stmt, 0, iterpool));
       SVN_ERR(svn_sqlite__column_checksum(&md5_checksum, stmt, 1, iterpool));
       size = svn_sqlite__column_int64(stmt, 2);
+      compression = svn_sqlite__column_int(stmt, 3);
 
       err = maybe_transfer_one_pristine(src_wcroot, dst_wcroot,
                                         checksum, md5_checksum, size,
+                                        compression, shared_store_abspath,
                                         cancel_func, cancel_baton,
                                         iterpool);
 
@@ -678,6 +1132,7 @@ svn_wc__db_pristine_transfer(svn_wc__db_t *db,
 
   SVN_WC__DB_WITH_TXN(
     pristine_transfer_txn(src_wcroot, dst_wcroot, src_relpath,
+                          db->shared_pristine_abspath,
                           cancel_func, cancel_baton, scratch_pool),
     dst_wcroot);
 
@@ -689,7 +1144,9 @@ svn_wc__db_pristine_transfer(svn_wc__db_t *db,
 
 /* If the pristine text referenced by SHA1_CHECKSUM in WCROOT/SDB, whose path
  * within the pristine store is PRISTINE_ABSPATH, has a reference count of
- * zero, delete it (both the database row and the disk file).
+ * zero, delete it (both the database row and the disk file).  Also remove
+ * it from the shared pristine store at SHARED_STORE_ABSPATH, if that is not
+ * NULL and no other working copy uses the text.
  *
  * This function expects to be executed inside a SQLite txn that has already
  * acquired a 'RESERVED' lock.
@@ -699,6 +1156,7 @@ pristine_remove_if_unreferenced_txn(svn_sqlite__db_t *sdb,
                                     svn_wc__db_wcroot_t *wcroot,
                                     const svn_checksum_t *sha1_checksum,
                                     const char *pristine_abspath,
+                                    const char *shared_store_abspath,
                                     apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
@@ -724,6 +1182,10 @@ pristine_remove_if_unreferenced_txn(svn_sqlite__db_t *sdb,
 
       SVN_ERR(svn_io_remove_file2(pristine_abspath, ignore_enoent,
                                   scratch_pool));
+
+      if (shared_store_abspath)
+        SVN_ERR(unshare_pristine(shared_store_abspath, sha1_checksum,
+                                 scratch_pool));
     }
 
   return SVN_NO_ERROR;
@@ -731,12 +1193,14 @@ pristine_remove_if_unreferenced_txn(svn_sqlite__db_t *sdb,
 
 /* If the pristine text referenced by SHA1_CHECKSUM in WCROOT has a
  * reference count of zero, delete it (both the database row and the disk
- * file).
+ * file), and from the shared pristine store SHARED_STORE_ABSPATH if that is
+ * not NULL.
  *
  * Implements 'notes/wc-ng/pristine-store' section A-3(b). */
 static svn_error_t *
 pristine_remove_if_unreferenced(svn_wc__db_wcroot_t *wcroot,
                                 const svn_checksum_t *sha1_checksum,
+                                const char *shared_store_abspath,
                                 apr_pool_t *scratch_pool)
 {
   const char *pristine_abspath;
@@ -746,10 +1210,11 @@ pristine_remove_if_unreferenced(svn_wc__db_wcroot_t *wcroot,
 
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
    * at the disk, to ensure no concurrent pristine install/delete txn. */
-  SVN_SQLITE__WITH_IMMEDIATE_TXN(
+  WITH_IMMEDIATE_TXN(
     pristine_remove_if_unreferenced_txn(
-      wcroot->sdb, wcroot, sha1_checksum, pristine_abspath, scratch_pool),
-    wcroot->sdb);
+      wcroot->sdb, wcroot, sha1_checksum, pristine_abspath,
+      shared_store_abspath, scratch_pool),
+    wcroot);
 
   return SVN_NO_ERROR;
 }
@@ -792,7 +1257,9 @@ svn_wc__db_pristine_remove(svn_wc__db_t *db,
   }
 
   /* If not referenced, remove the PRISTINE table row and the file. */
-  SVN_ERR(pristine_remove_if_unreferenced(wcroot, sha1_checksum, scratch_pool));
+  SVN_ERR(pristine_remove_if_unreferenced(wcroot, sha1_checksum,
+                                          db->shared_pristine_abspath,
+                                          scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -831,6 +1298,7 @@ svn_wc__db_pristine_remove(svn_wc__db_t *db,
  */
 static svn_error_t *
 pristine_cleanup_wcroot(svn_wc__db_wcroot_t *wcroot,
+                        const char *shared_store_abspath,
                         apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
@@ -854,6 +1322,7 @@ pristine_cleanup_wcroot(svn_wc__db_wcroot_t *wcroot,
       SVN_ERR(svn_sqlite__column_checksum(&sha1_checksum, stmt, 0,
                                           iterpool));
       err = pristine_remove_if_unreferenced(wcroot, sha1_checksum,
+                                            shared_store_abspath,
                                             iterpool);
     }
 
@@ -863,6 +1332,79 @@ pristine_cleanup_wcroot(svn_wc__db_wcroot_t *wcroot,
       svn_error_compose_create(err, svn_sqlite__reset(stmt)));
 }
 
+/* Remove all texts from the shared pristine store at SHARED_STORE_ABSPATH
+ * that no working copy links to any more, e.g. because the working copy
+ * was deleted without going through the pristine store. */
+static svn_error_t *
+cleanup_shared_store(const char *shared_store_abspath,
+                     apr_pool_t *scratch_pool)
+{
+  apr_hash_t *subdirs;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *file_pool = svn_pool_create(scratch_pool);
+  svn_error_t *err;
+
+  err = svn_io_get_dirents3(&subdirs, shared_store_abspath, TRUE,
+                            scratch_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  for (hi = apr_hash_first(scratch_pool, subdirs); hi; hi = apr_hash_next(hi))
+    {
+      const char *subdir_abspath;
+      apr_hash_t *files;
+      apr_hash_index_t *hi2;
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+
+      svn_pool_clear(iterpool);
+
+      if (dirent->kind != svn_node_dir || apr_hash_this_key_len(hi) != 2)
+        continue;
+
+      subdir_abspath = svn_dirent_join(shared_store_abspath,
+                                       apr_hash_this_key(hi), iterpool);
+      SVN_ERR(svn_io_get_dirents3(&files, subdir_abspath, TRUE,
+                                  iterpool, iterpool));
+
+      for (hi2 = apr_hash_first(iterpool, files); hi2; hi2 = apr_hash_next(hi2))
+        {
+          const char *name = apr_hash_this_key(hi2);
+          apr_size_t name_len = apr_hash_this_key_len(hi2);
+          const apr_size_t ext_len = sizeof(PRISTINE_STORAGE_EXT) - 1;
+          const char *file_abspath;
+          apr_finfo_t finfo;
+
+          svn_pool_clear(file_pool);
+
+          dirent = apr_hash_this_val(hi2);
+          if (dirent->kind != svn_node_file
+              || name_len < ext_len
+              || strcmp(name + name_len - ext_len, PRISTINE_STORAGE_EXT) != 0)
+            continue;
+
+          file_abspath = svn_dirent_join(subdir_abspath, name, file_pool);
+          err = svn_io_stat(&finfo, file_abspath, APR_FINFO_NLINK, file_pool);
+          if (err)
+            {
+              svn_error_clear(err);
+              continue;
+            }
+
+          if ((finfo.valid & APR_FINFO_NLINK) && finfo.nlink == 1)
+            SVN_ERR(svn_io_remove_file2(file_abspath, TRUE, file_pool));
+        }
+    }
+
+  svn_pool_destroy(file_pool);
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
                             const char *wri_abspath,
@@ -877,7 +1419,11 @@ svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
                               wri_abspath, scratch_pool, scratch_pool));
   VERIFY_USABLE_WCROOT(wcroot);
 
-  SVN_ERR(pristine_cleanup_wcroot(wcroot, scratch_pool));
+  SVN_ERR(pristine_cleanup_wcroot(wcroot, db->shared_pristine_abspath,
+                                  scratch_pool));
+
+  if (db->shared_pristine_abspath)
+    SVN_ERR(cleanup_shared_store(db->shared_pristine_abspath, scratch_pool));
 
   return SVN_NO_ERROR;
 }
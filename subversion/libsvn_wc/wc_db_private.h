@@ -52,6 +52,17 @@ struct svn_wc__db_t {
   /* Busy timeout in ms., 0 for the libsvn_subr default. */
   apr_int32_t timeout;
 
+  /* Number of threads used to run file installs from the work queue.
+     1 runs them one after another. */
+  int install_threads;
+
+  /* Root of the shared pristine store that pristine texts of all working
+     copies are hard linked to, or NULL if there is none. */
+  const char *shared_pristine_abspath;
+
+  /* Should new pristine texts be stored compressed? */
+  svn_boolean_t compress_pristines;
+
   /* Map a given working copy directory to its relevant data.
      const char *local_abspath -> svn_wc__db_wcroot_t *wcroot  */
   apr_hash_t *dir_data;
@@ -107,6 +118,14 @@ typedef struct svn_wc__db_wcroot_t {
      const char *local_abspath -> svn_wc_adm_access_t *adm_access */
   apr_hash_t *access_cache;
 
+  /* Number of nested bulk operations active on SDB, see
+     svn_wc__db_bulk_begin().  BULK_TXN is TRUE while one of them keeps a
+     transaction open and BULK_CHANGES counts the changes made since that
+     transaction got started.  */
+  int bulk_depth;
+  svn_boolean_t bulk_txn;
+  int bulk_changes;
+
 } svn_wc__db_wcroot_t;
 
 
@@ -148,14 +167,27 @@ svn_wc__db_wcroot_parse_local_abspath(svn_wc__db_wcroot_t **wcroot,
                                       apr_pool_t *result_pool,
                                       apr_pool_t *scratch_pool);
 
+/* Prepare for a change in WCROOT.  If a bulk operation is active on
+   WCROOT and has no open transaction, start one.  */
+svn_error_t *
+svn_wc__db_bulk_start_change(svn_wc__db_wcroot_t *wcroot);
+
+/* Note that a change has been made in WCROOT, within the transaction of
+   a bulk operation if there is one.  */
+svn_error_t *
+svn_wc__db_bulk_note_change(svn_wc__db_wcroot_t *wcroot);
+
 /* Return an error if the work queue in SDB is non-empty. */
 svn_error_t *
 svn_wc__db_verify_no_work(svn_sqlite__db_t *sdb);
 
-/* Assert that the given WCROOT is usable.
+/* Assert that the given WCROOT is usable, i.e. that it uses the current
+   format or the optional SVN_WC__COMPRESSED_PRISTINES format.
    NOTE: the expression is multiply-evaluated!!  */
 #define VERIFY_USABLE_WCROOT(wcroot)  SVN_ERR_ASSERT(               \
-    (wcroot) != NULL && (wcroot)->format == SVN_WC__VERSION)
+    (wcroot) != NULL                                                \
+    && ((wcroot)->format == SVN_WC__VERSION                         \
+        || (wcroot)->format == SVN_WC__COMPRESSED_PRISTINES))
 
 /* Check if the WCROOT is usable for light db operations such as path
    calculations */
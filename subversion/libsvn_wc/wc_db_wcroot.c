@@ -232,6 +232,7 @@ svn_wc__db_open(svn_wc__db_t **db,
   (*db)->verify_format = !open_without_upgrade;
   (*db)->enforce_empty_wq = enforce_empty_wq;
   (*db)->dir_data = apr_hash_make(result_pool);
+  (*db)->install_threads = SVN_WC__DEFAULT_INSTALL_THREADS;
 
   (*db)->state_pool = result_pool;
 
@@ -240,7 +241,10 @@ svn_wc__db_open(svn_wc__db_t **db,
     {
       svn_error_t *err;
       svn_boolean_t sqlite_exclusive = FALSE;
+      svn_boolean_t compress_pristines = FALSE;
       apr_int64_t timeout;
+      apr_int64_t install_threads;
+      const char *shared_pristine;
 
       err = svn_config_get_bool(config, &sqlite_exclusive,
                                 SVN_CONFIG_SECTION_WORKING_COPY,
@@ -261,6 +265,37 @@ svn_wc__db_open(svn_wc__db_t **db,
         svn_error_clear(err);
       else
         (*db)->timeout = (apr_int32_t)timeout;
+
+      err = svn_config_get_int64(config, &install_threads,
+                                 SVN_CONFIG_SECTION_WORKING_COPY,
+                                 SVN_CONFIG_OPTION_INSTALL_THREADS,
+                                 SVN_WC__DEFAULT_INSTALL_THREADS);
+      if (err || install_threads < 1
+          || install_threads > SVN_WC__MAX_INSTALL_THREADS)
+        svn_error_clear(err);
+      else
+        (*db)->install_threads = (int)install_threads;
+
+      svn_config_get(config, &shared_pristine,
+                     SVN_CONFIG_SECTION_WORKING_COPY,
+                     SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE, NULL);
+      if (shared_pristine && *shared_pristine)
+        {
+          shared_pristine = svn_dirent_internal_style(shared_pristine,
+                                                      scratch_pool);
+          if (svn_dirent_is_absolute(shared_pristine))
+            (*db)->shared_pristine_abspath = apr_pstrdup(result_pool,
+                                                         shared_pristine);
+        }
+
+      err = svn_config_get_bool(config, &compress_pristines,
+                                SVN_CONFIG_SECTION_WORKING_COPY,
+                                SVN_CONFIG_OPTION_COMPRESS_PRISTINES,
+                                FALSE);
+      if (err)
+        svn_error_clear(err);
+      else
+        (*db)->compress_pristines = compress_pristines;
     }
 
   return SVN_NO_ERROR;
@@ -321,7 +356,7 @@ svn_wc__db_pdh_create_wcroot(svn_wc__db_wcroot_t **wcroot,
     }
 
   /* If this working copy is from a future version, then bail out.  */
-  if (format > SVN_WC__VERSION)
+  if (format > SVN_WC__COMPRESSED_PRISTINES)
     {
       return svn_error_createf(
         SVN_ERR_WC_UNSUPPORTED_FORMAT, NULL,
@@ -377,6 +412,9 @@ svn_wc__db_pdh_create_wcroot(svn_wc__db_wcroot_t **wcroot,
   (*wcroot)->owned_locks = apr_array_make(result_pool, 8,
                                           sizeof(svn_wc__db_wclock_t));
   (*wcroot)->access_cache = apr_hash_make(result_pool);
+  (*wcroot)->bulk_depth = 0;
+  (*wcroot)->bulk_txn = FALSE;
+  (*wcroot)->bulk_changes = 0;
 
   /* SDB will be NULL for pre-NG working copies. We only need to run a
      cleanup when the SDB is present.  */
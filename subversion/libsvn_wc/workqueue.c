@@ -22,6 +22,7 @@
  */
 
 #include <apr_pools.h>
+#include <apr_thread_proc.h>
 
 #include "svn_private_config.h"
 #include "svn_types.h"
@@ -30,6 +31,7 @@
 #include "svn_subst.h"
 #include "svn_hash.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -38,8 +40,10 @@
 #include "conflicts.h"
 #include "translate.h"
 
+#include "private/svn_atomic.h"
 #include "private/svn_io_private.h"
 #include "private/svn_skel.h"
+#include "private/svn_subr_private.h"
 
 
 /* Workqueue operation names.  */
@@ -77,7 +81,12 @@ struct work_item_dispatch {
                        apr_pool_t *scratch_pool);
 };
 
-/* Forward definition */
+/* Forward definitions */
+static void
+record_fileinfo(work_item_baton_t *wqb,
+                const char *local_abspath,
+                const svn_io_dirent2_t *dirent);
+
 static svn_error_t *
 get_and_record_fileinfo(work_item_baton_t *wqb,
                         const char *local_abspath,
@@ -445,41 +454,62 @@ svn_wc__wq_build_postupgrade(svn_skel_t **work_item,
 
 /* OP_FILE_INSTALL */
 
-/* Process the OP_FILE_INSTALL work item WORK_ITEM.
- * See svn_wc__wq_build_file_install() which generates this work item.
- * Implements (struct work_item_dispatch).func. */
+/* Everything needed to install the file for one OP_FILE_INSTALL work item.
+   All of it gets read from the DB up front, so that install_file() itself
+   does not touch the DB and may run in a separate thread. */
+typedef struct file_install_t
+{
+  /* The file to install and where to read its "normal form" from. */
+  const char *local_abspath;
+  const char *source_abspath;
+
+  /* Whether SOURCE_ABSPATH is a compressed pristine text. */
+  svn_boolean_t source_compressed;
+
+  /* How to translate the source into the working file. */
+  svn_subst_eol_style_t style;
+  const char *eol;
+  apr_hash_t *keywords;
+  svn_boolean_t special;
+
+  /* Where to put the temporary file.  Unused for special files. */
+  const char *temp_dir_abspath;
+
+  /* How to tweak the installed file. */
+  svn_boolean_t set_executable;
+  svn_boolean_t set_read_only;
+  apr_time_t affected_time; /* 0 to keep the current time */
+
+  /* If not NULL, install_file() will fill this with the size and
+     timestamp of the installed file. */
+  svn_io_dirent2_t *dirent;
+} file_install_t;
+
+/* Read all information for the OP_FILE_INSTALL WORK_ITEM from DB and
+   return it in *INSTALL, allocated in RESULT_POOL. */
 static svn_error_t *
-run_file_install(work_item_baton_t *wqb,
-                 svn_wc__db_t *db,
-                 const svn_skel_t *work_item,
-                 const char *wri_abspath,
-                 svn_cancel_func_t cancel_func,
-                 void *cancel_baton,
-                 apr_pool_t *scratch_pool)
+prepare_file_install(file_install_t **install,
+                     svn_wc__db_t *db,
+                     const svn_skel_t *work_item,
+                     const char *wri_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
 {
   const svn_skel_t *arg1 = work_item->children->next;
   const svn_skel_t *arg4 = arg1->next->next->next;
+  file_install_t *fi = apr_pcalloc(result_pool, sizeof(*fi));
   const char *local_relpath;
-  const char *local_abspath;
   svn_boolean_t use_commit_times;
   svn_boolean_t record_fileinfo;
-  svn_boolean_t special;
-  svn_stream_t *src_stream;
-  svn_subst_eol_style_t style;
-  const char *eol;
-  apr_hash_t *keywords;
-  const char *temp_dir_abspath;
-  svn_stream_t *dst_stream;
   apr_int64_t val;
   const char *wcroot_abspath;
-  const char *source_abspath;
   const svn_checksum_t *checksum;
   apr_hash_t *props;
   apr_time_t changed_date;
 
   local_relpath = apr_pstrmemdup(scratch_pool, arg1->data, arg1->len);
-  SVN_ERR(svn_wc__db_from_relpath(&local_abspath, db, wri_abspath,
-                                  local_relpath, scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc__db_from_relpath(&fi->local_abspath, db, wri_abspath,
+                                  local_relpath, result_pool, scratch_pool));
 
   SVN_ERR(svn_skel__parse_int(&val, arg1->next, scratch_pool));
   use_commit_times = (val != 0);
@@ -489,16 +519,17 @@ run_file_install(work_item_baton_t *wqb,
   SVN_ERR(svn_wc__db_read_node_install_info(&wcroot_abspath,
                                             &checksum, &props,
                                             &changed_date,
-                                            db, local_abspath, wri_abspath,
+                                            db, fi->local_abspath,
+                                            wri_abspath,
                                             scratch_pool, scratch_pool));
 
   if (arg4 != NULL)
     {
       /* Use the provided path for the source.  */
       local_relpath = apr_pstrmemdup(scratch_pool, arg4->data, arg4->len);
-      SVN_ERR(svn_wc__db_from_relpath(&source_abspath, db, wri_abspath,
+      SVN_ERR(svn_wc__db_from_relpath(&fi->source_abspath, db, wri_abspath,
                                       local_relpath,
-                                      scratch_pool, scratch_pool));
+                                      result_pool, scratch_pool));
     }
   else if (! checksum)
     {
@@ -513,67 +544,139 @@ run_file_install(work_item_baton_t *wqb,
                                _("Can't install '%s' from pristine store, "
                                  "because no checksum is recorded for this "
                                  "file"),
-                               svn_dirent_local_style(local_abspath,
+                               svn_dirent_local_style(fi->local_abspath,
                                                       scratch_pool));
     }
   else
     {
-      SVN_ERR(svn_wc__db_pristine_get_future_path(&source_abspath,
+      SVN_ERR(svn_wc__db_pristine_get_future_path(&fi->source_abspath,
                                                   wcroot_abspath,
                                                   checksum,
-                                                  scratch_pool, scratch_pool));
+                                                  result_pool, scratch_pool));
+      SVN_ERR(svn_wc__db_pristine_is_compressed(&fi->source_compressed,
+                                                db, wcroot_abspath, checksum,
+                                                scratch_pool));
     }
 
-  SVN_ERR(svn_stream_open_readonly(&src_stream, source_abspath,
-                                   scratch_pool, scratch_pool));
-
   /* Fetch all the translation bits.  */
-  SVN_ERR(svn_wc__get_translate_info(&style, &eol,
-                                     &keywords,
-                                     &special, db, local_abspath,
+  SVN_ERR(svn_wc__get_translate_info(&fi->style, &fi->eol,
+                                     &fi->keywords,
+                                     &fi->special, db, fi->local_abspath,
                                      props, FALSE,
-                                     scratch_pool, scratch_pool));
-  if (special)
+                                     result_pool, scratch_pool));
+  if (fi->special)
+    {
+      /* No need to set exec or read-only flags on special files.  */
+
+      /* ### Shouldn't this record a timestamp and size, etc.? */
+      *install = fi;
+      return SVN_NO_ERROR;
+    }
+
+  /* Where is the Right Place to put a temp file in this working copy?  */
+  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&fi->temp_dir_abspath,
+                                         db, wcroot_abspath,
+                                         result_pool, scratch_pool));
+
+#ifndef WIN32
+  fi->set_executable = (props && svn_hash_gets(props, SVN_PROP_EXECUTABLE));
+#endif
+
+  /* Note that this explicitly checks the pristine properties, to make sure
+     that when the lock is locally set (=modification) it is not read only */
+  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
+    {
+      svn_wc__db_status_t status;
+      svn_wc__db_lock_t *lock;
+      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL,
+                                   db, fi->local_abspath,
+                                   scratch_pool, scratch_pool));
+
+      fi->set_read_only = (!lock && status != svn_wc__db_status_added);
+    }
+
+  if (use_commit_times)
+    fi->affected_time = changed_date;
+
+  if (record_fileinfo)
+    fi->dirent = apr_pcalloc(result_pool, sizeof(*fi->dirent));
+
+  *install = fi;
+  return SVN_NO_ERROR;
+}
+
+/* Install the file described by INSTALL into the working copy, without
+   accessing the working copy DB.  Use SCRATCH_POOL for temporary
+   allocations.
+
+   This does not allocate from any pool other than SCRATCH_POOL, so it may
+   run in a separate thread as long as that pool is thread-local. */
+static svn_error_t *
+install_file(file_install_t *install,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *scratch_pool)
+{
+  svn_stream_t *src_stream;
+  svn_stream_t *dst_stream;
+
+  SVN_ERR(svn_stream_open_readonly(&src_stream, install->source_abspath,
+                                   scratch_pool, scratch_pool));
+  if (install->source_compressed)
+    src_stream = svn__stream_compressed_lz4(src_stream, scratch_pool);
+
+  if (install->special)
     {
       /* When this stream is closed, the resulting special file will
          atomically be created/moved into place at LOCAL_ABSPATH.  */
-      SVN_ERR(svn_subst_create_specialfile(&dst_stream, local_abspath,
+      SVN_ERR(svn_subst_create_specialfile(&dst_stream,
+                                           install->local_abspath,
                                            scratch_pool, scratch_pool));
 
       /* Copy the "repository normal" form of the special file into the
          special stream.  */
-      SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
-                               cancel_func, cancel_baton,
-                               scratch_pool));
-
-      /* No need to set exec or read-only flags on special files.  */
-
-      /* ### Shouldn't this record a timestamp and size, etc.? */
-      return SVN_NO_ERROR;
+      return svn_error_trace(svn_stream_copy3(src_stream, dst_stream,
+                                              cancel_func, cancel_baton,
+                                              scratch_pool));
     }
 
-  if (svn_subst_translation_required(style, eol, keywords,
+  /* Translate to a temporary file. We don't want the user seeing a partial
+     file, nor let them muck with it while we translate. We may also need to
+     get its TRANSLATED_SIZE before the user can monkey it.  */
+  SVN_ERR(svn_stream__create_for_install(&dst_stream,
+                                         install->temp_dir_abspath,
+                                         scratch_pool, scratch_pool));
+
+  if (svn_subst_translation_required(install->style, install->eol,
+                                     install->keywords,
                                      FALSE /* special */,
                                      TRUE /* force_eol_check */))
     {
       /* Wrap it in a translating (expanding) stream.  */
-      src_stream = svn_subst_stream_translated(src_stream, eol,
+      src_stream = svn_subst_stream_translated(src_stream, install->eol,
                                                TRUE /* repair */,
-                                               keywords,
+                                               install->keywords,
                                                TRUE /* expand */,
                                                scratch_pool);
     }
+  else if (!install->source_compressed)
+    {
+      svn_boolean_t cloned;
 
-  /* Where is the Right Place to put a temp file in this working copy?  */
-  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&temp_dir_abspath,
-                                         db, wcroot_abspath,
-                                         scratch_pool, scratch_pool));
-
-  /* Translate to a temporary file. We don't want the user seeing a partial
-     file, nor let them muck with it while we translate. We may also need to
-     get its TRANSLATED_SIZE before the user can monkey it.  */
-  SVN_ERR(svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
-                                         scratch_pool, scratch_pool));
+      /* The working file is identical to the pristine, so let the file
+         system share the data blocks between them if it can.  */
+      SVN_ERR(svn_io__file_clone(&cloned, svn_stream__aprfile(dst_stream),
+                                 svn_stream__aprfile(src_stream),
+                                 scratch_pool));
+      if (cloned)
+        {
+          SVN_ERR(svn_stream_close(src_stream));
+          src_stream = svn_stream_empty(scratch_pool);
+        }
+    }
 
   /* Copy from the source to the dest, translating as we go. This will also
      close both streams.  */
@@ -585,52 +688,61 @@ run_file_install(work_item_baton_t *wqb,
   /* With a single db we might want to install files in a missing directory.
      Simply trying this scenario on error won't do any harm and at least
      one user reported this problem on IRC. */
-  SVN_ERR(svn_stream__install_stream(dst_stream, local_abspath,
+  SVN_ERR(svn_stream__install_stream(dst_stream, install->local_abspath,
                                      TRUE /* make_parents*/, scratch_pool));
 
   /* Tweak the on-disk file according to its properties.  */
-#ifndef WIN32
-  if (props && svn_hash_gets(props, SVN_PROP_EXECUTABLE))
-    SVN_ERR(svn_io_set_file_executable(local_abspath, TRUE, FALSE,
+  if (install->set_executable)
+    SVN_ERR(svn_io_set_file_executable(install->local_abspath, TRUE, FALSE,
                                        scratch_pool));
-#endif
 
-  /* Note that this explicitly checks the pristine properties, to make sure
-     that when the lock is locally set (=modification) it is not read only */
-  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
-    {
-      svn_wc__db_status_t status;
-      svn_wc__db_lock_t *lock;
-      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL,
-                                   db, local_abspath,
-                                   scratch_pool, scratch_pool));
-
-      if (!lock && status != svn_wc__db_status_added)
-        SVN_ERR(svn_io_set_file_read_only(local_abspath, FALSE, scratch_pool));
-    }
+  if (install->set_read_only)
+    SVN_ERR(svn_io_set_file_read_only(install->local_abspath, FALSE,
+                                      scratch_pool));
 
-  if (use_commit_times)
-    {
-      if (changed_date)
-        SVN_ERR(svn_io_set_file_affected_time(changed_date,
-                                              local_abspath,
-                                              scratch_pool));
-    }
+  if (install->affected_time)
+    SVN_ERR(svn_io_set_file_affected_time(install->affected_time,
+                                          install->local_abspath,
+                                          scratch_pool));
 
   /* ### this should happen before we rename the file into place.  */
-  if (record_fileinfo)
+  if (install->dirent)
     {
-      SVN_ERR(get_and_record_fileinfo(wqb, local_abspath,
-                                      FALSE /* ignore_enoent */,
-                                      scratch_pool));
+      const svn_io_dirent2_t *dirent;
+
+      SVN_ERR(svn_io_stat_dirent2(&dirent, install->local_abspath,
+                                  FALSE, FALSE /* ignore_enoent */,
+                                  scratch_pool, scratch_pool));
+      *install->dirent = *dirent;
     }
 
   return SVN_NO_ERROR;
 }
 
+/* Process the OP_FILE_INSTALL work item WORK_ITEM.
+ * See svn_wc__wq_build_file_install() which generates this work item.
+ * Implements (struct work_item_dispatch).func. */
+static svn_error_t *
+run_file_install(work_item_baton_t *wqb,
+                 svn_wc__db_t *db,
+                 const svn_skel_t *work_item,
+                 const char *wri_abspath,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  file_install_t *install;
+
+  SVN_ERR(prepare_file_install(&install, db, work_item, wri_abspath,
+                               scratch_pool, scratch_pool));
+  SVN_ERR(install_file(install, cancel_func, cancel_baton, scratch_pool));
+
+  if (install->dirent)
+    record_fileinfo(wqb, install->local_abspath, install->dirent);
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_wc__wq_build_file_install(svn_skel_t **work_item,
@@ -1474,8 +1586,294 @@ dispatch_work_item(work_item_baton_t *wqb,
 }
 
 
-svn_error_t *
-svn_wc__wq_run(svn_wc__db_t *db,
+/* Wrap ERR, the failure of the work item WORK_ITEM with identifier ID in
+   the work queue of WRI_ABSPATH, the way svn_wc__wq_run() reports it. */
+static svn_error_t *
+work_item_error(svn_error_t *err,
+                const char *wri_abspath,
+                apr_uint64_t id,
+                const svn_skel_t *work_item,
+                apr_pool_t *scratch_pool)
+{
+  const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
+
+  return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
+                           _("Failed to run the WC DB work queue "
+                             "associated with '%s', work item %d %s"),
+                           svn_dirent_local_style(wri_abspath,
+                                                  scratch_pool),
+                           (int)id, skel);
+}
+
+/* Maximum number of OP_FILE_INSTALL work items to run as one batch.  */
+#define INSTALL_BATCH_SIZE 256
+
+/* Return TRUE if WORK_ITEM is an OP_FILE_INSTALL item that may run as part
+   of a batch.  That excludes installs from an explicit source file, as
+   that file may be created or removed by other work items.  */
+static svn_boolean_t
+is_batchable_install(const svn_skel_t *work_item)
+{
+  return (svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL)
+          && svn_skel__list_length(work_item) == 4);
+}
+
+/* A batch of file installs that may run concurrently.  */
+typedef struct install_batch_t
+{
+  /* The installs to run, file_install_t * in queue order.  */
+  apr_array_header_t *installs;
+
+  /* The result of each element of INSTALLS.  */
+  svn_error_t **errors;
+
+  /* Index of the next element of INSTALLS to pick up.  */
+  volatile svn_atomic_t next;
+
+  /* The caller's cancellation callback.  Only ever invoked from the
+     calling thread, as it need not be thread-safe.  May be NULL.  */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Set once CANCEL_FUNC returned an error, to stop the other threads.  */
+  volatile svn_atomic_t cancelled;
+} install_batch_t;
+
+/* Implements svn_cancel_func_t for the calling thread of the
+   install_batch_t BATON.  Invokes the caller's cancellation callback and
+   notifies the other threads if it returns an error.  */
+static svn_error_t *
+check_batch_cancel(void *baton)
+{
+  install_batch_t *batch = baton;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  if (batch->cancel_func)
+    err = batch->cancel_func(batch->cancel_baton);
+
+  if (err)
+    svn_atomic_set(&batch->cancelled, TRUE);
+
+  return svn_error_trace(err);
+}
+
+/* Implements svn_cancel_func_t for the other threads working on the
+   install_batch_t BATON.  */
+static svn_error_t *
+check_batch_cancelled(void *baton)
+{
+  install_batch_t *batch = baton;
+
+  if (svn_atomic_read(&batch->cancelled))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Run installs from BATCH until there are none left, checking for
+   cancellation with CANCEL_FUNC, which is either check_batch_cancel or
+   check_batch_cancelled.  This may be called from multiple threads at
+   the same time.  */
+static void
+run_batch_installs(install_batch_t *batch,
+                   svn_cancel_func_t cancel_func)
+{
+  /* Each thread needs its own, thread-safe pool.  */
+  apr_pool_t *iterpool = svn_pool_create(NULL);
+  apr_uint32_t i;
+
+  while ((i = svn_atomic_inc(&batch->next))
+         < (apr_uint32_t)batch->installs->nelts)
+    {
+      file_install_t *install = APR_ARRAY_IDX(batch->installs, i,
+                                              file_install_t *);
+
+      svn_pool_clear(iterpool);
+      batch->errors[i] = cancel_func(batch);
+      if (! batch->errors[i])
+        batch->errors[i] = install_file(install, cancel_func, batch,
+                                        iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+}
+
+#if APR_HAS_THREADS
+
+/* Thread entry point for run_install_batch().  BATON is the
+   install_batch_t to work on.  */
+static void * APR_THREAD_FUNC
+install_thread(apr_thread_t *thread,
+               void *baton)
+{
+  run_batch_installs(baton, check_batch_cancelled);
+  apr_thread_exit(thread, APR_SUCCESS);
+
+  return NULL;
+}
+
+#endif
+
+/* Run the OP_FILE_INSTALL item FIRST_ITEM with identifier FIRST_ID in the
+   work queue of WRI_ABSPATH in DB, together with the independent installs
+   queued directly after it, using up to THREADS threads to write the files.
+   Set *COMPLETED_IDS to the apr_uint64_t identifiers of all items that
+   were run, allocated in RESULT_POOL.
+
+   Only the calling thread accesses DB: everything the installs need is
+   read up front and the file information to record is queued in WQB
+   afterwards.  None of the items gets marked as completed here, so an
+   interrupted batch will simply run again as a whole.
+
+   CANCEL_FUNC and CANCEL_BATON get only invoked from the calling thread.  */
+static svn_error_t *
+run_install_batch(apr_array_header_t **completed_ids,
+                  work_item_baton_t *wqb,
+                  svn_wc__db_t *db,
+                  const char *wri_abspath,
+                  apr_uint64_t first_id,
+                  const svn_skel_t *first_item,
+                  int threads,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *ids;
+  apr_array_header_t *work_items;
+  apr_hash_t *targets = apr_hash_make(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  install_batch_t batch = { 0 };
+  file_install_t *install;
+  svn_error_t *err;
+  int i;
+
+  SVN_ERR(svn_wc__db_wq_fetch_following(&ids, &work_items, db, wri_abspath,
+                                        first_id, INSTALL_BATCH_SIZE - 1,
+                                        scratch_pool, iterpool));
+
+  batch.installs = apr_array_make(scratch_pool, work_items->nelts + 1,
+                                  sizeof(file_install_t *));
+
+  err = prepare_file_install(&install, db, first_item, wri_abspath,
+                             scratch_pool, iterpool);
+  if (err)
+    return svn_error_trace(work_item_error(err, wri_abspath, first_id,
+                                           first_item, scratch_pool));
+
+  APR_ARRAY_PUSH(batch.installs, file_install_t *) = install;
+  svn_hash_sets(targets, install->local_abspath, install);
+
+  /* Add following installs up to the first one that must not run
+     concurrently with the ones we already have.  */
+  for (i = 0; i < work_items->nelts; i++)
+    {
+      const svn_skel_t *work_item = APR_ARRAY_IDX(work_items, i,
+                                                  const svn_skel_t *);
+
+      svn_pool_clear(iterpool);
+
+      if (! is_batchable_install(work_item))
+        break;
+
+      err = prepare_file_install(&install, db, work_item, wri_abspath,
+                                 scratch_pool, iterpool);
+      if (err)
+        {
+          /* Leave this item to the next iteration of svn_wc__wq_run(),
+             which will report the error in its own context.  */
+          svn_error_clear(err);
+          break;
+        }
+
+      /* Installs of the same file must happen in queue order.  */
+      if (svn_hash_gets(targets, install->local_abspath))
+        break;
+
+      APR_ARRAY_PUSH(batch.installs, file_install_t *) = install;
+      svn_hash_sets(targets, install->local_abspath, install);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  batch.errors = apr_pcalloc(scratch_pool,
+                             batch.installs->nelts * sizeof(*batch.errors));
+  batch.cancel_func = cancel_func;
+  batch.cancel_baton = cancel_baton;
+  threads = MIN(threads, batch.installs->nelts);
+
+#if APR_HAS_THREADS
+  if (threads > 1)
+    {
+      /* The thread objects must be allocated from a thread-safe pool.  */
+      apr_pool_t *threads_pool = svn_pool_create(NULL);
+      apr_thread_t **workers = apr_pcalloc(threads_pool,
+                                           (threads - 1) * sizeof(*workers));
+      int started;
+
+      /* If we can't start all threads, just run with fewer of them.  */
+      for (started = 0; started < threads - 1; started++)
+        if (apr_thread_create(&workers[started], NULL, install_thread,
+                              &batch, threads_pool))
+          break;
+
+      run_batch_installs(&batch, check_batch_cancel);
+
+      for (i = 0; i < started; i++)
+        {
+          apr_status_t retval;
+          apr_thread_join(&retval, workers[i]);
+        }
+
+      svn_pool_destroy(threads_pool);
+    }
+  else
+#endif
+    run_batch_installs(&batch, check_batch_cancel);
+
+  /* Report the first failure in queue order.  Like svn_wc__wq_run(), pass
+     cancellation through as is.  */
+  err = SVN_NO_ERROR;
+  for (i = 0; i < batch.installs->nelts; i++)
+    {
+      if (batch.errors[i] && !err
+          && batch.errors[i]->apr_err == SVN_ERR_CANCELLED)
+        err = batch.errors[i];
+      else if (batch.errors[i] && !err)
+        err = work_item_error(batch.errors[i], wri_abspath,
+                              i ? APR_ARRAY_IDX(ids, i - 1, apr_uint64_t)
+                                : first_id,
+                              i ? APR_ARRAY_IDX(work_items, i - 1,
+                                                const svn_skel_t *)
+                                : first_item,
+                              scratch_pool);
+      else
+        svn_error_clear(batch.errors[i]);
+    }
+
+  SVN_ERR(err);
+
+  for (i = 0; i < batch.installs->nelts; i++)
+    {
+      install = APR_ARRAY_IDX(batch.installs, i, file_install_t *);
+
+      if (install->dirent)
+        record_fileinfo(wqb, install->local_abspath, install->dirent);
+    }
+
+  *completed_ids = apr_array_make(result_pool, batch.installs->nelts,
+                                  sizeof(apr_uint64_t));
+  APR_ARRAY_PUSH(*completed_ids, apr_uint64_t) = first_id;
+  for (i = 0; i < batch.installs->nelts - 1; i++)
+    APR_ARRAY_PUSH(*completed_ids, apr_uint64_t)
+      = APR_ARRAY_IDX(ids, i, apr_uint64_t);
+
+  return SVN_NO_ERROR;
+}
+
+/* The body of svn_wc__wq_run(). */
+static svn_error_t *
+run_work_queue(svn_wc__db_t *db,
                const char *wri_abspath,
                svn_cancel_func_t cancel_func,
                void *cancel_baton,
@@ -1483,6 +1881,7 @@ svn_wc__wq_run(svn_wc__db_t *db,
 {
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   apr_uint64_t last_id = 0;
+  int install_threads = svn_wc__db_get_install_threads(db);
   work_item_baton_t wib = { 0 };
   wib.result_pool = svn_pool_create(scratch_pool);
 
@@ -1543,27 +1942,74 @@ svn_wc__wq_run(svn_wc__db_t *db,
       if (work_item == NULL)
         break;
 
-      err = dispatch_work_item(&wib, db, wri_abspath, work_item,
-                               cancel_func, cancel_baton, iterpool);
-      if (err)
+      if (install_threads > 1 && is_batchable_install(work_item))
         {
-          const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
-
-          return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
-                                   _("Failed to run the WC DB work queue "
-                                     "associated with '%s', work item %d %s"),
-                                   svn_dirent_local_style(wri_abspath,
-                                                          scratch_pool),
-                                   (int)id, skel);
+          apr_array_header_t *completed_ids;
+
+          /* Runs WORK_ITEM and possibly more items.  Mark exactly those
+             as completed right away, as the next item to fetch is not
+             necessarily the one queued after ID anymore.  */
+          SVN_ERR(run_install_batch(&completed_ids, &wib, db, wri_abspath,
+                                    id, work_item, install_threads,
+                                    cancel_func, cancel_baton,
+                                    iterpool, iterpool));
+          SVN_ERR(svn_wc__db_wq_record_and_complete(db, wri_abspath,
+                                                    completed_ids,
+                                                    wib.record_map,
+                                                    iterpool));
+
+          svn_pool_clear(wib.result_pool);
+          wib.record_map = NULL;
+          wib.used = FALSE;
+          last_id = 0;
+          continue;
+        }
+      else
+        {
+          err = dispatch_work_item(&wib, db, wri_abspath, work_item,
+                                   cancel_func, cancel_baton, iterpool);
+          if (err)
+            return svn_error_trace(work_item_error(err, wri_abspath, id,
+                                                   work_item, scratch_pool));
         }
 
-      /* The work item finished without error. Mark it completed
+      /* The work item(s) finished without error. Mark them completed
          in the next loop.  */
       last_id = id;
     }
 
   svn_pool_destroy(iterpool);
-  return SVN_NO_ERROR;
+
+  /* No work item refers to decompressed pristine texts anymore. */
+  return svn_error_trace(svn_wc__db_pristine_remove_decompressed(
+                           db, wri_abspath, scratch_pool));
+}
+
+svn_error_t *
+svn_wc__wq_run(svn_wc__db_t *db,
+               const char *wri_abspath,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *scratch_pool)
+{
+  int bulk_depth;
+  svn_error_t *err;
+
+  /* Work items may only see changes that can't be rolled back anymore,
+     and completing them must be just as durable.  So commit whatever a
+     bulk operation has collected so far and keep the work queue out of
+     its transactions.  */
+  SVN_ERR(svn_wc__db_bulk_suspend(&bulk_depth, db, wri_abspath,
+                                  scratch_pool));
+
+  err = run_work_queue(db, wri_abspath, cancel_func, cancel_baton,
+                       scratch_pool);
+
+  return svn_error_trace(
+           svn_error_compose_create(err,
+                                    svn_wc__db_bulk_resume(db, wri_abspath,
+                                                           bulk_depth,
+                                                           scratch_pool)));
 }
 
 
@@ -1615,6 +2061,25 @@ svn_wc__wq_merge(svn_skel_t *work_item1,
 }
 
 
+/* Queue the size and timestamp in DIRENT to be recorded for the file
+   LOCAL_ABSPATH once the current work item has been completed. */
+static void
+record_fileinfo(work_item_baton_t *wqb,
+                const char *local_abspath,
+                const svn_io_dirent2_t *dirent)
+{
+  if (dirent->kind != svn_node_file)
+    return;
+
+  wqb->used = TRUE;
+
+  if (! wqb->record_map)
+    wqb->record_map = apr_hash_make(wqb->result_pool);
+
+  svn_hash_sets(wqb->record_map, apr_pstrdup(wqb->result_pool, local_abspath),
+                apr_pmemdup(wqb->result_pool, dirent, sizeof(*dirent)));
+}
+
 static svn_error_t *
 get_and_record_fileinfo(work_item_baton_t *wqb,
                         const char *local_abspath,
@@ -1624,18 +2089,9 @@ get_and_record_fileinfo(work_item_baton_t *wqb,
   const svn_io_dirent2_t *dirent;
 
   SVN_ERR(svn_io_stat_dirent2(&dirent, local_abspath, FALSE, ignore_enoent,
-                              wqb->result_pool, scratch_pool));
-
-  if (dirent->kind != svn_node_file)
-    return SVN_NO_ERROR;
-
-  wqb->used = TRUE;
+                              scratch_pool, scratch_pool));
 
-  if (! wqb->record_map)
-    wqb->record_map = apr_hash_make(wqb->result_pool);
-
-  svn_hash_sets(wqb->record_map, apr_pstrdup(wqb->result_pool, local_abspath),
-                dirent);
+  record_fileinfo(wqb, local_abspath, dirent);
 
   return SVN_NO_ERROR;
 }
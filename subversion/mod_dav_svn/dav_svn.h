@@ -182,7 +182,8 @@ enum dav_svn_private_restype {
   DAV_SVN_RESTYPE_REV_COLLECTION,       /* .../!svn/rev/ */
   DAV_SVN_RESTYPE_REVROOT_COLLECTION,   /* .../!svn/rvr/ */
   DAV_SVN_RESTYPE_TXN_COLLECTION,       /* .../!svn/txn/ */
-  DAV_SVN_RESTYPE_TXNROOT_COLLECTION    /* .../!svn/txr/ */
+  DAV_SVN_RESTYPE_TXNROOT_COLLECTION,   /* .../!svn/txr/ */
+  DAV_SVN_RESTYPE_SHA1_COLLECTION       /* .../!svn/sha1/ */
 };
 
 
@@ -303,6 +304,10 @@ struct dav_resource_private {
   /* whether this resource parameters are fixed and won't change
      between requests. */
   svn_boolean_t idempotent;
+
+  /* Hex SHA-1 checksum of the file text, if this resource was requested
+     through a content-addressed .../!svn/sha1/ URI.  NULL otherwise. */
+  const char *content_sha1;
 };
 
 
@@ -344,6 +349,10 @@ dav_svn__get_nodeprop_cache_flag(request_rec *r);
  * request? */
 svn_boolean_t dav_svn__get_block_read_flag(request_rec *r);
 
+/* for the repository referred to by this request, are content-addressed
+ * (and therefore publicly cacheable) URIs for file texts enabled? */
+svn_boolean_t dav_svn__get_content_urls_flag(request_rec *r);
+
 /* for the repository referred to by this request, are subrequests bypassed?
  * A function pointer if yes, NULL if not.
  */
@@ -441,6 +450,9 @@ const char *dav_svn__get_rev_stub(request_rec *r);
 /* For accessing REV/PATH pairs (typically "!svn/bc") */
 const char *dav_svn__get_rev_root_stub(request_rec *r);
 
+/* For accessing file texts by SHA-1 checksum (typically "!svn/sha1") */
+const char *dav_svn__get_sha1_stub(request_rec *r);
+
 /* For accessing transaction resources (typically "!svn/txn") */
 const char *dav_svn__get_txn_stub(request_rec *r);
 
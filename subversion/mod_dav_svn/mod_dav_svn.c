@@ -107,6 +107,7 @@ typedef struct dir_conf_t {
   enum conf_flag revprop_cache;      /* whether to enable revprop caching */
   enum conf_flag nodeprop_cache;     /* whether to enable nodeprop caching */
   enum conf_flag block_read;         /* whether to enable block read mode */
+  enum conf_flag content_urls;       /* whether to serve !svn/sha1/ URIs */
   const char *hooks_env;             /* path to hook script env config file */
 } dir_conf_t;
 
@@ -283,6 +284,7 @@ merge_dir_config(apr_pool_t *p, void *base, void *overrides)
   newconf->revprop_cache = INHERIT_VALUE(parent, child, revprop_cache);
   newconf->nodeprop_cache = INHERIT_VALUE(parent, child, nodeprop_cache);
   newconf->block_read = INHERIT_VALUE(parent, child, block_read);
+  newconf->content_urls = INHERIT_VALUE(parent, child, content_urls);
   newconf->root_dir = INHERIT_VALUE(parent, child, root_dir);
   newconf->hooks_env = INHERIT_VALUE(parent, child, hooks_env);
 
@@ -604,6 +606,19 @@ SVNBlockRead_cmd(cmd_parms *cmd, void *config, int arg)
   return NULL;
 }
 
+static const char *
+SVNContentURLs_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  dir_conf_t *conf = config;
+
+  if (arg)
+    conf->content_urls = CONF_FLAG_ON;
+  else
+    conf->content_urls = CONF_FLAG_OFF;
+
+  return NULL;
+}
+
 static const char *
 SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -845,6 +860,14 @@ dav_svn__get_rev_root_stub(request_rec *r)
 }
 
 
+const char *
+dav_svn__get_sha1_stub(request_rec *r)
+{
+  return apr_pstrcat(r->pool, dav_svn__get_special_uri(r), "/sha1",
+                     SVN_VA_NULL);
+}
+
+
 const char *
 dav_svn__get_txn_stub(request_rec *r)
 {
@@ -1027,6 +1050,17 @@ dav_svn__get_block_read_flag(request_rec *r)
   return get_conf_flag(conf->block_read, FALSE);
 }
 
+svn_boolean_t
+dav_svn__get_content_urls_flag(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+
+  /* content-addressed URIs are disabled by default. */
+  return get_conf_flag(conf->content_urls, FALSE);
+}
+
 int
 dav_svn__get_compression_level(request_rec *r)
 {
@@ -1382,6 +1416,14 @@ static const command_rec cmds[] =
                "caches (see SVNInMemoryCacheSize) have been configured."
                "(default is Off)."),
 
+  /* per directory/location */
+  AP_INIT_FLAG("SVNContentURLs", SVNContentURLs_cmd, NULL,
+               ACCESS_CONF|RSRC_CONF,
+               "enables content-addressed URIs for file texts that "
+               "caching proxies may share between all users; only "
+               "enable this if knowing a file's SHA-1 checksum is "
+               "sufficient to be allowed to read it (default is Off)."),
+
   /* per server */
   AP_INIT_TAKE1("SVNInMemoryCacheSize", SVNInMemoryCacheSize_cmd, NULL,
                 RSRC_CONF,
@@ -86,6 +86,11 @@ typedef struct update_ctx_t {
      inline.  (This is implied when "send_all" is set.)  */
   svn_boolean_t include_props;
 
+  /* If non-zero, the texts of files no larger than this many bytes are
+     transmitted inline even when not in "send-all" mode, so that the
+     client needs to fetch only the larger files.  */
+  svn_filesize_t inline_text_size;
+
   /* SVNDIFF version to send to client.  */
   int svndiff_version;
 
@@ -127,6 +132,9 @@ typedef struct item_baton_t {
   /* File/dir copied? */
   svn_boolean_t copyfrom;
 
+  /* File text sent inline although not in "send-all" mode? */
+  svn_boolean_t text_inlined;
+
   /* Array of const char * names of removed properties.  (Used only
      for copied files/dirs in skelta mode.)  */
   apr_array_header_t *removed_props;
@@ -136,6 +144,11 @@ typedef struct item_baton_t {
 
 #define DIR_OR_FILE(is_dir) ((is_dir) ? "directory" : "file")
 
+/* Upper limit for the size of file texts that we send inline in "skelta"
+   mode, whatever the client asks for.  Larger texts are better fetched
+   by separate (parallel, cacheable) GET requests. */
+#define MAX_INLINE_TEXT_SIZE (64 * 1024)
+
 
 /* add PATH to the pathmap HASH with a repository path of LINKPATH.
    if LINKPATH is NULL, PATH will map to itself. */
@@ -486,9 +499,10 @@ maybe_start_update_report(update_ctx_t *uc)
                   uc->bb, uc->output,
                   DAV_XML_HEADER DEBUG_CR "<S:update-report xmlns:S=\""
                   SVN_XML_NAMESPACE "\" xmlns:V=\"" SVN_DAV_PROP_NS_DAV "\" "
-                  "xmlns:D=\"DAV:\" %s %s>" DEBUG_CR,
+                  "xmlns:D=\"DAV:\" %s %s %s>" DEBUG_CR,
                   uc->send_all ? "send-all=\"true\"" : "",
-                  uc->include_props ? "inline-props=\"true\"" : ""));
+                  uc->include_props ? "inline-props=\"true\"" : "",
+                  uc->inline_text_size ? "inline-texts=\"true\"" : ""));
 
       uc->started_update = TRUE;
     }
@@ -811,9 +825,21 @@ upd_apply_textdelta(void *file_baton,
   file->base_checksum = apr_pstrdup(file->pool, base_checksum);
   file->text_changed = TRUE;
 
+  /* If we're not in "send-all" mode, we may still send the texts of
+     small files inline to save the client a GET request for each. */
+  if (! file->uc->send_all && file->uc->inline_text_size)
+    {
+      svn_filesize_t length;
+
+      SVN_ERR(svn_fs_file_length(&length, file->uc->rev_root,
+                                 get_real_fs_path(file, pool), pool));
+      file->text_inlined = (length <= file->uc->inline_text_size);
+    }
+
   /* If this is a resource walk, or if we're not in "send-all" mode,
      we don't actually want to transmit text-deltas. */
-  if (file->uc->resource_walk || (! file->uc->send_all))
+  if (file->uc->resource_walk
+      || (! file->uc->send_all && ! file->text_inlined))
     {
       *handler = svn_delta_noop_window_handler;
       *handler_baton = NULL;
@@ -846,8 +872,9 @@ upd_close_file(void *file_baton, const char *text_checksum, apr_pool_t *pool)
 
   /* If we are not in "send all" mode, and this file is not a new
      addition or didn't otherwise have changed text, tell the client
-     to fetch it. */
-  if ((! file->uc->send_all) && (! file->added) && file->text_changed)
+     to fetch it -- unless we sent the text inline already. */
+  if ((! file->uc->send_all) && (! file->added) && file->text_changed
+      && (! file->text_inlined))
     {
       svn_checksum_t *sha1_checksum;
       const char *real_path = get_real_fs_path(file, pool);
@@ -1164,6 +1191,26 @@ dav_svn__update_report(const dav_resource *resource,
           if (strcmp(cdata, "no") != 0)
             uc.include_props = TRUE;
         }
+      if (child->ns == ns && strcmp(child->name, "inline-text-size") == 0)
+        {
+          apr_int64_t size;
+
+          cdata = dav_xml_get_cdata(child, resource->pool, 1);
+          if (! *cdata)
+            return malformed_element_error(child->name, resource->pool);
+          serr = svn_cstring_atoi64(&size, cdata);
+          if (serr)
+            {
+              svn_error_clear(serr);
+              return malformed_element_error(child->name, resource->pool);
+            }
+
+          /* Inlining texts is a (limited) form of bulk update, so honor
+             'SVNAllowBulkUpdates Off' here as well. */
+          if (repos->bulk_updates != CONF_BULKUPD_OFF && size > 0)
+            uc.inline_text_size = (size < MAX_INLINE_TEXT_SIZE)
+                                  ? size : MAX_INLINE_TEXT_SIZE;
+        }
     }
 
   /* If a target revision wasn't requested, or the requested target
@@ -1242,10 +1289,16 @@ dav_svn__update_report(const dav_resource *resource,
                                   resource->pool);
     }
 
+  /* Inlining texts in a "skelta" report makes no sense if the client
+     doesn't want to see them at all. */
+  if (uc.send_all || ! text_deltas)
+    uc.inline_text_size = 0;
+
   /* If the client did *not* request 'send-all' mode, then we will be
      sending only a "skelta" of the difference, which will not need to
-     contain actual text deltas. */
-  if (! uc.send_all)
+     contain actual text deltas -- except for the small files we send
+     inline. */
+  if (! uc.send_all && ! uc.inline_text_size)
     text_deltas = FALSE;
 
   /* When we call svn_repos_finish_report, it will ultimately run
@@ -480,6 +480,56 @@ parse_revroot_uri(dav_resource_combined *comb,
 }
 
 
+static int
+parse_sha1_uri(dav_resource_combined *comb,
+               const char *path,
+               const char *label,
+               int use_checked_in)
+{
+  /* format: !svn/sha1/SHA1
+
+     In HTTP protocol v2, this represents the file text with the given
+     SHA-1 checksum.  The URI itself does not say where to find that
+     text, so the client has to point us to a REVISION/REPOS_PATH that
+     has it in the SVN_DAV_CONTENT_LOCATOR_HEADER.  Caching proxies
+     ignore that header, so identical texts anywhere in the repository
+     share a single cache entry.
+   */
+
+  const char *locator;
+  svn_checksum_t *checksum;
+  svn_error_t *serr;
+
+  if (! dav_svn__get_content_urls_flag(comb->priv.r))
+    return TRUE;
+
+  serr = svn_checksum_parse_hex(&checksum, svn_checksum_sha1, path,
+                                comb->res.pool);
+  if (serr || checksum == NULL
+      || strlen(path) != 2 * svn_checksum_size(checksum))
+    {
+      svn_error_clear(serr);
+      return TRUE;
+    }
+
+  locator = apr_table_get(comb->priv.r->headers_in,
+                          SVN_DAV_CONTENT_LOCATOR_HEADER);
+  if (locator == NULL)
+    return TRUE;
+
+  /* The locator has the same format as rvr URIs.  The rest of the
+     resource setup (and the authz check) happens in prep_regular(). */
+  if (parse_baseline_coll_uri(comb,
+                              svn_path_uri_decode(locator, comb->res.pool),
+                              label, use_checked_in))
+    return TRUE;
+
+  comb->priv.content_sha1 = svn_checksum_to_cstring(checksum, comb->res.pool);
+
+  return FALSE;
+}
+
+
 static int
 parse_txnstub_uri(dav_resource_combined *comb,
                   const char *path,
@@ -678,6 +728,7 @@ static const struct special_defn
   { "txr", parse_txnroot_uri, 1, TRUE, DAV_SVN_RESTYPE_TXNROOT_COLLECTION},
   { "vtxn", parse_vtxnstub_uri, 1, FALSE, DAV_SVN_RESTYPE_TXN_COLLECTION},
   { "vtxr", parse_vtxnroot_uri, 1, TRUE, DAV_SVN_RESTYPE_TXNROOT_COLLECTION},
+  { "sha1", parse_sha1_uri, 1, FALSE, DAV_SVN_RESTYPE_SHA1_COLLECTION},
 
   { NULL } /* sentinel */
 };
@@ -862,6 +913,44 @@ prep_regular(dav_resource_combined *comb)
   if (! comb->res.exists)
     comb->priv.r->path_info = (char *) "";
 
+  /* Content-addressed resources are read-only views of file texts that
+     must match the location the client pointed us to.  Also, the authz
+     modules can't see that location, so check read access here. */
+  if (comb->priv.content_sha1)
+    {
+      svn_checksum_t *checksum;
+
+      if (comb->priv.r->method_number != M_GET)
+        return dav_svn__new_error(pool, HTTP_METHOD_NOT_ALLOWED, 0, 0,
+                                  "Content-addressed resources can only "
+                                  "be read.");
+
+      if (! comb->res.exists || comb->res.collection)
+        return dav_svn__new_error(pool, HTTP_NOT_FOUND, 0, 0,
+                                  "The content locator does not point "
+                                  "to a file.");
+
+      if (! dav_svn__allow_read(comb->priv.r, repos, comb->priv.repos_path,
+                                comb->priv.root.rev, pool))
+        return dav_svn__new_error(pool, HTTP_FORBIDDEN, 0, 0,
+                                  "Access to the content locator path "
+                                  "is forbidden.");
+
+      serr = svn_fs_file_checksum(&checksum, svn_checksum_sha1,
+                                  comb->priv.root.root,
+                                  comb->priv.repos_path, TRUE, pool);
+      if (serr != NULL)
+        return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                    "Could not get the file's checksum",
+                                    pool);
+
+      if (strcmp(svn_checksum_to_cstring(checksum, pool),
+                 comb->priv.content_sha1) != 0)
+        return dav_svn__new_error(pool, HTTP_NOT_FOUND, 0, 0,
+                                  "The file at the content locator has "
+                                  "a different checksum.");
+    }
+
   return NULL;
 }
 
@@ -1741,7 +1830,9 @@ static int sort_encoding_pref(const void *accept_rec1, const void *accept_rec2)
 
 static int get_svndiff_version(const struct accept_rec *rec)
 {
-  if (strcmp(rec->name, "svndiff2") == 0)
+  if (strcmp(rec->name, "svndiff3") == 0)
+    return 3;
+  else if (strcmp(rec->name, "svndiff2") == 0)
     return 2;
   else if (strcmp(rec->name, "svndiff1") == 0)
     return 1;
@@ -1766,6 +1857,7 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
   apr_array_header_t *encoding_prefs;
   apr_array_header_t *svndiff_encodings;
   svn_boolean_t accepts_svndiff2 = FALSE;
+  svn_boolean_t accepts_svndiff3 = FALSE;
 
   encoding_prefs = do_header_line(r->pool,
                                   apr_table_get(r->headers_in,
@@ -1789,6 +1881,8 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
 
       if (version == 2)
         accepts_svndiff2 = TRUE;
+      else if (version == 3)
+        accepts_svndiff3 = TRUE;
     }
 
   if (dav_svn__get_compression_level(r) == 0)
@@ -1797,14 +1891,16 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
        * svndiff0 format, which we assume is always supported. */
       *svndiff_version = 0;
     }
-  else if (accepts_svndiff2 && dav_svn__get_compression_level(r) == 1)
+  else if ((accepts_svndiff2 || accepts_svndiff3)
+           && dav_svn__get_compression_level(r) == 1)
     {
       /* Enable svndiff2 if the client can read it, and if the server-side
        * compression level is set to 1.  Svndiff2 offers better speed and
        * compression ratio comparable to svndiff1 with compression level 1,
-       * but not with other compression levels.
+       * but not with other compression levels.  Svndiff3 uses the same
+       * compression with more compact instructions, so prefer that.
        */
-      *svndiff_version = 2;
+      *svndiff_version = accepts_svndiff3 ? 3 : 2;
     }
   else if (svndiff_encodings->nelts > 0)
     {
@@ -3109,6 +3205,10 @@ dav_svn__getetag(const dav_resource *resource, apr_pool_t *pool)
 
   /* ### what kind of etag to return for activities, etc.? */
 
+  /* Content-addressed file texts are identified by their checksum. */
+  if (resource->info->content_sha1)
+    return apr_psprintf(pool, "\"%s\"", resource->info->content_sha1);
+
   if ((serr = svn_fs_node_created_rev(&created_rev, resource->info->root.root,
                                       resource->info->repos_path,
                                       pool)))
@@ -3168,8 +3268,13 @@ set_headers(request_rec *r, const dav_resource *resource)
   svn_filesize_t length;
   const char *mimetype = NULL;
 
+  /* Content-addressed file texts can never change and are the same no
+     matter where they were found.  Let everybody cache them. */
+  if (resource->info->content_sha1)
+    apr_table_setn(r->headers_out, "Cache-Control",
+                   "public, max-age=31536000, immutable");
   /* As version resources don't change, encourage caching. */
-  if (is_cacheable(r, resource))
+  else if (is_cacheable(r, resource))
     /* Cache resource for one week (specified in seconds). */
     apr_table_setn(r->headers_out, "Cache-Control", "max-age=604800");
   else
@@ -3220,6 +3325,11 @@ set_headers(request_rec *r, const dav_resource *resource)
       svn_error_clear(serr);
     }
 
+  /* The svn:mime-type of the file at the content locator's path is not
+     a property of the file text. */
+  if ((mimetype == NULL) && resource->info->content_sha1)
+    mimetype = "application/octet-stream";
+
   if ((mimetype == NULL)
       && ((resource->type == DAV_RESOURCE_TYPE_VERSION)
           || (resource->type == DAV_RESOURCE_TYPE_REGULAR))
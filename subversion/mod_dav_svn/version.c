@@ -197,6 +197,7 @@ get_option(const dav_resource *resource,
     { SVN_DAV_NS_DAV_SVN_EPHEMERAL_TXNPROPS,  { 1,  8, 0, ""} },
     { SVN_DAV_NS_DAV_SVN_SVNDIFF1,            { 1, 10, 0, ""} },
     { SVN_DAV_NS_DAV_SVN_SVNDIFF2,            { 1, 10, 0, ""} },
+    { SVN_DAV_NS_DAV_SVN_SVNDIFF3,            { 1, 11, 0, ""} },
     { SVN_DAV_NS_DAV_SVN_PUT_RESULT_CHECKSUM, { 1, 10, 0, ""} },
   };
 
@@ -320,6 +321,10 @@ get_option(const dav_resource *resource,
       apr_table_set(r->headers_out, SVN_DAV_REV_STUB_HEADER,
                     apr_pstrcat(r->pool, repos_root_uri, "/",
                                 dav_svn__get_rev_stub(r), SVN_VA_NULL));
+      if (dav_svn__get_content_urls_flag(r))
+        apr_table_set(r->headers_out, SVN_DAV_SHA1_STUB_HEADER,
+                      apr_pstrcat(r->pool, repos_root_uri, "/",
+                                  dav_svn__get_sha1_stub(r), SVN_VA_NULL));
       apr_table_set(r->headers_out, SVN_DAV_TXN_ROOT_STUB_HEADER,
                     apr_pstrcat(r->pool, repos_root_uri, "/",
                                 dav_svn__get_txn_root_stub(r), SVN_VA_NULL));
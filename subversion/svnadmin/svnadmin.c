@@ -95,6 +95,7 @@ check_lib_versions(void)
 /** Subcommands. **/
 
 static svn_opt_subcommand_t
+  subcommand_build_log_index,
   subcommand_crashtest,
   subcommand_create,
   subcommand_delrevprop,
@@ -121,7 +122,8 @@ static svn_opt_subcommand_t
   subcommand_setuuid,
   subcommand_unlock,
   subcommand_upgrade,
-  subcommand_verify;
+  subcommand_verify,
+  subcommand_verify_log_index;
 
 enum svnadmin__cmdline_options_t
   {
@@ -303,6 +305,15 @@ static const apr_getopt_option_t options_table[] =
  */
 static const svn_opt_subcommand_desc2_t cmd_table[] =
 {
+  {"build-log-index", subcommand_build_log_index, {0}, N_
+   ("usage: svnadmin build-log-index REPOS_PATH\n\n"
+    "Create the log index of the repository if it does not exist yet and\n"
+    "add all revisions to it that have not been indexed yet.  The index\n"
+    "speeds up 'svn log' on paths and is updated with every commit once it\n"
+    "exists.  Run this command again after loading revisions with\n"
+    "'svnadmin load' without --use-post-commit-hook.\n"),
+   {'q'} },
+
   {"crashtest", subcommand_crashtest, {0}, N_
    ("usage: svnadmin crashtest REPOS_PATH\n\n"
     "Open the repository at REPOS_PATH, then abort, thus simulating\n"
@@ -541,6 +552,13 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
     svnadmin__check_normalization, svnadmin__metadata_only} },
 
+  {"verify-log-index", subcommand_verify_log_index, {0}, N_
+   ("usage: svnadmin verify-log-index REPOS_PATH\n\n"
+    "Verify that the log index of the repository matches the changes\n"
+    "recorded in the repository for all indexed revisions.  Use -r to\n"
+    "restrict the verification to a range of revisions.\n"),
+   {'r', 'q'} },
+
   { NULL, NULL, {0}, NULL, {0} }
 };
 
@@ -1190,6 +1208,12 @@ repos_notify_handler(void *baton,
                         notify->new_revision));
       return;
 
+    case svn_repos_notify_log_index_rev_end:
+      svn_error_clear(svn_stream_printf(feedback_stream, scratch_pool,
+                                        _("* Indexed revision %ld.\n"),
+                                        notify->revision));
+      return;
+
     default:
       return;
   }
@@ -2097,6 +2121,29 @@ subcommand_setlog(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 }
 
 
+/* This implements 'svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_build_log_index(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  svn_stream_t *feedback_stream = NULL;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+
+  /* Progress feedback goes to STDOUT, unless they asked to suppress it. */
+  if (! opt_state->quiet)
+    feedback_stream = recode_stream_create(stdout, pool);
+
+  return svn_error_trace(
+    svn_repos_log_index_build(repos,
+                              !opt_state->quiet ? repos_notify_handler : NULL,
+                              feedback_stream, check_cancel, NULL, pool));
+}
+
 /* This implements 'svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_pack(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -2262,6 +2309,44 @@ subcommand_verify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_verify_log_index(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_revnum_t youngest, lower, upper;
+  svn_stream_t *feedback_stream = NULL;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+  fs = svn_repos_fs(repos);
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+
+  /* Find the revision numbers at which to start and end. */
+  SVN_ERR(get_revnum(&lower, &opt_state->start_revision,
+                     youngest, repos, pool));
+  SVN_ERR(get_revnum(&upper, &opt_state->end_revision,
+                     youngest, repos, pool));
+
+  if (upper == SVN_INVALID_REVNUM)
+    upper = lower;
+  else if (lower > upper)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+       _("First revision cannot be higher than second"));
+
+  if (!opt_state->quiet)
+    feedback_stream = recode_stream_create(stdout, pool);
+
+  return svn_error_trace(
+    svn_repos_log_index_verify(repos, lower, upper,
+                               !opt_state->quiet ? repos_notify_handler : NULL,
+                               feedback_stream, check_cancel, NULL, pool));
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 svn_error_t *
 subcommand_hotcopy(apr_getopt_t *os, void *baton, apr_pool_t *pool)
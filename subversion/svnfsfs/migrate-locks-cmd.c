@@ -0,0 +1,46 @@
+/* migrate-locks-cmd.c -- implements the migrate-locks sub-command.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include "svn_cmdline.h"
+
+#include "private/svn_fs_fs_private.h"
+
+#include "svn_private_config.h"
+
+#include "svnfsfs.h"
+
+/* This implements `svn_opt_subcommand_t'. */
+svn_error_t *
+subcommand__migrate_locks(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+  svn_fs_t *fs;
+
+  SVN_ERR(open_fs(&fs, opt_state->repository_path, pool));
+  SVN_ERR(svn_fs_fs__migrate_locks(fs, check_cancel, NULL, pool));
+
+  if (!opt_state->quiet)
+    SVN_ERR(svn_cmdline_printf(pool, _("Locks migrated.\n")));
+
+  return SVN_NO_ERROR;
+}
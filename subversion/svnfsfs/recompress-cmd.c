@@ -0,0 +1,115 @@
+/* recompress-cmd.c -- implements the recompress sub-command.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+
+#include "private/svn_fs_fs_private.h"
+
+#include "svn_private_config.h"
+
+#include "svnfsfs.h"
+
+/* Compression used if none has been given on the command line. */
+#define DEFAULT_COMPRESSION "zlib-9"
+
+/* Notification baton type used with notify(). */
+typedef struct notify_baton_t
+{
+  /* Repository root directory. */
+  const char *path;
+
+  /* Size of the pack file when the current shard started. */
+  apr_off_t size;
+} notify_baton_t;
+
+/* Set *SIZE to the size of the pack file of SHARD in the repository at
+ * PATH.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_pack_size(apr_off_t *size,
+              const char *path,
+              apr_int64_t shard,
+              apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  const char *pack_path
+    = svn_dirent_join_many(scratch_pool, path, "db", "revs",
+                           apr_psprintf(scratch_pool,
+                                        "%" APR_INT64_T_FMT ".pack", shard),
+                           "pack", SVN_VA_NULL);
+
+  SVN_ERR(svn_io_stat(&finfo, pack_path, APR_FINFO_SIZE, scratch_pool));
+  *size = finfo.size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_pack_notify_t, reporting the progress and the pack
+ * file sizes for the repository given by the notify_baton_t BATON. */
+static svn_error_t *
+notify(void *baton,
+       apr_int64_t shard,
+       svn_fs_pack_notify_action_t action,
+       apr_pool_t *pool)
+{
+  notify_baton_t *nb = baton;
+  apr_off_t size;
+
+  SVN_ERR(get_pack_size(&size, nb->path, shard, pool));
+  if (action == svn_fs_pack_notify_start)
+    {
+      nb->size = size;
+      SVN_ERR(svn_cmdline_printf(pool,
+                                 _("Recompressing shard %" APR_INT64_T_FMT
+                                   "..."), shard));
+    }
+  else
+    {
+      SVN_ERR(svn_cmdline_printf(pool,
+                                 _(" done (%s -> %s bytes).\n"),
+                                 apr_off_t_toa(pool, nb->size),
+                                 apr_off_t_toa(pool, size)));
+    }
+
+  return svn_error_trace(svn_cmdline_fflush(stdout));
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+svn_error_t *
+subcommand__recompress(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+  notify_baton_t nb = { 0 };
+  svn_fs_t *fs;
+
+  nb.path = opt_state->repository_path;
+  SVN_ERR(open_fs(&fs, opt_state->repository_path, pool));
+  SVN_ERR(svn_fs_fs__recompress(fs,
+                                opt_state->compression
+                                  ? opt_state->compression
+                                  : DEFAULT_COMPRESSION,
+                                opt_state->quiet ? NULL : notify, &nb,
+                                check_cancel, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
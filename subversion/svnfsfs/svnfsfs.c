@@ -76,7 +76,8 @@ check_lib_versions(void)
 
 enum svnfsfs__cmdline_options_t
   {
-    svnfsfs__version = SVN_OPT_FIRST_LONGOPT_ID
+    svnfsfs__version = SVN_OPT_FIRST_LONGOPT_ID,
+    svnfsfs__compression
   };
 
 /* Option codes and descriptions.
@@ -104,6 +105,10 @@ static const apr_getopt_option_t options_table[] =
      N_("size of the extra in-memory cache in MB used to\n"
         "                             minimize redundant operations. Default: 16.")},
 
+    {"compression",   svnfsfs__compression, 1,
+     N_("compression to use: none | lz4 | zlib | zlib-1 ...\n"
+        "                             zlib-9.  Default: zlib-9.")},
+
     {NULL}
   };
 
@@ -152,6 +157,24 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
     "number is automatically extracted from input stream.  No ordering is required.\n"),
    {'M'} },
 
+  {"migrate-locks", subcommand__migrate_locks, {0}, N_
+   ("usage: svnfsfs migrate-locks REPOS_PATH\n\n"
+    "Move all locks from the per-path lock files into a single lock database.\n"
+    "Listing and checking the locks within a sub-tree then takes a single\n"
+    "database lookup instead of reading one file per lock, which matters for\n"
+    "repositories with many locks.  Expired locks are removed.  There is no\n"
+    "way back to lock files.  This is only available for FSFS format 9\n"
+    "repositories.\n"),
+   {'q'} },
+
+  {"recompress", subcommand__recompress, {0}, N_
+   ("usage: svnfsfs recompress REPOS_PATH [--compression ARG]\n\n"
+    "Re-encode the deltas in all packed shards using the given compression and\n"
+    "replace each pack file atomically.  The deltas themselves do not change and\n"
+    "representations that would not get smaller are kept as they are.  This is\n"
+    "only available for FSFS format 9 repositories.\n"),
+   {'M', svnfsfs__compression} },
+
   {"stats", subcommand__stats, {0}, N_
    ("usage: svnfsfs stats REPOS_PATH\n\n"
     "Write object size statistics to console.\n"),
@@ -311,6 +334,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnfsfs__version:
         opt_state.version = TRUE;
         break;
+      case svnfsfs__compression:
+        SVN_ERR(svn_utf_cstring_to_utf8(&opt_state.compression, opt_arg,
+                                        pool));
+        break;
       default:
         {
           SVN_ERR(subcommand__help(NULL, NULL, pool));
@@ -45,6 +45,7 @@ typedef struct svnfsfs__opt_state
   svn_boolean_t version;                            /* --version */
   svn_boolean_t quiet;                              /* --quiet */
   apr_uint64_t memory_cache_size;                   /* --memory-cache-size M */
+  const char *compression;                          /* --compression ARG */
 } svnfsfs__opt_state;
 
 /* Declare all the command procedures */
@@ -52,6 +53,8 @@ svn_opt_subcommand_t
   subcommand__help,
   subcommand__dump_index,
   subcommand__load_index,
+  subcommand__migrate_locks,
+  subcommand__recompress,
   subcommand__stats;
 
 
@@ -37,6 +37,7 @@
 #include "svn_pools.h"
 #include "svn_error.h"
 
+#include "private/svn_delta_private.h"
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
 
@@ -330,7 +331,7 @@ do_random_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 4,
                               i % 10, delta_pool);
 
       /* Make stage 1: create the text delta.  */
@@ -426,7 +427,7 @@ do_random_combine_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 4,
                               i % 10, delta_pool);
 
       /* Make stage 1: create the text deltas.  */
@@ -569,7 +570,7 @@ do_random_txdelta_to_svndiff_stream_test(apr_pool_t *pool,
                    svn_stream_from_aprfile2(source, TRUE, iterpool),
                    svn_stream_from_aprfile2(target, TRUE, iterpool),
                    FALSE, iterpool);
-      delta_stream = svn_txdelta_to_svndiff_stream(txstream, i % 3, i % 10,
+      delta_stream = svn_txdelta_to_svndiff_stream(txstream, i % 4, i % 10,
                                                    iterpool);
 
       /* Apply it to a copy of the source file to see if we get the
@@ -605,6 +606,71 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Implements svn_test_driver_t.  Deltify a few MB of random text with
+   large windows, send them through svndiff3 and check that we get the same
+   target back.  svndiff2 can encode such windows but must not accept them. */
+static svn_error_t *
+large_window_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0x5eed;
+  apr_size_t len = 3 * SVN_DELTA_LARGE_WINDOW_SIZE + 1234;
+  svn_stringbuf_t *source = svn_stringbuf_create_ensure(len, pool);
+  svn_stringbuf_t *target;
+  apr_size_t i;
+  int version;
+
+  for (i = 0; i < len; i++)
+    svn_stringbuf_appendbyte(source,
+                             (char)('a' + svn_test_rand(&seed) % 26));
+
+  /* Change a few bytes and shift the second half of the text. */
+  target = svn_stringbuf_dup(source, pool);
+  for (i = 0; i < len; i += 300000)
+    target->data[i] = '!';
+  svn_stringbuf_insert(target, len / 2, "inserted", 8);
+
+  for (version = 2; version <= 3; version++)
+    {
+      svn_stringbuf_t *svndiff = svn_stringbuf_create_empty(pool);
+      svn_stringbuf_t *result = svn_stringbuf_create_empty(pool);
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_stream_t *stream;
+      svn_error_t *err;
+
+      svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                              svn_stream_from_stringbuf(svndiff, pool),
+                              version, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                              pool);
+      stream = svn_txdelta__target_push(handler, handler_baton,
+                                        svn_stream_from_stringbuf(source,
+                                                                  pool),
+                                        SVN_DELTA_LARGE_WINDOW_SIZE, pool);
+      SVN_ERR(svn_stream_write(stream, target->data, &target->len));
+      SVN_ERR(svn_stream_close(stream));
+
+      svn_txdelta_apply(svn_stream_from_stringbuf(source, pool),
+                        svn_stream_from_stringbuf(result, pool),
+                        NULL, NULL, pool, &handler, &handler_baton);
+      stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE, pool);
+      err = svn_stream_write(stream, svndiff->data, &svndiff->len);
+      if (!err)
+        err = svn_stream_close(stream);
+
+      if (version < 3)
+        {
+          SVN_TEST_ASSERT_ERROR(err, SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+        }
+      else
+        {
+          SVN_ERR(err);
+          SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +691,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_PASS2(large_window_test,
+                   "svndiff3 with large delta windows"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
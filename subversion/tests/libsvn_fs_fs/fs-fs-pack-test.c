@@ -23,14 +23,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <apr_pools.h>
+#include <apr_thread_proc.h>
 
 #include "../svn_test.h"
 #include "../../libsvn_fs/fs-loader.h"
 #include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
+#include "../../libsvn_fs_fs/index.h"
 #include "../../libsvn_fs_fs/low_level.h"
 #include "../../libsvn_fs_fs/pack.h"
+#include "../../libsvn_fs_fs/rev_file.h"
 #include "../../libsvn_fs_fs/util.h"
+#include "../../libsvn_delta/delta.h"
 
 #include "svn_hash.h"
 #include "svn_pools.h"
@@ -264,6 +268,95 @@ huge_log(svn_revnum_t rev, apr_pool_t *pool)
   return large_log(rev, 90000, pool);
 }
 
+/* Return LEN random lower-case letters allocated in POOL.  Such contents
+ * contain no repetitions but compress to about 60% due to their limited
+ * alphabet.  *SEED is the state of the random number generator.
+ */
+static svn_stringbuf_t *
+random_contents(apr_size_t len,
+                apr_uint32_t *seed,
+                apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(len, pool);
+  while (result->len < len)
+    svn_stringbuf_appendbyte(result, (char)('a' + svn_test_rand(seed) % 26));
+
+  return result;
+}
+
+/* Set the contents of file "large" in a new revision of FS to CONTENTS,
+ * adding the file if necessary, and return that revision in *NEW_REV.
+ * Check that the txn returns CONTENTS before committing it.  Use POOL for
+ * allocations.
+ */
+static svn_error_t *
+commit_large_file(svn_revnum_t *new_rev,
+                  svn_fs_t *fs,
+                  const svn_stringbuf_t *contents,
+                  apr_pool_t *pool)
+{
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_node_kind_t kind;
+  svn_stream_t *stream;
+  svn_stringbuf_t *read;
+
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_check_path(&kind, root, "large", pool));
+  if (kind == svn_node_none)
+    SVN_ERR(svn_fs_make_file(root, "large", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "large", contents->data, pool));
+
+  SVN_ERR(svn_fs_file_contents(&stream, root, "large", pool));
+  SVN_ERR(svn_test__stream_to_string(&read, stream, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read, contents));
+
+  SVN_ERR(svn_fs_commit_txn(NULL, new_rev, txn, pool));
+  SVN_TEST_ASSERT(*new_rev == rev + 1);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the filesystem at REPO_NAME as *FS with caches not shared with any
+ * other FS instance, i.e. all data has to be read from disk.  Return the
+ * config used in *FS_CONFIG.  Allocate both in POOL.
+ */
+static svn_error_t *
+reopen_uncached(svn_fs_t **fs,
+                apr_hash_t **fs_config,
+                const char *repo_name,
+                apr_pool_t *pool)
+{
+  *fs_config = apr_hash_make(pool);
+  svn_hash_sets(*fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(fs, repo_name, *fs_config, pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Check that PATH in ROOT has the contents EXPECTED.  Use POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+check_file_contents(svn_fs_root_t *root,
+                    const char *path,
+                    const svn_stringbuf_t *expected,
+                    apr_pool_t *pool)
+{
+  svn_stream_t *stream;
+  svn_stringbuf_t *read;
+
+  SVN_ERR(svn_fs_file_contents(&stream, root, path, pool));
+  SVN_ERR(svn_test__stream_to_string(&read, stream, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read, expected));
+
+  return SVN_NO_ERROR;
+}
+
 
 /*** Tests ***/
 
@@ -1887,6 +1980,926 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+/* Read all revisions through memory mapped rev and pack files, with fewer
+   mappings allowed than there are files. */
+#define REPO_NAME "test-repo-read-mapped-files"
+#define SHARD_SIZE 4
+#define MAX_REV 10
+static svn_error_t *
+read_mapped_files(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int pass;
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support mapped files");
+
+  /* Two packed shards plus a few non-packed revisions. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_io_file_create(svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                             "[" CONFIG_SECTION_IO "]\n"
+                             CONFIG_OPTION_MMAP_FILES " = 2\n", pool));
+
+  /* Don't let the caches hide the file access. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ, "1");
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  ffd = fs->fsap_data;
+#if APR_HAS_MMAP
+  SVN_TEST_ASSERT(ffd->file_mappings != NULL);
+#else
+  SVN_TEST_ASSERT(ffd->file_mappings == NULL);
+#endif
+
+  /* The second pass will reuse some of the existing mappings. */
+  for (pass = 0; pass < 2; ++pass)
+    {
+      svn_revnum_t i;
+      for (i = 1; i <= MAX_REV; i++)
+        {
+          svn_fs_root_t *rev_root;
+          svn_stream_t *rstream;
+          svn_stringbuf_t *rstring;
+          const char *expected;
+
+          svn_pool_clear(iterpool);
+
+          SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, iterpool));
+          SVN_ERR(svn_fs_file_contents(&rstream, rev_root, "iota",
+                                       iterpool));
+          SVN_ERR(svn_test__stream_to_string(&rstring, rstream, iterpool));
+
+          expected = i == 1 ? "This is the file 'iota'.\n"
+                            : get_rev_contents(i, iterpool);
+          SVN_TEST_STRING_ASSERT(rstring->data, expected);
+        }
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, MAX_REV, NULL, NULL,
+                        NULL, NULL, iterpool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+/* Batched l2p lookups must return the same offsets as individual ones,
+   regardless of the order in which the items are given. */
+#define REPO_NAME "test-repo-batch-item-offsets"
+#define SHARD_SIZE 4
+#define MAX_REV 6
+static svn_error_t *
+batch_item_offsets(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_fs__revision_file_t *rev_file;
+  apr_array_header_t *max_ids;
+  apr_array_header_t *items;
+  apr_off_t *offsets;
+  svn_revnum_t start_rev;
+  int i;
+
+  /* Packed shard r0 .. r3 and non-packed revisions r4 .. r6. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  if (!svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this test requires log addressing");
+
+  for (start_rev = 0; start_rev <= MAX_REV; )
+    {
+      svn_revnum_t count = start_rev < SHARD_SIZE ? SHARD_SIZE : 1;
+      svn_revnum_t rev;
+
+      SVN_ERR(svn_fs_fs__l2p_get_max_ids(&max_ids, fs, start_rev, count,
+                                         pool, pool));
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, start_rev,
+                                               pool, pool));
+
+      /* Request all items, last revision and highest index first. */
+      items = apr_array_make(pool, 16, sizeof(svn_fs_fs__id_part_t));
+      for (rev = start_rev + count - 1; rev >= start_rev; --rev)
+        {
+          apr_uint64_t k = APR_ARRAY_IDX(max_ids, rev - start_rev,
+                                         apr_uint64_t);
+          while (k-- > 0)
+            {
+              svn_fs_fs__id_part_t *item = apr_array_push(items);
+              item->revision = rev;
+              item->number = k;
+            }
+        }
+
+      offsets = apr_palloc(pool, items->nelts * sizeof(*offsets));
+      SVN_ERR(svn_fs_fs__item_offsets(offsets, fs, rev_file, items, pool));
+
+      for (i = 0; i < items->nelts; ++i)
+        {
+          svn_fs_fs__id_part_t *item
+            = &APR_ARRAY_IDX(items, i, svn_fs_fs__id_part_t);
+          apr_off_t offset;
+
+          SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file,
+                                         item->revision, NULL, item->number,
+                                         pool));
+          SVN_TEST_ASSERT(offsets[i] == offset);
+        }
+
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+      start_rev += count;
+    }
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+/* File contents above the configured threshold must be stored outside the
+   rev files and still read back correctly, from the txn as well as from
+   the committed revisions. */
+#define REPO_NAME "test-repo-large-file-storage"
+static svn_error_t *
+large_file_storage(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents[2];
+  apr_hash_t *fs_config;
+  apr_uint32_t seed = 0;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support large file storage");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  ffd->large_file_threshold = 1024;
+
+  /* Two versions of a file that only differ in their first few bytes,
+   * i.e. the second one would deltify well. */
+  contents[0] = random_contents(0x10000, &seed, pool);
+  contents[1] = svn_stringbuf_dup(contents[0], pool);
+  memcpy(contents[1]->data, "modified", 8);
+
+  for (i = 0; i < 2; ++i)
+    {
+      svn_checksum_t *sha1;
+      svn_node_kind_t kind;
+
+      SVN_ERR(commit_large_file(&rev, fs, contents[i], pool));
+
+      /* The fulltext must now be in its final location. */
+      SVN_ERR(svn_checksum(&sha1, svn_checksum_sha1, contents[i]->data,
+                           contents[i]->len, pool));
+      SVN_ERR(svn_io_check_path(svn_fs_fs__path_large_file(fs, sha1->digest,
+                                                           pool),
+                                &kind, pool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+    }
+
+  SVN_ERR(reopen_uncached(&fs, &fs_config, REPO_NAME, pool));
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, i + 1, pool));
+      SVN_ERR(check_file_contents(root, "large", contents[i], pool));
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, rev, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-large-delta-windows"
+static svn_error_t *
+large_delta_windows(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_root_t *root, *base_root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents[2];
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_t *window;
+  apr_hash_t *fs_config;
+  apr_size_t len = 3 * SVN_DELTA_LARGE_WINDOW_SIZE;
+  apr_uint32_t seed = 0;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support svndiff3");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  ffd->delta_compression_type = compression_type_lz4;
+  ffd->large_delta_windows = TRUE;
+  ffd->large_file_threshold = 0;
+
+  /* Two versions of a file.  The second one has a few bytes changed and
+   * its second half shifted. */
+  contents[0] = random_contents(len, &seed, pool);
+  contents[1] = svn_stringbuf_dup(contents[0], pool);
+  memcpy(contents[1]->data, "modified", 8);
+  svn_stringbuf_insert(contents[1], len / 2, "inserted", 8);
+
+  for (i = 0; i < 2; ++i)
+    SVN_ERR(commit_large_file(&rev, fs, contents[i], pool));
+
+  SVN_ERR(reopen_uncached(&fs, &fs_config, REPO_NAME, pool));
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, i + 1, pool));
+      SVN_ERR(check_file_contents(root, "large", contents[i], pool));
+    }
+
+  /* The stored delta uses large windows, which not every consumer can
+   * handle.  So, the delta handed out must have been recomputed. */
+  SVN_ERR(svn_fs_revision_root(&base_root, fs, 1, pool));
+  SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, base_root, "large",
+                                       root, "large", pool));
+  do
+    {
+      SVN_ERR(svn_txdelta_next_window(&window, delta_stream, pool));
+      SVN_TEST_ASSERT(!window || window->tview_len <= SVN_DELTA_WINDOW_SIZE);
+    }
+  while (window);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, rev, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+/* Set *COUNT to the number of chunks in the chunk store of FS.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+count_chunks(int *count,
+             svn_fs_t *fs,
+             apr_pool_t *pool)
+{
+  const char *chunks_dir = svn_dirent_join(fs->path, PATH_CHUNKS_DIR, pool);
+  apr_hash_t *subdirs;
+  apr_hash_index_t *hi;
+
+  SVN_ERR(svn_io_get_dirents3(&subdirs, chunks_dir, TRUE, pool, pool));
+
+  *count = 0;
+  for (hi = apr_hash_first(pool, subdirs); hi; hi = apr_hash_next(hi))
+    {
+      apr_hash_t *chunks;
+
+      SVN_ERR(svn_io_get_dirents3(&chunks,
+                                  svn_dirent_join(chunks_dir,
+                                                  apr_hash_this_key(hi),
+                                                  pool),
+                                  TRUE, pool, pool));
+      *count += apr_hash_count(chunks);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-large-file-chunking"
+static svn_error_t *
+large_file_chunking(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents[2];
+  apr_hash_t *fs_config;
+  apr_size_t len = 0x100000;
+  apr_uint32_t seed = 0;
+  int chunk_count[2];
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support chunked storage");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  ffd->large_file_threshold = 1024;
+  ffd->large_file_chunking = TRUE;
+
+  /* Two versions of a file.  The second one has a few bytes changed and
+   * a few inserted. */
+  contents[0] = random_contents(len, &seed, pool);
+  contents[1] = svn_stringbuf_dup(contents[0], pool);
+  memcpy(contents[1]->data + len / 2, "modified", 8);
+  svn_stringbuf_insert(contents[1], len / 4, "inserted", 8);
+
+  for (i = 0; i < 2; ++i)
+    {
+      svn_checksum_t *sha1;
+      svn_node_kind_t kind;
+
+      SVN_ERR(commit_large_file(&rev, fs, contents[i], pool));
+
+      /* The chunk list must now be in its final location. */
+      SVN_ERR(svn_checksum(&sha1, svn_checksum_sha1, contents[i]->data,
+                           contents[i]->len, pool));
+      SVN_ERR(svn_io_check_path(svn_fs_fs__path_chunk_list(fs, sha1->digest,
+                                                           pool),
+                                &kind, pool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+
+      SVN_ERR(count_chunks(&chunk_count[i], fs, pool));
+    }
+
+  /* The file got split into many chunks and the second version only
+   * added those around the two modifications. */
+  SVN_TEST_ASSERT(chunk_count[0] > 8);
+  SVN_TEST_ASSERT(chunk_count[1] - chunk_count[0] <= 2);
+
+  SVN_ERR(reopen_uncached(&fs, &fs_config, REPO_NAME, pool));
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, i + 1, pool));
+      SVN_ERR(check_file_contents(root, "large", contents[i], pool));
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, rev, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-delta-base-candidates"
+
+static svn_error_t *
+delta_base_candidates(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents[2];
+  apr_hash_t *fs_config;
+  apr_finfo_t finfo;
+  apr_size_t lengths[2] = { 20000, 100000 };
+  apr_uint32_t seed = 0;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support delta base search");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  ffd->delta_base_candidates = 4;
+
+  /* Two files, one of them larger than what the delta base search
+   * looks at. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  for (i = 0; i < 2; ++i)
+    {
+      contents[i] = random_contents(lengths[i], &seed, pool);
+      SVN_ERR(svn_fs_make_file(root, i ? "large" : "small", pool));
+      SVN_ERR(svn_test__set_file_contents(root, i ? "large" : "small",
+                                          contents[i]->data, pool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Add slightly modified versions of them as new files without history,
+   * e.g. the result of an import or a merge between unrelated branches.
+   * They have no predecessor to deltify against. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  for (i = 0; i < 2; ++i)
+    {
+      memcpy(contents[i]->data, "modified", 8);
+      SVN_ERR(svn_fs_make_file(root, i ? "large-2" : "small-2", pool));
+      SVN_ERR(svn_test__set_file_contents(root, i ? "large-2" : "small-2",
+                                          contents[i]->data, pool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 2);
+
+  /* Both got deltified against the similar contents from r1 instead of
+   * being stored as self-deltas. */
+  SVN_ERR(svn_io_stat(&finfo, svn_fs_fs__path_rev_absolute(fs, rev, pool),
+                      APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(finfo.size < (lengths[0] + lengths[1]) / 4);
+
+  SVN_ERR(reopen_uncached(&fs, &fs_config, REPO_NAME, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  for (i = 0; i < 2; ++i)
+    SVN_ERR(check_file_contents(root, i ? "large-2" : "small-2",
+                                contents[i], pool));
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, rev, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-recompress-packed-shards"
+#define SHARD_SIZE 4
+#define MAX_REV 9
+static svn_error_t *
+recompress_packed_shards(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents[MAX_REV + 1];
+  apr_hash_t *fs_config;
+  apr_finfo_t finfo;
+  apr_off_t sizes[2];
+  apr_uint32_t seed = 0;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support recompression");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  /* Store all deltas uncompressed. */
+  ffd = fs->fsap_data;
+  ffd->delta_compression_type = compression_type_none;
+  ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+  ffd->large_delta_windows = FALSE;
+
+  /* Add a new file in every revision.  Its random contents still leave
+   * room for compression. */
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      const char *path = apr_psprintf(pool, "file-%ld", rev);
+
+      contents[rev] = random_contents(20000, &seed, pool);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      SVN_ERR(svn_fs_make_file(root, path, pool));
+      SVN_ERR(svn_test__set_file_contents(root, path, contents[rev]->data,
+                                          pool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+    }
+
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(svn_io_stat(&finfo,
+                          svn_fs_fs__path_rev_packed(fs, i * SHARD_SIZE,
+                                                     PATH_PACKED, pool),
+                          APR_FINFO_SIZE, pool));
+      sizes[i] = finfo.size;
+    }
+
+  /* Read all contents once to populate the caches with data read from the
+   * original pack files. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, MAX_REV, pool));
+  for (i = 1; i <= MAX_REV; ++i)
+    SVN_ERR(check_file_contents(root, apr_psprintf(pool, "file-%d", i),
+                                contents[i], pool));
+
+  /* Recompress the packed shards.  Only the packed shards change. */
+  SVN_ERR(svn_fs_fs__recompress(fs, "zlib-9", NULL, NULL, NULL, NULL,
+                                pool));
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(svn_io_stat(&finfo,
+                          svn_fs_fs__path_rev_packed(fs, i * SHARD_SIZE,
+                                                     PATH_PACKED, pool),
+                          APR_FINFO_SIZE, pool));
+      SVN_TEST_ASSERT(finfo.size < sizes[i] * 3 / 4);
+    }
+
+  /* Continue through the same FS instance and caches and deltify against
+   * a recompressed representation.  Nothing cached for the old pack files
+   * must be used for the new ones. */
+  memcpy(contents[1]->data, "modified", 8);
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, MAX_REV, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "file-1", contents[1]->data,
+                                      pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* All contents are still intact. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  for (i = 1; i <= MAX_REV; ++i)
+    SVN_ERR(check_file_contents(root, apr_psprintf(pool, "file-%d", i),
+                                contents[i], pool));
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, rev, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-pack-access-trace"
+#define SHARD_SIZE 4
+static svn_error_t *
+pack_access_trace(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stream_t *stream;
+  svn_stringbuf_t *contents;
+  apr_hash_t *fs_config;
+  apr_array_header_t *entries;
+  apr_array_header_t *traced;
+  apr_array_header_t *packed;
+  svn_boolean_t eof = FALSE;
+  const char *trace_path;
+  int i;
+
+  static const char *read_order[] = { "c-3", "a-1", "b-2" };
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support access traces");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  if (!svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "access traces require logical addressing");
+
+  /* Three files per revision, then complete the first shard. */
+  for (rev = 1; rev <= SHARD_SIZE; ++rev)
+    {
+      const char *names = rev < SHARD_SIZE ? "abc" : "d";
+      const char *name;
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      for (name = names; *name; ++name)
+        {
+          const char *path = apr_psprintf(pool, "%c-%ld", *name, rev);
+
+          SVN_ERR(svn_fs_make_file(root, path, pool));
+          SVN_ERR(svn_test__set_file_contents(root, path,
+                                              apr_psprintf(pool,
+                                                           "This is %s.\n",
+                                                           path),
+                                              pool));
+        }
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+    }
+
+  /* Record the reads through a new FS instance with disjoint caches. */
+  trace_path = svn_dirent_join(REPO_NAME, "access-trace", pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ffd = fs->fsap_data;
+  ffd->record_access_trace = trace_path;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, SHARD_SIZE, pool));
+  for (i = 0; i < (int)(sizeof(read_order) / sizeof(read_order[0])); ++i)
+    {
+      SVN_ERR(svn_fs_file_contents(&stream, root, read_order[i], pool));
+      SVN_ERR(svn_test__stream_to_string(&contents, stream, pool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             apr_psprintf(pool, "This is %s.\n",
+                                          read_order[i]));
+    }
+
+  /* Pack using that trace. */
+  SVN_ERR(svn_io_file_create(svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                             "[" CONFIG_SECTION_PACKING "]\n"
+                             CONFIG_OPTION_ACCESS_TRACE " = access-trace\n",
+                             pool));
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+
+  /* The file reps in the pack file, in storage order. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  entries = apr_array_make(pool, 16, sizeof(svn_fs_fs__p2l_entry_t *));
+  SVN_ERR(svn_fs_fs__dump_index(fs, 0, receive_index, entries, NULL, NULL,
+                                pool));
+  packed = apr_array_make(pool, 16, sizeof(svn_fs_fs__p2l_entry_t *));
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_fs_fs__p2l_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t *);
+      if (entry->type == SVN_FS_FS__ITEM_TYPE_FILE_REP)
+        APR_ARRAY_PUSH(packed, svn_fs_fs__p2l_entry_t *) = entry;
+    }
+
+  /* The file reps in the trace, in the order of their first access. */
+  traced = apr_array_make(pool, 4, sizeof(svn_fs_fs__p2l_entry_t *));
+  SVN_ERR(svn_stream_open_readonly(&stream, trace_path, pool, pool));
+  while (!eof)
+    {
+      svn_stringbuf_t *line;
+      int k;
+
+      SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, pool));
+      for (i = 0; i < packed->nelts; ++i)
+        {
+          svn_fs_fs__p2l_entry_t *entry
+            = APR_ARRAY_IDX(packed, i, svn_fs_fs__p2l_entry_t *);
+          const char *item = apr_psprintf(pool, "%ld %" APR_UINT64_T_FMT,
+                                          entry->item.revision,
+                                          entry->item.number);
+          if (strcmp(line->data, item))
+            continue;
+
+          for (k = 0; k < traced->nelts; ++k)
+            if (APR_ARRAY_IDX(traced, k, svn_fs_fs__p2l_entry_t *) == entry)
+              break;
+
+          if (k == traced->nelts)
+            APR_ARRAY_PUSH(traced, svn_fs_fs__p2l_entry_t *) = entry;
+        }
+    }
+  SVN_ERR(svn_stream_close(stream));
+
+  /* The traced reps come first and in the order they have been read.
+   * Without the trace, they would have been stored in path order. */
+  SVN_TEST_ASSERT(traced->nelts == 3);
+  for (i = 0; i < traced->nelts; ++i)
+    {
+      svn_fs_fs__p2l_entry_t *entry
+        = APR_ARRAY_IDX(packed, i, svn_fs_fs__p2l_entry_t *);
+
+      SVN_TEST_ASSERT(entry
+                      == APR_ARRAY_IDX(traced, i, svn_fs_fs__p2l_entry_t *));
+      SVN_TEST_ASSERT(entry->item.revision == read_order[i][2] - '0');
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SHARD_SIZE, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-group-commit"
+#define COMMITTERS 4
+#define COMMITS 5
+
+/* State of a committer in the group_commit test. */
+typedef struct group_committer_t
+{
+  /* Index of the file that this committer modifies. */
+  int number;
+
+  /* Result of the committer's work. */
+  svn_error_t *err;
+} group_committer_t;
+
+/* Commit COMMITS changes to the file of COMMITTER in REPO_NAME.
+   Use POOL for allocations. */
+static svn_error_t *
+run_group_committer(group_committer_t *committer,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const char *path = apr_psprintf(pool, "file-%d", committer->number);
+  svn_fs_t *fs;
+  int i;
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (i = 1; i <= COMMITS; ++i)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *root;
+      svn_revnum_t rev;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_youngest_rev(&rev, fs, iterpool));
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, path,
+                                          apr_psprintf(iterpool,
+                                                       "change %d\n", i),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Thread function running run_group_committer on the group_committer_t
+   DATA. */
+static void * APR_THREAD_FUNC
+group_committer_thread(apr_thread_t *tid, void *data)
+{
+  group_committer_t *committer = data;
+  apr_pool_t *pool = svn_pool_create_ex(NULL,
+                                        svn_pool_create_allocator(FALSE));
+
+  committer->err = run_group_committer(committer, pool);
+
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, 0);
+  return NULL;
+}
+#endif
+
+static svn_error_t *
+group_commit(const svn_test_opts_t *opts,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs, *fs2;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn, *txn2;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  const char *conflict;
+  group_committer_t committers[COMMITTERS];
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support group commits");
+
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, NULL, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "group commits require format 3");
+
+  SVN_ERR(svn_io_file_create(svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                             "[" CONFIG_SECTION_IO "]\n"
+                             CONFIG_OPTION_GROUP_COMMIT " = true\n",
+                             pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->group_commit);
+
+  /* r1: one file per committer. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  for (i = 0; i < COMMITTERS; ++i)
+    {
+      const char *path = apr_psprintf(pool, "file-%d", i);
+
+      SVN_ERR(svn_fs_make_file(root, path, pool));
+      SVN_ERR(svn_test__set_file_contents(root, path, "change 0\n", pool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 1);
+
+  /* Conflicting changes must still be reported as such. */
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "file-0", "change 0a\n", pool));
+  SVN_ERR(svn_fs_begin_txn(&txn2, fs2, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn2, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "file-0", "change 0b\n", pool));
+
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 2);
+  SVN_TEST_ASSERT_ERROR(svn_fs_commit_txn(&conflict, &rev, txn2, pool),
+                        SVN_ERR_FS_CONFLICT);
+  SVN_TEST_STRING_ASSERT(conflict, "/file-0");
+  SVN_ERR(svn_fs_abort_txn(txn2, pool));
+
+  /* Concurrent committers, each one modifying its own file. */
+  for (i = 0; i < COMMITTERS; ++i)
+    {
+      committers[i].number = i;
+      committers[i].err = SVN_NO_ERROR;
+    }
+
+#if APR_HAS_THREADS
+  {
+    apr_thread_t *threads[COMMITTERS];
+    apr_status_t status;
+
+    for (i = 0; i < COMMITTERS; ++i)
+      {
+        status = apr_thread_create(&threads[i], NULL, group_committer_thread,
+                                   &committers[i], pool);
+        if (status)
+          return svn_error_wrap_apr(status, "Can't create thread");
+      }
+
+    for (i = 0; i < COMMITTERS; ++i)
+      {
+        apr_status_t child_status;
+
+        status = apr_thread_join(&child_status, threads[i]);
+        if (status)
+          return svn_error_wrap_apr(status, "Can't join thread");
+      }
+  }
+#else
+  for (i = 0; i < COMMITTERS; ++i)
+    committers[i].err = run_group_committer(&committers[i], pool);
+#endif
+
+  for (i = 0; i < COMMITTERS; ++i)
+    err = svn_error_compose_create(err, committers[i].err);
+  SVN_ERR(err);
+
+  /* All changes must have made it into the repository. */
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_TEST_ASSERT(rev == 2 + COMMITTERS * COMMITS);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  for (i = 0; i < COMMITTERS; ++i)
+    {
+      svn_stringbuf_t *contents;
+
+      SVN_ERR(svn_test__get_file_contents(root,
+                                          apr_psprintf(pool, "file-%d", i),
+                                          &contents, pool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             apr_psprintf(pool, "change %d\n", COMMITS));
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, rev, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef COMMITTERS
+#undef COMMITS
 
 
 /* The test table.  */
@@ -1942,6 +2955,24 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(read_mapped_files,
+                       "read from memory mapped rev and pack files"),
+    SVN_TEST_OPTS_PASS(batch_item_offsets,
+                       "batched l2p index lookups"),
+    SVN_TEST_OPTS_PASS(large_file_storage,
+                       "store large files outside the rev files"),
+    SVN_TEST_OPTS_PASS(large_delta_windows,
+                       "store deltas with large windows"),
+    SVN_TEST_OPTS_PASS(large_file_chunking,
+                       "store large files as shared chunks"),
+    SVN_TEST_OPTS_PASS(delta_base_candidates,
+                       "deltify new files against similar contents"),
+    SVN_TEST_OPTS_PASS(recompress_packed_shards,
+                       "recompress packed shards"),
+    SVN_TEST_OPTS_PASS(pack_access_trace,
+                       "order packed items by an access trace"),
+    SVN_TEST_OPTS_PASS(group_commit,
+                       "commit concurrently with group commits"),
     SVN_TEST_NULL
   };
 
@@ -29,6 +29,7 @@
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "svn_dirent_uri.h"
 
 #include "private/svn_string_private.h"
 #include "private/svn_fs_fs_private.h"
@@ -420,6 +421,206 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+/* Implements svn_fs_get_locks_callback_t, adding the path and token of
+ * LOCK to the hash BATON. */
+static svn_error_t *
+receive_lock(void *baton,
+             svn_lock_t *lock,
+             apr_pool_t *pool)
+{
+  apr_hash_t *locks = baton;
+  apr_pool_t *hash_pool = apr_hash_pool_get(locks);
+
+  svn_hash_sets(locks, apr_pstrdup(hash_pool, lock->path),
+                apr_pstrdup(hash_pool, lock->token));
+
+  return SVN_NO_ERROR;
+}
+
+/* Assert that exactly COUNT locks exist at or below PATH in FS.
+ * Use POOL for allocations. */
+static svn_error_t *
+check_lock_count(svn_fs_t *fs,
+                 const char *path,
+                 unsigned int count,
+                 apr_pool_t *pool)
+{
+  apr_hash_t *locks = apr_hash_make(pool);
+
+  SVN_ERR(svn_fs_get_locks2(fs, path, svn_depth_infinity, receive_lock,
+                            locks, pool));
+  SVN_TEST_ASSERT(apr_hash_count(locks) == count);
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-migrate-locks-test"
+
+static svn_error_t *
+migrate_locks(const svn_test_opts_t *opts,
+              apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_revnum_t rev;
+  svn_fs_t *fs;
+  svn_fs_access_t *access;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_lock_t *lock;
+  svn_node_kind_t kind;
+  const char *fs_path;
+  apr_hash_t *locks = apr_hash_make(pool);
+  apr_hash_t *fs_config = apr_hash_make(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support lock databases");
+
+  /* Create a filesystem with a few locks in digest files. */
+  SVN_ERR(create_greek_repo(&repos, &rev, opts, REPO_NAME, pool, pool));
+  fs = svn_repos_fs(repos);
+  fs_path = svn_fs_path(fs, pool);
+  SVN_ERR(svn_fs_create_access(&access, "user", pool));
+  SVN_ERR(svn_fs_set_access(fs, access));
+
+  SVN_ERR(svn_fs_lock(&lock, fs, "/iota", NULL, "", FALSE, 0, rev, FALSE,
+                      pool));
+  SVN_ERR(svn_fs_lock(&lock, fs, "/A/mu", NULL, "", FALSE, 0, rev, FALSE,
+                      pool));
+  SVN_ERR(svn_fs_lock(&lock, fs, "/A/D/G/pi", NULL, "", FALSE, 0, rev,
+                      FALSE, pool));
+
+  /* Migrate them. */
+  SVN_ERR(svn_fs_fs__migrate_locks(fs, NULL, NULL, pool));
+  SVN_ERR(svn_io_check_path(svn_dirent_join(fs_path, "locks.db", pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+  SVN_ERR(svn_io_check_path(svn_dirent_join(fs_path, "locks", pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  /* Sub-tree queries must only return the locks within their tree. */
+  SVN_ERR(check_lock_count(fs, "/", 3, pool));
+  SVN_ERR(check_lock_count(fs, "/A", 2, pool));
+  SVN_ERR(check_lock_count(fs, "/A/D", 1, pool));
+  SVN_ERR(check_lock_count(fs, "/A/D/G/pi", 1, pool));
+  SVN_ERR(check_lock_count(fs, "/A/B", 0, pool));
+
+  /* Lock and unlock using the database. */
+  SVN_ERR(svn_fs_lock(&lock, fs, "/A/D/gamma", NULL, "", FALSE, 0, rev,
+                      FALSE, pool));
+  SVN_ERR(svn_fs_get_locks2(fs, "/A", svn_depth_infinity, receive_lock,
+                            locks, pool));
+  SVN_ERR(svn_fs_unlock(fs, "/A/mu", svn_hash_gets(locks, "/A/mu"), FALSE,
+                        pool));
+  SVN_ERR(svn_fs_get_lock(&lock, fs, "/A/mu", pool));
+  SVN_TEST_ASSERT(lock == NULL);
+  SVN_ERR(svn_fs_get_lock(&lock, fs, "/A/D/gamma", pool));
+  SVN_TEST_ASSERT(lock && !strcmp(lock->owner, "user"));
+
+  /* A new FS instance must see the same locks. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, fs_path, fs_config, pool, pool));
+  SVN_ERR(svn_fs_set_access(fs, access));
+  SVN_ERR(check_lock_count(fs, "/", 3, pool));
+  SVN_ERR(check_lock_count(fs, "/A/D", 2, pool));
+
+  /* Deleting a directory requires the tokens of all locks below it. */
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, rev, SVN_FS_TXN_CHECK_LOCKS, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_TEST_ASSERT_ERROR(svn_fs_delete(txn_root, "/A/D", pool),
+                        SVN_ERR_FS_BAD_LOCK_TOKEN);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+/* Implements svn_fs_get_locks_callback_t, failing on the first lock. */
+static svn_error_t *
+fail_on_lock(void *baton,
+             svn_lock_t *lock,
+             apr_pool_t *pool)
+{
+  return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+}
+
+#define REPO_NAME "test-repo-lock-db-operations-test"
+
+static svn_error_t *
+lock_db_operations(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_revnum_t rev;
+  svn_fs_t *fs;
+  svn_fs_access_t *access;
+  svn_lock_t *lock;
+  apr_hash_t *locks = apr_hash_make(pool);
+  apr_hash_index_t *hi;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't support lock databases");
+
+  /* Switch a new filesystem to the lock database.  All connections to it
+   * use synchronous=FULL. */
+  SVN_ERR(create_greek_repo(&repos, &rev, opts, REPO_NAME, pool, pool));
+  fs = svn_repos_fs(repos);
+  SVN_ERR(svn_fs_create_access(&access, "user", pool));
+  SVN_ERR(svn_fs_set_access(fs, access));
+  SVN_ERR(svn_fs_lock(&lock, fs, "/iota", NULL, "", FALSE, 0, rev, FALSE,
+                      pool));
+  SVN_ERR(svn_fs_fs__migrate_locks(fs, NULL, NULL, pool));
+
+  SVN_ERR(svn_fs_lock(&lock, fs, "/A/mu", NULL, "", FALSE, 0, rev, FALSE,
+                      pool));
+  SVN_ERR(svn_fs_lock(&lock, fs, "/A/B/lambda", NULL, "", FALSE, 0, rev,
+                      FALSE, pool));
+  SVN_ERR(svn_fs_lock(&lock, fs, "/A/D/G/pi", NULL, "", FALSE, 0, rev,
+                      FALSE, pool));
+  SVN_ERR(check_lock_count(fs, "/", 4, pool));
+
+  /* A failing receiver must not leave the database in an unusable state. */
+  SVN_TEST_ASSERT_ERROR(svn_fs_get_locks2(fs, "/A", svn_depth_infinity,
+                                          fail_on_lock, NULL, pool),
+                        SVN_ERR_CANCELLED);
+  SVN_ERR(check_lock_count(fs, "/A", 3, pool));
+
+  /* Remove all locks again. */
+  SVN_ERR(svn_fs_get_locks2(fs, "/", svn_depth_infinity, receive_lock,
+                            locks, pool));
+  for (hi = apr_hash_first(pool, locks); hi; hi = apr_hash_next(hi))
+    SVN_ERR(svn_fs_unlock(fs, apr_hash_this_key(hi), apr_hash_this_val(hi),
+                          FALSE, pool));
+  SVN_ERR(check_lock_count(fs, "/", 0, pool));
+
+  /* A new FS instance must see the same state. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, svn_fs_path(fs, pool), fs_config, pool, pool));
+  SVN_ERR(check_lock_count(fs, "/", 0, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
 
 
 /* The test table.  */
@@ -435,6 +636,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "dump the P2L index"),
     SVN_TEST_OPTS_PASS(load_index,
                        "load the P2L index"),
+    SVN_TEST_OPTS_PASS(migrate_locks,
+                       "migrate locks to a lock database"),
+    SVN_TEST_OPTS_PASS(lock_db_operations,
+                       "lock, unlock and list locks in a lock database"),
     SVN_TEST_NULL
   };
 
@@ -39,11 +39,13 @@
 #include "svn_props.h"
 #include "svn_sorts.h"
 #include "svn_version.h"
+#include "private/svn_mergeinfo_private.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_dep_compat.h"
 
 /* be able to look into svn_config_t */
 #include "../../libsvn_subr/config_impl.h"
+#include "../../libsvn_repos/repos.h"
 
 #include "../svn_test_fs.h"
 
@@ -3512,6 +3514,308 @@ get_logs(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Log receiver which appends the revision number to the stringbuf
+   passed in as BATON. */
+static svn_error_t *
+log_revs_receiver(void *baton,
+                  svn_repos_log_entry_t *log_entry,
+                  apr_pool_t *pool)
+{
+  svn_stringbuf_t *revs = baton;
+  svn_stringbuf_appendcstr(revs, apr_psprintf(pool, " %ld",
+                                              log_entry->revision));
+  return SVN_NO_ERROR;
+}
+
+/* Return the revisions reported by svn_repos_get_logs5 for PATH in
+   REPOS, youngest first, as a space separated list in *REVS. */
+static svn_error_t *
+get_log_revs(const char **revs,
+             svn_repos_t *repos,
+             const char *path,
+             svn_boolean_t strict_node_history,
+             apr_pool_t *pool)
+{
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+  apr_array_header_t *paths = apr_array_make(pool, 1, sizeof(const char *));
+
+  APR_ARRAY_PUSH(paths, const char *) = path;
+  SVN_ERR(svn_repos_get_logs5(repos, paths, SVN_INVALID_REVNUM, 0, 0,
+                              strict_node_history, FALSE, NULL, NULL, NULL,
+                              NULL, NULL, log_revs_receiver, buf, pool));
+  *revs = buf->data;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+log_index(const svn_test_opts_t *opts,
+          apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  const char *paths[] = { "/", "/A", "/A/mu", "/A/B/E/alpha", "/A/D/G",
+                          "/A/D/G/pi", "/Z/E/alpha", "/Z" };
+  const char *expected[2][sizeof(paths) / sizeof(paths[0])];
+  int i;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-log-index",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 2:  Tweak A/mu and A/B/E/alpha. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu",
+                                      "Revision 2", subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/E/alpha",
+                                      "Revision 2", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 3:  Copy A/B to Z. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A/B", txn_root, "Z", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 4:  Tweak Z/E/alpha and replace A/D/G. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "Z/E/alpha",
+                                      "Revision 4", subpool));
+  SVN_ERR(svn_fs_delete(txn_root, "A/D/G", subpool));
+  SVN_ERR(svn_fs_make_dir(txn_root, "A/D/G", subpool));
+  SVN_ERR(svn_fs_make_file(txn_root, "A/D/G/pi", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Record what the plain history walk reports. */
+  for (i = 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+    {
+      SVN_ERR(get_log_revs(&expected[0][i], repos, paths[i], FALSE, pool));
+      SVN_ERR(get_log_revs(&expected[1][i], repos, paths[i], TRUE, pool));
+    }
+
+  /* Build the index for r0..r4 and let the next commit update it. */
+  SVN_ERR(svn_repos_log_index_build(repos, NULL, NULL, NULL, NULL, pool));
+
+  /* Revision 5:  Tweak A/mu once more. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu",
+                                      "Revision 5", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* r5 shows up for "/", "/A" and "/A/mu" only. */
+  for (i = 0; i < 3; i++)
+    {
+      expected[0][i] = apr_pstrcat(pool, " 5", expected[0][i], SVN_VA_NULL);
+      expected[1][i] = apr_pstrcat(pool, " 5", expected[1][i], SVN_VA_NULL);
+    }
+
+  /* The index must not change any of the results. */
+  for (i = 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+    {
+      const char *revs;
+
+      SVN_ERR(get_log_revs(&revs, repos, paths[i], FALSE, subpool));
+      SVN_TEST_STRING_ASSERT(revs, expected[0][i]);
+      SVN_ERR(get_log_revs(&revs, repos, paths[i], TRUE, subpool));
+      SVN_TEST_STRING_ASSERT(revs, expected[1][i]);
+      svn_pool_clear(subpool);
+    }
+
+  SVN_ERR(svn_repos_log_index_verify(repos, SVN_INVALID_REVNUM,
+                                     SVN_INVALID_REVNUM, NULL, NULL,
+                                     NULL, NULL, pool));
+
+  /* A late post-commit update for an older revision must not drop
+     younger revisions from the index. */
+  SVN_ERR(svn_repos__log_index_update(repos, 3, pool));
+  SVN_ERR(svn_repos_log_index_verify(repos, 5, 5, NULL, NULL, NULL, NULL,
+                                     pool));
+
+  SVN_TEST_ASSERT_ERROR(svn_repos_log_index_verify(repos, 4, 2, NULL, NULL,
+                                                   NULL, NULL, pool),
+                        SVN_ERR_REPOS_BAD_ARGS);
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+/* Log receiver which appends the revision number to the stringbuf
+   passed in as BATON, marking revisions with merged children by a '+'
+   and the end of the children by a '.'. */
+static svn_error_t *
+log_merged_revs_receiver(void *baton,
+                         svn_repos_log_entry_t *log_entry,
+                         apr_pool_t *pool)
+{
+  svn_stringbuf_t *revs = baton;
+
+  if (SVN_IS_VALID_REVNUM(log_entry->revision))
+    svn_stringbuf_appendcstr(revs,
+                             apr_psprintf(pool, " %ld%s",
+                                          log_entry->revision,
+                                          log_entry->has_children ? "+"
+                                                                  : ""));
+  else
+    svn_stringbuf_appendcstr(revs, " .");
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the revisions, including merged ones, reported by
+   svn_repos_get_logs5 for PATH in REPOS as formatted by
+   log_merged_revs_receiver in *REVS. */
+static svn_error_t *
+get_log_merged_revs(const char **revs,
+                    svn_repos_t *repos,
+                    const char *path,
+                    apr_pool_t *pool)
+{
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+  apr_array_header_t *paths = apr_array_make(pool, 1, sizeof(const char *));
+
+  APR_ARRAY_PUSH(paths, const char *) = path;
+  SVN_ERR(svn_repos_get_logs5(repos, paths, SVN_INVALID_REVNUM, 0, 0,
+                              FALSE, TRUE, NULL, NULL, NULL,
+                              NULL, NULL, log_merged_revs_receiver, buf,
+                              pool));
+  *revs = buf->data;
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the mergeinfo catalogs EXPECTED and ACTUAL are equal. */
+static svn_error_t *
+compare_mergeinfo_catalogs(svn_mergeinfo_catalog_t expected,
+                           svn_mergeinfo_catalog_t actual,
+                           apr_pool_t *pool)
+{
+  apr_hash_index_t *hi;
+
+  SVN_TEST_ASSERT(apr_hash_count(expected) == apr_hash_count(actual));
+  for (hi = apr_hash_first(pool, expected); hi; hi = apr_hash_next(hi))
+    {
+      const char *path = apr_hash_this_key(hi);
+      svn_mergeinfo_t mergeinfo = svn_hash_gets(actual, path);
+      svn_boolean_t equal;
+
+      SVN_TEST_ASSERT(mergeinfo);
+      SVN_ERR(svn_mergeinfo__equals(&equal, apr_hash_this_val(hi),
+                                    mergeinfo, TRUE, pool));
+      SVN_TEST_ASSERT(equal);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+log_index_mergeinfo(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  svn_revnum_t rev;
+  svn_repos__log_index_t *index;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  const char *expected, *revs;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-log-index-mergeinfo",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 2:  Branch A to B2. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "B2", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 3:  Tweak B2/mu. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "B2/mu",
+                                      "Revision 3", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 4:  Merge r3 back into A. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu",
+                                      "Revision 3", subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A", SVN_PROP_MERGEINFO,
+                                  svn_string_create("/B2:3", subpool),
+                                  subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 5:  Extend the mergeinfo. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A", SVN_PROP_MERGEINFO,
+                                  svn_string_create("/B2:2-3", subpool),
+                                  subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 6:  Remove the mergeinfo again. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A", SVN_PROP_MERGEINFO,
+                                  NULL, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  SVN_ERR(get_log_merged_revs(&expected, repos, "/A", pool));
+  SVN_ERR(svn_repos_log_index_build(repos, NULL, NULL, NULL, NULL, pool));
+
+  /* The pre-parsed mergeinfo changes must match the ones read from the
+     repository. */
+  SVN_ERR(svn_repos__log_index_open(&index, repos, pool, pool));
+  SVN_TEST_ASSERT(index);
+  SVN_TEST_ASSERT(svn_repos__log_index_youngest(index) == youngest_rev);
+  for (rev = 1; rev <= youngest_rev; ++rev)
+    {
+      svn_mergeinfo_catalog_t deleted, added;
+      svn_mergeinfo_catalog_t indexed_deleted, indexed_added;
+
+      SVN_ERR(svn_repos__mergeinfo_changed(&deleted, &added, fs, rev,
+                                           subpool, subpool));
+      SVN_ERR(svn_repos__log_index_mergeinfo_changed(&indexed_deleted,
+                                                     &indexed_added, index,
+                                                     rev, subpool, subpool));
+      SVN_ERR(compare_mergeinfo_catalogs(deleted, indexed_deleted, subpool));
+      SVN_ERR(compare_mergeinfo_catalogs(added, indexed_added, subpool));
+      svn_pool_clear(subpool);
+    }
+
+  /* Merged revisions reported through the index must not change. */
+  SVN_ERR(get_log_merged_revs(&revs, repos, "/A", pool));
+  SVN_TEST_STRING_ASSERT(revs, expected);
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
 
 /* Tests for svn_repos_get_file_revsN() */
 
@@ -4505,6 +4809,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test if revprops are validated by repos"),
     SVN_TEST_OPTS_PASS(get_logs,
                        "test svn_repos_get_logs ranges and limits"),
+    SVN_TEST_OPTS_PASS(log_index,
+                       "test svn_repos_get_logs with the log index"),
+    SVN_TEST_OPTS_PASS(log_index_mergeinfo,
+                       "test merged revisions with the log index"),
     SVN_TEST_OPTS_PASS(test_get_file_revs,
                        "test svn_repos_get_file_revsN"),
     SVN_TEST_OPTS_PASS(issue_4060,
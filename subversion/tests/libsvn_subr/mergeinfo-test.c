@@ -1857,6 +1857,216 @@ test_rangelist_loop(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Set REVS[1..RANDOM_REV_ARRAY_LENGTH-1] randomly to 0 (not merged),
+ * 1 (merged and inheritable) or 2 (merged but non-inheritable). */
+static void
+randomly_fill_rev_states(int *revs)
+{
+  int i;
+
+  revs[0] = 0;
+  for (i = 1; i < RANDOM_REV_ARRAY_LENGTH; i++)
+    revs[i] = (int)(svn_test_rand(&random_rev_array_seed) % 3);
+}
+
+/* Return the canonical compact rangelist for the rev states in REVS as
+ * produced by randomly_fill_rev_states(), allocated in POOL. */
+static svn_error_t *
+rev_states_to_compact(svn_rangelist__compact_t **compact,
+                      const int *revs,
+                      apr_pool_t *pool)
+{
+  svn_rangelist_t *rangelist = apr_array_make(pool, 1,
+                                              sizeof(svn_merge_range_t *));
+  svn_merge_range_t *range = NULL;
+  int i;
+
+  for (i = 1; i < RANDOM_REV_ARRAY_LENGTH; i++)
+    {
+      if (!revs[i])
+        range = NULL;
+      else if (range && range->inheritable == (revs[i] == 1))
+        range->end = i;
+      else
+        {
+          range = apr_palloc(pool, sizeof(*range));
+          range->start = i - 1;
+          range->end = i;
+          range->inheritable = (revs[i] == 1);
+          APR_ARRAY_PUSH(rangelist, svn_merge_range_t *) = range;
+        }
+    }
+
+  SVN_TEST_ASSERT(svn_rangelist__is_canonical(rangelist));
+  return svn_error_trace(svn_rangelist__compact_from_rangelist(compact,
+                                                               rangelist,
+                                                               pool, pool));
+}
+
+/* Verify that COMPACT is canonical and covers exactly the revisions that
+ * are non-zero in EXPECTED.  If CHECK_INHERITANCE is set, also verify
+ * the inheritability of every revision.  Use OP in error messages. */
+static svn_error_t *
+verify_compact(const svn_rangelist__compact_t *compact,
+               const int *expected,
+               svn_boolean_t check_inheritance,
+               const char *op,
+               apr_pool_t *pool)
+{
+  int actual[RANDOM_REV_ARRAY_LENGTH] = { 0 };
+  int i, k;
+
+  SVN_TEST_ASSERT(svn_rangelist__is_canonical(
+                    svn_rangelist__compact_to_rangelist(compact, pool)));
+
+  for (i = 0; i < compact->nelts; i++)
+    for (k = compact->start[i] + 1; k <= compact->end[i]; k++)
+      actual[k] = compact->inheritable[i] ? 1 : 2;
+
+  for (k = 0; k < RANDOM_REV_ARRAY_LENGTH; k++)
+    if (   (!actual[k] != !expected[k])
+        || (check_inheritance && actual[k] != expected[k]))
+      return fail(pool, "compact %s gave state %d for r%d, expected %d",
+                  op, actual[k], k, expected[k]);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_compact_rangelist_randomly(apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  random_rev_array_seed = (apr_uint32_t) apr_time_now();
+
+  for (i = 0; i < 100; i++)
+    {
+      int first_revs[RANDOM_REV_ARRAY_LENGTH];
+      int second_revs[RANDOM_REV_ARRAY_LENGTH];
+      int expected[RANDOM_REV_ARRAY_LENGTH];
+      svn_rangelist__compact_t *first, *second, *result;
+      int k;
+
+      svn_pool_clear(iterpool);
+
+      randomly_fill_rev_states(first_revs);
+      randomly_fill_rev_states(second_revs);
+      SVN_ERR(rev_states_to_compact(&first, first_revs, iterpool));
+      SVN_ERR(rev_states_to_compact(&second, second_revs, iterpool));
+
+      /* Union: inheritable wins. */
+      for (k = 0; k < RANDOM_REV_ARRAY_LENGTH; k++)
+        if (first_revs[k] == 1 || second_revs[k] == 1)
+          expected[k] = 1;
+        else
+          expected[k] = first_revs[k] ? first_revs[k] : second_revs[k];
+      svn_rangelist__compact_merge(&result, first, second, iterpool);
+      SVN_ERR(verify_compact(result, expected, TRUE, "merge", iterpool));
+
+      /* Intersection and removal ignore inheritance and may combine
+         adjacent ranges of different inheritability. */
+      for (k = 0; k < RANDOM_REV_ARRAY_LENGTH; k++)
+        expected[k] = first_revs[k] && second_revs[k];
+      svn_rangelist__compact_intersect(&result, first, second, iterpool);
+      SVN_ERR(verify_compact(result, expected, FALSE, "intersect",
+                             iterpool));
+
+      for (k = 0; k < RANDOM_REV_ARRAY_LENGTH; k++)
+        expected[k] = second_revs[k] && !first_revs[k];
+      svn_rangelist__compact_remove(&result, first, second, iterpool);
+      SVN_ERR(verify_compact(result, expected, FALSE, "remove", iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Return a rangelist with COUNT ranges of length LENGTH, separated by
+ * gaps of GAP revisions and starting at FIRST, allocated in POOL.  Every
+ * third range is non-inheritable. */
+static svn_rangelist_t *
+make_striped_rangelist(int count,
+                       svn_revnum_t first,
+                       svn_revnum_t length,
+                       svn_revnum_t gap,
+                       apr_pool_t *pool)
+{
+  svn_rangelist_t *rangelist = apr_array_make(pool, count,
+                                              sizeof(svn_merge_range_t *));
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      svn_merge_range_t *range = apr_palloc(pool, sizeof(*range));
+
+      range->start = first + i * (length + gap);
+      range->end = range->start + length;
+      range->inheritable = (i % 3 != 0);
+      APR_ARRAY_PUSH(rangelist, svn_merge_range_t *) = range;
+    }
+
+  return rangelist;
+}
+
+static svn_error_t *
+test_rangelist_merge_performance(apr_pool_t *pool)
+{
+  enum { COUNT = 200000 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_rangelist_t *base, *changes, *output;
+  svn_rangelist__compact_t *compact_base, *compact_changes, *result;
+  apr_time_t start, end;
+  int i;
+
+  /* Two interleaved lists of partially overlapping ranges. */
+  base = make_striped_rangelist(COUNT, 0, 3, 2, pool);
+  changes = make_striped_rangelist(COUNT, 2, 2, 3, pool);
+
+  start = apr_time_now();
+  for (i = 0; i < 10; i++)
+    {
+      svn_rangelist_t *target = svn_rangelist_dup(base, iterpool);
+
+      SVN_ERR(svn_rangelist_merge2(target, changes, iterpool, iterpool));
+      svn_pool_clear(iterpool);
+    }
+  end = apr_time_now();
+  printf("svn_rangelist_merge2:     %"APR_TIME_T_FMT" musecs\n",
+         (end - start) / 10);
+
+  start = apr_time_now();
+  for (i = 0; i < 10; i++)
+    {
+      SVN_ERR(svn_rangelist_intersect(&output, base, changes, FALSE,
+                                      iterpool));
+      svn_pool_clear(iterpool);
+    }
+  end = apr_time_now();
+  printf("svn_rangelist_intersect:  %"APR_TIME_T_FMT" musecs\n",
+         (end - start) / 10);
+
+  /* The set operation alone, without converting from and to
+     svn_rangelist_t. */
+  SVN_ERR(svn_rangelist__compact_from_rangelist(&compact_base, base,
+                                                pool, pool));
+  SVN_ERR(svn_rangelist__compact_from_rangelist(&compact_changes, changes,
+                                                pool, pool));
+  start = apr_time_now();
+  for (i = 0; i < 10; i++)
+    {
+      svn_rangelist__compact_merge(&result, compact_base, compact_changes,
+                                   iterpool);
+      svn_pool_clear(iterpool);
+    }
+  end = apr_time_now();
+  printf("compact merge:            %"APR_TIME_T_FMT" musecs\n",
+         (end - start) / 10);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -1904,6 +2114,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "merge of rangelists with overlaps (issue 4686)"),
     SVN_TEST_XFAIL2(test_rangelist_loop,
                     "test rangelist edgecases via loop"),
+    SVN_TEST_PASS2(test_compact_rangelist_randomly,
+                   "test compact rangelists with random data"),
+    SVN_TEST_SKIP2(test_rangelist_merge_performance, TRUE,
+                   "optional rangelist merge performance test"),
     SVN_TEST_NULL
   };
 
@@ -31,10 +31,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <apr_pools.h>
+#include <apr_time.h>
 
 #include "../svn_test.h"
 
 #include "svn_error.h"
+#include "svn_pools.h"
 #include "svn_string.h"   /* This includes <apr_*.h> */
 #include "private/svn_packed_data.h"
 
@@ -553,6 +555,80 @@ test_full_structure(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Mostly small numbers with a few large ones at varying positions, to
+ * exercise the word-at-a-time as well as the number-by-number decoding
+ * paths.  In verbose mode, report the decoding speed.
+ */
+static svn_error_t *
+test_small_uint_runs(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  enum { COUNT = 100000, ROUNDS = 20 };
+  apr_uint64_t *values = apr_palloc(pool, COUNT * sizeof(*values));
+  svn_packed__data_root_t *root;
+  svn_packed__int_stream_t *stream;
+  svn_stringbuf_t *serialized = svn_stringbuf_create_empty(pool);
+  svn_stream_t *data_stream;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_time_t start;
+  apr_interval_time_t elapsed;
+  apr_uint64_t sum = 0;
+  apr_uint64_t expected_sum = 0;
+  apr_size_t i;
+  int round;
+
+  for (i = 0; i < COUNT; ++i)
+    {
+      if (i % 37 == 0)
+        values[i] = APR_UINT64_C(1) << (i % 64);
+      else if (i % 11 == 0)
+        values[i] = 128 + i % 1000;
+      else
+        values[i] = i % 128;
+
+      expected_sum += values[i];
+    }
+
+  SVN_ERR(verify_uint_stream(values, COUNT, FALSE, pool));
+  SVN_ERR(verify_uint_stream(values, COUNT, TRUE, pool));
+
+  /* Serialize the numbers once and decode them many times. */
+  root = svn_packed__data_create_root(pool);
+  stream = svn_packed__create_int_stream(root, FALSE, FALSE);
+  for (i = 0; i < COUNT; ++i)
+    svn_packed__add_uint(stream, values[i]);
+
+  data_stream = svn_stream_from_stringbuf(serialized, pool);
+  SVN_ERR(svn_packed__data_write(data_stream, root, pool));
+  SVN_ERR(svn_stream_close(data_stream));
+
+  start = apr_time_now();
+  for (round = 0; round < ROUNDS; ++round)
+    {
+      svn_packed__data_root_t *read_root;
+
+      svn_pool_clear(iterpool);
+      data_stream = svn_stream_from_stringbuf(serialized, iterpool);
+      SVN_ERR(svn_packed__data_read(&read_root, data_stream, iterpool,
+                                    iterpool));
+      stream = svn_packed__first_int_stream(read_root);
+      for (i = 0; i < COUNT; ++i)
+        sum += svn_packed__get_uint(stream);
+    }
+
+  elapsed = apr_time_now() - start;
+  svn_pool_destroy(iterpool);
+
+  SVN_TEST_ASSERT(sum == expected_sum * ROUNDS);
+
+  if (opts->verbose)
+    printf("Decoded %.0f numbers per second\n",
+           (double)COUNT * ROUNDS * APR_USEC_PER_SEC
+             / (elapsed > 0 ? elapsed : 1));
+
+  return SVN_NO_ERROR;
+}
+
 /* An array of all test functions */
 
 static int max_threads = 1;
@@ -572,6 +648,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test empty, nested structure"),
     SVN_TEST_PASS2(test_full_structure,
                    "test nested structure"),
+    SVN_TEST_OPTS_PASS(test_small_uint_runs,
+                       "test and time decoding runs of small numbers"),
     SVN_TEST_NULL
   };
 
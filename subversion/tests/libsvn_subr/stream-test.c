@@ -24,11 +24,13 @@
 #include <stdio.h>
 #include "svn_pools.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 #include "svn_subst.h"
 #include "svn_base64.h"
 #include <apr_general.h>
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test.h"
 
@@ -1002,6 +1004,55 @@ test_stream_readline_file_crlf(apr_pool_t *pool)
 
 /* The test table.  */
 
+static svn_error_t *
+test_stream_compressed_lz4(apr_pool_t *pool)
+{
+  /* Empty, shorter than a block, exactly one block and several blocks
+     with a partial one at the end. */
+  static const apr_size_t sizes[] = { 0, 17, 0x10000, 200000 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+      svn_stringbuf_t *origbuf, *packed, *inbuf;
+      svn_stream_t *stream;
+      apr_size_t pos;
+
+      svn_pool_clear(iterpool);
+      origbuf = generate_test_bytes((int)sizes[i], iterpool);
+      packed = svn_stringbuf_create_empty(iterpool);
+
+      /* Write in odd-sized pieces to exercise the block buffering. */
+      stream = svn__stream_compressed_lz4(
+                 svn_stream_from_stringbuf(packed, iterpool), iterpool);
+      for (pos = 0; pos < origbuf->len; )
+        {
+          apr_size_t len = MIN(origbuf->len - pos, 1000 + pos % 7);
+
+          SVN_ERR(svn_stream_write(stream, origbuf->data + pos, &len));
+          pos += len;
+        }
+      SVN_ERR(svn_stream_close(stream));
+
+      if (sizes[i] == 0)
+        SVN_TEST_INT_ASSERT(packed->len, 0);
+
+      stream = svn__stream_compressed_lz4(
+                 svn_stream_from_stringbuf(packed, iterpool), iterpool);
+      SVN_ERR(svn_stringbuf_from_stream(&inbuf, stream, 0, iterpool));
+      SVN_ERR(svn_stream_close(stream));
+
+      if (! svn_stringbuf_compare(inbuf, origbuf))
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Got unexpected result for %d bytes",
+                                 (int)sizes[i]);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 static int max_threads = 1;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -1037,6 +1088,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test reading LF-terminated lines from file"),
     SVN_TEST_PASS2(test_stream_readline_file_crlf,
                    "test reading CRLF-terminated lines from file"),
+    SVN_TEST_PASS2(test_stream_compressed_lz4,
+                   "test LZ4 compressed streams"),
     SVN_TEST_NULL
   };
 
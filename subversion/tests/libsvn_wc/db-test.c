@@ -1525,6 +1525,141 @@ test_externals_store(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Add the directory DIR with COUNT child files to the BASE tree of the
+   working copy at LOCAL_ABSPATH in DB, and set *ROWS_PER_SEC to the number
+   of file nodes that got added per second.  */
+static svn_error_t *
+add_many_files(double *rows_per_sec,
+               svn_wc__db_t *db,
+               const char *local_abspath,
+               const char *dir,
+               int count,
+               apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_hash_t *props = apr_hash_make(pool);
+  svn_checksum_t *checksum;
+  apr_time_t start;
+  int i;
+
+  SVN_ERR(svn_checksum_parse_hex(&checksum, svn_checksum_sha1, SHA1_1, pool));
+
+  SVN_ERR(svn_wc__db_base_add_directory(
+            db, svn_dirent_join(local_abspath, dir, pool),
+            local_abspath,
+            dir, ROOT_ONE, UUID_ONE, 3,
+            props,
+            1, TIME_1a, AUTHOR_1,
+            NULL, svn_depth_infinity,
+            NULL, FALSE, NULL, NULL, NULL, NULL,
+            pool));
+
+  start = apr_time_now();
+  for (i = 0; i < count; i++)
+    {
+      const char *relpath;
+
+      svn_pool_clear(iterpool);
+      relpath = svn_relpath_join(dir, apr_psprintf(iterpool, "f-%d", i),
+                                 iterpool);
+
+      SVN_ERR(svn_wc__db_base_add_file(
+                db, svn_dirent_join(local_abspath, relpath, iterpool),
+                local_abspath,
+                relpath, ROOT_ONE, UUID_ONE, 3,
+                props,
+                1, TIME_1a, AUTHOR_1,
+                checksum,
+                NULL, FALSE, FALSE, NULL, NULL, FALSE, FALSE,
+                NULL, NULL,
+                iterpool));
+    }
+
+  *rows_per_sec = count * (double)APR_USEC_PER_SEC
+                / (apr_time_now() - start + 1);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_bulk_base_add(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  const char *local_abspath;
+  double plain_rate, bulk_rate;
+  const int count = 2 * SVN_WC__BULK_MAX_CHANGES + 10;
+  svn_boolean_t full;
+  int bulk_depth;
+
+  SVN_ERR(create_open(&db, &local_abspath, "test_bulk_base_add", pool));
+
+  SVN_ERR(add_many_files(&plain_rate, db, local_abspath, "plain", count,
+                         pool));
+
+  /* Nested bulk operations share one transaction. */
+  SVN_ERR(svn_wc__db_bulk_begin(db, local_abspath, pool));
+  SVN_ERR(svn_wc__db_bulk_begin(db, local_abspath, pool));
+  SVN_ERR(svn_wc__db_bulk_is_full(&full, db, local_abspath, pool));
+  SVN_TEST_ASSERT(!full);
+  SVN_ERR(add_many_files(&bulk_rate, db, local_abspath, "bulk", count,
+                         pool));
+  SVN_ERR(svn_wc__db_bulk_is_full(&full, db, local_abspath, pool));
+  SVN_TEST_ASSERT(full);
+
+  /* Pending changes are visible to the DB handle that made them. */
+  SVN_ERR(validate_node(db, local_abspath, "bulk/f-0",
+                        svn_node_file, svn_wc__db_status_normal,
+                        pool));
+
+  /* Suspending commits them, just like the work queue does. */
+  SVN_ERR(svn_wc__db_bulk_suspend(&bulk_depth, db, local_abspath, pool));
+  SVN_TEST_ASSERT(bulk_depth == 2);
+  SVN_ERR(svn_wc__db_bulk_is_full(&full, db, local_abspath, pool));
+  SVN_TEST_ASSERT(!full);
+  SVN_ERR(svn_wc__db_bulk_resume(db, local_abspath, bulk_depth, pool));
+
+  SVN_ERR(add_many_files(&bulk_rate, db, local_abspath, "bulk2", count,
+                         pool));
+  SVN_ERR(svn_wc__db_bulk_end(db, local_abspath, pool));
+  SVN_ERR(svn_wc__db_bulk_end(db, local_abspath, pool));
+
+  /* Everything must have been committed. */
+  SVN_ERR(svn_wc__db_close(db));
+  SVN_ERR(svn_wc__db_open(&db, NULL, FALSE, TRUE, pool, pool));
+
+  SVN_ERR(validate_node(db, local_abspath, "plain",
+                        svn_node_dir, svn_wc__db_status_normal,
+                        pool));
+  SVN_ERR(validate_node(db, local_abspath,
+                        apr_psprintf(pool, "plain/f-%d", count - 1),
+                        svn_node_file, svn_wc__db_status_normal,
+                        pool));
+  SVN_ERR(validate_node(db, local_abspath, "bulk",
+                        svn_node_dir, svn_wc__db_status_normal,
+                        pool));
+  SVN_ERR(validate_node(db, local_abspath, "bulk/f-0",
+                        svn_node_file, svn_wc__db_status_normal,
+                        pool));
+  SVN_ERR(validate_node(db, local_abspath,
+                        apr_psprintf(pool, "bulk/f-%d", count - 1),
+                        svn_node_file, svn_wc__db_status_normal,
+                        pool));
+  SVN_ERR(validate_node(db, local_abspath,
+                        apr_psprintf(pool, "bulk2/f-%d", count - 1),
+                        svn_node_file, svn_wc__db_status_normal,
+                        pool));
+
+  if (opts->verbose)
+    printf("BASE file nodes per second: %.0f separately, %.0f in bulk\n",
+           plain_rate, bulk_rate);
+
+  SVN_ERR(svn_wc__db_close(db));
+
+  return SVN_NO_ERROR;
+}
+
 static int max_threads = 2;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -1550,6 +1685,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "work queue processing"),
     SVN_TEST_PASS2(test_externals_store,
                    "externals store"),
+    SVN_TEST_OPTS_PASS(test_bulk_base_add,
+                       "adding BASE nodes in bulk mode"),
     SVN_TEST_NULL
   };
 
@@ -34,6 +34,7 @@
 #define SVN_DEPRECATED
 #include "svn_io.h"
 
+#include "svn_config.h"
 #include "svn_dirent_uri.h"
 #include "svn_pools.h"
 #include "svn_repos.h"
@@ -306,6 +307,279 @@ reject_mismatching_text(const svn_test_opts_t *opts,
 #endif
 }
 
+/* Install TEXT into the pristine store of the WC at WC_ABSPATH using DB.
+ * Set *SHA1 to its checksum. */
+static svn_error_t *
+install_text(svn_checksum_t **sha1,
+             svn_wc__db_t *db,
+             const char *wc_abspath,
+             const char *text,
+             apr_pool_t *pool)
+{
+  svn_wc__db_install_data_t *install_data;
+  svn_stream_t *pristine_stream;
+  svn_checksum_t *md5;
+  apr_size_t sz = strlen(text);
+
+  SVN_ERR(svn_wc__db_pristine_prepare_install(&pristine_stream,
+                                              &install_data,
+                                              sha1, &md5,
+                                              db, wc_abspath,
+                                              pool, pool));
+  SVN_ERR(svn_stream_write(pristine_stream, text, &sz));
+  SVN_ERR(svn_stream_close(pristine_stream));
+
+  return svn_error_trace(svn_wc__db_pristine_install(install_data,
+                                                     *sha1, md5, pool));
+}
+
+/* Test that two working copies configured with the same shared pristine
+ * store share their pristine texts, and that a text is removed from the
+ * shared store only when neither of them uses it any more. */
+static svn_error_t *
+shared_pristine_store(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  svn_config_t *config;
+  const char *wc1_abspath, *wc2_abspath;
+  const char *shared_abspath;
+  const char *shared_text_abspath;
+  const char *pristine_abspath;
+  svn_wc__db_t *ignored_db;
+  svn_checksum_t *sha1;
+  svn_node_kind_t kind;
+  apr_finfo_t finfo;
+  const char *hexdigest;
+  svn_stringbuf_t *contents;
+
+  SVN_ERR(create_repos_and_wc(&wc1_abspath, &ignored_db,
+                              "shared_pristine_store_1", opts, pool));
+  SVN_ERR(create_repos_and_wc(&wc2_abspath, &ignored_db,
+                              "shared_pristine_store_2", opts, pool));
+
+  shared_abspath = svn_test_data_path("shared_pristine_store", pool);
+  SVN_ERR(svn_io_remove_dir2(shared_abspath, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(shared_abspath);
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE, shared_abspath);
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, TRUE, pool, pool));
+
+  SVN_ERR(install_text(&sha1, db, wc1_abspath, "Shared text", pool));
+
+  hexdigest = svn_checksum_to_cstring(sha1, pool);
+  shared_text_abspath = svn_dirent_join_many(pool, shared_abspath,
+                                             apr_pstrndup(pool, hexdigest, 2),
+                                             apr_pstrcat(pool, hexdigest,
+                                                         ".svn-base",
+                                                         SVN_VA_NULL),
+                                             SVN_VA_NULL);
+
+  SVN_ERR(svn_io_check_path(shared_text_abspath, &kind, pool));
+  if (kind != svn_node_file)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "Hard links are not supported here");
+
+  SVN_ERR(install_text(&sha1, db, wc2_abspath, "Shared text", pool));
+
+  /* Both pristine stores use the shared copy. */
+  SVN_ERR(svn_wc__db_pristine_get_path(&pristine_abspath, db, wc2_abspath,
+                                       sha1, pool, pool));
+  SVN_ERR(svn_io_stat(&finfo, shared_text_abspath, APR_FINFO_NLINK, pool));
+  if (finfo.valid & APR_FINFO_NLINK)
+    SVN_TEST_INT_ASSERT(finfo.nlink, 3);
+
+  /* Removing it from one working copy keeps it for the other. */
+  SVN_ERR(svn_wc__db_pristine_remove(db, wc1_abspath, sha1, pool));
+  SVN_ERR(svn_io_check_path(shared_text_abspath, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+  SVN_ERR(svn_io_check_path(pristine_abspath, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  /* Removing it from the last one removes the shared copy as well. */
+  SVN_ERR(svn_wc__db_pristine_remove(db, wc2_abspath, sha1, pool));
+  SVN_ERR(svn_io_check_path(shared_text_abspath, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  /* A file of the right size but with the wrong text in the shared store
+     must not replace our own copy. */
+  SVN_ERR(svn_checksum(&sha1, svn_checksum_sha1, "Other text", 10, pool));
+  hexdigest = svn_checksum_to_cstring(sha1, pool);
+  shared_text_abspath = svn_dirent_join_many(pool, shared_abspath,
+                                             apr_pstrndup(pool, hexdigest, 2),
+                                             apr_pstrcat(pool, hexdigest,
+                                                         ".svn-base",
+                                                         SVN_VA_NULL),
+                                             SVN_VA_NULL);
+  SVN_ERR(svn_io_make_dir_recursively(svn_dirent_dirname(shared_text_abspath,
+                                                         pool),
+                                      pool));
+  SVN_ERR(svn_io_file_create(shared_text_abspath, "Forged txt", pool));
+
+  SVN_ERR(install_text(&sha1, db, wc1_abspath, "Other text", pool));
+  SVN_ERR(svn_wc__db_pristine_get_path(&pristine_abspath, db, wc1_abspath,
+                                       sha1, pool, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&contents, pristine_abspath, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "Other text");
+  SVN_ERR(svn_io_stat(&finfo, shared_text_abspath, APR_FINFO_NLINK, pool));
+  if (finfo.valid & APR_FINFO_NLINK)
+    SVN_TEST_INT_ASSERT(finfo.nlink, 1);
+
+  return SVN_NO_ERROR;
+}
+
+/* Test storing, reading and decompressing a compressed pristine text. */
+static svn_error_t *
+compressed_pristine(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  svn_config_t *config;
+  const char *wc_abspath;
+  const char *pristine_abspath;
+  svn_wc__db_t *ignored_db;
+  svn_stringbuf_t *text = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *contents;
+  svn_checksum_t *sha1;
+  svn_stream_t *stream;
+  svn_filesize_t size;
+  svn_boolean_t compressed;
+  svn_boolean_t bumped;
+  svn_node_kind_t kind;
+  apr_finfo_t finfo;
+  int format;
+  int i;
+
+  SVN_ERR(create_repos_and_wc(&wc_abspath, &ignored_db,
+                              "compressed_pristine", opts, pool));
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set_bool(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                      SVN_CONFIG_OPTION_COMPRESS_PRISTINES, TRUE);
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, TRUE, pool, pool));
+
+  /* Several compression blocks of well compressible text. */
+  for (i = 0; i < 10000; i++)
+    svn_stringbuf_appendcstr(text, apr_psprintf(pool, "Line %d\n", i % 100));
+
+  /* Without an explicit upgrade, the working copy stays readable for
+     older clients. */
+  SVN_ERR(install_text(&sha1, db, wc_abspath, "Some text", pool));
+  SVN_ERR(svn_wc__db_pristine_is_compressed(&compressed, db, wc_abspath,
+                                            sha1, pool));
+  SVN_TEST_ASSERT(!compressed);
+
+  SVN_ERR(svn_wc__db_close(db));
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, TRUE, pool, pool));
+  SVN_ERR(svn_wc__db_bump_format(&format, &bumped, db, wc_abspath, pool));
+  SVN_TEST_INT_ASSERT(format, SVN_WC__COMPRESSED_PRISTINES);
+  SVN_TEST_ASSERT(bumped);
+
+  SVN_ERR(install_text(&sha1, db, wc_abspath, text->data, pool));
+
+  SVN_ERR(svn_wc__db_pristine_is_compressed(&compressed, db, wc_abspath,
+                                            sha1, pool));
+  SVN_TEST_ASSERT(compressed);
+
+  /* The store reports the uncompressed size and content. */
+  SVN_ERR(svn_wc__db_pristine_read(&stream, &size, db, wc_abspath, sha1,
+                                   pool, pool));
+  SVN_TEST_INT_ASSERT(size, text->len);
+  SVN_ERR(svn_stringbuf_from_stream(&contents, stream, 0, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, text->data);
+
+  /* Asking for a file provides a decompressed copy, without changing the
+     store. */
+  SVN_ERR(svn_wc__db_pristine_get_path(&pristine_abspath, db, wc_abspath,
+                                       sha1, pool, pool));
+  SVN_ERR(svn_io_stat(&finfo, pristine_abspath, APR_FINFO_SIZE, pool));
+  SVN_TEST_INT_ASSERT(finfo.size, text->len);
+  SVN_ERR(svn_stringbuf_from_file2(&contents, pristine_abspath, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, text->data);
+
+  /* That copy goes away once no work item can refer to it anymore. */
+  SVN_ERR(svn_wc__wq_run(db, wc_abspath, NULL, NULL, pool));
+  SVN_ERR(svn_io_check_path(pristine_abspath, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  SVN_ERR(svn_wc__db_pristine_is_compressed(&compressed, db, wc_abspath,
+                                            sha1, pool));
+  SVN_TEST_ASSERT(compressed);
+  SVN_ERR(svn_wc__db_pristine_get_future_path(&pristine_abspath, wc_abspath,
+                                              sha1, pool, pool));
+  SVN_ERR(svn_io_stat(&finfo, pristine_abspath, APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(finfo.size < text->len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Test that copying a compressed pristine text into a working copy that
+ * does not support compressed pristines stores it uncompressed. */
+static svn_error_t *
+transfer_compressed_pristine(const svn_test_opts_t *opts,
+                             apr_pool_t *pool)
+{
+  svn_test__sandbox_t b1, b2;
+  svn_config_t *config;
+  svn_wc__db_t *db;
+  svn_stringbuf_t *text = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *contents;
+  svn_checksum_t *sha1;
+  const char *pristine_abspath;
+  svn_boolean_t compressed;
+  svn_boolean_t bumped;
+  svn_boolean_t present;
+  int format;
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b1, "transfer_compressed_pristine_1",
+                                   opts, pool));
+  SVN_ERR(svn_test__sandbox_create(&b2, "transfer_compressed_pristine_2",
+                                   opts, pool));
+
+  /* B1 stores its pristine texts compressed. */
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set_bool(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                      SVN_CONFIG_OPTION_COMPRESS_PRISTINES, TRUE);
+  SVN_ERR(svn_wc_context_create(&b1.wc_ctx, config, pool, pool));
+  db = b1.wc_ctx->db;
+  SVN_ERR(svn_wc__db_bump_format(&format, &bumped, db, b1.wc_abspath,
+                                 pool));
+  SVN_TEST_INT_ASSERT(format, SVN_WC__COMPRESSED_PRISTINES);
+
+  for (i = 0; i < 10000; i++)
+    svn_stringbuf_appendcstr(text, apr_psprintf(pool, "Line %d\n", i % 100));
+  SVN_ERR(svn_checksum(&sha1, svn_checksum_sha1, text->data, text->len,
+                       pool));
+
+  SVN_ERR(sbox_file_write(&b1, "f", text->data));
+  SVN_ERR(sbox_wc_add(&b1, "f"));
+  SVN_ERR(sbox_wc_commit(&b1, ""));
+  SVN_ERR(svn_wc__db_pristine_is_compressed(&compressed, db, b1.wc_abspath,
+                                            sha1, pool));
+  SVN_TEST_ASSERT(compressed);
+
+  /* B2 still uses the default format. */
+  SVN_ERR(svn_wc__db_pristine_transfer(db, sbox_wc_path(&b1, "f"),
+                                       b2.wc_abspath, NULL, NULL, pool));
+  SVN_ERR(svn_wc__db_pristine_check(&present, db, b2.wc_abspath, sha1,
+                                    pool));
+  SVN_TEST_ASSERT(present);
+  SVN_ERR(svn_wc__db_pristine_is_compressed(&compressed, db, b2.wc_abspath,
+                                            sha1, pool));
+  SVN_TEST_ASSERT(!compressed);
+
+  SVN_ERR(svn_wc__db_pristine_get_future_path(&pristine_abspath,
+                                              b2.wc_abspath, sha1,
+                                              pool, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&contents, pristine_abspath, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, text->data);
+
+  return SVN_NO_ERROR;
+}
+
 
 static int max_threads = -1;
 
@@ -318,6 +592,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pristine_delete_while_open"),
     SVN_TEST_OPTS_PASS(reject_mismatching_text,
                        "reject_mismatching_text"),
+    SVN_TEST_OPTS_PASS(shared_pristine_store,
+                       "shared_pristine_store"),
+    SVN_TEST_OPTS_PASS(compressed_pristine,
+                       "compressed_pristine"),
+    SVN_TEST_OPTS_PASS(transfer_compressed_pristine,
+                       "transfer_compressed_pristine"),
     SVN_TEST_NULL
   };
 
@@ -43,6 +43,7 @@
 #include "private/svn_dep_compat.h"
 #include "../../libsvn_wc/wc.h"
 #include "../../libsvn_wc/wc_db.h"
+#include "../../libsvn_wc/workqueue.h"
 #define SVN_WC__I_AM_WC_DB
 #include "../../libsvn_wc/wc_db_private.h"
 
@@ -493,6 +494,112 @@ test_internal_file_modified(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Verify that all files of the greek tree in the working copy of B have
+   their original contents and that the work queue is empty. */
+static svn_error_t *
+check_installed_greek_tree(svn_test__sandbox_t *b,
+                           apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint64_t id;
+  svn_skel_t *work_item;
+  int i;
+
+  for (i = 0; svn_test__greek_tree_nodes[i].path; i++)
+    {
+      const char *local_abspath;
+      svn_stringbuf_t *contents;
+      svn_boolean_t modified;
+
+      svn_pool_clear(iterpool);
+      if (! svn_test__greek_tree_nodes[i].contents)
+        continue;
+
+      local_abspath = sbox_wc_path(b, svn_test__greek_tree_nodes[i].path);
+      SVN_ERR(svn_stringbuf_from_file2(&contents, local_abspath, iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             svn_test__greek_tree_nodes[i].contents);
+
+      SVN_ERR(svn_wc__internal_file_modified_p(&modified, b->wc_ctx->db,
+                                               local_abspath, FALSE,
+                                               iterpool));
+      SVN_TEST_ASSERT(!modified);
+    }
+
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, b->wc_ctx->db,
+                                   b->wc_abspath, 0, iterpool, iterpool));
+  SVN_TEST_ASSERT(work_item == NULL);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cancel_func_t.  Cancel after *(int *)BATON calls. */
+static svn_error_t *
+cancel_after(void *baton)
+{
+  int *remaining = baton;
+
+  if ((*remaining)-- <= 0)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_batched_installs(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_wc__db_t *db;
+  apr_uint64_t id;
+  svn_skel_t *work_item;
+  int remaining;
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "batched_installs", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  db = b.wc_ctx->db;
+  db->install_threads = 4;
+
+  /* Let the update install all files through batches. */
+  SVN_ERR(sbox_wc_update(&b, "", 0));
+  SVN_ERR(sbox_wc_update(&b, "", 1));
+  SVN_ERR(check_installed_greek_tree(&b, pool));
+
+  /* Queue installs for all files by hand. */
+  SVN_ERR(svn_wc__acquire_write_lock(NULL, b.wc_ctx, b.wc_abspath, FALSE,
+                                     pool, pool));
+  for (i = 0; svn_test__greek_tree_nodes[i].path; i++)
+    if (svn_test__greek_tree_nodes[i].contents)
+      {
+        const char *local_abspath
+          = sbox_wc_path(&b, svn_test__greek_tree_nodes[i].path);
+
+        SVN_ERR(svn_io_remove_file2(local_abspath, FALSE, pool));
+        SVN_ERR(svn_wc__wq_build_file_install(&work_item, db, local_abspath,
+                                              NULL, FALSE, TRUE,
+                                              pool, pool));
+        SVN_ERR(svn_wc__db_wq_add(db, b.wc_abspath, work_item, pool));
+      }
+
+  /* Cancelling within the batch must keep all of its items queued. */
+  remaining = 1;
+  SVN_TEST_ASSERT_ERROR(svn_wc__wq_run(db, b.wc_abspath, cancel_after,
+                                       &remaining, pool),
+                        SVN_ERR_CANCELLED);
+  SVN_TEST_ASSERT(remaining < 0);
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, b.wc_abspath, 0,
+                                   pool, pool));
+  SVN_TEST_ASSERT(work_item != NULL);
+
+  SVN_ERR(svn_wc__wq_run(db, b.wc_abspath, NULL, NULL, pool));
+  SVN_ERR(svn_wc__release_write_lock(b.wc_ctx, b.wc_abspath, pool));
+  SVN_ERR(check_installed_greek_tree(&b, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* ---------------------------------------------------------------------- */
 /* The list of test functions */
 
@@ -515,6 +622,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test legacy commit2"),
     SVN_TEST_OPTS_PASS(test_internal_file_modified,
                        "test internal_file_modified"),
+    SVN_TEST_OPTS_PASS(test_batched_installs,
+                       "test batched file installs"),
     SVN_TEST_NULL
   };
 
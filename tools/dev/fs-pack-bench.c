@@ -0,0 +1,226 @@
+/* fs-pack-bench.c -- measure the throughput of 'svnadmin pack'
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Pack the unpacked shards of the repository at the path given on the
+ * command line and report:
+ *
+ *   data   total size of the revision files before packing
+ *   time   wall clock time spent in svn_fs_pack
+ *   rate   MB of revision data packed per second
+ *
+ * If the repository does not exist yet, create one of the given type
+ * first and fill it with enough revisions for one shard of the default
+ * size.  To compare storage devices, copy an unpacked repository onto
+ * each of them and run this tool with a cold page cache, e.g. after
+ * dropping the OS caches.
+ */
+
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_time.h"
+
+#include "svn_private_config.h"
+
+/* Return the seconds elapsed since START, but never 0. */
+static double
+seconds_since(apr_time_t start)
+{
+  apr_interval_time_t elapsed = apr_time_now() - start;
+
+  return elapsed > 0 ? (double)elapsed / APR_USEC_PER_SEC : 1e-6;
+}
+
+/* Create a new repository of FS_TYPE at REPOS_PATH with REVISIONS
+ * revisions, each of them modifying a few files in a tree of 100 files.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+create_repos(const char *repos_path,
+             const char *fs_type,
+             int revisions,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_hash_t *fs_config = apr_hash_make(scratch_pool);
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  const char *conflict;
+  int i, k;
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FS_TYPE, fs_type);
+  SVN_ERR(svn_fs_create2(&fs, repos_path, fs_config, scratch_pool,
+                         scratch_pool));
+
+  for (rev = 1; rev <= revisions; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, rev - 1, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+
+      if (rev == 1)
+        for (i = 0; i < 10; ++i)
+          SVN_ERR(svn_fs_make_dir(root, apr_psprintf(iterpool, "d%d", i),
+                                  iterpool));
+
+      /* Touch 5 files per revision.  Their contents keep growing, so we
+       * get deltas of all sizes. */
+      for (k = 0; k < 5; ++k)
+        {
+          int file = (int)((rev * 7 + k * 13) % 100);
+          const char *path = apr_psprintf(iterpool, "d%d/f%d", file / 10,
+                                          file % 10);
+          svn_stringbuf_t *contents = svn_stringbuf_create_empty(iterpool);
+          svn_node_kind_t kind;
+          svn_stream_t *stream;
+
+          SVN_ERR(svn_fs_check_path(&kind, root, path, iterpool));
+          if (kind == svn_node_none)
+            SVN_ERR(svn_fs_make_file(root, path, iterpool));
+
+          for (i = 0; i < rev / 10 + 10; ++i)
+            svn_stringbuf_appendcstr(contents,
+                                     apr_psprintf(iterpool,
+                                                  "line %d of %s, "
+                                                  "modified in r%ld\n",
+                                                  i, path,
+                                                  i % 3 ? rev - rev % 50
+                                                        : rev));
+
+          SVN_ERR(svn_fs_apply_text(&stream, root, path, NULL, iterpool));
+          SVN_ERR(svn_stream_write(stream, contents->data, &contents->len));
+          SVN_ERR(svn_stream_close(stream));
+        }
+
+      SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton type used with sum_sizes(). */
+typedef struct size_baton_t
+{
+  apr_int64_t total;
+} size_baton_t;
+
+/* Implements svn_io_walk_func_t, adding the sizes of all files to the
+ * size_baton_t BATON. */
+static svn_error_t *
+sum_sizes(void *baton,
+          const char *path,
+          const apr_finfo_t *finfo,
+          apr_pool_t *pool)
+{
+  size_baton_t *sb = baton;
+
+  if (finfo->filetype == APR_REG)
+    sb->total += finfo->size;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+sub_main(int argc, const char *argv[], apr_pool_t *pool)
+{
+  const char *repos_path;
+  const char *fs_type = SVN_FS_TYPE_FSX;
+  int revisions = 1000;
+  size_baton_t sizes = { 0 };
+  svn_node_kind_t kind;
+  apr_time_t start;
+  double seconds;
+  int i = 1;
+
+  while (i + 1 < argc && argv[i][0] == '-')
+    {
+      if (strcmp(argv[i], "-t") == 0)
+        {
+          fs_type = argv[i + 1];
+        }
+      else if (strcmp(argv[i], "-n") == 0)
+        {
+          SVN_ERR(svn_cstring_atoi(&revisions, argv[i + 1]));
+          if (revisions < 1)
+            return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                    _("Revision count must be positive"));
+        }
+      else
+        break;
+
+      i += 2;
+    }
+
+  if (i + 1 != argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Usage: fs-pack-bench [-t FS-TYPE] "
+                              "[-n REVISIONS] REPOS"));
+
+  SVN_ERR(svn_dirent_get_absolute(&repos_path,
+                                  svn_dirent_internal_style(argv[i], pool),
+                                  pool));
+
+  SVN_ERR(svn_fs_initialize(pool));
+  SVN_ERR(svn_io_check_path(repos_path, &kind, pool));
+  if (kind == svn_node_none)
+    SVN_ERR(create_repos(repos_path, fs_type, revisions, pool));
+
+  SVN_ERR(svn_io_dir_walk2(svn_dirent_join(repos_path, "revs", pool),
+                           APR_FINFO_TYPE | APR_FINFO_SIZE, sum_sizes,
+                           &sizes, pool));
+
+  start = apr_time_now();
+  SVN_ERR(svn_fs_pack(repos_path, NULL, NULL, NULL, NULL, pool));
+  seconds = seconds_since(start);
+
+  return svn_error_trace(svn_cmdline_printf(pool,
+                             "  data %10.1f MB\n"
+                             "  time %10.3f s\n"
+                             "  rate %10.1f MB/s\n",
+                             (double)sizes.total / (1024 * 1024), seconds,
+                             (double)sizes.total / seconds / (1024 * 1024)));
+}
+
+int main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("fs-pack-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "fs-pack-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}
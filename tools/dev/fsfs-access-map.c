@@ -20,6 +20,8 @@
  * ====================================================================
  */
 
+#include <apr_strings.h>
+
 #include "svn_pools.h"
 #include "svn_string.h"
 #include "svn_io.h"
@@ -67,6 +69,12 @@ typedef struct file_stats_t
   /* number of clusters read */
   apr_int64_t clusters_read;
 
+  /* number of mmap() calls for this file */
+  apr_int64_t map_count;
+
+  /* total number of bytes mapped by those calls */
+  apr_int64_t map_size;
+
   /* number of different clusters read
    * (i.e. number of non-zero entries in read_map). */
   apr_int64_t unique_clusters_read;
@@ -282,6 +290,20 @@ seek_file(int handle, apr_int64_t location)
     }
 }
 
+/* SIZE bytes of the file with the given HANDLE have been mapped into
+ * memory.  Accesses to that memory don't show up in the strace output.
+ */
+static void
+map_file(int handle, apr_int64_t size)
+{
+  handle_info_t *handle_info = apr_hash_get(handles, &handle, sizeof(handle));
+  if (handle_info)
+    {
+      handle_info->file->map_count++;
+      handle_info->file->map_size += size;
+    }
+}
+
 /* The given file HANDLE has been closed.
  */
 static void
@@ -345,6 +367,20 @@ parse_line(svn_stringbuf_t *line)
     seek_file(atoi(func_end), func_return);
   else if (strcmp(func_start, "close") == 0)
     close_file(atoi(func_end));
+  else if (strcmp(func_start, "mmap") == 0)
+    {
+      /* mmap(addr, length, prot, flags, fd, offset):
+       * skip to the 2nd and then to the 5th parameter. */
+      char *length = first_param_end + 1;
+      char *fd = length;
+      int i;
+
+      for (i = 0; fd && i < 3; ++i)
+        fd = strchr(fd + 1, ',');
+
+      if (fd)
+        map_file(atoi(fd + 1), apr_atoi64(length));
+    }
 }
 
 /* Process the strace output stored in FILE.
@@ -698,6 +734,8 @@ print_stats(apr_pool_t *pool)
   apr_int64_t uncached_seek_count = 0;
   apr_int64_t unnecessary_seek_count = 0;
   apr_int64_t empty_read_count = 0;
+  apr_int64_t map_count = 0;
+  apr_int64_t map_size = 0;
 
   apr_hash_index_t *hi;
   for (hi = apr_hash_first(pool, files); hi; hi = apr_hash_next(hi))
@@ -717,6 +755,8 @@ print_stats(apr_pool_t *pool)
       uncached_seek_count += file->uncached_seek_count;
       unnecessary_seek_count += file->unnecessary_seeks;
       empty_read_count += file->empty_reads;
+      map_count += file->map_count;
+      map_size += file->map_size;
     }
 
   printf("%20s files\n", svn__i64toa_sep(apr_hash_count(files), ',', pool));
@@ -729,6 +769,8 @@ print_stats(apr_pool_t *pool)
   printf("%20s unique clusters read\n", svn__i64toa_sep(unique_clusters_read, ',', pool));
   printf("%20s clusters read\n", svn__i64toa_sep(clusters_read, ',', pool));
   printf("%20s bytes read\n", svn__i64toa_sep(read_size, ',', pool));
+  printf("%20s mmaps\n", svn__i64toa_sep(map_count, ',', pool));
+  printf("%20s bytes mapped\n", svn__i64toa_sep(map_size, ',', pool));
 }
 
 /* Some help output. */
@@ -743,7 +785,7 @@ print_usage(void)
   printf("1 and 2 hits, yellow to read-ish colors for up to 20, shares of\n");
   printf("for up to 100 and black for > 200 hits.\n\n");
   printf("A typical strace invocation looks like this:\n");
-  printf("strace -e trace=open,close,read,lseek -o strace.txt svn log ...\n");
+  printf("strace -e trace=open,close,read,lseek,mmap -o strace.txt svn log ...\n");
 }
 
 /* linear control flow */
@@ -0,0 +1,361 @@
+/* fsfs-commit-bench.c -- measure FSFS commit throughput
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Create a new FSFS repository and let a number of concurrent committers
+ * commit to it as fast as they can.  Each committer modifies the contents
+ * and a property of its own file, i.e. there are no conflicts, but all
+ * commits compete for the repository write lock and out-of-date commits
+ * have to be merged and retried.  Reports:
+ *
+ *   commits   total number of revisions created
+ *   time      wall clock time for all of them
+ *   rate      revisions per second
+ *   latency   average time a single svn_fs_commit_txn call took
+ *
+ * Run it with different committer counts to see how commit throughput
+ * scales.  Use a repository path on the file system of interest.  With
+ * -g, the repository gets group commits enabled in its fsfs.conf.  Then,
+ * commits queued on the write lock share their flushes to disk, i.e. the
+ * gain over the default depends on the flush latency of the storage.
+ */
+
+#include <apr_thread_proc.h>
+
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_time.h"
+
+#include "svn_private_config.h"
+
+/* State of one concurrent committer. */
+typedef struct committer_t
+{
+  /* Repository to commit to. */
+  const char *repos_path;
+
+  /* The file modified by this committer. */
+  const char *path;
+
+  /* Number of commits to make. */
+  int commits;
+
+  /* Time spent in svn_fs_commit_txn. */
+  apr_interval_time_t commit_time;
+
+  /* Error returned by the committer, if any. */
+  svn_error_t *err;
+} committer_t;
+
+/* Return the seconds elapsed since START, but never 0. */
+static double
+seconds_since(apr_time_t start)
+{
+  apr_interval_time_t elapsed = apr_time_now() - start;
+
+  return elapsed > 0 ? (double)elapsed / APR_USEC_PER_SEC : 1e-6;
+}
+
+/* Make COMMITTER->COMMITS commits as described at the top of this file.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_committer(committer_t *committer,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_fs_t *fs;
+  int i;
+
+  SVN_ERR(svn_fs_open2(&fs, committer->repos_path, NULL, scratch_pool,
+                       scratch_pool));
+
+  for (i = 0; i < committer->commits; ++i)
+    {
+      svn_revnum_t youngest, new_rev;
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *root;
+      svn_stream_t *stream;
+      const char *conflict;
+      const char *text;
+      apr_time_t start;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_youngest_rev(&youngest, fs, iterpool));
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+
+      text = apr_psprintf(iterpool, "%s, change %d\n", committer->path, i);
+      SVN_ERR(svn_fs_apply_text(&stream, root, committer->path, NULL,
+                                iterpool));
+      SVN_ERR(svn_stream_puts(stream, text));
+      SVN_ERR(svn_stream_close(stream));
+      SVN_ERR(svn_fs_change_node_prop(root, committer->path, "change",
+                                      svn_string_createf(iterpool, "%d", i),
+                                      iterpool));
+
+      start = apr_time_now();
+      SVN_ERR(svn_fs_commit_txn(&conflict, &new_rev, txn, iterpool));
+      committer->commit_time += apr_time_now() - start;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Thread body calling run_committer for the committer_t DATA. */
+static void * APR_THREAD_FUNC
+committer_thread(apr_thread_t *tid, void *data)
+{
+  committer_t *committer = data;
+  apr_pool_t *pool = svn_pool_create_ex(NULL,
+                                        svn_pool_create_allocator(FALSE));
+
+  committer->err = run_committer(committer, pool);
+
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, 0);
+  return NULL;
+}
+#endif
+
+/* Create a new repository at REPOS_PATH with one file per committer in
+ * COMMITTERS.  Enable group commits if GROUP_COMMIT is set.  Use
+ * SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+create_repos(const char *repos_path,
+             apr_array_header_t *committers,
+             svn_boolean_t group_commit,
+             apr_pool_t *scratch_pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(scratch_pool);
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t new_rev;
+  const char *conflict;
+  int i;
+
+  SVN_ERR(svn_io_remove_dir2(repos_path, TRUE, NULL, NULL, scratch_pool));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FS_TYPE, SVN_FS_TYPE_FSFS);
+  SVN_ERR(svn_fs_create2(&fs, repos_path, fs_config, scratch_pool,
+                         scratch_pool));
+
+  /* The committers will open the repository again and pick this up.
+   * Later sections of the same name extend the earlier ones. */
+  if (group_commit)
+    {
+      static const char option[] = "\n[io]\ngroup-commit = true\n";
+      apr_file_t *file;
+
+      SVN_ERR(svn_io_file_open(&file,
+                               svn_dirent_join(repos_path, "fsfs.conf",
+                                               scratch_pool),
+                               APR_WRITE | APR_APPEND, APR_OS_DEFAULT,
+                               scratch_pool));
+      SVN_ERR(svn_io_file_write_full(file, option, sizeof(option) - 1, NULL,
+                                     scratch_pool));
+      SVN_ERR(svn_io_file_close(file, scratch_pool));
+    }
+
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, 0, 0, scratch_pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, scratch_pool));
+  for (i = 0; i < committers->nelts; ++i)
+    {
+      committer_t *committer = APR_ARRAY_IDX(committers, i, committer_t *);
+      SVN_ERR(svn_fs_make_file(root, committer->path, scratch_pool));
+    }
+
+  return svn_error_trace(svn_fs_commit_txn(&conflict, &new_rev, txn,
+                                           scratch_pool));
+}
+
+/* Run COMMITTERS concurrently and print the results.  GROUP_COMMIT tells
+ * whether the repository uses group commits.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+run_committers(apr_array_header_t *committers,
+               svn_boolean_t group_commit,
+               apr_pool_t *scratch_pool)
+{
+  apr_interval_time_t commit_time = 0;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_time_t start;
+  double seconds;
+  int commits = 0;
+  int i;
+
+#if APR_HAS_THREADS
+  apr_array_header_t *threads = apr_array_make(scratch_pool,
+                                               committers->nelts,
+                                               sizeof(apr_thread_t *));
+  apr_threadattr_t *tattr;
+  apr_status_t status;
+
+  status = apr_threadattr_create(&tattr, scratch_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create threadattr"));
+
+  start = apr_time_now();
+  for (i = 0; i < committers->nelts; ++i)
+    {
+      apr_thread_t *tid;
+
+      status = apr_thread_create(&tid, tattr, committer_thread,
+                                 APR_ARRAY_IDX(committers, i, committer_t *),
+                                 scratch_pool);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't create thread"));
+
+      APR_ARRAY_PUSH(threads, apr_thread_t *) = tid;
+    }
+
+  for (i = 0; i < threads->nelts; ++i)
+    {
+      apr_status_t child_status;
+
+      status = apr_thread_join(&child_status,
+                               APR_ARRAY_IDX(threads, i, apr_thread_t *));
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't join thread"));
+    }
+#else
+  if (committers->nelts > 1)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Concurrent committers require threads"));
+
+  start = apr_time_now();
+  APR_ARRAY_IDX(committers, 0, committer_t *)->err
+    = run_committer(APR_ARRAY_IDX(committers, 0, committer_t *),
+                    scratch_pool);
+#endif
+  seconds = seconds_since(start);
+
+  for (i = 0; i < committers->nelts; ++i)
+    {
+      committer_t *committer = APR_ARRAY_IDX(committers, i, committer_t *);
+
+      err = svn_error_compose_create(err, committer->err);
+      commits += committer->commits;
+      commit_time += committer->commit_time;
+    }
+  SVN_ERR(err);
+
+  return svn_error_trace(svn_cmdline_printf(scratch_pool,
+                             "%d committers%s:\n"
+                             "  commits %8d\n"
+                             "  time    %8.3f s\n"
+                             "  rate    %8.1f revisions/s\n"
+                             "  latency %8.3f ms\n",
+                             committers->nelts,
+                             group_commit ? ", group commits" : "",
+                             commits, seconds,
+                             commits / seconds,
+                             commits
+                               ? (double)commit_time / commits / 1000.0
+                               : 0.0));
+}
+
+static svn_error_t *
+sub_main(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_array_header_t *committers;
+  const char *repos_path;
+  svn_boolean_t group_commit = FALSE;
+  int threads = 4;
+  int commits = 100;
+  int i = 1;
+
+  while (i + 1 < argc && argv[i][0] == '-')
+    {
+      int *value;
+
+      if (strcmp(argv[i], "-g") == 0)
+        {
+          group_commit = TRUE;
+          ++i;
+          continue;
+        }
+
+      if (strcmp(argv[i], "-t") == 0)
+        value = &threads;
+      else if (strcmp(argv[i], "-n") == 0)
+        value = &commits;
+      else
+        break;
+
+      SVN_ERR(svn_cstring_atoi(value, argv[i + 1]));
+      if (*value < 1)
+        return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                 _("Value for '%s' must be positive"),
+                                 argv[i]);
+      i += 2;
+    }
+
+  if (i + 1 != argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Usage: fsfs-commit-bench [-g] [-t COMMITTERS] "
+                              "[-n COMMITS-PER-COMMITTER] SCRATCH-REPOS"));
+
+  SVN_ERR(svn_dirent_get_absolute(&repos_path,
+                                  svn_dirent_internal_style(argv[i], pool),
+                                  pool));
+
+  committers = apr_array_make(pool, threads, sizeof(committer_t *));
+  for (i = 0; i < threads; ++i)
+    {
+      committer_t *committer = apr_pcalloc(pool, sizeof(*committer));
+
+      committer->repos_path = repos_path;
+      committer->path = apr_psprintf(pool, "/file-%d", i);
+      committer->commits = commits;
+      APR_ARRAY_PUSH(committers, committer_t *) = committer;
+    }
+
+  SVN_ERR(svn_fs_initialize(pool));
+  SVN_ERR(create_repos(repos_path, committers, group_commit, pool));
+
+  return svn_error_trace(run_committers(committers, group_commit, pool));
+}
+
+int main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("fsfs-commit-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "fsfs-commit-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}
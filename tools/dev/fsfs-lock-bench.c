@@ -0,0 +1,295 @@
+/* fsfs-lock-bench.c -- measure the throughput of FSFS lock operations
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Create a new FSFS repository with the given number of files, lock all
+ * of them in batches, look up each lock, list all locks of the repository
+ * and finally unlock all files again.  Reports:
+ *
+ *   lock       locks created per second
+ *   lookup     single lock lookups (svn_fs_get_lock) per second
+ *   get-locks  time to list all locks of the repository
+ *   unlock     locks removed per second
+ *
+ * With "-s db", the locks get migrated to a lock database before the
+ * first lock is being taken.  Run the tool with either lock store to
+ * compare them.  Use a repository path on the file system of interest.
+ */
+
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_time.h"
+
+#include "private/svn_fs_fs_private.h"
+
+#include "svn_private_config.h"
+
+/* Number of files per directory in the test repository. */
+#define FILES_PER_DIR 100
+
+/* Return the seconds elapsed since START, but never 0. */
+static double
+seconds_since(apr_time_t start)
+{
+  apr_interval_time_t elapsed = apr_time_now() - start;
+
+  return elapsed > 0 ? (double)elapsed / APR_USEC_PER_SEC : 1e-6;
+}
+
+/* Implements svn_fs_lock_callback_t, failing for any FS_ERR. */
+static svn_error_t *
+check_lock_result(void *baton,
+                  const char *path,
+                  const svn_lock_t *lock,
+                  svn_error_t *fs_err,
+                  apr_pool_t *scratch_pool)
+{
+  return svn_error_dup(fs_err);
+}
+
+/* Implements svn_fs_get_locks_callback_t, counting the locks in the int
+ * BATON. */
+static svn_error_t *
+count_lock(void *baton,
+           svn_lock_t *lock,
+           apr_pool_t *pool)
+{
+  int *count = baton;
+  ++*count;
+
+  return SVN_NO_ERROR;
+}
+
+/* Create a new repository at REPOS_PATH with the files in PATHS and return
+ * it in *FS.  Allocate *FS in RESULT_POOL and use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+create_repos(svn_fs_t **fs,
+             const char *repos_path,
+             apr_array_header_t *paths,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(scratch_pool);
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t new_rev;
+  const char *conflict;
+  int i;
+
+  SVN_ERR(svn_io_remove_dir2(repos_path, TRUE, NULL, NULL, scratch_pool));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FS_TYPE, SVN_FS_TYPE_FSFS);
+  SVN_ERR(svn_fs_create2(fs, repos_path, fs_config, result_pool,
+                         scratch_pool));
+
+  SVN_ERR(svn_fs_begin_txn2(&txn, *fs, 0, 0, scratch_pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, scratch_pool));
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      const char *path = APR_ARRAY_IDX(paths, i, const char *);
+
+      if (i % FILES_PER_DIR == 0)
+        SVN_ERR(svn_fs_make_dir(root, apr_psprintf(scratch_pool, "/d%d",
+                                                   i / FILES_PER_DIR),
+                                scratch_pool));
+      SVN_ERR(svn_fs_make_file(root, path, scratch_pool));
+    }
+
+  return svn_error_trace(svn_fs_commit_txn(&conflict, &new_rev, txn,
+                                           scratch_pool));
+}
+
+/* Lock (if LOCK is set) or unlock all PATHS in FS, BATCH_SIZE paths per
+ * call.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+lock_paths(svn_fs_t *fs,
+           apr_array_header_t *paths,
+           int batch_size,
+           svn_boolean_t lock,
+           apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i, k;
+
+  for (i = 0; i < paths->nelts; i += batch_size)
+    {
+      apr_hash_t *targets;
+
+      svn_pool_clear(iterpool);
+      targets = apr_hash_make(iterpool);
+      for (k = i; k < i + batch_size && k < paths->nelts; ++k)
+        {
+          /* Unlocking breaks the locks, so we don't need their tokens. */
+          void *target = lock
+                       ? (void *)svn_fs_lock_target_create(NULL,
+                                                           SVN_INVALID_REVNUM,
+                                                           iterpool)
+                       : (void *)"";
+
+          svn_hash_sets(targets, APR_ARRAY_IDX(paths, k, const char *),
+                        target);
+        }
+
+      if (lock)
+        SVN_ERR(svn_fs_lock_many(fs, targets, "benchmark", FALSE, 0, FALSE,
+                                 check_lock_result, NULL, iterpool,
+                                 iterpool));
+      else
+        SVN_ERR(svn_fs_unlock_many(fs, targets, TRUE, check_lock_result,
+                                   NULL, iterpool, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+sub_main(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_array_header_t *paths;
+  const char *repos_path;
+  const char *store = "digest";
+  svn_fs_access_t *access;
+  svn_fs_t *fs;
+  apr_time_t start;
+  double lock_time, lookup_time, list_time, unlock_time;
+  int files = 10000;
+  int batch_size = 1000;
+  int count = 0;
+  int i = 1;
+
+  while (i + 1 < argc && argv[i][0] == '-')
+    {
+      if (strcmp(argv[i], "-s") == 0)
+        {
+          store = argv[i + 1];
+          if (strcmp(store, "digest") && strcmp(store, "db"))
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Unknown lock store '%s'"), store);
+        }
+      else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "-b") == 0)
+        {
+          int *value = argv[i][1] == 'n' ? &files : &batch_size;
+
+          SVN_ERR(svn_cstring_atoi(value, argv[i + 1]));
+          if (*value < 1)
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Value for '%s' must be positive"),
+                                     argv[i]);
+        }
+      else
+        break;
+
+      i += 2;
+    }
+
+  if (i + 1 != argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Usage: fsfs-lock-bench [-s digest|db] "
+                              "[-n FILES] [-b BATCH-SIZE] SCRATCH-REPOS"));
+
+  SVN_ERR(svn_dirent_get_absolute(&repos_path,
+                                  svn_dirent_internal_style(argv[i], pool),
+                                  pool));
+
+  paths = apr_array_make(pool, files, sizeof(const char *));
+  for (i = 0; i < files; ++i)
+    APR_ARRAY_PUSH(paths, const char *)
+      = apr_psprintf(pool, "/d%d/f%d", i / FILES_PER_DIR, i % FILES_PER_DIR);
+
+  SVN_ERR(svn_fs_initialize(pool));
+  SVN_ERR(create_repos(&fs, repos_path, paths, pool, pool));
+  if (strcmp(store, "db") == 0)
+    SVN_ERR(svn_fs_fs__migrate_locks(fs, NULL, NULL, pool));
+
+  SVN_ERR(svn_fs_create_access(&access, "bench", pool));
+  SVN_ERR(svn_fs_set_access(fs, access));
+
+  start = apr_time_now();
+  SVN_ERR(lock_paths(fs, paths, batch_size, TRUE, pool));
+  lock_time = seconds_since(start);
+
+  start = apr_time_now();
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      svn_lock_t *lock;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_get_lock(&lock, fs, APR_ARRAY_IDX(paths, i,
+                                                       const char *),
+                              iterpool));
+      if (!lock)
+        return svn_error_createf(SVN_ERR_FS_NO_SUCH_LOCK, NULL,
+                                 _("No lock on '%s'"),
+                                 APR_ARRAY_IDX(paths, i, const char *));
+    }
+  lookup_time = seconds_since(start);
+
+  start = apr_time_now();
+  SVN_ERR(svn_fs_get_locks2(fs, "/", svn_depth_infinity, count_lock, &count,
+                            pool));
+  list_time = seconds_since(start);
+  if (count != files)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Listed %d locks instead of %d"),
+                             count, files);
+
+  start = apr_time_now();
+  SVN_ERR(lock_paths(fs, paths, batch_size, FALSE, pool));
+  unlock_time = seconds_since(start);
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_cmdline_printf(pool,
+                             "%d locks in %s store:\n"
+                             "  lock      %10.1f locks/s\n"
+                             "  lookup    %10.1f lookups/s\n"
+                             "  get-locks %10.3f s\n"
+                             "  unlock    %10.1f locks/s\n",
+                             files, store, files / lock_time,
+                             files / lookup_time, list_time,
+                             files / unlock_time));
+}
+
+int main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("fsfs-lock-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "fsfs-lock-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}
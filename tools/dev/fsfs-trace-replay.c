@@ -0,0 +1,368 @@
+/* fsfs-trace-replay.c -- replay an FSFS access trace against a block cache
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Map each item access in an access trace, as recorded by the FSFS
+ * 'record-access-trace' option, to the rev / pack file block that
+ * contains the item in a given repository.  Then, simulate an LRU cache
+ * of a fixed number of blocks and report:
+ *
+ *   accesses  number of item accesses in the trace
+ *   unknown   accesses to items not found in the repository
+ *   blocks    number of distinct blocks touched
+ *   reads     blocks that had to be read with the simulated cache
+ *   hit rate  percentage of accesses served from the simulated cache
+ *
+ * To see how well the pack file layout fits a workload, record a trace
+ * on an unpacked repository, make two copies of it, pack one of them
+ * normally and the other with the trace given as the 'access-trace'
+ * option in fsfs.conf, and run this tool against both.
+ */
+
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+
+#include "private/svn_fs_fs_private.h"
+#include "private/svn_string_private.h"
+
+#include "svn_private_config.h"
+
+/* A block in the simulated LRU cache. */
+typedef struct block_t
+{
+  /* Key of this block in the cache's hash. */
+  const char *key;
+
+  /* Neighbours in the LRU list.  NULL at the list ends. */
+  struct block_t *previous;
+  struct block_t *next;
+} block_t;
+
+/* The simulation state. */
+typedef struct replay_t
+{
+  /* Repository to map the accesses to. */
+  svn_fs_t *fs;
+
+  /* Block size in bytes. */
+  apr_off_t block_size;
+
+  /* Maximum number of blocks in the cache. */
+  int capacity;
+
+  /* "<revision> <item index>" -> "<file> <block>", for all items read
+   * from the repository so far. */
+  apr_hash_t *blocks_by_item;
+
+  /* Revisions, as svn_revnum_t *, whose index has been read. */
+  apr_hash_t *revisions;
+
+  /* "<file> <block>" -> block_t *, for the blocks in the cache. */
+  apr_hash_t *cache;
+
+  /* Most and least recently used cached block.  NULL if empty. */
+  block_t *first;
+  block_t *last;
+
+  /* Distinct "<file> <block>" keys touched. */
+  apr_hash_t *touched;
+
+  /* Statistics. */
+  apr_int64_t accesses;
+  apr_int64_t unknown;
+  apr_int64_t reads;
+
+  /* Pool for all of the above. */
+  apr_pool_t *pool;
+} replay_t;
+
+/* Baton type used with index_entry(). */
+typedef struct index_baton_t
+{
+  /* The simulation to add the items to. */
+  replay_t *replay;
+
+  /* Identifies the rev / pack file being read. */
+  svn_revnum_t file;
+} index_baton_t;
+
+/* Implements svn_fs_fs__dump_index_func_t, adding the block of ENTRY to
+ * the index_baton_t BATON. */
+static svn_error_t *
+index_entry(const svn_fs_fs__p2l_entry_t *entry,
+            void *baton,
+            apr_pool_t *scratch_pool)
+{
+  index_baton_t *ib = baton;
+  replay_t *replay = ib->replay;
+  svn_revnum_t *revision;
+
+  /* Readers access items by their start offset.  Items crossing block
+   * boundaries will be counted as a single block read.  Unused sections
+   * get keyed by an invalid revision and are never looked up. */
+  svn_hash_sets(replay->blocks_by_item,
+                apr_psprintf(replay->pool, "%ld %" APR_UINT64_T_FMT,
+                             entry->item.revision, entry->item.number),
+                apr_psprintf(replay->pool, "%ld %" APR_OFF_T_FMT, ib->file,
+                             entry->offset / replay->block_size));
+
+  revision = apr_pmemdup(replay->pool, &entry->item.revision,
+                         sizeof(*revision));
+  apr_hash_set(replay->revisions, revision, sizeof(*revision), revision);
+
+  return SVN_NO_ERROR;
+}
+
+/* Make sure that REPLAY knows the blocks of all items of REVISION.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_index(replay_t *replay,
+           svn_revnum_t revision,
+           apr_pool_t *scratch_pool)
+{
+  index_baton_t baton;
+  svn_revnum_t *key;
+
+  if (apr_hash_get(replay->revisions, &revision, sizeof(revision)))
+    return SVN_NO_ERROR;
+
+  /* Pack files contain many revisions.  The first one requested names
+   * the file for all of them. */
+  baton.replay = replay;
+  baton.file = revision;
+  SVN_ERR(svn_fs_fs__dump_index(replay->fs, revision, index_entry, &baton,
+                                NULL, NULL, scratch_pool));
+
+  /* Don't try again, even if the revision has no items. */
+  key = apr_pmemdup(replay->pool, &revision, sizeof(revision));
+  apr_hash_set(replay->revisions, key, sizeof(*key), key);
+
+  return SVN_NO_ERROR;
+}
+
+/* Remove BLOCK from the LRU list in REPLAY. */
+static void
+unlink_block(replay_t *replay,
+             block_t *block)
+{
+  if (block->previous)
+    block->previous->next = block->next;
+  else
+    replay->first = block->next;
+
+  if (block->next)
+    block->next->previous = block->previous;
+  else
+    replay->last = block->previous;
+
+  block->previous = NULL;
+  block->next = NULL;
+}
+
+/* Make BLOCK the most recently used one in REPLAY. */
+static void
+link_block(replay_t *replay,
+           block_t *block)
+{
+  block->next = replay->first;
+  if (replay->first)
+    replay->first->previous = block;
+  else
+    replay->last = block;
+
+  replay->first = block;
+}
+
+/* Simulate reading the block identified by KEY in REPLAY. */
+static void
+access_block(replay_t *replay,
+             const char *key)
+{
+  block_t *block = svn_hash_gets(replay->cache, key);
+
+  if (!svn_hash_gets(replay->touched, key))
+    {
+      key = apr_pstrdup(replay->pool, key);
+      svn_hash_sets(replay->touched, key, key);
+    }
+
+  if (block)
+    {
+      unlink_block(replay, block);
+      link_block(replay, block);
+      return;
+    }
+
+  ++replay->reads;
+  if (apr_hash_count(replay->cache) < (unsigned)replay->capacity)
+    {
+      block = apr_pcalloc(replay->pool, sizeof(*block));
+    }
+  else
+    {
+      /* Re-use the least recently used block. */
+      block = replay->last;
+      unlink_block(replay, block);
+      svn_hash_sets(replay->cache, block->key, NULL);
+    }
+
+  block->key = svn_hash_gets(replay->touched, key);
+  svn_hash_sets(replay->cache, block->key, block);
+  link_block(replay, block);
+}
+
+/* Replay the access trace at TRACE_PATH in REPLAY.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+replay_trace(replay_t *replay,
+             const char *trace_path,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_stream_t *stream;
+  svn_boolean_t eof = FALSE;
+
+  SVN_ERR(svn_stream_open_readonly(&stream, trace_path, scratch_pool,
+                                   iterpool));
+  while (!eof)
+    {
+      svn_stringbuf_t *line;
+      const char *block_key;
+      const char *end;
+      svn_revnum_t revision;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, iterpool));
+      if (line->len == 0)
+        continue;
+
+      revision = (svn_revnum_t)svn__strtoul(line->data, &end);
+      if (end == line->data || *end != ' ')
+        return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                                 _("Malformed line '%s' in access trace"),
+                                 line->data);
+
+      ++replay->accesses;
+      SVN_ERR(read_index(replay, revision, iterpool));
+
+      block_key = svn_hash_gets(replay->blocks_by_item, line->data);
+      if (block_key)
+        access_block(replay, block_key);
+      else
+        ++replay->unknown;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+static svn_error_t *
+sub_main(int argc, const char *argv[], apr_pool_t *pool)
+{
+  replay_t *replay = apr_pcalloc(pool, sizeof(*replay));
+  const char *repos_path;
+  const char *trace_path;
+  int capacity = 16;
+  int block_size = 64;
+  apr_int64_t hits;
+  int i = 1;
+
+  while (i + 2 < argc && argv[i][0] == '-')
+    {
+      int *value;
+
+      if (strcmp(argv[i], "-c") == 0)
+        value = &capacity;
+      else if (strcmp(argv[i], "-b") == 0)
+        value = &block_size;
+      else
+        break;
+
+      SVN_ERR(svn_cstring_atoi(value, argv[i + 1]));
+      if (*value < 1)
+        return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                 _("Value for '%s' must be positive"),
+                                 argv[i]);
+      i += 2;
+    }
+
+  if (i + 2 != argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Usage: fsfs-trace-replay [-c CACHE-BLOCKS] "
+                              "[-b BLOCK-SIZE-IN-KB] REPOS TRACE"));
+
+  repos_path = svn_dirent_internal_style(argv[i], pool);
+  trace_path = svn_dirent_internal_style(argv[i + 1], pool);
+
+  SVN_ERR(svn_fs_initialize(pool));
+  SVN_ERR(svn_fs_open2(&replay->fs, svn_dirent_join(repos_path, "db", pool),
+                       NULL, pool, pool));
+
+  replay->block_size = (apr_off_t)block_size * 0x400;
+  replay->capacity = capacity;
+  replay->blocks_by_item = apr_hash_make(pool);
+  replay->revisions = apr_hash_make(pool);
+  replay->cache = apr_hash_make(pool);
+  replay->touched = apr_hash_make(pool);
+  replay->pool = pool;
+
+  SVN_ERR(replay_trace(replay, trace_path, pool));
+
+  hits = replay->accesses - replay->unknown - replay->reads;
+  return svn_error_trace(svn_cmdline_printf(pool,
+                             "%d blocks of %d kB:\n"
+                             "  accesses %10" APR_INT64_T_FMT "\n"
+                             "  unknown  %10" APR_INT64_T_FMT "\n"
+                             "  blocks   %10u\n"
+                             "  reads    %10" APR_INT64_T_FMT "\n"
+                             "  hit rate %10.1f %%\n",
+                             capacity, block_size,
+                             replay->accesses, replay->unknown,
+                             apr_hash_count(replay->touched), replay->reads,
+                             replay->accesses > replay->unknown
+                               ? 100.0 * hits
+                                 / (replay->accesses - replay->unknown)
+                               : 0.0));
+}
+
+int main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("fsfs-trace-replay", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "fsfs-trace-replay: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/* ra-serf-xml-bench.c -- time ra_serf's XML parser on captured responses
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Feed response bodies captured from a server (e.g. a log or update
+ * REPORT response saved with "curl" or a debugging proxy) through the
+ * ra_serf XML parsing machinery a number of times and report the
+ * throughput.  The transition table used here accepts any element and
+ * collects the attributes that the log and update report parsers
+ * typically look at, so the numbers include all the per-element
+ * overhead of the real parsers but none of their editor work.
+ */
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_string.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_time.h"
+
+#include "../../subversion/libsvn_ra_serf/ra_serf.h"
+
+#include "svn_private_config.h"
+
+enum {
+  INITIAL = XML_STATE_INITIAL,
+  ELEMENT
+};
+
+static const svn_ra_serf__xml_transition_t bench_ttable[] = {
+  { INITIAL, "", "*", ELEMENT,
+    FALSE, { NULL }, FALSE },
+
+  { ELEMENT, "", "*", ELEMENT,
+    TRUE, { "?name", "?rev", "?revision", "?sha1-checksum",
+            "?base-checksum", "?copyfrom-path", "?copyfrom-rev",
+            "?encoding", NULL }, TRUE },
+
+  { 0 }
+};
+
+/* Statistics collected by the callbacks below. */
+typedef struct bench_baton_t
+{
+  apr_int64_t elements;
+  apr_int64_t attributes;
+} bench_baton_t;
+
+/* Conforms to svn_ra_serf__xml_closed_t  */
+static svn_error_t *
+bench_closed(svn_ra_serf__xml_estate_t *xes,
+             void *baton,
+             int leaving_state,
+             const svn_string_t *cdata,
+             apr_hash_t *attrs,
+             apr_pool_t *scratch_pool)
+{
+  bench_baton_t *b = baton;
+
+  /* Do what the real parsers do for most elements: look at all
+     attributes collected so far.  */
+  b->elements++;
+  b->attributes += apr_hash_count(svn_ra_serf__xml_gather_since(xes,
+                                                                ELEMENT));
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse BODY ITERATIONS times and print the results for FILE_NAME. */
+static svn_error_t *
+bench_file(const char *file_name,
+           const svn_stringbuf_t *body,
+           int iterations,
+           apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  bench_baton_t b = { 0 };
+  apr_time_t start = apr_time_now();
+  apr_interval_time_t elapsed;
+  double seconds;
+  int i;
+
+  for (i = 0; i < iterations; ++i)
+    {
+      svn_ra_serf__xml_context_t *xmlctx;
+
+      svn_pool_clear(iterpool);
+      xmlctx = svn_ra_serf__xml_context_create(bench_ttable, NULL,
+                                               bench_closed, NULL, &b,
+                                               iterpool);
+      SVN_ERR(svn_ra_serf__xml_parse_buffer(xmlctx, body->data, body->len,
+                                            iterpool));
+    }
+
+  elapsed = apr_time_now() - start;
+  seconds = elapsed > 0 ? (double)elapsed / APR_USEC_PER_SEC : 1e-6;
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%s: %d x %" APR_SIZE_T_FMT " bytes, "
+                             "%" APR_INT64_T_FMT " elements, "
+                             "%" APR_INT64_T_FMT " attributes in %.3f s\n"
+                             "  %.1f MB/s, %.0f elements/s\n",
+                             file_name, iterations, body->len,
+                             b.elements / iterations,
+                             b.attributes / iterations, seconds,
+                             (double)body->len * iterations / seconds
+                               / (1024 * 1024),
+                             b.elements / seconds));
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+sub_main(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int iterations = 10;
+  int i = 1;
+
+  if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+      SVN_ERR(svn_cstring_atoi(&iterations, argv[2]));
+      if (iterations < 1)
+        return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                _("Iteration count must be positive"));
+      i = 3;
+    }
+
+  if (i >= argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Usage: ra-serf-xml-bench [-n ITERATIONS] "
+                              "FILE..."));
+
+  for (; i < argc; ++i)
+    {
+      const char *file_name;
+      svn_stringbuf_t *body;
+
+      svn_pool_clear(iterpool);
+      file_name = svn_dirent_internal_style(argv[i], iterpool);
+      SVN_ERR(svn_stringbuf_from_file2(&body, file_name, iterpool));
+      SVN_ERR(bench_file(argv[i], body, iterations, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+int main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("ra-serf-xml-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "ra-serf-xml-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}
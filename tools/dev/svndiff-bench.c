@@ -0,0 +1,271 @@
+/* svndiff-bench.c -- compare the svndiff formats on a series of files
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Treat the files given on the command line as consecutive versions of
+ * the same file, deltify each of them against its predecessor the way
+ * FSFS does during a commit (the first one against the empty text) and
+ * report, for each svndiff format:
+ *
+ *   size    total size of the svndiff data, i.e. what the repository
+ *           would store for these versions
+ *   encode  time spent deltifying and encoding
+ *   decode  time spent parsing and applying the deltas
+ *
+ * svndiff3 is measured with standard and with large delta windows.
+ */
+
+#include "svn_cmdline.h"
+#include "svn_delta.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_time.h"
+
+#include "private/svn_delta_private.h"
+
+#include "svn_private_config.h"
+
+/* One of the svndiff configurations to compare. */
+typedef struct bench_format_t
+{
+  const char *name;
+  int svndiff_version;
+  int compression_level;
+  svn_boolean_t large_windows;
+} bench_format_t;
+
+static const bench_format_t formats[] =
+{
+  { "svndiff1", 1, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, FALSE },
+  { "svndiff2", 2, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, FALSE },
+  { "svndiff3", 3, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, FALSE },
+  { "svndiff3 (1 MB windows)", 3, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+    TRUE },
+  { NULL }
+};
+
+/* Return the seconds elapsed since START, but never 0. */
+static double
+seconds_since(apr_time_t start)
+{
+  apr_interval_time_t elapsed = apr_time_now() - start;
+
+  return elapsed > 0 ? (double)elapsed / APR_USEC_PER_SEC : 1e-6;
+}
+
+/* Append the svndiff data turning SOURCE into TARGET to SVNDIFF, using
+ * FORMAT.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+encode(svn_stringbuf_t *svndiff,
+       const svn_string_t *source,
+       const svn_string_t *target,
+       const bench_format_t *format,
+       apr_pool_t *scratch_pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  apr_size_t len = target->len;
+
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(svndiff, scratch_pool),
+                          format->svndiff_version, format->compression_level,
+                          scratch_pool);
+  stream = svn_txdelta__target_push(handler, handler_baton,
+                                    svn_stream_from_string(source,
+                                                           scratch_pool),
+                                    svn_txdelta__max_window_size(
+                                      format->large_windows
+                                        ? format->svndiff_version : 0),
+                                    scratch_pool);
+  SVN_ERR(svn_stream_write(stream, target->data, &len));
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* Apply SVNDIFF to SOURCE and verify that the result equals TARGET.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+decode(const svn_stringbuf_t *svndiff,
+       const svn_string_t *source,
+       const svn_string_t *target,
+       apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(target->len,
+                                                        scratch_pool);
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  apr_size_t len = svndiff->len;
+
+  svn_txdelta_apply(svn_stream_from_string(source, scratch_pool),
+                    svn_stream_from_stringbuf(result, scratch_pool),
+                    NULL, NULL, scratch_pool, &handler, &handler_baton);
+  stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE,
+                                     scratch_pool);
+  SVN_ERR(svn_stream_write(stream, svndiff->data, &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  if (!svn_string_compare_stringbuf(target, result))
+    return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
+                            "Delta does not reproduce the target text");
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the benchmark for FORMAT on the file contents TEXTS, ITERATIONS
+ * times, and print the results. */
+static svn_error_t *
+bench_format(const bench_format_t *format,
+             const apr_array_header_t *texts,
+             int iterations,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *deltas = apr_array_make(scratch_pool, texts->nelts,
+                                              sizeof(svn_stringbuf_t *));
+  svn_string_t *empty = svn_string_create_empty(scratch_pool);
+  apr_int64_t text_bytes = 0;
+  apr_int64_t delta_bytes = 0;
+  double encode_seconds, decode_seconds;
+  apr_time_t start;
+  int i, n;
+
+  for (i = 0; i < texts->nelts; i++)
+    {
+      text_bytes += APR_ARRAY_IDX(texts, i, svn_string_t *)->len;
+      APR_ARRAY_PUSH(deltas, svn_stringbuf_t *)
+        = svn_stringbuf_create_empty(scratch_pool);
+    }
+
+  start = apr_time_now();
+  for (n = 0; n < iterations; n++)
+    for (i = 0; i < texts->nelts; i++)
+      {
+        svn_stringbuf_t *svndiff = APR_ARRAY_IDX(deltas, i,
+                                                 svn_stringbuf_t *);
+
+        svn_pool_clear(iterpool);
+        svn_stringbuf_setempty(svndiff);
+        SVN_ERR(encode(svndiff,
+                       i ? APR_ARRAY_IDX(texts, i - 1, svn_string_t *)
+                         : empty,
+                       APR_ARRAY_IDX(texts, i, svn_string_t *),
+                       format, iterpool));
+      }
+  encode_seconds = seconds_since(start);
+
+  start = apr_time_now();
+  for (n = 0; n < iterations; n++)
+    for (i = 0; i < texts->nelts; i++)
+      {
+        svn_pool_clear(iterpool);
+        SVN_ERR(decode(APR_ARRAY_IDX(deltas, i, svn_stringbuf_t *),
+                       i ? APR_ARRAY_IDX(texts, i - 1, svn_string_t *)
+                         : empty,
+                       APR_ARRAY_IDX(texts, i, svn_string_t *),
+                       iterpool));
+      }
+  decode_seconds = seconds_since(start);
+
+  for (i = 0; i < deltas->nelts; i++)
+    delta_bytes += APR_ARRAY_IDX(deltas, i, svn_stringbuf_t *)->len;
+
+  SVN_ERR(svn_cmdline_printf(iterpool,
+                             "%s:\n"
+                             "  size   %12" APR_INT64_T_FMT " bytes"
+                             " (%.1f%% of the texts)\n"
+                             "  encode %12.3f s  %8.1f MB/s\n"
+                             "  decode %12.3f s  %8.1f MB/s\n",
+                             format->name, delta_bytes,
+                             text_bytes ? 100.0 * delta_bytes / text_bytes
+                                        : 100.0,
+                             encode_seconds,
+                             (double)text_bytes * iterations
+                               / encode_seconds / (1024 * 1024),
+                             decode_seconds,
+                             (double)text_bytes * iterations
+                               / decode_seconds / (1024 * 1024)));
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+sub_main(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_array_header_t *texts;
+  const bench_format_t *format;
+  int iterations = 10;
+  int i = 1;
+
+  if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+      SVN_ERR(svn_cstring_atoi(&iterations, argv[2]));
+      if (iterations < 1)
+        return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                _("Iteration count must be positive"));
+      i = 3;
+    }
+
+  if (i >= argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Usage: svndiff-bench [-n ITERATIONS] "
+                              "FILE..."));
+
+  texts = apr_array_make(pool, argc - i, sizeof(svn_string_t *));
+  for (; i < argc; i++)
+    {
+      svn_stringbuf_t *text;
+
+      SVN_ERR(svn_stringbuf_from_file2(&text,
+                                       svn_dirent_internal_style(argv[i],
+                                                                 pool),
+                                       pool));
+      APR_ARRAY_PUSH(texts, svn_string_t *)
+        = svn_string_create_from_buf(text, pool);
+    }
+
+  for (format = formats; format->name; format++)
+    SVN_ERR(bench_format(format, texts, iterations, pool));
+
+  return SVN_NO_ERROR;
+}
+
+int main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("svndiff-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "svndiff-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,290 @@
+/* svn-wc-pristine-bench.c -- compare plain and compressed pristine stores
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Store a set of files in the pristine store of two scratch working
+ * copies, one of them with 'compress-pristines' enabled, and time the
+ * pristine store operations that 'svn diff' and 'svn revert' spend most
+ * of their I/O on:
+ *
+ *   diff    read each pristine text and compare it with the file
+ *   revert  copy each pristine text to a new file, like the work queue
+ *           does when it installs a working file
+ *
+ * Run it with a cold page cache to include the effect of the smaller
+ * compressed files on disk I/O.
+ */
+
+#include "svn_cmdline.h"
+#include "svn_config.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_time.h"
+#include "svn_wc.h"
+
+#include "../../../subversion/libsvn_wc/wc.h"
+#include "../../../subversion/libsvn_wc/wc_db.h"
+
+#include "svn_private_config.h"
+
+/* One file given on the command line, and its pristine text. */
+typedef struct bench_file_t
+{
+  const char *abspath;
+  svn_checksum_t *sha1;
+  svn_filesize_t size;
+} bench_file_t;
+
+/* Return the seconds elapsed since START, but never 0. */
+static double
+seconds_since(apr_time_t start)
+{
+  apr_interval_time_t elapsed = apr_time_now() - start;
+
+  return elapsed > 0 ? (double)elapsed / APR_USEC_PER_SEC : 1e-6;
+}
+
+/* Print the throughput for processing BYTES in SECONDS for OPERATION. */
+static svn_error_t *
+print_rate(const char *operation,
+           apr_int64_t bytes,
+           double seconds,
+           apr_pool_t *scratch_pool)
+{
+  return svn_cmdline_printf(scratch_pool, "  %-8s %8.3f s  %8.1f MB/s\n",
+                            operation, seconds,
+                            (double)bytes / seconds / (1024 * 1024));
+}
+
+/* Create a working copy at WC_ABSPATH, store all FILES in its pristine
+ * store, with or without COMPRESS, and time the operations described
+ * above ITERATIONS times. */
+static svn_error_t *
+bench_store(const char *wc_abspath,
+            svn_boolean_t compress,
+            apr_array_header_t *files,
+            int iterations,
+            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_wc_context_t *wc_ctx;
+  svn_config_t *config;
+  svn_wc__db_t *db;
+  apr_int64_t text_bytes = 0;
+  apr_int64_t disk_bytes = 0;
+  apr_time_t start;
+  double diff_seconds, revert_seconds;
+  int i, n;
+
+  SVN_ERR(svn_io_remove_dir2(wc_abspath, TRUE, NULL, NULL, scratch_pool));
+  SVN_ERR(svn_io_make_dir_recursively(wc_abspath, scratch_pool));
+  SVN_ERR(svn_wc_context_create(&wc_ctx, NULL, scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc_ensure_adm4(wc_ctx, wc_abspath, "file:///bench",
+                             "file:///bench",
+                             "00000000-0000-0000-0000-000000000000",
+                             0, svn_depth_infinity, scratch_pool));
+  SVN_ERR(svn_wc_context_destroy(wc_ctx));
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, scratch_pool));
+  svn_config_set_bool(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                      SVN_CONFIG_OPTION_COMPRESS_PRISTINES, compress);
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, TRUE,
+                          scratch_pool, scratch_pool));
+
+  /* Compression needs the optional working copy format. */
+  if (compress)
+    {
+      int format;
+
+      SVN_ERR(svn_wc__db_bump_format(&format, NULL, db, wc_abspath,
+                                     scratch_pool));
+    }
+
+  for (i = 0; i < files->nelts; i++)
+    text_bytes += APR_ARRAY_IDX(files, i, bench_file_t *)->size;
+
+  /* Fill the store. */
+  start = apr_time_now();
+  for (i = 0; i < files->nelts; i++)
+    {
+      bench_file_t *file = APR_ARRAY_IDX(files, i, bench_file_t *);
+      svn_wc__db_install_data_t *install_data;
+      svn_stream_t *src, *dst;
+      svn_checksum_t *md5;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_open_readonly(&src, file->abspath,
+                                       iterpool, iterpool));
+      SVN_ERR(svn_wc__db_pristine_prepare_install(&dst, &install_data,
+                                                  &file->sha1, &md5,
+                                                  db, wc_abspath,
+                                                  scratch_pool, iterpool));
+      SVN_ERR(svn_stream_copy3(src, dst, NULL, NULL, iterpool));
+      SVN_ERR(svn_wc__db_pristine_install(install_data, file->sha1, md5,
+                                          iterpool));
+    }
+  SVN_ERR(print_rate("install", text_bytes, seconds_since(start),
+                     iterpool));
+
+  for (i = 0; i < files->nelts; i++)
+    {
+      bench_file_t *file = APR_ARRAY_IDX(files, i, bench_file_t *);
+      const char *pristine_abspath;
+      apr_finfo_t finfo;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_wc__db_pristine_get_future_path(&pristine_abspath,
+                                                  wc_abspath, file->sha1,
+                                                  iterpool, iterpool));
+      SVN_ERR(svn_io_stat(&finfo, pristine_abspath, APR_FINFO_SIZE,
+                          iterpool));
+      disk_bytes += finfo.size;
+    }
+
+  /* 'svn diff': compare each pristine text with its file. */
+  start = apr_time_now();
+  for (n = 0; n < iterations; n++)
+    for (i = 0; i < files->nelts; i++)
+      {
+        bench_file_t *file = APR_ARRAY_IDX(files, i, bench_file_t *);
+        svn_stream_t *pristine, *working;
+        svn_boolean_t same;
+
+        svn_pool_clear(iterpool);
+        SVN_ERR(svn_wc__db_pristine_read(&pristine, NULL, db, wc_abspath,
+                                         file->sha1, iterpool, iterpool));
+        SVN_ERR(svn_stream_open_readonly(&working, file->abspath,
+                                         iterpool, iterpool));
+        SVN_ERR(svn_stream_contents_same2(&same, pristine, working,
+                                          iterpool));
+        if (!same)
+          return svn_error_createf(SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
+                                   "Pristine text of '%s' differs",
+                                   svn_dirent_local_style(file->abspath,
+                                                          iterpool));
+      }
+  diff_seconds = seconds_since(start);
+
+  /* 'svn revert': write each pristine text to a new file. */
+  start = apr_time_now();
+  for (n = 0; n < iterations; n++)
+    for (i = 0; i < files->nelts; i++)
+      {
+        bench_file_t *file = APR_ARRAY_IDX(files, i, bench_file_t *);
+        svn_stream_t *pristine, *working;
+
+        svn_pool_clear(iterpool);
+        SVN_ERR(svn_wc__db_pristine_read(&pristine, NULL, db, wc_abspath,
+                                         file->sha1, iterpool, iterpool));
+        SVN_ERR(svn_stream_open_unique(&working, NULL, wc_abspath,
+                                       svn_io_file_del_on_pool_cleanup,
+                                       iterpool, iterpool));
+        SVN_ERR(svn_stream_copy3(pristine, working, NULL, NULL, iterpool));
+      }
+  revert_seconds = seconds_since(start);
+
+  SVN_ERR(print_rate("diff", text_bytes * iterations, diff_seconds,
+                     iterpool));
+  SVN_ERR(print_rate("revert", text_bytes * iterations, revert_seconds,
+                     iterpool));
+  SVN_ERR(svn_cmdline_printf(iterpool,
+                             "  %" APR_INT64_T_FMT " bytes of text use %"
+                             APR_INT64_T_FMT " bytes on disk (%.0f%%)\n",
+                             text_bytes, disk_bytes,
+                             text_bytes ? 100.0 * disk_bytes / text_bytes
+                                        : 100.0));
+
+  SVN_ERR(svn_wc__db_close(db));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+sub_main(int argc, const char *argv[], apr_pool_t *pool)
+{
+  apr_array_header_t *files;
+  const char *dir_abspath;
+  int iterations = 10;
+  int i = 1;
+
+  if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+      SVN_ERR(svn_cstring_atoi(&iterations, argv[2]));
+      if (iterations < 1)
+        return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                _("Iteration count must be positive"));
+      i = 3;
+    }
+
+  if (i + 1 >= argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Usage: svn-wc-pristine-bench [-n ITERATIONS] "
+                              "SCRATCH-DIR FILE..."));
+
+  SVN_ERR(svn_dirent_get_absolute(&dir_abspath,
+                                  svn_dirent_internal_style(argv[i++], pool),
+                                  pool));
+
+  files = apr_array_make(pool, argc - i, sizeof(bench_file_t *));
+  for (; i < argc; i++)
+    {
+      bench_file_t *file = apr_pcalloc(pool, sizeof(*file));
+      apr_finfo_t finfo;
+
+      SVN_ERR(svn_dirent_get_absolute(&file->abspath,
+                                      svn_dirent_internal_style(argv[i],
+                                                                pool),
+                                      pool));
+      SVN_ERR(svn_io_stat(&finfo, file->abspath, APR_FINFO_SIZE, pool));
+      file->size = finfo.size;
+      APR_ARRAY_PUSH(files, bench_file_t *) = file;
+    }
+
+  SVN_ERR(svn_cmdline_printf(pool, "uncompressed:\n"));
+  SVN_ERR(bench_store(svn_dirent_join(dir_abspath, "plain", pool), FALSE,
+                      files, iterations, pool));
+  SVN_ERR(svn_cmdline_printf(pool, "lz4:\n"));
+  SVN_ERR(bench_store(svn_dirent_join(dir_abspath, "lz4", pool), TRUE,
+                      files, iterations, pool));
+
+  return SVN_NO_ERROR;
+}
+
+int main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("svn-wc-pristine-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool,
+                                         "svn-wc-pristine-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}